@@ -23,6 +23,31 @@
 #include "miniz-cpp/zip_file.hpp"
 #include "filesystem.hpp"
 
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#if defined(_MSC_VER) || defined(_WIN32) || defined(__MINGW32__)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/file.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
 /// Main namespace for the fmu-forge package
 namespace fmu_forge {
 
@@ -32,33 +57,454 @@ namespace fmu_forge {
 /// Enumeration of supported FMI standard versions.
 enum class FmuVersion { FMI2, FMI3 };
 
+/// Extract the entries of the given FMU archive in the specified (existing) directory.
+/// Entries are decompressed one at a time directly from the archive file, without loading it in memory.
+/// If a prefix is given (e.g. "resources/"), only the entries whose path starts with it are extracted.
+/// Returns the number of extracted entries.
+size_t ExtractFmuArchive(const std::string& fmufilename, const std::string& unzipdir, const std::string& prefix = "") {
+    mz_zip_archive zip;
+    std::memset(&zip, 0, sizeof(zip));
+    if (!mz_zip_reader_init_file(&zip, fmufilename.c_str(), 0))
+        throw std::runtime_error("Cannot open FMU archive: " + fmufilename + "\n");
+
+    size_t num_extracted = 0;
+    mz_uint num_files = mz_zip_reader_get_num_files(&zip);
+    for (mz_uint i = 0; i < num_files; i++) {
+        mz_zip_archive_file_stat stat;
+        if (!mz_zip_reader_file_stat(&zip, i, &stat)) {
+            mz_zip_reader_end(&zip);
+            throw std::runtime_error("Corrupted entry in FMU archive: " + fmufilename + "\n");
+        }
+        if (std::strncmp(stat.m_filename, prefix.c_str(), prefix.size()) != 0)
+            continue;
+        num_extracted++;
+
+        fs::path target = fs::path(unzipdir) / stat.m_filename;
+        if (mz_zip_reader_is_file_a_directory(&zip, i)) {
+            fs::create_directories(target);
+            continue;
+        }
+
+        fs::create_directories(target.parent_path());
+        if (!mz_zip_reader_extract_to_file(&zip, i, target.generic_string().c_str(), 0)) {
+            mz_zip_reader_end(&zip);
+            throw std::runtime_error("Cannot extract " + std::string(stat.m_filename) + " from FMU archive: " +
+                                     fmufilename + "\n");
+        }
+    }
+
+    mz_zip_reader_end(&zip);
+    return num_extracted;
+}
+
 /// Extract the given FMU in the specified directory.
 void UnzipFmu(const std::string& fmufilename, const std::string& unzipdir) {
     std::error_code ec;
     fs::remove_all(unzipdir, ec);
     fs::create_directories(unzipdir);
-    miniz_cpp::zip_file zipfile(fmufilename);
-    zipfile.extractall(unzipdir);
+    ExtractFmuArchive(fmufilename, unzipdir);
+}
+
+/// Read a single entry of the given FMU archive in memory, without extracting the archive.
+/// The returned buffer is null-terminated, so that it can be directly handed to rapidxml for in-place parsing.
+std::vector<char> ReadFmuArchiveEntry(const std::string& fmufilename, const std::string& entry) {
+    mz_zip_archive zip;
+    std::memset(&zip, 0, sizeof(zip));
+    if (!mz_zip_reader_init_file(&zip, fmufilename.c_str(), 0))
+        throw std::runtime_error("Cannot open FMU archive: " + fmufilename + "\n");
+
+    size_t size = 0;
+    void* data = mz_zip_reader_extract_file_to_heap(&zip, entry.c_str(), &size, 0);
+    mz_zip_reader_end(&zip);
+    if (!data)
+        throw std::runtime_error("Cannot find " + entry + " in FMU archive: " + fmufilename + "\n");
+
+    std::vector<char> buffer(size + 1);
+    std::memcpy(buffer.data(), data, size);
+    buffer[size] = '\0';
+    mz_free(data);
+    return buffer;
+}
+
+/// Compute the 64-bit FNV-1a hash of the given bytes, optionally continuing from a previous hash value.
+uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t b = 0; b < size; b++) {
+        hash ^= bytes[b];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/// Compute a key identifying the content of the given FMU archive.
+/// The key is a 64-bit FNV-1a hash of the central directory (entry names, CRC-32 and uncompressed sizes), hence it
+/// changes whenever any packed file changes, but it can be computed without decompressing the archive.
+std::string GetFmuArchiveKey(const std::string& fmufilename) {
+    mz_zip_archive zip;
+    std::memset(&zip, 0, sizeof(zip));
+    if (!mz_zip_reader_init_file(&zip, fmufilename.c_str(), 0))
+        throw std::runtime_error("Cannot open FMU archive: " + fmufilename + "\n");
+
+    uint64_t hash = HashBytes(nullptr, 0);
+    auto mix = [&hash](const void* data, size_t size) { hash = HashBytes(data, size, hash); };
+
+    mz_uint num_files = mz_zip_reader_get_num_files(&zip);
+    for (mz_uint i = 0; i < num_files; i++) {
+        mz_zip_archive_file_stat stat;
+        if (!mz_zip_reader_file_stat(&zip, i, &stat)) {
+            mz_zip_reader_end(&zip);
+            throw std::runtime_error("Corrupted entry in FMU archive: " + fmufilename + "\n");
+        }
+        uint32_t crc = stat.m_crc32;
+        uint64_t size = stat.m_uncomp_size;
+        mix(stat.m_filename, std::strlen(stat.m_filename) + 1);
+        mix(&crc, sizeof(crc));
+        mix(&size, sizeof(size));
+    }
+    mz_zip_reader_end(&zip);
+
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+    return std::string(key);
+}
+
+/// Exclusive inter-process lock on a file, held for the lifetime of the object.
+/// The lock file is created if it does not exist; it is advisory and is never removed.
+class FileLock {
+  public:
+    explicit FileLock(const std::string& filename) {
+#ifdef _WIN32
+        m_handle = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL, NULL);
+        if (m_handle == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("Cannot open lock file: " + filename + "\n");
+        OVERLAPPED overlapped = {};
+        if (!LockFileEx(m_handle, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped)) {
+            CloseHandle(m_handle);
+            throw std::runtime_error("Cannot acquire lock on file: " + filename + "\n");
+        }
+#else
+        m_fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0666);
+        if (m_fd < 0)
+            throw std::runtime_error("Cannot open lock file: " + filename + "\n");
+        int res;
+        while ((res = ::flock(m_fd, LOCK_EX)) != 0 && errno == EINTR) {
+        }
+        if (res != 0) {
+            ::close(m_fd);
+            throw std::runtime_error("Cannot acquire lock on file: " + filename + "\n");
+        }
+#endif
+    }
+
+    ~FileLock() {
+#ifdef _WIN32
+        OVERLAPPED overlapped = {};
+        UnlockFileEx(m_handle, 0, MAXDWORD, MAXDWORD, &overlapped);
+        CloseHandle(m_handle);
+#else
+        ::flock(m_fd, LOCK_UN);
+        ::close(m_fd);
+#endif
+    }
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+  private:
+#ifdef _WIN32
+    HANDLE m_handle;
+#else
+    int m_fd;
+#endif
+};
+
+/// Extract the given FMU in a persistent, content-addressed cache and return the extraction directory.
+/// Archives with the same content (see GetFmuArchiveKey) share the same extracted tree, which is reused by all later
+/// calls, also from other processes. The tree is populated in a staging directory, under an inter-process lock, and
+/// then atomically renamed in place, so that a cache directory is either complete or not there at all.
+/// The extracted files are shared and must be treated as read-only.
+std::string UnzipFmuCached(const std::string& fmufilename,
+                           const std::string& cachedir = fs::temp_directory_path().generic_string() +
+                                                         std::string("/_fmu_cache")) {
+    std::string target = cachedir + "/" + GetFmuArchiveKey(fmufilename);
+
+    // Fast path: published trees are always complete
+    std::error_code ec;
+    if (fs::is_directory(target, ec))
+        return target;
+
+    fs::create_directories(cachedir);
+    FileLock lock(target + ".lock");
+
+    // Another process may have populated the cache while waiting for the lock
+    if (fs::is_directory(target, ec))
+        return target;
+
+    // The staging directory is private to the lock holder; leftovers of an interrupted extraction are discarded
+    std::string staging = target + ".staging";
+    fs::remove_all(staging, ec);
+    fs::create_directories(staging);
+    try {
+        ExtractFmuArchive(fmufilename, staging);
+        fs::rename(staging, target);
+    } catch (std::exception&) {
+        fs::remove_all(staging, ec);
+        throw;
+    }
+
+    return target;
+}
+
+/// Read-only content of a whole file, memory-mapped whenever possible.
+/// The content is always followed by a null character, as required by rapidxml. This comes for free from the zero
+/// padding of the last mapped page, unless the file size is an exact multiple of the page size: in that case (and
+/// for empty files) the file is read into a buffer instead.
+class MappedFile {
+  public:
+    explicit MappedFile(const std::string& filename) : m_data(nullptr), m_size(0), m_mapped(false) {
+#ifdef _WIN32
+        m_file = INVALID_HANDLE_VALUE;
+        m_mapping = NULL;
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                  FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("Cannot find file: " + filename + "\n");
+        LARGE_INTEGER file_size;
+        SYSTEM_INFO sys_info;
+        GetSystemInfo(&sys_info);
+        if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0 &&
+            file_size.QuadPart % sys_info.dwPageSize != 0) {
+            HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+            if (view) {
+                m_file = file;
+                m_mapping = mapping;
+                m_data = static_cast<const char*>(view);
+                m_size = static_cast<size_t>(file_size.QuadPart);
+                m_mapped = true;
+                return;
+            }
+            if (mapping)
+                CloseHandle(mapping);
+        }
+        CloseHandle(file);
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Cannot find file: " + filename + "\n");
+        struct stat st;
+        long page_size = ::sysconf(_SC_PAGESIZE);
+        if (::fstat(fd, &st) == 0 && st.st_size > 0 && page_size > 0 && st.st_size % page_size != 0) {
+            void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                ::close(fd);
+                m_data = static_cast<const char*>(addr);
+                m_size = static_cast<size_t>(st.st_size);
+                m_mapped = true;
+                return;
+            }
+        }
+        ::close(fd);
+#endif
+
+        // Fallback: read the file in a null-terminated buffer
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.good())
+            throw std::runtime_error("Cannot find file: " + filename + "\n");
+        m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        m_size = m_buffer.size();
+        m_buffer.push_back('\0');
+        m_data = m_buffer.data();
+    }
+
+    ~MappedFile() {
+        if (!m_mapped)
+            return;
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+        CloseHandle(m_mapping);
+        CloseHandle(m_file);
+#else
+        ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// Return the (null-terminated) file content.
+    const char* data() const { return m_data; }
+
+    /// Return the size of the file, excluding the terminating null character.
+    size_t size() const { return m_size; }
+
+    /// Return true if the file is memory-mapped, false if it has been read into a buffer.
+    bool IsMapped() const { return m_mapped; }
+
+  private:
+    const char* m_data;
+    size_t m_size;
+    bool m_mapped;
+    std::vector<char> m_buffer;
+#ifdef _WIN32
+    HANDLE m_file;
+    HANDLE m_mapping;
+#endif
+};
+
+/// Writer of a compact binary stream of trivially copyable values and strings (native byte order).
+class BinaryWriter {
+  public:
+    template <typename T>
+    void Write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "BinaryWriter only accepts trivially copyable types");
+        m_data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void WriteString(const std::string& str) {
+        Write(static_cast<uint32_t>(str.size()));
+        m_data.append(str);
+    }
+
+    /// Return the stream content.
+    const std::string& GetData() const { return m_data; }
+
+  private:
+    std::string m_data;
+};
+
+/// Reader of a binary stream written by BinaryWriter.
+/// Reads are bounds-checked: reading past the end of the stream throws an exception.
+class BinaryReader {
+  public:
+    BinaryReader(const char* data, size_t size) : m_pos(data), m_end(data + size) {}
+
+    template <typename T>
+    T Read() {
+        static_assert(std::is_trivially_copyable<T>::value, "BinaryReader only accepts trivially copyable types");
+        T value;
+        checkAvailable(sizeof(T));
+        std::memcpy(&value, m_pos, sizeof(T));
+        m_pos += sizeof(T);
+        return value;
+    }
+
+    std::string ReadString() {
+        uint32_t size = Read<uint32_t>();
+        checkAvailable(size);
+        std::string str(m_pos, size);
+        m_pos += size;
+        return str;
+    }
+
+    /// Return true if the whole stream has been read.
+    bool AtEnd() const { return m_pos == m_end; }
+
+  private:
+    void checkAvailable(size_t size) const {
+        if (static_cast<size_t>(m_end - m_pos) < size)
+            throw std::runtime_error("Unexpected end of binary stream.");
+    }
+
+    const char* m_pos;
+    const char* m_end;
+};
+
+/// Return the value of an XML attribute parsed in non-destructive mode (rapidxml::parse_non_destructive).
+/// In such mode values are neither null-terminated nor entity-translated: the value is copied and the predefined and
+/// numeric character references are expanded.
+std::string XmlString(const rapidxml::xml_base<>* item) {
+    const char* text = item->value();
+    size_t size = item->value_size();
+    if (!std::memchr(text, '&', size))
+        return std::string(text, size);
+
+    std::string result;
+    result.reserve(size);
+    for (size_t i = 0; i < size; i++) {
+        if (text[i] != '&') {
+            result.push_back(text[i]);
+            continue;
+        }
+
+        const char* ent = text + i + 1;
+        const char* end = static_cast<const char*>(std::memchr(ent, ';', size - i - 1));
+        if (!end) {
+            result.append(text + i, size - i);
+            break;
+        }
+        size_t len = static_cast<size_t>(end - ent);
+        if (len == 2 && std::memcmp(ent, "lt", 2) == 0)
+            result.push_back('<');
+        else if (len == 2 && std::memcmp(ent, "gt", 2) == 0)
+            result.push_back('>');
+        else if (len == 3 && std::memcmp(ent, "amp", 3) == 0)
+            result.push_back('&');
+        else if (len == 4 && std::memcmp(ent, "quot", 4) == 0)
+            result.push_back('"');
+        else if (len == 4 && std::memcmp(ent, "apos", 4) == 0)
+            result.push_back('\'');
+        else if (len > 1 && ent[0] == '#') {
+            unsigned long code =
+                ent[1] == 'x' ? std::strtoul(ent + 2, nullptr, 16) : std::strtoul(ent + 1, nullptr, 10);
+            // UTF-8 encoding of the code point
+            if (code < 0x80) {
+                result.push_back(static_cast<char>(code));
+            } else if (code < 0x800) {
+                result.push_back(static_cast<char>(0xC0 | (code >> 6)));
+                result.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+            } else if (code < 0x10000) {
+                result.push_back(static_cast<char>(0xE0 | (code >> 12)));
+                result.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                result.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+            } else {
+                result.push_back(static_cast<char>(0xF0 | (code >> 18)));
+                result.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+                result.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                result.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+            }
+        } else {
+            result.append(text + i, end + 1);
+        }
+        i = static_cast<size_t>(end - text);
+    }
+    return result;
+}
+
+/// Check if the value of an XML attribute parsed in non-destructive mode is equal to the given string.
+bool XmlEquals(const rapidxml::xml_base<>* item, const char* str) {
+    size_t len = std::strlen(str);
+    return item->value_size() == len && std::strncmp(item->value(), str, len) == 0;
+}
+
+/// Convert the value of an XML attribute parsed in non-destructive mode to an unsigned integer.
+/// Throws an exception if the value is not a valid unsigned integer.
+unsigned long long XmlToUnsigned(const rapidxml::xml_base<>* item) {
+    const char* text = item->value();
+    size_t size = item->value_size();
+    if (size == 0)
+        throw std::runtime_error("Empty value where an unsigned integer is expected in XML.");
+
+    unsigned long long value = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (text[i] < '0' || text[i] > '9')
+            throw std::runtime_error("Invalid unsigned integer in XML: " + std::string(text, size));
+        value = value * 10 + static_cast<unsigned long long>(text[i] - '0');
+    }
+    return value;
 }
 
 /// Get the FMI version (2.0 or 3.0) from the model description file of the specified FMU.
+/// Only the model description is read from the archive; the FMU is not extracted.
 FmuVersion GetFmuVersion(const std::string& fmufilename) {
-    // Unzip FMU archive in temporary directory
-    std::string unzipdir = fs::temp_directory_path().generic_string() + std::string("/fmu_ver_temp");
-    UnzipFmu(fmufilename, unzipdir);
-
-    // Open model description XML
-    std::string xml_filename = unzipdir + "/modelDescription.xml";
-    std::ifstream file(xml_filename);
-    if (!file.good())
-        throw std::runtime_error("Cannot find file: " + xml_filename + "\n");
-
-    rapidxml::xml_document<>* doc_ptr = new rapidxml::xml_document<>();
-    std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    buffer.push_back('\0');
-    doc_ptr->parse<0>(&buffer[0]);
-
-    auto root_node = doc_ptr->first_node("fmiModelDescription");
+    std::vector<char> buffer = ReadFmuArchiveEntry(fmufilename, "modelDescription.xml");
+
+    rapidxml::xml_document<> doc;
+    doc.parse<0>(&buffer[0]);
+
+    auto root_node = doc.first_node("fmiModelDescription");
     if (!root_node)
         throw std::runtime_error("Not a valid FMU. Missing <fmiModelDescription> node in XML. \n");
 
@@ -33,6 +33,11 @@
 #else
     #include <dlfcn.h>
     #include <limits.h>
+    #include <stdlib.h>
+    #include <unistd.h>
+    #if defined(__linux__)
+        #include <sys/syscall.h>
+    #endif
     #define DYNLIB_HANDLE void*
     #define get_function_ptr dlsym
 #endif
@@ -45,6 +50,8 @@ namespace fmu_forge {
 /// @{
 
 /// Runtime/Dynamic linking of shared library.
+/// On Windows the directory is added to the DLL search path; elsewhere it is used to locate the library when its name
+/// is given without a path.
 /// @param dynlib_dir The directory where the shared library is located.
 /// @param dynlib_name The name of the shared library.
 DYNLIB_HANDLE RuntimeLinkLibrary(const std::string& dynlib_dir, const std::string& dynlib_name) {
@@ -68,7 +75,79 @@ DYNLIB_HANDLE RuntimeLinkLibrary(const std::string& dynlib_dir, const std::strin
 
     return dynlib_handle;
 #else
-    return dlopen(dynlib_name.c_str(), RTLD_LAZY);
+    if (dynlib_dir.empty() || dynlib_name.find('/') != std::string::npos)
+        return dlopen(dynlib_name.c_str(), RTLD_LAZY);
+
+    std::string dynlib_path = dynlib_dir;
+    if (dynlib_path.back() != '/')
+        dynlib_path += "/";
+    return dlopen((dynlib_path + dynlib_name).c_str(), RTLD_LAZY);
+#endif
+}
+
+/// Runtime/Dynamic linking of a shared library whose image is in memory (e.g. read directly from an FMU archive).
+/// On Linux the image is copied to an anonymous in-memory file (memfd_create) and loaded through /proc/self/fd, so that
+/// nothing is written to disk; the file descriptor is kept open for the lifetime of the process, as the library is
+/// never unloaded. Elsewhere (or if memfd_create is not available) the image is written to a temporary file which is
+/// loaded and then removed on POSIX systems; on Windows, where a loaded DLL cannot be deleted, the temporary file is
+/// left in the temporary folder.
+/// Returns a null handle on failure.
+/// @param data The image of the shared library.
+/// @param size The size of the image, in bytes.
+/// @param name The name of the shared library (used to name the in-memory or temporary file).
+DYNLIB_HANDLE RuntimeLinkLibraryFromMemory(const void* data, size_t size, const std::string& name) {
+#ifdef _WIN32
+    char temp_dir[MAX_PATH];
+    if (!GetTempPathA(MAX_PATH, temp_dir))
+        return NULL;
+    static long counter = 0;
+    std::string filename = std::string(temp_dir) + "fmu_forge_" + std::to_string(GetCurrentProcessId()) + "_" +
+                           std::to_string(InterlockedIncrement(&counter)) + "_" + name;
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+    DWORD written = 0;
+    bool ok = WriteFile(file, data, static_cast<DWORD>(size), &written, NULL) && written == size;
+    CloseHandle(file);
+    if (!ok)
+        return NULL;
+    return LoadLibraryA(filename.c_str());
+#else
+    auto write_all = [data, size](int fd) {
+        const char* bytes = static_cast<const char*>(data);
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::write(fd, bytes + done, size - done);
+            if (n <= 0)
+                return false;
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    };
+
+    #if defined(__linux__) && defined(SYS_memfd_create)
+    int memfd = static_cast<int>(::syscall(SYS_memfd_create, name.c_str(), 0));
+    if (memfd >= 0) {
+        if (write_all(memfd)) {
+            std::string fd_path = "/proc/self/fd/" + std::to_string(memfd);
+            DYNLIB_HANDLE handle = dlopen(fd_path.c_str(), RTLD_LAZY);
+            if (handle)
+                return handle;  // the descriptor stays open: its path identifies the library for dlopen
+        }
+        ::close(memfd);
+    }
+    #endif
+
+    // Fallback: temporary file, removed as soon as it is loaded
+    std::string filename = (fs::temp_directory_path() / ("fmu_forge_XXXXXX_" + name)).string();
+    int fd = ::mkstemps(&filename[0], static_cast<int>(name.size()) + 1);
+    if (fd < 0)
+        return nullptr;
+    bool ok = write_all(fd);
+    ::close(fd);
+    DYNLIB_HANDLE handle = ok ? dlopen(filename.c_str(), RTLD_LAZY) : nullptr;
+    ::unlink(filename.c_str());
+    return handle;
 #endif
 }
 
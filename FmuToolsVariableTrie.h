@@ -0,0 +1,328 @@
+// =============================================================================
+// fmu-forge
+//
+// Copyright (c) 2024 Project Chrono (projectchrono.org)
+// Copyright (c) 2024 Digital Dynamics Lab, University of Parma, Italy
+// Copyright (c) 2024 Simulation Based Engineering Lab, University of Wisconsin-Madison, USA
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution.
+//
+// =============================================================================
+// Flat trie of the hierarchical names of the FMU variables, independent of FMI version
+// =============================================================================
+
+#ifndef FMUTOOLS_VARIABLE_TRIE_H
+#define FMUTOOLS_VARIABLE_TRIE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fmu_forge {
+
+/// @addtogroup fmu-forge
+/// @{
+
+/// Trie of the variable names, split at the '.' separators.
+/// In the XML one has the flattened list such as for example
+///     myobject.mysubobject.pos
+///     myobject.mysubobject.dir
+/// so the trie will contain:
+///     myobject
+///          mysubobject
+///                pos
+///                dir
+/// Nodes are stored in a single array, in depth-first order with children sorted by name, so that the subtree of a
+/// node (e.g. all variables under "body3.frame_a") is a contiguous range of nodes. Name segments are interned: each
+/// node only stores the index of its segment.
+/// The trie is built in a single pass over the variables (Insert), then sorted once (Finalize).
+template <class Leaf>
+class FmuVariableTrie {
+  public:
+    typedef uint32_t NodeId;
+    static const NodeId npos = static_cast<NodeId>(-1);
+
+    struct Node {
+        uint32_t segment;         ///< index of the name segment (see GetSegmentName)
+        NodeId parent;            ///< parent node (npos for the root)
+        NodeId end;               ///< one past the last node of the subtree
+        uint32_t children_begin;  ///< index of the first child in the children array
+        uint32_t num_children;
+        Leaf leaf;  ///< variable whose name ends at this node, if any (default-constructed otherwise)
+    };
+
+    FmuVariableTrie() { Clear(); }
+
+    /// Remove all nodes, leaving only the root.
+    void Clear();
+
+    /// Check if the trie has no variables.
+    bool Empty() const { return m_nodes.size() <= 1; }
+
+    /// Add a variable, creating the nodes of its name as needed.
+    void Insert(const std::string& name, Leaf leaf);
+
+    /// Sort the nodes in depth-first order and release the construction data; to be called once all variables are
+    /// inserted, before any query.
+    void Finalize();
+
+    /// Return the root node (its children are the first segments of the names).
+    NodeId Root() const { return 0; }
+
+    size_t GetNumNodes() const { return m_nodes.size(); }
+    const Node& GetNode(NodeId node) const { return m_nodes[node]; }
+
+    /// Return the name segment of the given node.
+    const std::string& GetSegmentName(NodeId node) const { return m_segments[m_nodes[node].segment]; }
+
+    /// Return the index of a name segment, or npos if no variable name contains it.
+    uint32_t FindSegment(const std::string& segment) const;
+
+    /// Return the full name of the given node (e.g. "myobject.mysubobject").
+    std::string GetPath(NodeId node) const;
+
+    /// Children of the given node, sorted by name.
+    const NodeId* ChildrenBegin(NodeId node) const { return m_children.data() + m_nodes[node].children_begin; }
+    const NodeId* ChildrenEnd(NodeId node) const { return ChildrenBegin(node) + m_nodes[node].num_children; }
+
+    /// Return the child of the given node with the given segment index, or npos.
+    NodeId FindChildSegment(NodeId node, uint32_t segment) const;
+
+    /// Return the child of the given node with the given name segment, or npos.
+    NodeId FindChild(NodeId node, const std::string& segment) const {
+        uint32_t id = FindSegment(segment);
+        return id == npos ? npos : FindChildSegment(node, id);
+    }
+
+    /// Return the node of the given path, relative to 'from' (e.g. "body3.frame_a"), or npos.
+    NodeId Find(const std::string& path, NodeId from = 0) const;
+
+    /// Call 'fun(leaf)' for all variables in the subtree of the given node, including the node itself.
+    template <class Fun>
+    void ForEachLeaf(NodeId node, Fun fun) const;
+
+    /// Return the variables whose name is the given prefix or starts with it, followed by '.'.
+    std::vector<Leaf> GetLeaves(const std::string& prefix) const;
+
+  private:
+    /// Return the index of the segment, adding it if not present.
+    uint32_t internSegment(const std::string& segment);
+
+    std::vector<Node> m_nodes;
+    std::vector<NodeId> m_children;       ///< children of all nodes, contiguous for each node
+    std::vector<std::string> m_segments;  ///< interned name segments (index 0: the empty root segment)
+    std::unordered_map<std::string, uint32_t> m_segmentIds;
+
+    // Construction data, released by Finalize
+    std::unordered_map<uint64_t, NodeId> m_edges;  ///< child by (parent, segment)
+    std::string m_token;                           ///< current segment
+    std::string m_lastName;                        ///< last inserted name
+    std::vector<std::pair<size_t, NodeId>> m_lastPath;  ///< end of each segment of the last name, and its node
+};
+
+// -----------------------------------------------------------------------------
+
+template <class Leaf>
+const typename FmuVariableTrie<Leaf>::NodeId FmuVariableTrie<Leaf>::npos;
+
+template <class Leaf>
+void FmuVariableTrie<Leaf>::Clear() {
+    m_nodes.assign(1, Node{0, npos, 1, 0, 0, Leaf()});
+    m_children.clear();
+    m_segments.assign(1, std::string());
+    m_segmentIds.clear();
+    m_edges.clear();
+    m_lastName.clear();
+    m_lastPath.clear();
+}
+
+template <class Leaf>
+uint32_t FmuVariableTrie<Leaf>::internSegment(const std::string& segment) {
+    auto it = m_segmentIds.find(segment);
+    if (it != m_segmentIds.end())
+        return it->second;
+
+    uint32_t id = static_cast<uint32_t>(m_segments.size());
+    m_segments.push_back(segment);
+    m_segmentIds.emplace(segment, id);
+    return id;
+}
+
+template <class Leaf>
+void FmuVariableTrie<Leaf>::Insert(const std::string& name, Leaf leaf) {
+    // variables of the same object are usually listed together: the segments shared with the last name are not
+    // looked up again
+    size_t common = 0;
+    while (common < name.size() && common < m_lastName.size() && name[common] == m_lastName[common])
+        ++common;
+    while (!m_lastPath.empty() && m_lastPath.back().first >= common)
+        m_lastPath.pop_back();
+
+    NodeId node = m_lastPath.empty() ? Root() : m_lastPath.back().second;
+    size_t begin = m_lastPath.empty() ? 0 : m_lastPath.back().first + 1;
+    while (begin <= name.size()) {
+        size_t end = name.find('.', begin);
+        if (end == std::string::npos)
+            end = name.size();
+
+        // the token buffer keeps its capacity, so that segments are looked up without allocations
+        m_token.assign(name, begin, end - begin);
+        uint32_t segment = internSegment(m_token);
+
+        uint64_t key = (static_cast<uint64_t>(node) << 32) | segment;
+        auto edge = m_edges.find(key);
+        if (edge != m_edges.end()) {
+            node = edge->second;
+        } else {
+            NodeId child = static_cast<NodeId>(m_nodes.size());
+            m_nodes.push_back(Node{segment, node, 0, 0, 0, Leaf()});
+            m_edges.emplace(key, child);
+            node = child;
+        }
+
+        m_lastPath.push_back(std::make_pair(end, node));
+        begin = end + 1;
+    }
+
+    m_nodes[node].leaf = leaf;
+    m_lastName = name;
+}
+
+template <class Leaf>
+void FmuVariableTrie<Leaf>::Finalize() {
+    size_t num_nodes = m_nodes.size();
+
+    // children of each node in insertion order, as offsets in a single array (counting sort on the parent)
+    std::vector<uint32_t> offsets(num_nodes + 1, 0);
+    for (size_t i = 1; i < num_nodes; ++i)
+        ++offsets[m_nodes[i].parent + 1];
+    for (size_t i = 0; i < num_nodes; ++i)
+        offsets[i + 1] += offsets[i];
+    std::vector<NodeId> children(num_nodes > 0 ? num_nodes - 1 : 0);
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 1; i < num_nodes; ++i)
+            children[fill[m_nodes[i].parent]++] = static_cast<NodeId>(i);
+    }
+    for (size_t i = 0; i < num_nodes; ++i) {
+        std::sort(children.begin() + offsets[i], children.begin() + offsets[i + 1], [this](NodeId a, NodeId b) {
+            return m_segments[m_nodes[a].segment] < m_segments[m_nodes[b].segment];
+        });
+    }
+
+    // depth-first renumbering, with an explicit stack
+    std::vector<Node> nodes(num_nodes);
+    std::vector<NodeId> new_id(num_nodes);
+    std::vector<NodeId> stack(1, Root());
+    NodeId next = 0;
+    while (!stack.empty()) {
+        NodeId old_id = stack.back();
+        stack.pop_back();
+        new_id[old_id] = next;
+        Node& node = nodes[next++];
+        node = m_nodes[old_id];
+        node.num_children = offsets[old_id + 1] - offsets[old_id];
+        for (uint32_t c = offsets[old_id + 1]; c > offsets[old_id]; --c)
+            stack.push_back(children[c - 1]);
+    }
+
+    // parents are visited first, then the end of each subtree is propagated up from the last node
+    m_children.resize(children.size());
+    uint32_t children_begin = 0;
+    for (size_t i = 0; i < num_nodes; ++i) {
+        Node& node = nodes[i];
+        if (node.parent != npos)
+            node.parent = new_id[node.parent];
+        node.end = static_cast<NodeId>(i + 1);
+        node.children_begin = children_begin;
+        children_begin += node.num_children;
+    }
+    for (size_t i = num_nodes; i-- > 1;) {
+        Node& parent = nodes[nodes[i].parent];
+        parent.end = std::max(parent.end, nodes[i].end);
+    }
+    std::vector<uint32_t> fill(num_nodes, 0);
+    for (size_t i = 1; i < num_nodes; ++i) {
+        Node& parent = nodes[nodes[i].parent];
+        m_children[parent.children_begin + fill[nodes[i].parent]++] = static_cast<NodeId>(i);
+    }
+
+    m_nodes = std::move(nodes);
+    m_edges = std::unordered_map<uint64_t, NodeId>();
+    m_token = std::string();
+    m_lastName = std::string();
+    m_lastPath = std::vector<std::pair<size_t, NodeId>>();
+}
+
+template <class Leaf>
+uint32_t FmuVariableTrie<Leaf>::FindSegment(const std::string& segment) const {
+    auto it = m_segmentIds.find(segment);
+    return it == m_segmentIds.end() ? npos : it->second;
+}
+
+template <class Leaf>
+std::string FmuVariableTrie<Leaf>::GetPath(NodeId node) const {
+    std::vector<NodeId> path;
+    for (; node != Root() && node != npos; node = m_nodes[node].parent)
+        path.push_back(node);
+
+    std::string name;
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        if (!name.empty())
+            name += '.';
+        name += GetSegmentName(*it);
+    }
+    return name;
+}
+
+template <class Leaf>
+typename FmuVariableTrie<Leaf>::NodeId FmuVariableTrie<Leaf>::FindChildSegment(NodeId node, uint32_t segment) const {
+    for (const NodeId* child = ChildrenBegin(node); child != ChildrenEnd(node); ++child) {
+        if (m_nodes[*child].segment == segment)
+            return *child;
+    }
+    return npos;
+}
+
+template <class Leaf>
+typename FmuVariableTrie<Leaf>::NodeId FmuVariableTrie<Leaf>::Find(const std::string& path, NodeId from) const {
+    NodeId node = from;
+    size_t begin = 0;
+    while (node != npos && begin <= path.size()) {
+        size_t end = path.find('.', begin);
+        if (end == std::string::npos)
+            end = path.size();
+        node = FindChild(node, path.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return node;
+}
+
+template <class Leaf>
+template <class Fun>
+void FmuVariableTrie<Leaf>::ForEachLeaf(NodeId node, Fun fun) const {
+    for (NodeId i = node; i < m_nodes[node].end; ++i) {
+        if (m_nodes[i].leaf != Leaf())
+            fun(m_nodes[i].leaf);
+    }
+}
+
+template <class Leaf>
+std::vector<Leaf> FmuVariableTrie<Leaf>::GetLeaves(const std::string& prefix) const {
+    std::vector<Leaf> leaves;
+    NodeId node = prefix.empty() ? Root() : Find(prefix);
+    if (node != npos)
+        ForEachLeaf(node, [&leaves](const Leaf& leaf) { leaves.push_back(leaf); });
+    return leaves;
+}
+
+/// @} fmu-forge
+
+}  // namespace fmu_forge
+
+#endif
@@ -15,6 +15,9 @@
 
 #include <regex>
 #include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <new>
 
 #include "fmi2/FmuToolsExport.h"
 #include "FmuToolsRuntimeLinking.h"
@@ -132,7 +135,7 @@ FmuVariableExport& FmuVariableExport::operator=(const FmuVariableExport& other)
 
 void FmuVariableExport::SetValue(const fmi2String& val) const {
     if (is_pointer_variant(m_varbind))
-        *varns::get<std::string*>(m_varbind) = std::string(val);
+        varns::get<std::string*>(m_varbind)->assign(val);  // reuse the capacity of the bound string
     else
         varns::get<FunGetSet<std::string>>(m_varbind).second(std::string(val));
 }
@@ -142,6 +145,13 @@ void FmuVariableExport::GetValue(fmi2String* varptr) const {
                                             : varns::get<FunGetSet<std::string>>(m_varbind).first().c_str();
 }
 
+void FmuVariableExport::GetValue(fmi2String* varptr, FmuArena& arena) const {
+    if (is_pointer_variant(m_varbind))
+        *varptr = varns::get<std::string*>(m_varbind)->c_str();
+    else
+        *varptr = arena.CopyString(varns::get<FunGetSet<std::string>>(m_varbind).first());
+}
+
 void FmuVariableExport::SetStartVal(fmi2String start) {
     if (!m_allowed_start)
         return;
@@ -187,6 +197,78 @@ std::string FmuVariableExport::GetStartValAsString() const {
 
 // =============================================================================
 
+FmuArena::~FmuArena() {
+    freeBlocks();
+}
+
+void* FmuArena::allocateBlock(size_t size) {
+    if (m_functions && m_functions->allocateMemory)
+        return m_functions->allocateMemory(1, size);
+    return std::malloc(size);
+}
+
+void FmuArena::freeBlock(void* block) {
+    if (m_functions && m_functions->freeMemory)
+        m_functions->freeMemory(block);
+    else
+        std::free(block);
+}
+
+void FmuArena::freeBlocks() {
+    while (m_block) {
+        Block* next = m_block->next;
+        freeBlock(m_block);
+        m_block = next;
+    }
+    m_offset = 0;
+    m_used = 0;
+    m_capacity = 0;
+}
+
+void* FmuArena::Allocate(size_t size, size_t alignment) {
+    // the block header keeps the usable memory aligned as std::max_align_t
+    const size_t header_size = (sizeof(Block) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) *
+                               alignof(std::max_align_t);
+
+    size_t offset = (m_offset + alignment - 1) / alignment * alignment;
+    if (!m_block || offset + size > m_block->size) {
+        size_t block_size = std::max(min_block_size, std::max(size + alignment, m_block ? 2 * m_block->size : 0));
+        Block* block = static_cast<Block*>(allocateBlock(header_size + block_size));
+        if (!block)
+            throw std::bad_alloc();
+        block->next = m_block;
+        block->size = block_size;
+        m_block = block;
+        m_capacity += block_size;
+        m_offset = 0;
+        offset = 0;
+    }
+
+    m_used += offset - m_offset + size;
+    m_offset = offset + size;
+    return reinterpret_cast<char*>(m_block) + header_size + offset;
+}
+
+fmi2String FmuArena::CopyString(const char* str, size_t length) {
+    char* copy = static_cast<char*>(Allocate(length + 1, 1));
+    std::memcpy(copy, str, length);
+    copy[length] = 0;
+    return copy;
+}
+
+void FmuArena::Reset() {
+    if (m_block && m_block->next) {
+        // coalesce the blocks, so that the same usage fits in a single block from now on
+        size_t capacity = m_capacity;
+        freeBlocks();
+        Allocate(capacity, 1);
+    }
+    m_offset = 0;
+    m_used = 0;
+}
+
+// =============================================================================
+
 FmuComponentBase::FmuComponentBase(fmi2String instanceName,
                                    fmi2Type fmuType,
                                    fmi2String fmuGUID,
@@ -197,14 +279,15 @@ FmuComponentBase::FmuComponentBase(fmi2String instanceName,
                                    const std::unordered_map<std::string, bool>& logCategories_init,
                                    const std::unordered_set<std::string>& logCategories_debug_init)
     : m_instanceName(instanceName),
-      m_callbackFunctions(*functions),
       m_fmuGUID(FMU_GUID),
       m_visible(visible == fmi2True ? true : false),
+      m_logCategories_debug(logCategories_debug_init),
       m_debug_logging_enabled(loggingOn == fmi2True ? true : false),
       m_modelIdentifier(FMU_MODEL_IDENTIFIER),
+      m_callbackFunctions(*functions),
+      m_arena(&m_callbackFunctions),
       m_fmuMachineState(FmuMachineState::instantiated),
-      m_logCategories_enabled(logCategories_init),
-      m_logCategories_debug(logCategories_debug_init) {
+      m_logCategories_enabled(logCategories_init) {
     m_unitDefinitions["1"] = UnitDefinition("1");  // guarantee the existence of the default unit
     m_unitDefinitions[""] = UnitDefinition("");    // guarantee the existence of the unassigned unit
 
@@ -343,6 +426,8 @@ const FmuVariableExport& FmuComponentBase::AddFmuVariable(const FmuVariableExpor
     if (!ret.second)
         throw std::runtime_error("Developer error: cannot insert new variable into FMU.");
 
+    indexVariable(ret.first);
+
     return *(ret.first);
 }
 
@@ -355,6 +440,12 @@ bool FmuComponentBase::RebindVariable(FmuVariableExport::VarbindType varbind, st
 
         std::pair<std::set<FmuVariableExport>::iterator, bool> ret = m_variables.insert(newvar);
 
+        // the erased iterator is no longer valid: refresh the lookup table
+        if (ret.second)
+            indexVariable(ret.first);
+        else
+            rebuildValrefIndex();
+
         return ret.second;
     }
 
@@ -755,10 +846,10 @@ void FmuComponentBase::executePostStepCallbacks() {
 
 std::set<FmuVariableExport>::iterator FmuComponentBase::findByValrefType(fmi2ValueReference vr,
                                                                          FmuVariable::Type vartype) {
-    auto predicate_samevalreftype = [vr, vartype](const FmuVariable& var) {
-        return var.GetValueReference() == vr && var.GetType() == vartype;
-    };
-    return std::find_if(m_variables.begin(), m_variables.end(), predicate_samevalreftype);
+    size_t type_index = static_cast<size_t>(vartype);
+    if (type_index >= m_valrefIndex.size() || vr >= m_valrefIndex[type_index].size())
+        return m_variables.end();
+    return m_valrefIndex[type_index][vr];
 }
 
 std::set<FmuVariableExport>::iterator FmuComponentBase::findByName(const std::string& name) {
@@ -766,6 +857,25 @@ std::set<FmuVariableExport>::iterator FmuComponentBase::findByName(const std::st
     return std::find_if(m_variables.begin(), m_variables.end(), predicate_samename);
 }
 
+void FmuComponentBase::indexVariable(std::set<FmuVariableExport>::iterator it) {
+    // value references are assigned sequentially within each type, thus the lookup tables are dense
+    size_t type_index = static_cast<size_t>(it->GetType());
+    if (type_index >= m_valrefIndex.size())
+        return;
+    auto& table = m_valrefIndex[type_index];
+    fmi2ValueReference vr = it->GetValueReference();
+    if (vr >= table.size())
+        table.resize(vr + 1, m_variables.end());
+    table[vr] = it;
+}
+
+void FmuComponentBase::rebuildValrefIndex() {
+    for (auto& table : m_valrefIndex)
+        table.assign(table.size(), m_variables.end());
+    for (auto it = m_variables.begin(); it != m_variables.end(); ++it)
+        indexVariable(it);
+}
+
 // -----------------------------------------------------------------------------
 
 fmi2Status FmuComponentBase::EnterInitializationMode() {
@@ -784,6 +894,9 @@ fmi2Status FmuComponentBase::ExitInitializationMode() {
 fmi2Status FmuComponentBase::DoStep(fmi2Real currentCommunicationPoint,
                                     fmi2Real communicationStepSize,
                                     fmi2Boolean noSetFMUStatePriorToCurrentPoint) {
+    // transient allocations of the previous step (e.g. strings returned by fmi2GetString) are released
+    m_arena.Reset();
+
     // invoke any pre step callbacks (e.g., to process input variables)
     executePreStepCallbacks();
 
@@ -830,6 +943,8 @@ fmi2Status FmuComponentBase::NewDiscreteStates(fmi2EventInfo* fmi2eventInfo) {
 fmi2Status FmuComponentBase::CompletedIntegratorStep(fmi2Boolean noSetFMUStatePriorToCurrentPoint,
                                                      fmi2Boolean* enterEventMode,
                                                      fmi2Boolean* terminateSimulation) {
+    m_arena.Reset();
+
     fmi2Status status =
         completedIntegratorStepIMPL(noSetFMUStatePriorToCurrentPoint, enterEventMode, terminateSimulation);
 
@@ -884,7 +999,7 @@ void FmuComponentBase::addUnitDefinition(const UnitDefinition& unit_definition)
     m_unitDefinitions[unit_definition.name] = unit_definition;
 }
 
-void FmuComponentBase::sendToLog(std::string msg, fmi2Status status, std::string msg_cat) {
+void FmuComponentBase::sendToLog(const std::string& msg, fmi2Status status, const std::string& msg_cat) {
     assert(m_logCategories_enabled.find(msg_cat) != m_logCategories_enabled.end() &&
            ("Developer warning: the category \"" + msg_cat + "\" is not recognized by the FMU").c_str());
 
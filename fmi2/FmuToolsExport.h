@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <vector>
 #include <array>
 #include <map>
@@ -70,6 +71,55 @@ bool is_pointer_variant(const FmuVariableBindType& myVariant);
 
 // =============================================================================
 
+/// Arena of the transient allocations of an FMU instance (e.g. strings returned by fmi2GetString).
+/// Memory is carved out of blocks obtained from the environment's allocateMemory (if available, otherwise from the
+/// heap) and is released all at once by Reset. After a Reset, the blocks are coalesced into a single block large
+/// enough for the previous usage, so that a steady step-by-step workload does not allocate at all.
+class FmuArena {
+  public:
+    explicit FmuArena(const fmi2CallbackFunctions* functions = nullptr) : m_functions(functions) {}
+    ~FmuArena();
+
+    FmuArena(const FmuArena&) = delete;
+    FmuArena& operator=(const FmuArena&) = delete;
+
+    /// Allocate \a size bytes, valid until the next Reset.
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    /// Copy a string in the arena, returning a null-terminated copy valid until the next Reset.
+    fmi2String CopyString(const char* str, size_t length);
+    fmi2String CopyString(const std::string& str) { return CopyString(str.data(), str.size()); }
+
+    /// Release all the allocations made since the last Reset.
+    void Reset();
+
+    /// Memory currently in use.
+    size_t GetUsed() const { return m_used; }
+
+    /// Memory currently reserved.
+    size_t GetCapacity() const { return m_capacity; }
+
+    static const size_t min_block_size = 4096;
+
+  private:
+    struct Block {
+        Block* next;
+        size_t size;  ///< usable bytes after the block header
+    };
+
+    void* allocateBlock(size_t size);
+    void freeBlock(void* block);
+    void freeBlocks();
+
+    const fmi2CallbackFunctions* m_functions;
+    Block* m_block = nullptr;  ///< current block, with the previous ones linked through 'next'
+    size_t m_offset = 0;       ///< offset of the free space in the current block
+    size_t m_used = 0;
+    size_t m_capacity = 0;
+};
+
+// =============================================================================
+
 /// Implementation of an FMU variable for export (generation of model description XML).
 class FmuVariableExport : public FmuVariable {
   public:
@@ -112,6 +162,10 @@ class FmuVariableExport : public FmuVariable {
     /// Get the value of this FMU variable of type fmi2String.
     void GetValue(fmi2String* varptr) const;
 
+    /// Get the value of this FMU variable of type fmi2String.
+    /// Values returned by getter functions are copied in \a arena, so that they outlive the call.
+    void GetValue(fmi2String* varptr, FmuArena& arena) const;
+
     /// Set the start value for this FMU variable (for all cases, except variables of type fmi2String).
     template <typename T, typename = typename std::enable_if<!std::is_same<T, fmi2String>::value>::type>
     void SetStartVal(T start) {
@@ -213,7 +267,7 @@ class FmuComponentBase {
                 sendToLog(msg, fmi2Status::fmi2Error, "logStatusError");
                 return fmi2Status::fmi2Error;
             } else {
-                it->GetValue(&value[s]);
+                getValue(*it, &value[s]);
             }
         }
 
@@ -404,14 +458,31 @@ class FmuComponentBase {
     /// debugging category;
     /// FMUs generated by this library provides a Description in which it is reported if the category
     /// is of debug.
-    void sendToLog(std::string msg, fmi2Status status, std::string msg_cat);
+    void sendToLog(const std::string& msg, fmi2Status status, const std::string& msg_cat);
+
+    /// Arena for the transient allocations of the FMU: its memory is released at each step (DoStep for
+    /// co-simulation, CompletedIntegratorStep for model exchange).
+    FmuArena& GetArena() { return m_arena; }
 
     std::set<FmuVariableExport>::iterator findByValrefType(fmi2ValueReference vr, FmuVariable::Type vartype);
     std::set<FmuVariableExport>::iterator findByName(const std::string& name);
 
+    /// Register the variable pointed by \a it in the value reference lookup tables.
+    void indexVariable(std::set<FmuVariableExport>::iterator it);
+
+    /// Rebuild the value reference lookup tables from scratch.
+    /// Must be called if m_variables is modified without passing through AddFmuVariable or RebindVariable.
+    void rebuildValrefIndex();
+
     void executePreStepCallbacks();
     void executePostStepCallbacks();
 
+    template <class T>
+    void getValue(const FmuVariableExport& var, T* value) {
+        var.GetValue(value);
+    }
+    void getValue(const FmuVariableExport& var, fmi2String* value) { var.GetValue(value, m_arena); }
+
     std::string m_instanceName;
     std::string m_fmuGUID;
     std::string m_resources_location;
@@ -438,6 +509,8 @@ class FmuComponentBase {
     std::map<FmuVariable::Type, unsigned int> m_valueReferenceCounter;
 
     std::set<FmuVariableExport> m_variables;
+    std::array<std::vector<std::set<FmuVariableExport>::iterator>, static_cast<size_t>(FmuVariable::Type::Unknown)>
+        m_valrefIndex;  ///< lookup tables (one per variable type), indexed by value reference
     std::unordered_map<std::string, UnitDefinition> m_unitDefinitions;
     std::unordered_map<std::string, std::pair<std::string, std::vector<std::string>>> m_derivatives;
     std::unordered_map<std::string, std::vector<std::string>> m_variableDependencies;
@@ -446,6 +519,7 @@ class FmuComponentBase {
     std::list<std::function<void(void)>> m_postStepCallbacks;
 
     fmi2CallbackFunctions m_callbackFunctions;
+    FmuArena m_arena;  ///< transient allocations, backed by m_callbackFunctions.allocateMemory
     FmuMachineState m_fmuMachineState;
 
     std::unordered_map<std::string, bool> m_logCategories_enabled;
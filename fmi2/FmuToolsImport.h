@@ -18,6 +18,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <fstream>
 #include <sstream>
 #include <cstdarg>
@@ -28,6 +29,7 @@
 
 #include "FmuToolsRuntimeLinking.h"
 #include "FmuToolsImportCommon.h"
+#include "FmuToolsVariableTrie.h"
 #include "fmi2/FmuToolsVariable.h"
 
 namespace fmu_forge {
@@ -74,25 +76,8 @@ class FmuVariableImport : public FmuVariable {
 
 // =============================================================================
 
-/// Class for a node in a tree of FMU variables.
-/// The tree is constructed by analyzing the flat list of variables in the XML.
-/// In the XML one has the flattened list such as for example
-///     myobject.mysubobjetct.pos
-///     myobject.mysubobjetct.dir
-/// so the tree will contain:
-///     myobject
-///          mysubobject
-///                pos
-///                dir
-class FmuVariableTreeNode {
-  public:
-    std::string object_name;
-
-    std::map<std::string, FmuVariableTreeNode> children;
-    FmuVariableImport* leaf = nullptr;
-
-    FmuVariableTreeNode() {}
-};
+/// Trie of the FMU variables, by their hierarchical names.
+typedef FmuVariableTrie<FmuVariableImport*> FmuVariableTree;
 
 // =============================================================================
 
@@ -114,6 +99,19 @@ class FmuUnit {
               const std::string& fmupath,
               const std::string& unzipdir = fs::temp_directory_path().generic_string() + std::string("/_fmu_temp"));
 
+    /// Load the FMU through the persistent extraction cache (see UnzipFmuCached).
+    /// An FMU already extracted by a previous load, possibly from another process, is not unzipped again.
+    /// The unzipped folder is shared and must not be modified.
+    void LoadCached(fmi2Type fmuType,
+                    const std::string& fmupath,
+                    const std::string& cachedir = fs::temp_directory_path().generic_string() +
+                                                  std::string("/_fmu_cache"));
+
+    /// Load only the model description, reading it in memory directly from the FMU archive.
+    /// The FMU is neither extracted nor linked: metadata and variables are available, but the FMU cannot be
+    /// instantiated. Use Load, LoadCached or LoadUnzipped to load the complete FMU.
+    void LoadModelDescription(const std::string& fmupath);
+
     /// Load the FMU from the specified directory, assuming it has been already unzipped.
     virtual void LoadUnzipped(fmi2Type fmuType, const std::string& directory);
 
@@ -142,7 +140,10 @@ class FmuUnit {
     const VarList& GetVariablesList() const { return scalarVariables; }
 
     /// Print the tree of variables
-    void PrintVariablesTree(int tab) { PrintVariablesTree(&tree_variables, tab); }
+    void PrintVariablesTree(int tab) { PrintVariablesTree(tree_variables.Root(), tab); }
+
+    /// Return the trie of the variables, by their hierarchical names (e.g. for the variables under a given prefix).
+    const FmuVariableTree& GetVariablesTree() const { return tree_variables; }
 
     /// Set debug logging level.
     fmi2Status SetDebugLogging(fmi2Boolean loggingOn, const std::vector<std::string>& logCategories);
@@ -232,7 +233,10 @@ class FmuUnit {
 
     VarList scalarVariables;  ///< FMU variables
 
-    FmuVariableTreeNode tree_variables;
+    std::unordered_map<std::string, VarList::iterator> m_variablesByName;  ///< hashed access to scalarVariables
+    std::vector<VarList::iterator> m_variablesByIndex;  ///< variables, ordered by their (1-based) XML index
+
+    FmuVariableTree tree_variables;
 
   public:
     fmi2CallbackFunctions callbacks;
@@ -270,9 +274,12 @@ class FmuUnit {
     fmi2GetDerivativesTYPE* _fmi2GetDerivatives;
 
   private:
-    /// Parse XML and create the list of variables.
+    /// Read the model description file from the unzipped folder and parse it.
     void LoadXML();
 
+    /// Parse the model description (null-terminated text, not modified) and create the list of variables.
+    void ParseXML(const char* text);
+
     /// Load the shared library in run-time and do the dynamic linking to the required FMU functions.
     void LoadSharedLibrary(fmi2Type fmuType);
 
@@ -280,11 +287,18 @@ class FmuUnit {
     void BuildVariablesTree();
 
     /// Print the tree of variables (recursive).
-    void PrintVariablesTree(FmuVariableTreeNode* mynode, int tab);
+    void PrintVariablesTree(FmuVariableTree::NodeId node, int tab);
+
+    /// Construct the lookup tables (by name and by XML index) from the flat variable list.
+    void BuildVariablesIndex();
 
     /// Find a variable by its index.
     VarList::iterator FindByIndex(int index);
 
+    /// Find a variable by its name.
+    /// Throws std::out_of_range if the variable is not found.
+    const FmuVariableImport& FindByName(const std::string& varname) const;
+
     std::string m_directory;
     std::string m_bin_directory;
 
@@ -318,6 +332,25 @@ void FmuUnit::Load(fmi2Type fmuType, const std::string& filepath, const std::str
     }
 }
 
+void FmuUnit::LoadModelDescription(const std::string& fmupath) {
+    if (m_verbose)
+        std::cout << "Reading model description from FMU: " << fmupath << std::endl;
+
+    std::vector<char> buffer = ReadFmuArchiveEntry(fmupath, "modelDescription.xml");
+    ParseXML(buffer.data());
+}
+
+void FmuUnit::LoadCached(fmi2Type fmuType, const std::string& fmupath, const std::string& cachedir) {
+    std::string unzipdir = UnzipFmuCached(fmupath, cachedir);
+
+    if (m_verbose) {
+        std::cout << "Loading FMU: " << fmupath << std::endl;
+        std::cout << "  cached in: " << unzipdir << std::endl;
+    }
+
+    LoadUnzipped(fmuType, unzipdir);
+}
+
 void FmuUnit::LoadUnzipped(fmi2Type fmuType, const std::string& directory) {
     m_fmuType = fmuType;
     m_directory = directory;
@@ -347,48 +380,45 @@ void FmuUnit::LoadXML() {
     if (m_verbose)
         std::cout << "Loading model description file: " << xml_filename << std::endl;
 
-    rapidxml::xml_document<>* doc_ptr = new rapidxml::xml_document<>();
-
-    // Read the xml file into a vector
-    std::ifstream file(xml_filename);
-
-    if (!file.good())
-        throw std::runtime_error("Cannot find file: " + xml_filename + "\n");
+    MappedFile file(xml_filename);
 
-    std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    buffer.push_back('\0');
+    ParseXML(file.data());
+}
 
-    // Parse the buffer using the xml file parsing library into doc
-    doc_ptr->parse<0>(&buffer[0]);
+void FmuUnit::ParseXML(const char* text) {
+    // Parse in non-destructive mode: the text is never modified (it can be a read-only memory mapping) and names and
+    // values are referenced in place instead of being copied and null-terminated
+    rapidxml::xml_document<> doc;
+    doc.parse<rapidxml::parse_non_destructive>(const_cast<char*>(text));
 
     // Find the root node
-    auto root_node = doc_ptr->first_node("fmiModelDescription");
+    auto root_node = doc.first_node("fmiModelDescription");
     if (!root_node)
         throw std::runtime_error("Not a valid FMU. Missing <fmiModelDescription> in XML. \n");
 
     if (auto attr = root_node->first_attribute("modelName")) {
-        modelName = attr->value();
+        modelName = XmlString(attr);
     }
     if (auto attr = root_node->first_attribute("guid")) {
-        guid = attr->value();
+        guid = XmlString(attr);
     }
     if (auto attr = root_node->first_attribute("fmiVersion")) {
-        fmiVersion = attr->value();
+        fmiVersion = XmlString(attr);
     }
     if (auto attr = root_node->first_attribute("description")) {
-        description = attr->value();
+        description = XmlString(attr);
     }
     if (auto attr = root_node->first_attribute("generationTool")) {
-        generationTool = attr->value();
+        generationTool = XmlString(attr);
     }
     if (auto attr = root_node->first_attribute("generationDateAndTime")) {
-        generationDateAndTime = attr->value();
+        generationDateAndTime = XmlString(attr);
     }
     if (auto attr = root_node->first_attribute("variableNamingConvention")) {
-        variableNamingConvention = attr->value();
+        variableNamingConvention = XmlString(attr);
     }
     if (auto attr = root_node->first_attribute("numberOfEventIndicators")) {
-        numberOfEventIndicators = attr->value();
+        numberOfEventIndicators = XmlString(attr);
     }
 
     if (fmiVersion.compare("2.0") != 0)
@@ -398,34 +428,34 @@ void FmuUnit::LoadXML() {
     auto cosimulation_node = root_node->first_node("CoSimulation");
     if (cosimulation_node) {
         if (auto attr = cosimulation_node->first_attribute("modelIdentifier")) {
-            info_cosim_modelIdentifier = attr->value();
+            info_cosim_modelIdentifier = XmlString(attr);
         }
         if (auto attr = cosimulation_node->first_attribute("needsExecutionTool")) {
-            info_cosim_needsExecutionTool = attr->value();
+            info_cosim_needsExecutionTool = XmlString(attr);
         }
         if (auto attr = cosimulation_node->first_attribute("canHandleVariableCommunicationStepSize")) {
-            info_cosim_canHandleVariableCommunicationStepSize = attr->value();
+            info_cosim_canHandleVariableCommunicationStepSize = XmlString(attr);
         }
         if (auto attr = cosimulation_node->first_attribute("canInterpolateInputs")) {
-            info_cosim_canInterpolateInputs = attr->value();
+            info_cosim_canInterpolateInputs = XmlString(attr);
         }
         if (auto attr = cosimulation_node->first_attribute("maxOutputDerivativeOrder")) {
-            info_cosim_maxOutputDerivativeOrder = attr->value();
+            info_cosim_maxOutputDerivativeOrder = XmlString(attr);
         }
         if (auto attr = cosimulation_node->first_attribute("canRunAsynchronuously")) {
-            info_cosim_canRunAsynchronuously = attr->value();
+            info_cosim_canRunAsynchronuously = XmlString(attr);
         }
         if (auto attr = cosimulation_node->first_attribute("canBeInstantiatedOnlyOncePerProcess")) {
-            info_cosim_canBeInstantiatedOnlyOncePerProcess = attr->value();
+            info_cosim_canBeInstantiatedOnlyOncePerProcess = XmlString(attr);
         }
         if (auto attr = cosimulation_node->first_attribute("canNotUseMemoryManagementFunctions")) {
-            info_cosim_canNotUseMemoryManagementFunctions = attr->value();
+            info_cosim_canNotUseMemoryManagementFunctions = XmlString(attr);
         }
         if (auto attr = cosimulation_node->first_attribute("canGetAndSetFMUstate")) {
-            info_cosim_canGetAndSetFMUstate = attr->value();
+            info_cosim_canGetAndSetFMUstate = XmlString(attr);
         }
         if (auto attr = cosimulation_node->first_attribute("canSerializeFMUstate")) {
-            info_cosim_canSerializeFMUstate = attr->value();
+            info_cosim_canSerializeFMUstate = XmlString(attr);
         }
         cosim = true;
 
@@ -437,29 +467,29 @@ void FmuUnit::LoadXML() {
     auto modelexchange_node = root_node->first_node("ModelExchange");
     if (modelexchange_node) {
         if (auto attr = modelexchange_node->first_attribute("modelIdentifier")) {
-            info_modex_modelIdentifier = attr->value();
+            info_modex_modelIdentifier = XmlString(attr);
         }
         if (auto attr = modelexchange_node->first_attribute("needsExecutionTool")) {
-            info_modex_needsExecutionTool = attr->value();
+            info_modex_needsExecutionTool = XmlString(attr);
         }
         if (auto attr = modelexchange_node->first_attribute("completedIntegratorStepNotNeeded")) {
-            info_modex_completedIntegratorStepNotNeeded = attr->value();
+            info_modex_completedIntegratorStepNotNeeded = XmlString(attr);
         }
 
         if (auto attr = modelexchange_node->first_attribute("canBeInstantiatedOnlyOncePerProcess")) {
-            info_modex_canBeInstantiatedOnlyOncePerProcess = attr->value();
+            info_modex_canBeInstantiatedOnlyOncePerProcess = XmlString(attr);
         }
         if (auto attr = modelexchange_node->first_attribute("canNotUseMemoryManagementFunctions")) {
-            info_modex_canNotUseMemoryManagementFunctions = attr->value();
+            info_modex_canNotUseMemoryManagementFunctions = XmlString(attr);
         }
         if (auto attr = modelexchange_node->first_attribute("canGetAndSetFMUState")) {
-            info_modex_canGetAndSetFMUState = attr->value();
+            info_modex_canGetAndSetFMUState = XmlString(attr);
         }
         if (auto attr = modelexchange_node->first_attribute("canSerializeFMUstate")) {
-            info_modex_canSerializeFMUstate = attr->value();
+            info_modex_canSerializeFMUstate = XmlString(attr);
         }
         if (auto attr = modelexchange_node->first_attribute("providesDirectionalDerivative")) {
-            info_modex_providesDirectionalDerivative = attr->value();
+            info_modex_providesDirectionalDerivative = XmlString(attr);
         }
         modex = true;
 
@@ -490,7 +520,7 @@ void FmuUnit::LoadXML() {
         std::string var_name;
 
         if (auto attr = var_node->first_attribute("name"))
-            var_name = attr->value();
+            var_name = XmlString(attr);
         else
             throw std::runtime_error("Cannot find 'name' property in variable.\n");
 
@@ -503,21 +533,21 @@ void FmuUnit::LoadXML() {
 
         // valueReference is 1-based
         if (auto attr = var_node->first_attribute("valueReference"))
-            valref = std::stoul(attr->value());
+            valref = static_cast<fmi2ValueReference>(XmlToUnsigned(attr));
         else
             throw std::runtime_error("Cannot find 'valueReference' property in variable.\n");
 
         if (auto attr = var_node->first_attribute("description"))
-            description = attr->value();
+            description = XmlString(attr);
 
         if (auto attr = var_node->first_attribute("variability"))
-            variability = attr->value();
+            variability = XmlString(attr);
 
         if (auto attr = var_node->first_attribute("causality"))
-            causality = attr->value();
+            causality = XmlString(attr);
 
         if (auto attr = var_node->first_attribute("initial"))
-            initial = attr->value();
+            initial = XmlString(attr);
 
         FmuVariable::CausalityType causality_enum;
         FmuVariable::VariabilityType variability_enum;
@@ -591,12 +621,12 @@ void FmuUnit::LoadXML() {
         std::string unit = "";
         if (type_node) {
             if (auto attr = type_node->first_attribute("derivative")) {
-                state_indices.push_back(std::stoi(attr->value()));
+                state_indices.push_back(static_cast<int>(XmlToUnsigned(attr)));
                 deriv_indices.push_back(crt_index);
                 is_deriv = true;
             }
             if (auto attr = type_node->first_attribute("unit")) {
-                unit = attr->value();
+                unit = XmlString(attr);
             }
             if (auto attr = type_node->first_attribute("start")) {
                 //// TODO
@@ -611,6 +641,8 @@ void FmuUnit::LoadXML() {
         scalarVariables[var_name] = var;
     }
 
+    BuildVariablesIndex();
+
     // Traverse the list of state indices and mark the corresponding FMU variable as a state
     for (const auto& si : state_indices) {
         auto it = FindByIndex(si);
@@ -633,8 +665,6 @@ void FmuUnit::LoadXML() {
             std::cout << std::endl;
         }
     }
-
-    delete doc_ptr;
 }
 
 void FmuUnit::LoadSharedLibrary(fmi2Type fmuType) {
@@ -698,54 +728,58 @@ void FmuUnit::BuildVariablesTree() {
     if (m_verbose)
         std::cout << "Building variables tree" << std::endl;
 
-    for (auto& iv : this->scalarVariables) {
-        std::string token;
-        std::istringstream ss(iv.second.GetName());
-
-        // scan all tokens delimited by "."
-        int ntokens = 0;
-        FmuVariableTreeNode* tree_node = &this->tree_variables;
-        while (std::getline(ss, token, '.') && ntokens < 300) {
-            auto next_node = tree_node->children.find(token);
-            if (next_node != tree_node->children.end())  // already added
-            {
-                tree_node = &(next_node->second);
-            } else {
-                FmuVariableTreeNode new_node;
-                new_node.object_name = token;
-                tree_node->children[token] = new_node;
-                tree_node = &tree_node->children[token];
-            }
-            ++ntokens;
-        }
-        tree_node->leaf = &iv.second;
-    }
+    tree_variables.Clear();
+    for (auto& iv : this->scalarVariables)
+        tree_variables.Insert(iv.second.GetName(), &iv.second);
+    tree_variables.Finalize();
 }
 
-void FmuUnit::PrintVariablesTree(FmuVariableTreeNode* mynode, int tab) {
-    for (auto& in : mynode->children) {
+void FmuUnit::PrintVariablesTree(FmuVariableTree::NodeId node, int tab) {
+    for (auto child = tree_variables.ChildrenBegin(node); child != tree_variables.ChildrenEnd(node); ++child) {
         for (int itab = 0; itab < tab; ++itab) {
             std::cout << "\t";
         }
 
         // name of tree level
-        std::cout << in.first;
+        std::cout << tree_variables.GetSegmentName(*child);
 
         // level is a FMU variable (tree leaf)
-        if (in.second.leaf) {
-            std::cout << " -> FMU reference:" << in.second.leaf->GetValueReference();
+        if (tree_variables.GetNode(*child).leaf) {
+            std::cout << " -> FMU reference:" << tree_variables.GetNode(*child).leaf->GetValueReference();
         }
 
         std::cout << "\n";
-        PrintVariablesTree(&in.second, tab + 1);
+        PrintVariablesTree(*child, tab + 1);
+    }
+}
+
+void FmuUnit::BuildVariablesIndex() {
+    m_variablesByName.clear();
+    m_variablesByName.reserve(scalarVariables.size());
+    m_variablesByIndex.assign(scalarVariables.size() + 1, scalarVariables.end());
+
+    for (auto it = scalarVariables.begin(); it != scalarVariables.end(); ++it) {
+        m_variablesByName[it->first] = it;
+        int index = it->second.GetIndex();
+        if (index >= 0) {
+            if (static_cast<size_t>(index) >= m_variablesByIndex.size())
+                m_variablesByIndex.resize(index + 1, scalarVariables.end());
+            m_variablesByIndex[index] = it;
+        }
     }
 }
 
 FmuUnit::VarList::iterator FmuUnit::FindByIndex(int index) {
-    auto predicate_same_index = [index](const std::pair<std::string, FmuVariableImport>& var) {
-        return var.second.GetIndex() == index;
-    };
-    return std::find_if(scalarVariables.begin(), scalarVariables.end(), predicate_same_index);
+    if (index < 0 || static_cast<size_t>(index) >= m_variablesByIndex.size())
+        return scalarVariables.end();
+    return m_variablesByIndex[index];
+}
+
+const FmuVariableImport& FmuUnit::FindByName(const std::string& varname) const {
+    auto it = m_variablesByName.find(varname);
+    if (it == m_variablesByName.end())
+        throw std::out_of_range("Variable not found: " + varname);
+    return it->second->second;
 }
 
 std::string FmuUnit::GetVersion() const {
@@ -922,12 +956,12 @@ fmi2Status FmuUnit::SetVariable(fmi2ValueReference vr, const T& value, FmuVariab
 
 template <class T>
 fmi2Status FmuUnit::GetVariable(const std::string& varname, T& value, FmuVariable::Type vartype) noexcept(false) {
-    return GetVariable(scalarVariables.at(varname).GetValueReference(), value, vartype);
+    return GetVariable(FindByName(varname).GetValueReference(), value, vartype);
 }
 
 template <class T>
 fmi2Status FmuUnit::SetVariable(const std::string& varname, const T& value, FmuVariable::Type vartype) noexcept(false) {
-    return SetVariable(scalarVariables.at(varname).GetValueReference(), value, vartype);
+    return SetVariable(FindByName(varname).GetValueReference(), value, vartype);
 }
 
 fmi2Status FmuUnit::GetVariable(const std::string& varname, std::string& value) noexcept(false) {
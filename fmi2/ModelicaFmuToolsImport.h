@@ -33,7 +33,7 @@ struct FmuModelicaBody {
 /// Visual shape for the FMU.
 /// The visualizer could be a cylinder, a sphere, a mesh, etc.
 struct FmuModelicaVisualShape {
-    FmuVariableTreeNode* visualizer_node = nullptr;
+    FmuVariableTree::NodeId visualizer_node = FmuVariableTree::npos;  ///< node of the visualizer in the trie
 
     unsigned int pos_references[3] = {0, 0, 0};
     unsigned int rot_references[9] = {0, 0, 0};
@@ -48,6 +48,41 @@ struct FmuModelicaVisualShape {
 
     std::string type;
     std::string filename;
+
+    size_t frame_index = 0;  ///< index of the shape in FmuModelicaVisualFrame
+};
+
+// =============================================================================
+
+/// Values of the visual shapes of a Modelica FMU at one frame, in structure-of-arrays layout.
+/// Each attribute of all shapes is stored contiguously (e.g. positions as x0,y0,z0,x1,y1,z1,...), so that the arrays
+/// can be uploaded as-is as per-instance buffers for instanced rendering. All attributes are parts of a single buffer,
+/// filled by one fmi2GetReal call (see FmuModelicaUnit::UpdateVisualizers).
+struct FmuModelicaVisualFrame {
+    /// Attributes, in the order they are stored in the buffer, and their number of components.
+    enum Attribute { POSITION, ROTATION, R_SHAPE, LENGTH_DIRECTION, WIDTH_DIRECTION, COLOR, SIZE, NUM_ATTRIBUTES };
+    static size_t Components(Attribute attribute) { return attribute == ROTATION ? 9 : 3; }
+
+    /// Return the array of the given attribute for all shapes (e.g. 3 * num_shapes values for POSITION).
+    const fmi2Real* Data(Attribute attribute) const { return values.data() + offsets[attribute]; }
+
+    /// Return the given attribute of one shape.
+    const fmi2Real* Data(Attribute attribute, size_t shape) const {
+        return Data(attribute) + shape * Components(attribute);
+    }
+
+    const fmi2Real* Position(size_t shape) const { return Data(POSITION, shape); }  ///< r: frame origin
+    const fmi2Real* Rotation(size_t shape) const { return Data(ROTATION, shape); }  ///< R.T: row-major 3x3 matrix
+    const fmi2Real* RShape(size_t shape) const { return Data(R_SHAPE, shape); }     ///< r_shape: shape offset
+    const fmi2Real* LengthDirection(size_t shape) const { return Data(LENGTH_DIRECTION, shape); }
+    const fmi2Real* WidthDirection(size_t shape) const { return Data(WIDTH_DIRECTION, shape); }
+    const fmi2Real* Color(size_t shape) const { return Data(COLOR, shape); }
+    const fmi2Real* Size(size_t shape) const { return Data(SIZE, shape); }  ///< length, width, height
+
+    size_t num_shapes = 0;
+    size_t offsets[NUM_ATTRIBUTES] = {};
+    std::vector<fmi2ValueReference> references;  ///< value references of all values, in buffer order
+    std::vector<fmi2Real> values;
 };
 
 // =============================================================================
@@ -57,107 +92,151 @@ class FmuModelicaUnit : public FmuUnit {
   public:
     FmuModelicaUnit() : FmuUnit() {}
 
-    virtual void LoadUnzipped(Type type, const std::string& directory) override;
+    virtual void LoadUnzipped(fmi2Type type, const std::string& directory) override;
+
+    void BuildBodyList(FmuVariableTree::NodeId node);
+
+    /// Collect the visualizers in the subtree of the given node of the variables trie.
+    void BuildVisualizersList(FmuVariableTree::NodeId node);
+
+    /// Pack the value references of all the visualizers in the frame buffer (done at load time).
+    void BuildVisualizersFrame();
 
-    void BuildBodyList(FmuVariableTreeNode* mynode) {}
-    void BuildVisualizersList(FmuVariableTreeNode* mynode);
+    /// Read the current values of all the visualizers with a single fmi2GetReal call.
+    fmi2Status UpdateVisualizers();
+
+    /// Return the values of the visualizers read by the last call to UpdateVisualizers.
+    const FmuModelicaVisualFrame& GetVisualizersFrame() const { return visual_frame; }
 
     std::vector<FmuModelicaVisualShape> visualizers;
     std::vector<FmuModelicaBody> bodies;
+
+  private:
+    FmuModelicaVisualFrame visual_frame;
 };
 
 // -----------------------------------------------------------------------------
 
-void FmuModelicaUnit::LoadUnzipped(Type type, const std::string& directory) {
+void FmuModelicaUnit::LoadUnzipped(fmi2Type type, const std::string& directory) {
     FmuUnit::LoadUnzipped(type, directory);
 
-    BuildBodyList(&tree_variables);
-    BuildVisualizersList(&tree_variables);
+    bodies.clear();
+    visualizers.clear();
+    BuildBodyList(tree_variables.Root());
+    BuildVisualizersList(tree_variables.Root());
+    BuildVisualizersFrame();
 }
 
-void FmuModelicaUnit::BuildBodyList(FmuVariableTreeNode* mynode) {
+void FmuModelicaUnit::BuildBodyList(FmuVariableTree::NodeId node) {
     //// TODO
 }
 
-void FmuModelicaUnit::BuildVisualizersList(FmuVariableTreeNode* mynode) {
-    auto found_shtype = mynode->children.find("shapeType");
-    auto found_R = mynode->children.find("R");
-    auto found_r1 = mynode->children.find("r[1]");
-    auto found_r2 = mynode->children.find("r[2]");
-    auto found_r3 = mynode->children.find("r[3]");
-    auto found_rshape1 = mynode->children.find("r_shape[1]");
-    auto found_rshape2 = mynode->children.find("r_shape[2]");
-    auto found_rshape3 = mynode->children.find("r_shape[3]");
-    auto found_l1 = mynode->children.find("lengthDirection[1]");
-    auto found_l2 = mynode->children.find("lengthDirection[2]");
-    auto found_l3 = mynode->children.find("lengthDirection[3]");
-    auto found_w1 = mynode->children.find("widthDirection[1]");
-    auto found_w2 = mynode->children.find("widthDirection[2]");
-    auto found_w3 = mynode->children.find("widthDirection[3]");
-    auto found_color1 = mynode->children.find("color[1]");
-    auto found_color2 = mynode->children.find("color[2]");
-    auto found_color3 = mynode->children.find("color[3]");
-    auto found_length = mynode->children.find("length");
-    auto found_width = mynode->children.find("width");
-    auto found_height = mynode->children.find("height");
-    if (found_shtype != mynode->children.end() && found_R != mynode->children.end() &&
-        found_r1 != mynode->children.end() && found_r2 != mynode->children.end() &&
-        found_r3 != mynode->children.end() && found_l1 != mynode->children.end() &&
-        found_l2 != mynode->children.end() && found_l3 != mynode->children.end() &&
-        found_w1 != mynode->children.end() && found_w2 != mynode->children.end() &&
-        found_w3 != mynode->children.end()) {
-        auto found_T11 = found_R->second.children.find("T[1,1]");
-        auto found_T12 = found_R->second.children.find("T[1,2]");
-        auto found_T13 = found_R->second.children.find("T[1,3]");
-        auto found_T21 = found_R->second.children.find("T[2,1]");
-        auto found_T22 = found_R->second.children.find("T[2,2]");
-        auto found_T23 = found_R->second.children.find("T[2,3]");
-        auto found_T31 = found_R->second.children.find("T[3,1]");
-        auto found_T32 = found_R->second.children.find("T[3,2]");
-        auto found_T33 = found_R->second.children.find("T[3,3]");
-        if (found_T11 != found_R->second.children.end() && found_T12 != found_R->second.children.end() &&
-            found_T13 != found_R->second.children.end() && found_T21 != found_R->second.children.end() &&
-            found_T22 != found_R->second.children.end() && found_T23 != found_R->second.children.end() &&
-            found_T31 != found_R->second.children.end() && found_T32 != found_R->second.children.end() &&
-            found_T33 != found_R->second.children.end()) {
-            FmuModelicaVisualShape my_v;
-            my_v.pos_references[0] = found_r1->second.leaf->GetValueReference();
-            my_v.pos_references[1] = found_r2->second.leaf->GetValueReference();
-            my_v.pos_references[2] = found_r3->second.leaf->GetValueReference();
-            my_v.pos_shape_references[0] = found_rshape1->second.leaf->GetValueReference();
-            my_v.pos_shape_references[1] = found_rshape2->second.leaf->GetValueReference();
-            my_v.pos_shape_references[2] = found_rshape3->second.leaf->GetValueReference();
-            my_v.rot_references[0] = found_T11->second.leaf->GetValueReference();
-            my_v.rot_references[1] = found_T12->second.leaf->GetValueReference();
-            my_v.rot_references[2] = found_T13->second.leaf->GetValueReference();
-            my_v.rot_references[3] = found_T21->second.leaf->GetValueReference();
-            my_v.rot_references[4] = found_T22->second.leaf->GetValueReference();
-            my_v.rot_references[5] = found_T23->second.leaf->GetValueReference();
-            my_v.rot_references[6] = found_T31->second.leaf->GetValueReference();
-            my_v.rot_references[7] = found_T32->second.leaf->GetValueReference();
-            my_v.rot_references[8] = found_T33->second.leaf->GetValueReference();
-            my_v.shapetype_reference = found_shtype->second.leaf->GetValueReference();
-            my_v.l_references[0] = found_l1->second.leaf->GetValueReference();
-            my_v.l_references[1] = found_l2->second.leaf->GetValueReference();
-            my_v.l_references[2] = found_l3->second.leaf->GetValueReference();
-            my_v.w_references[0] = found_w1->second.leaf->GetValueReference();
-            my_v.w_references[1] = found_w2->second.leaf->GetValueReference();
-            my_v.w_references[2] = found_w3->second.leaf->GetValueReference();
-            my_v.color_references[0] = found_color1->second.leaf->GetValueReference();
-            my_v.color_references[1] = found_color2->second.leaf->GetValueReference();
-            my_v.color_references[2] = found_color3->second.leaf->GetValueReference();
-            my_v.width_reference = found_width->second.leaf->GetValueReference();
-            my_v.length_reference = found_length->second.leaf->GetValueReference();
-            my_v.height_reference = found_height->second.leaf->GetValueReference();
-            my_v.visualizer_node = mynode;
-
-            visualizers.push_back(my_v);
+void FmuModelicaUnit::BuildVisualizersList(FmuVariableTree::NodeId node) {
+    const FmuVariableTree& tree = tree_variables;
+
+    // visualizer attributes, as children of the visualizer node
+    enum Child { SHAPE_TYPE, R, R1, R2, R3, R_SHAPE1, R_SHAPE2, R_SHAPE3, L1, L2, L3, W1, W2, W3,
+                 COLOR1, COLOR2, COLOR3, LENGTH, WIDTH, HEIGHT, NUM_CHILDREN };
+    static const char* child_names[NUM_CHILDREN] = {
+        "shapeType",          "R",                  "r[1]",               "r[2]",               "r[3]",
+        "r_shape[1]",         "r_shape[2]",         "r_shape[3]",         "lengthDirection[1]", "lengthDirection[2]",
+        "lengthDirection[3]", "widthDirection[1]",  "widthDirection[2]",  "widthDirection[3]",  "color[1]",
+        "color[2]",           "color[3]",           "length",             "width",              "height"};
+    static const char* T_names[9] = {"T[1,1]", "T[1,2]", "T[1,3]", "T[2,1]", "T[2,2]",
+                                     "T[2,3]", "T[3,1]", "T[3,2]", "T[3,3]"};
+
+    // segments are resolved once: a missing segment means that no node has such a child
+    uint32_t child_segments[NUM_CHILDREN];
+    uint32_t T_segments[9];
+    for (int c = 0; c < NUM_CHILDREN; ++c)
+        child_segments[c] = tree.FindSegment(child_names[c]);
+    for (int c = 0; c < 9; ++c)
+        T_segments[c] = tree.FindSegment(T_names[c]);
+    for (auto segment : child_segments)
+        if (segment == FmuVariableTree::npos)
+            return;
+    for (auto segment : T_segments)
+        if (segment == FmuVariableTree::npos)
+            return;
+
+    // candidates are the parents of the 'shapeType' nodes, visited in depth-first order
+    for (auto n = node; n < tree.GetNode(node).end; ++n) {
+        if (tree.GetNode(n).segment != child_segments[SHAPE_TYPE] || tree.GetNode(n).parent == FmuVariableTree::npos)
+            continue;
+        auto vis_node = tree.GetNode(n).parent;
+
+        FmuVariableTree::NodeId children[NUM_CHILDREN];
+        FmuVariableTree::NodeId T_children[9];
+        bool found = true;
+        for (int c = 0; c < NUM_CHILDREN && found; ++c) {
+            children[c] = tree.FindChildSegment(vis_node, child_segments[c]);
+            found = children[c] != FmuVariableTree::npos && (c == R || tree.GetNode(children[c]).leaf);
+        }
+        for (int c = 0; c < 9 && found; ++c) {
+            T_children[c] = tree.FindChildSegment(children[R], T_segments[c]);
+            found = T_children[c] != FmuVariableTree::npos && tree.GetNode(T_children[c]).leaf;
         }
+        if (!found)
+            continue;
+
+        auto ref = [&tree](FmuVariableTree::NodeId child) { return tree.GetNode(child).leaf->GetValueReference(); };
+
+        FmuModelicaVisualShape my_v;
+        for (int i = 0; i < 3; ++i) {
+            my_v.pos_references[i] = ref(children[R1 + i]);
+            my_v.pos_shape_references[i] = ref(children[R_SHAPE1 + i]);
+            my_v.l_references[i] = ref(children[L1 + i]);
+            my_v.w_references[i] = ref(children[W1 + i]);
+            my_v.color_references[i] = ref(children[COLOR1 + i]);
+        }
+        for (int i = 0; i < 9; ++i)
+            my_v.rot_references[i] = ref(T_children[i]);
+        my_v.shapetype_reference = ref(children[SHAPE_TYPE]);
+        my_v.width_reference = ref(children[WIDTH]);
+        my_v.length_reference = ref(children[LENGTH]);
+        my_v.height_reference = ref(children[HEIGHT]);
+        my_v.visualizer_node = vis_node;
+
+        visualizers.push_back(my_v);
+    }
+}
+
+void FmuModelicaUnit::BuildVisualizersFrame() {
+    using Frame = FmuModelicaVisualFrame;
+
+    // value references of each attribute, for all shapes
+    std::vector<fmi2ValueReference> refs[Frame::NUM_ATTRIBUTES];
+    for (size_t i = 0; i < visualizers.size(); ++i) {
+        auto& v = visualizers[i];
+        v.frame_index = i;
+        refs[Frame::POSITION].insert(refs[Frame::POSITION].end(), v.pos_references, v.pos_references + 3);
+        refs[Frame::ROTATION].insert(refs[Frame::ROTATION].end(), v.rot_references, v.rot_references + 9);
+        refs[Frame::R_SHAPE].insert(refs[Frame::R_SHAPE].end(), v.pos_shape_references, v.pos_shape_references + 3);
+        auto& l_refs = refs[Frame::LENGTH_DIRECTION];
+        l_refs.insert(l_refs.end(), v.l_references, v.l_references + 3);
+        auto& w_refs = refs[Frame::WIDTH_DIRECTION];
+        w_refs.insert(w_refs.end(), v.w_references, v.w_references + 3);
+        refs[Frame::COLOR].insert(refs[Frame::COLOR].end(), v.color_references, v.color_references + 3);
+        refs[Frame::SIZE].push_back(v.length_reference);
+        refs[Frame::SIZE].push_back(v.width_reference);
+        refs[Frame::SIZE].push_back(v.height_reference);
     }
-    // recursion
-    for (auto& in : mynode->children) {
-        BuildVisualizersList(&in.second);
+
+    // concatenate the attributes in a single buffer
+    visual_frame.num_shapes = visualizers.size();
+    visual_frame.references.clear();
+    for (int a = 0; a < Frame::NUM_ATTRIBUTES; ++a) {
+        visual_frame.offsets[a] = visual_frame.references.size();
+        visual_frame.references.insert(visual_frame.references.end(), refs[a].begin(), refs[a].end());
     }
+    visual_frame.values.assign(visual_frame.references.size(), 0.0);
+}
+
+fmi2Status FmuModelicaUnit::UpdateVisualizers() {
+    if (visual_frame.references.empty())
+        return fmi2OK;
+    return _fmi2GetReal(component, visual_frame.references.data(), visual_frame.references.size(),
+                        visual_frame.values.data());
 }
 
 }  // namespace fmi2
@@ -0,0 +1,332 @@
+// =============================================================================
+// fmu-forge
+//
+// Copyright (c) 2024 Project Chrono (projectchrono.org)
+// Copyright (c) 2024 Digital Dynamics Lab, University of Parma, Italy
+// Copyright (c) 2024 Simulation Based Engineering Lab, University of Wisconsin-Madison, USA
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution.
+//
+// =============================================================================
+// Adaptive communication step control for Co-Simulation FMUs (FMI 3.0)
+// =============================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "fmi3/FmuToolsImport.h"
+
+namespace fmu_forge {
+namespace fmi3 {
+
+/// @addtogroup fmu_forge_fmi3
+/// @{
+
+/// Controller of the communication step size of a Co-Simulation FMU, advancing the FMU with the largest steps that
+/// keep the estimated error of the monitored outputs within the tolerances.
+/// The error is estimated either by step doubling (a step of size h compared with two steps of size h/2, from the
+/// same FMU state) or by comparing the outputs with their linear extrapolation (using the output derivatives if the
+/// FMU provides them, maxOutputDerivativeOrder >= 1, or the outputs at the previous step otherwise).
+/// Steps exceeding the tolerances are rolled back and retried with a smaller size if the FMU can get and set its
+/// state; otherwise, only the size of the next step is reduced. Step doubling requires the rollback and falls back
+/// to extrapolation if not available. An FMU not declaring canHandleVariableCommunicationStepSize is advanced with the
+/// initial step size.
+/// All the buffers are allocated by Initialize, so that no allocation happens during AdvanceTo.
+class AdaptiveStepController {
+  public:
+    enum class ErrorEstimate {
+        STEP_DOUBLING,  ///< Richardson extrapolation of one step against two half steps (3 DoStep per step)
+        EXTRAPOLATION   ///< linear extrapolation of the outputs (1 DoStep per step)
+    };
+
+    AdaptiveStepController(FmuUnit& fmu, ErrorEstimate estimate = ErrorEstimate::STEP_DOUBLING);
+    ~AdaptiveStepController();
+
+    AdaptiveStepController(const AdaptiveStepController&) = delete;
+    AdaptiveStepController& operator=(const AdaptiveStepController&) = delete;
+
+    void SetErrorEstimate(ErrorEstimate estimate) { m_estimate = estimate; }
+
+    /// Set the Float64 outputs whose error is controlled (default: all the Float64 outputs of the FMU).
+    void SetOutputs(const std::vector<fmi3ValueReference>& outputs) { m_outputs = outputs; }
+
+    /// Set the initial step size (also the step size of FMUs not supporting variable communication steps).
+    void SetStepSize(double step_size) { m_stepSize = step_size; }
+
+    /// Set the range of the step size.
+    void SetStepSizeLimits(double min_step_size, double max_step_size) {
+        m_minStepSize = min_step_size;
+        m_maxStepSize = max_step_size;
+    }
+
+    /// Set the tolerances on the monitored outputs.
+    void SetTolerances(double rel_tol, double abs_tol) {
+        m_relTol = rel_tol;
+        m_absTol = abs_tol;
+    }
+
+    /// Set the order of convergence of the outputs with the communication step size, used by step doubling (default:
+    /// 1, as for the inputs held constant over the step).
+    void SetOrder(int order) { m_order = order; }
+
+    /// Initialize the controller at the given time.
+    /// Must be called after fmi3ExitInitializationMode.
+    fmi3Status Initialize(double start_time);
+
+    /// Advance the FMU up to the given time, with as many steps as required by the tolerances.
+    /// The last step is shortened to reach the given time exactly.
+    fmi3Status AdvanceTo(double time);
+
+    double GetTime() const { return m_time; }
+
+    /// Return the size of the next step.
+    double GetStepSize() const { return m_stepSizeNext; }
+
+    /// Check if the steps exceeding the tolerances can be rolled back (the FMU can get and set its state).
+    bool CanRollback() const { return m_rollback; }
+
+    /// Check if the step size is adapted (the FMU can handle variable communication step sizes).
+    bool IsAdaptive() const { return m_variableStep; }
+
+    /// Return the values of the monitored outputs at the current time.
+    const std::vector<fmi3Float64>& GetOutputs() const { return m_y; }
+
+    size_t GetNumSteps() const { return m_numSteps; }
+    size_t GetNumRejectedSteps() const { return m_numRejectedSteps; }
+    size_t GetNumDoStepCalls() const { return m_numDoStepCalls; }
+
+  private:
+    /// Call DoStep on the FMU.
+    fmi3Status doStep(double t, double h);
+
+    /// Get the monitored outputs.
+    fmi3Status getOutputs(fmi3Float64* y);
+
+    /// Compute the output derivatives, from the FMU or from the previous step (false if not available).
+    bool getOutputDerivatives();
+
+    /// Weighted maximum norm of the difference of two output vectors, relative to the tolerances.
+    double errorNorm(const std::vector<fmi3Float64>& a, const std::vector<fmi3Float64>& b, double scale) const;
+
+    /// Size of the next step, from the size and the normalized error of the last step.
+    double nextStepSize(double h, double err, double exponent) const;
+
+    FmuUnit& m_fmu;
+    ErrorEstimate m_estimate;
+
+    double m_stepSize = 1e-3;
+    double m_minStepSize = 1e-9;
+    double m_maxStepSize = std::numeric_limits<double>::infinity();
+    double m_relTol = 1e-4;
+    double m_absTol = 1e-6;
+    int m_order = 1;
+
+    bool m_variableStep = false;
+    bool m_rollback = false;
+    bool m_outputDerivatives = false;
+    ErrorEstimate m_activeEstimate = ErrorEstimate::EXTRAPOLATION;  ///< estimate used, given the FMU capabilities
+
+    std::vector<fmi3ValueReference> m_outputs;
+    std::vector<fmi3Int32> m_derivativeOrders;  ///< first order for all outputs (fmi3GetOutputDerivatives)
+    size_t m_ny = 0;
+
+    double m_time = 0;
+    double m_stepSizeNext = 0;
+    double m_stepSizePrev = 0;  ///< size of the previous step (0 if no history is available)
+
+    std::vector<fmi3Float64> m_y;      ///< outputs at the current time
+    std::vector<fmi3Float64> m_yPrev;  ///< outputs at the previous step
+    std::vector<fmi3Float64> m_dy;     ///< output derivatives at the current time
+    std::vector<fmi3Float64> m_yFull;  ///< outputs after a full step (step doubling) or extrapolated outputs
+    std::vector<fmi3Float64> m_yNew;   ///< outputs at the end of the step
+
+    fmi3FMUState m_state = nullptr;  ///< FMU state at the beginning of the step (rollback)
+
+    size_t m_numSteps = 0;
+    size_t m_numRejectedSteps = 0;
+    size_t m_numDoStepCalls = 0;
+};
+
+// -----------------------------------------------------------------------------
+
+AdaptiveStepController::AdaptiveStepController(FmuUnit& fmu, ErrorEstimate estimate)
+    : m_fmu(fmu), m_estimate(estimate) {}
+
+AdaptiveStepController::~AdaptiveStepController() {
+    if (m_state && m_fmu.instance)
+        m_fmu._fmi3FreeFMUState(m_fmu.instance, &m_state);
+}
+
+fmi3Status AdaptiveStepController::Initialize(double start_time) {
+    m_time = start_time;
+    m_stepSizeNext = std::min(std::max(m_stepSize, m_minStepSize), m_maxStepSize);
+    m_stepSizePrev = 0;
+    m_numSteps = 0;
+    m_numRejectedSteps = 0;
+    m_numDoStepCalls = 0;
+
+    m_variableStep = m_fmu.CanHandleVariableCommunicationStepSize();
+    m_rollback = m_fmu.CanGetAndSetFMUState();
+    m_outputDerivatives = m_fmu.GetMaxOutputDerivativeOrder() >= 1;
+    m_activeEstimate = m_estimate == ErrorEstimate::STEP_DOUBLING && m_rollback ? ErrorEstimate::STEP_DOUBLING
+                                                                                 : ErrorEstimate::EXTRAPOLATION;
+
+    if (m_outputs.empty()) {
+        for (const auto& iv : m_fmu.GetVariablesList()) {
+            const FmuVariableImport& var = iv.second;
+            if (var.GetCausality() == FmuVariable::CausalityType::output && var.GetType() == FmuVariable::Type::Float64)
+                m_outputs.push_back(iv.first);
+        }
+    }
+
+    m_ny = 0;
+    for (auto vr : m_outputs)
+        m_ny += m_fmu.GetVariableSize(vr);
+    m_derivativeOrders.assign(m_outputs.size(), 1);
+
+    m_y.assign(m_ny, 0.0);
+    m_yPrev.assign(m_ny, 0.0);
+    m_dy.assign(m_ny, 0.0);
+    m_yFull.assign(m_ny, 0.0);
+    m_yNew.assign(m_ny, 0.0);
+
+    fmi3Status status = getOutputs(m_y.data());
+
+    // the FMU state is allocated here, then overwritten at each step
+    if (m_rollback && !m_state)
+        status = std::max(status, m_fmu._fmi3GetFMUState(m_fmu.instance, &m_state));
+
+    return status;
+}
+
+fmi3Status AdaptiveStepController::AdvanceTo(double time) {
+    const double time_eps = 100 * std::numeric_limits<double>::epsilon() * std::max(1.0, std::abs(time));
+
+    fmi3Status status = fmi3Status::fmi3OK;
+    while (m_time < time - time_eps) {
+        double h = m_variableStep ? m_stepSizeNext : m_stepSize;
+        bool clipped = m_time + h > time - time_eps;
+        if (clipped)
+            h = time - m_time;
+
+        if (m_rollback && m_variableStep)
+            status = std::max(status, m_fmu._fmi3GetFMUState(m_fmu.instance, &m_state));
+
+        double err = 0;
+        double exponent = 0.5;
+        bool has_estimate = false;
+
+        if (!m_variableStep) {
+            status = std::max(status, doStep(m_time, h));
+            status = std::max(status, getOutputs(m_yNew.data()));
+        } else if (m_activeEstimate == ErrorEstimate::STEP_DOUBLING) {
+            // full step, then two half steps from the same state
+            status = std::max(status, doStep(m_time, h));
+            status = std::max(status, getOutputs(m_yFull.data()));
+            status = std::max(status, m_fmu._fmi3SetFMUState(m_fmu.instance, m_state));
+            status = std::max(status, doStep(m_time, 0.5 * h));
+            status = std::max(status, doStep(m_time + 0.5 * h, 0.5 * h));
+            status = std::max(status, getOutputs(m_yNew.data()));
+
+            err = errorNorm(m_yNew, m_yFull, 1.0 / (std::pow(2.0, m_order) - 1));
+            exponent = 1.0 / (m_order + 1);
+            has_estimate = true;
+        } else {
+            has_estimate = getOutputDerivatives();
+            if (has_estimate) {
+                for (size_t i = 0; i < m_ny; ++i)
+                    m_yFull[i] = m_y[i] + h * m_dy[i];
+            }
+            status = std::max(status, doStep(m_time, h));
+            status = std::max(status, getOutputs(m_yNew.data()));
+            if (has_estimate)
+                err = errorNorm(m_yNew, m_yFull, 1.0);
+        }
+
+        if (status > fmi3Status::fmi3Warning)
+            return status;
+
+        // rejected step, rolled back and retried with a smaller size
+        bool at_min = h <= m_minStepSize * (1 + 1e-12);
+        if (has_estimate && err > 1 && m_rollback && !at_min) {
+            status = std::max(status, m_fmu._fmi3SetFMUState(m_fmu.instance, m_state));
+            m_stepSizeNext = std::max(m_minStepSize, nextStepSize(h, err, exponent));
+            ++m_numRejectedSteps;
+            continue;
+        }
+
+        m_yPrev.swap(m_y);
+        m_y.swap(m_yNew);
+        m_time += h;
+        m_stepSizePrev = h;
+        ++m_numSteps;
+
+        // a step shortened to reach the target time does not limit the next one
+        if (m_variableStep && has_estimate && !(clipped && err <= 1))
+            m_stepSizeNext = std::min(std::max(m_minStepSize, nextStepSize(h, err, exponent)), m_maxStepSize);
+    }
+
+    return status;
+}
+
+fmi3Status AdaptiveStepController::doStep(double t, double h) {
+    ++m_numDoStepCalls;
+    // the importer restores earlier states only if rollback is enabled
+    return m_fmu.DoStep(t, h, m_rollback && m_variableStep ? fmi3False : fmi3True);
+}
+
+fmi3Status AdaptiveStepController::getOutputs(fmi3Float64* y) {
+    if (m_outputs.empty())
+        return fmi3Status::fmi3OK;
+    return m_fmu._fmi3GetFloat64(m_fmu.instance, m_outputs.data(), m_outputs.size(), y, m_ny);
+}
+
+bool AdaptiveStepController::getOutputDerivatives() {
+    if (m_ny == 0)
+        return false;
+
+    // an FMU failing to provide the derivatives it declares falls back to the previous step
+    if (m_outputDerivatives) {
+        if (m_fmu._fmi3GetOutputDerivatives(m_fmu.instance, m_outputs.data(), m_outputs.size(),
+                                            m_derivativeOrders.data(), m_dy.data(), m_ny) <= fmi3Status::fmi3Warning)
+            return true;
+        m_outputDerivatives = false;
+    }
+
+    if (m_stepSizePrev <= 0)
+        return false;
+    for (size_t i = 0; i < m_ny; ++i)
+        m_dy[i] = (m_y[i] - m_yPrev[i]) / m_stepSizePrev;
+    return true;
+}
+
+double AdaptiveStepController::errorNorm(const std::vector<fmi3Float64>& a,
+                                         const std::vector<fmi3Float64>& b,
+                                         double scale) const {
+    double err = 0;
+    for (size_t i = 0; i < m_ny; ++i) {
+        double tol = m_absTol + m_relTol * std::max(std::abs(a[i]), std::abs(b[i]));
+        err = std::max(err, scale * std::abs(a[i] - b[i]) / tol);
+    }
+    return err;
+}
+
+double AdaptiveStepController::nextStepSize(double h, double err, double exponent) const {
+    const double safety = 0.9;
+    const double min_factor = 0.2;
+    const double max_factor = 5.0;
+
+    double factor = err > 0 ? safety * std::pow(err, -exponent) : max_factor;
+    return h * std::min(max_factor, std::max(min_factor, factor));
+}
+
+/// @} fmu_forge_fmi3
+
+}  // namespace fmi3
+}  // namespace fmu_forge
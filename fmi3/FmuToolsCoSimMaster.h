@@ -0,0 +1,308 @@
+// =============================================================================
+// fmu-forge
+//
+// Copyright (c) 2024 Project Chrono (projectchrono.org)
+// Copyright (c) 2024 Digital Dynamics Lab, University of Parma, Italy
+// Copyright (c) 2024 Simulation Based Engineering Lab, University of Wisconsin-Madison, USA
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution.
+//
+// =============================================================================
+// Co-simulation master coupling several Co-Simulation FMUs (FMI 3.0)
+// =============================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fmi3/FmuToolsImport.h"
+#include "fmi3/FmuToolsThreadPool.h"
+
+namespace fmu_forge {
+namespace fmi3 {
+
+/// @addtogroup fmu_forge_fmi3
+/// @{
+
+/// Co-simulation master coupling a set of Co-Simulation FMUs through output-to-input connections.
+/// Each macro step is a Jacobi step: the DoStep of all the FMUs run concurrently on a thread pool, then the values of
+/// the connected variables are exchanged through FmuVariableGroup, with a single fmi3Get|fmi3Set call per FMU and
+/// variable type.
+/// Connections flagged as direct feedthrough are resolved Gauss-Seidel style instead: the destination FMU steps after
+/// the source one, receiving the output computed at the end of the current macro step. FMUs are thus grouped in levels
+/// that are stepped one after the other (FMUs within a level still run concurrently).
+/// The FMUs must be instantiated and initialized by the caller; the master does not take ownership of them.
+class CoSimMaster {
+  public:
+    /// Create a master using the given number of threads (if 0, the number of hardware threads).
+    explicit CoSimMaster(size_t num_threads = 0);
+
+    CoSimMaster(const CoSimMaster&) = delete;
+    CoSimMaster& operator=(const CoSimMaster&) = delete;
+
+    /// Add an FMU to the master; return its index.
+    size_t AddFmu(FmuUnit& fmu);
+
+    /// Connect an output of an FMU to an input of another FMU.
+    /// Variables must have the same numeric type and size. If 'feedthrough' is true, the destination FMU is stepped
+    /// after the source FMU and receives the output at the end of the current macro step.
+    void Connect(size_t src_fmu, fmi3ValueReference src_vr, size_t dst_fmu, fmi3ValueReference dst_vr,
+                 bool feedthrough = false);
+
+    /// Connect an output of an FMU to an input of another FMU, given the variable names.
+    void Connect(size_t src_fmu, const std::string& src_var, size_t dst_fmu, const std::string& dst_var,
+                 bool feedthrough = false) {
+        Connect(src_fmu, m_fmus[src_fmu]->GetValueReference(src_var), dst_fmu,
+                m_fmus[dst_fmu]->GetValueReference(dst_var), feedthrough);
+    }
+
+    /// Exchange the values of all the connections (e.g. to propagate the initial outputs before the first step).
+    fmi3Status ExchangeValues();
+
+    /// Advance all the FMUs from 'time' to 'time + step'.
+    /// Return the worst status returned by the FMUs; exceptions thrown while stepping are rethrown.
+    fmi3Status DoStep(fmi3Float64 time, fmi3Float64 step);
+
+    /// Return the number of FMUs.
+    size_t GetNumFmus() const { return m_fmus.size(); }
+
+    /// Return the number of stepping levels (1 if there are no feedthrough connections).
+    size_t GetNumLevels() {
+        prepare();
+        return m_levels.size();
+    }
+
+    /// Return the number of threads used to step the FMUs.
+    size_t GetNumThreads() const { return m_pool.GetNumThreads(); }
+
+  private:
+    struct Connection {
+        size_t src_fmu;
+        fmi3ValueReference src_vr;
+        size_t dst_fmu;
+        fmi3ValueReference dst_vr;
+        bool feedthrough;
+        FmuVariable::Type type;
+        size_t size;  ///< number of values
+    };
+
+    /// Copy of the values of a connection between the variable groups of an exchange.
+    struct Copy {
+        size_t src_group;
+        size_t src_member;
+        size_t dst_group;
+        size_t dst_member;
+        size_t bytes;
+    };
+
+    /// Batched transfer of the values of a set of connections.
+    struct Exchange {
+        std::vector<FmuVariableGroup> gets;  ///< outputs read from the source FMUs (one group per FMU)
+        std::vector<FmuVariableGroup> sets;  ///< inputs written into the destination FMUs (one group per FMU)
+        std::vector<Copy> copies;
+    };
+
+    /// Build the variable groups for the given connections.
+    void buildExchange(const std::vector<const Connection*>& connections, Exchange& exchange) const;
+
+    fmi3Status runExchange(Exchange& exchange);
+
+    /// Sort the FMUs in levels according to the feedthrough connections and build the exchanges.
+    void prepare();
+
+    std::vector<FmuUnit*> m_fmus;
+    std::vector<Connection> m_connections;
+
+    bool m_prepared = false;
+    std::vector<std::vector<size_t>> m_levels;       ///< FMUs stepped concurrently, level by level
+    std::vector<Exchange> m_levelExchanges;          ///< feedthrough values entering each level (first unused)
+    Exchange m_jacobiExchange;                       ///< values exchanged at the end of the macro step
+    Exchange m_fullExchange;                         ///< all the connections
+    std::vector<fmi3Status> m_stepStatus;            ///< status of the last DoStep of each FMU
+
+    FmuThreadPool m_pool;
+};
+
+// -----------------------------------------------------------------------------
+
+CoSimMaster::CoSimMaster(size_t num_threads) : m_pool(num_threads) {}
+
+size_t CoSimMaster::AddFmu(FmuUnit& fmu) {
+    m_fmus.push_back(&fmu);
+    m_prepared = false;
+    return m_fmus.size() - 1;
+}
+
+void CoSimMaster::Connect(size_t src_fmu,
+                          fmi3ValueReference src_vr,
+                          size_t dst_fmu,
+                          fmi3ValueReference dst_vr,
+                          bool feedthrough) {
+    if (src_fmu >= m_fmus.size() || dst_fmu >= m_fmus.size())
+        throw std::runtime_error("CoSimMaster: connection between FMUs not added to the master.");
+    if (src_fmu == dst_fmu && feedthrough)
+        throw std::runtime_error("CoSimMaster: feedthrough connection of an FMU with itself.");
+
+    const FmuVariableImport& src_var = m_fmus[src_fmu]->GetVariableInfo(src_vr);
+    const FmuVariableImport& dst_var = m_fmus[dst_fmu]->GetVariableInfo(dst_vr);
+
+    if (src_var.GetType() != dst_var.GetType())
+        throw std::runtime_error("CoSimMaster: variables '" + src_var.GetName() + "' and '" + dst_var.GetName() +
+                                 "' have different types.");
+    if (!FmuVariable::IsFixedSizeType(src_var.GetType()))
+        throw std::runtime_error("CoSimMaster: only numeric and Boolean variables can be connected ('" +
+                                 src_var.GetName() + "').");
+
+    size_t size = m_fmus[src_fmu]->GetVariableSize(src_var);
+    if (m_fmus[dst_fmu]->GetVariableSize(dst_var) != size)
+        throw std::runtime_error("CoSimMaster: variables '" + src_var.GetName() + "' and '" + dst_var.GetName() +
+                                 "' have different sizes.");
+
+    m_connections.push_back({src_fmu, src_vr, dst_fmu, dst_vr, feedthrough, src_var.GetType(), size});
+    m_prepared = false;
+}
+
+fmi3Status CoSimMaster::ExchangeValues() {
+    prepare();
+    return runExchange(m_fullExchange);
+}
+
+fmi3Status CoSimMaster::DoStep(fmi3Float64 time, fmi3Float64 step) {
+    prepare();
+
+    fmi3Status status = fmi3Status::fmi3OK;
+    for (size_t l = 0; l < m_levels.size(); ++l) {
+        // outputs of the previous levels feeding through into this level
+        if (l > 0)
+            status = std::max(status, runExchange(m_levelExchanges[l]));
+
+        const auto& level = m_levels[l];
+        m_pool.ParallelFor(level.size(), [this, &level, time, step](size_t i) {
+            size_t f = level[i];
+            m_stepStatus[f] = m_fmus[f]->DoStep(time, step, fmi3True);
+        });
+        for (size_t f : level)
+            status = std::max(status, m_stepStatus[f]);
+    }
+
+    return std::max(status, runExchange(m_jacobiExchange));
+}
+
+void CoSimMaster::buildExchange(const std::vector<const Connection*>& connections, Exchange& exchange) const {
+    exchange.gets.clear();
+    exchange.sets.clear();
+    exchange.copies.clear();
+
+    // variables read from (or written into) each FMU, each one listed once
+    size_t num_fmus = m_fmus.size();
+    std::vector<std::vector<fmi3ValueReference>> get_vrs(num_fmus);
+    std::vector<std::vector<fmi3ValueReference>> set_vrs(num_fmus);
+    auto add = [](std::vector<fmi3ValueReference>& vrs, fmi3ValueReference vr) {
+        auto pos = std::find(vrs.begin(), vrs.end(), vr);
+        if (pos == vrs.end())
+            pos = vrs.insert(vrs.end(), vr);
+        return static_cast<size_t>(pos - vrs.begin());
+    };
+
+    for (const Connection* c : connections) {
+        Copy copy;
+        copy.src_group = c->src_fmu;
+        copy.src_member = add(get_vrs[c->src_fmu], c->src_vr);
+        copy.dst_group = c->dst_fmu;
+        copy.dst_member = add(set_vrs[c->dst_fmu], c->dst_vr);
+        copy.bytes = c->size * FmuVariable::GetTypeSize(c->type);
+        exchange.copies.push_back(copy);
+    }
+
+    // one group for each FMU involved in the exchange
+    std::vector<size_t> get_group(num_fmus);
+    std::vector<size_t> set_group(num_fmus);
+    for (size_t f = 0; f < num_fmus; ++f) {
+        get_group[f] = exchange.gets.size();
+        if (!get_vrs[f].empty())
+            exchange.gets.emplace_back(*m_fmus[f], get_vrs[f]);
+        set_group[f] = exchange.sets.size();
+        if (!set_vrs[f].empty())
+            exchange.sets.emplace_back(*m_fmus[f], set_vrs[f]);
+    }
+
+    for (auto& copy : exchange.copies) {
+        copy.src_group = get_group[copy.src_group];
+        copy.dst_group = set_group[copy.dst_group];
+    }
+}
+
+fmi3Status CoSimMaster::runExchange(Exchange& exchange) {
+    fmi3Status status = fmi3Status::fmi3OK;
+
+    for (auto& group : exchange.gets)
+        status = std::max(status, group.Fetch());
+
+    for (const auto& copy : exchange.copies) {
+        std::memcpy(exchange.sets[copy.dst_group].RawValues(copy.dst_member),
+                    exchange.gets[copy.src_group].RawValues(copy.src_member), copy.bytes);
+    }
+
+    for (auto& group : exchange.sets)
+        status = std::max(status, group.Push());
+
+    return status;
+}
+
+void CoSimMaster::prepare() {
+    if (m_prepared)
+        return;
+
+    // level of each FMU: longest chain of feedthrough connections reaching it
+    size_t num_fmus = m_fmus.size();
+    std::vector<size_t> level(num_fmus, 0);
+    for (size_t iter = 0;; ++iter) {
+        bool changed = false;
+        for (const auto& c : m_connections) {
+            if (c.feedthrough && level[c.dst_fmu] < level[c.src_fmu] + 1) {
+                level[c.dst_fmu] = level[c.src_fmu] + 1;
+                changed = true;
+            }
+        }
+        if (!changed)
+            break;
+        if (iter >= num_fmus)
+            throw std::runtime_error("CoSimMaster: the feedthrough connections form an algebraic loop.");
+    }
+
+    size_t num_levels = num_fmus > 0 ? *std::max_element(level.begin(), level.end()) + 1 : 0;
+    m_levels.assign(num_levels, std::vector<size_t>());
+    for (size_t f = 0; f < num_fmus; ++f)
+        m_levels[level[f]].push_back(f);
+
+    std::vector<std::vector<const Connection*>> level_connections(num_levels);
+    std::vector<const Connection*> jacobi_connections;
+    std::vector<const Connection*> all_connections;
+    for (const auto& c : m_connections) {
+        if (c.feedthrough)
+            level_connections[level[c.dst_fmu]].push_back(&c);
+        else
+            jacobi_connections.push_back(&c);
+        all_connections.push_back(&c);
+    }
+
+    m_levelExchanges.resize(num_levels);
+    for (size_t l = 0; l < num_levels; ++l)
+        buildExchange(level_connections[l], m_levelExchanges[l]);
+    buildExchange(jacobi_connections, m_jacobiExchange);
+    buildExchange(all_connections, m_fullExchange);
+
+    m_stepStatus.assign(num_fmus, fmi3Status::fmi3OK);
+    m_prepared = true;
+}
+
+/// @} fmu_forge_fmi3
+
+}  // namespace fmi3
+}  // namespace fmu_forge
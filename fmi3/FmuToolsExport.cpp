@@ -26,14 +26,21 @@
 #define NOMINMAX
 #include <algorithm>
 
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
 #include <regex>
+#include <cstring>
+#include <cmath>
+#include <limits>
 #include <fstream>
 
 #include "fmi3/FmuToolsExport.h"
 #include "FmuToolsRuntimeLinking.h"
 
-#include "rapidxml/rapidxml_ext.hpp"
-
 namespace fmu_forge {
 namespace fmi3 {
 
@@ -85,12 +92,29 @@ bool createModelDescription(const std::string& path, std::string& err_msg) {
         e_modex = e;
     }
 
-    bool ok = has_cosim || has_modex;
+    // FMU implementing only the ScheduledExecution interface
+    bool has_sched = false;
+    if (!has_cosim && !has_modex) {
+        try {
+            fmu = fmi3InstantiateIMPL(FmuType::SCHEDULED_EXECUTION,                                      //
+                                      "",                                                                //
+                                      FMU_GUID,                                                          //
+                                      ("file:///" + GetLibraryLocation() + "/../../resources").c_str(),  //
+                                      fmi3False, fmi3False,                                              //
+                                      nullptr,                                                           //
+                                      LoggingUtilities::logger_default                                   //
+            );
+            has_sched = true;
+        } catch (std::exception&) {
+        }
+    }
+
+    bool ok = has_cosim || has_modex || has_sched;
 
     if (ok) {
         fmu->ExportModelDescription(path);
     } else {
-        err_msg = "FMU is not set as either CoSimulation nor ModelExchange.\nCosim exception : " +
+        err_msg = "FMU is not set as either CoSimulation, ModelExchange nor ScheduledExecution.\nCosim exception : " +
                   std::string(e_cosim.what()) + "\nModex exception: " + std::string(e_modex.what());
     }
 
@@ -190,8 +214,6 @@ void FmuVariableExport::SetValue(const fmi3Binary* val, size_t nValues, const si
                 " but it seems that it is a scalar.")
                    .c_str());
 
-        std::vector<fmi3Byte>* varptr_this = varns::get<std::vector<fmi3Byte>*>(m_varbind);
-
         // try to fetch the dimension of the variable
         size_t var_size;
         bool success = GetSize(var_size);
@@ -200,6 +222,22 @@ void FmuVariableExport::SetValue(const fmi3Binary* val, size_t nValues, const si
                "declared using {, true}.");
         assert(nValues == var_size && "The user provided nValues that is not matching the size of the variable.");
 
+        if (varns::holds_alternative<FmuBinaryBuffer*>(m_varbind)) {
+            FmuBinaryBuffer* buffer = varns::get<FmuBinaryBuffer*>(m_varbind);
+            for (size_t s = 0; s < nValues; s++) {
+                if (buffer[s].reference) {
+                    buffer[s].data = val[s];
+                } else {
+                    buffer[s].storage.assign(val[s], val[s] + valueSize_ptr[s]);
+                    buffer[s].data = buffer[s].storage.data();
+                }
+                buffer[s].size = valueSize_ptr[s];
+            }
+            return;
+        }
+
+        std::vector<fmi3Byte>* varptr_this = varns::get<std::vector<fmi3Byte>*>(m_varbind);
+
         // copy values
         for (size_t s = 0; s < nValues; s++) {
             varptr_this[s].resize(valueSize_ptr[s]);
@@ -230,22 +268,32 @@ void FmuVariableExport::GetValue(fmi3String* varptr_ext, size_t nValues) const {
         }
 
     } else {
-        // returns the address of the underlying string, does not copy any value
-        *varptr_ext =
-            varns::get<FunGetSet<std::string>>(m_varbind).first().data();  // TODO: check if c_str or data is needed
+        // the getter returns a temporary: keep a copy, valid until the next call
+        m_getterString = varns::get<FunGetSet<std::string>>(m_varbind).first();
+        *varptr_ext = m_getterString.c_str();
     }
 }
 
 void FmuVariableExport::GetValue(fmi3Binary* varptr_ext, size_t nValues, size_t* valueSize_ptr) const {
     if (is_pointer_variant(m_varbind)) {
-        // the fmi3Binary is implemented by default as an std::vector<fmi3Byte>
-        std::vector<fmi3Byte>* varptr_this = varns::get<std::vector<fmi3Byte>*>(m_varbind);
         size_t var_size;
         bool success = GetSize(var_size);
         assert(success &&
                "Developer Error: the size of a fmi3Binary variable could not be determined. Please ensure it has been "
                "declared using {, true}.");
         assert(nValues == var_size && "The user provided nValues that is not matching the size of the variable.");
+
+        if (varns::holds_alternative<FmuBinaryBuffer*>(m_varbind)) {
+            const FmuBinaryBuffer* buffer = varns::get<FmuBinaryBuffer*>(m_varbind);
+            for (size_t size = 0; size < var_size; size++) {
+                varptr_ext[size] = buffer[size].data;
+                valueSize_ptr[size] = buffer[size].size;
+            }
+            return;
+        }
+
+        // the fmi3Binary is implemented by default as an std::vector<fmi3Byte>
+        std::vector<fmi3Byte>* varptr_this = varns::get<std::vector<fmi3Byte>*>(m_varbind);
         for (size_t size = 0; size < var_size; size++) {
             varptr_ext[size] = varptr_this[size].data();
             valueSize_ptr[size] = varptr_this[size].size();
@@ -270,31 +318,169 @@ void variant_to_string(const std::vector<fmi3Byte>* varb, size_t id, std::string
     ss << std::dec;
 }
 
+void variant_to_string(const FmuBinaryBuffer* varb, size_t id, std::stringstream& ss) {
+    ss << std::hex;
+    for (size_t s = 0; s < varb[id].size; ++s) {
+        ss << static_cast<unsigned int>(varb[id].data[s]);
+    }
+    ss << std::dec;
+}
+
 void variant_to_string(const FunGetSet<std::string> varb, size_t size, std::stringstream& ss) {
     ss << varb.first();
 }
 
-std::string FmuVariableExport::GetStartValAsString(size_t size_id) const {
-    // TODO: C++17 would allow the overload operator in lambda
-    // std::string start_string;
-    // varns::visit([&start_string](auto&& arg) -> std::string {return start_string = std::to_string(*start_ptr)});
+namespace {
+
+// Append a value to 'out' with the same text as the default formatting of std::ostream.
+void append_value(std::string& out, bool value) {
+    out += value ? '1' : '0';
+}
 
-    std::stringstream start_value;
+void append_value(std::string& out, char value) {
+    out += value;
+}
 
-    if (m_type == Type::String || m_type == Type::Binary) {
-        size_t id = size_id;  // alias, just to make the code more readable
-        varns::visit([&start_value, id](auto&& varb) { variant_to_string(varb, id, start_value); }, m_varbind);
-    } else {
-        size_t size = size_id;  // alias, just to make the code more readable
-        if (size == 0) {
-            bool success = GetSize(size);
-            if (!success)
-                throw std::runtime_error("GetStartValAsString: cannot get size of variable.");
+void append_value(std::string& out, signed char value) {
+    out += static_cast<char>(value);
+}
+
+void append_value(std::string& out, unsigned char value) {
+    out += static_cast<char>(value);
+}
+
+template <typename T>
+void append_integer(std::string& out, T value) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, res.ptr);
+}
+
+void append_value(std::string& out, short value) {
+    append_integer(out, value);
+}
+void append_value(std::string& out, unsigned short value) {
+    append_integer(out, value);
+}
+void append_value(std::string& out, int value) {
+    append_integer(out, value);
+}
+void append_value(std::string& out, unsigned int value) {
+    append_integer(out, value);
+}
+// 64-bit integers (fmi3Int64, fmi3UInt64 and size_t), whatever their underlying type on the platform
+void append_value(std::string& out, std::int64_t value) {
+    append_integer(out, value);
+}
+void append_value(std::string& out, std::uint64_t value) {
+    append_integer(out, value);
+}
+
+// Floating point values are printed as with printf("%g"), the default of std::ostream (precision 6)
+template <typename T>
+void append_floating(std::string& out, T value) {
+    char buf[32];
+#if defined(__cpp_lib_to_chars)
+    auto res = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::general, 6);
+    out.append(buf, res.ptr);
+#else
+    int n = std::snprintf(buf, sizeof(buf), "%g", static_cast<double>(value));
+    out.append(buf, n);
+#endif
+}
+
+void append_value(std::string& out, float value) {
+    append_floating(out, value);
+}
+void append_value(std::string& out, double value) {
+    append_floating(out, value);
+}
+
+void append_value(std::string& out, const std::string& value) {
+    out += value;
+}
+
+// Fallback for other types
+template <typename T>
+void append_value(std::string& out, const T& value) {
+    std::ostringstream ss;
+    ss << value;
+    out += ss.str();
+}
+
+// Append the start value of a variable, with the same text as variant_to_string.
+struct StartValueAppender {
+    std::string& out;
+    size_t size;  ///< number of elements, or element index for String and Binary variables
+
+    template <typename T>
+    void append_array(const T* values, size_t n) const {
+        for (size_t s = 0; s < n; ++s) {
+            if (s > 0)
+                out += ' ';
+            append_value(out, values[s]);
+        }
+    }
+
+    template <typename T>
+    void operator()(const T* varb) const {
+        append_array(varb, size);
+    }
+
+    void operator()(const std::string* varb) const { out += varb[size]; }
+
+    void operator()(const std::vector<fmi3Byte>* varb) const { append_hex(varb[size].data(), varb[size].size()); }
+
+    void operator()(const FmuBinaryBuffer* varb) const { append_hex(varb[size].data, varb[size].size); }
+
+    void append_hex(const fmi3Byte* bytes, size_t n) const {
+        static const char digits[] = "0123456789abcdef";
+        for (size_t s = 0; s < n; ++s) {
+            unsigned int value = static_cast<unsigned char>(bytes[s]);
+            if (value >= 16)
+                out += digits[value >> 4];
+            out += digits[value & 15];
         }
-        varns::visit([&start_value, size](auto&& varb) { variant_to_string(varb, size, start_value); }, m_varbind);
     }
-    std::string s = start_value.str();
-    return start_value.str();
+
+    template <typename T>
+    void operator()(const FunGetSet<T>& varb) const {
+        append_value(out, varb.first());
+    }
+
+    template <typename T>
+    void operator()(const FmuSpan<T>& varb) const {
+        append_array(static_cast<const T*>(varb.data), std::min(size, varb.size));
+    }
+
+    template <typename T>
+    void operator()(const std::vector<T>* varb) const {
+        append_array(varb->data(), std::min(size, varb->size()));
+    }
+
+    template <typename T>
+    void operator()(const FunGetSetArray<T>& varb) const {
+        std::unique_ptr<T[]> values(new T[size]);
+        varb.first(values.get(), size);
+        append_array(static_cast<const T*>(values.get()), size);
+    }
+};
+
+}  // namespace
+
+void FmuVariableExport::AppendStartValAsString(std::string& out, size_t size_id) const {
+    if (m_type != Type::String && m_type != Type::Binary && size_id == 0) {
+        bool success = GetSize(size_id);
+        if (!success)
+            throw std::runtime_error("GetStartValAsString: cannot get size of variable.");
+    }
+    varns::visit(StartValueAppender{out, size_id}, m_varbind);
+}
+
+std::string FmuVariableExport::GetStartValAsString(size_t size_id) const {
+    std::string start_value;
+    AppendStartValAsString(start_value, size_id);
+    return start_value;
 }
 
 // =============================================================================
@@ -310,15 +496,25 @@ FmuComponentBase::FmuComponentBase(FmuType fmiInterfaceType,
                                    const std::unordered_map<std::string, bool>& logCategories_init,
                                    const std::unordered_set<std::string>& logCategories_debug_init)
     : m_instanceName(instanceName),
-      m_logMessage(logMessage),
       m_instantiationToken(FMU_GUID),
       m_visible(visible == fmi3True ? true : false),
+      m_logCategories_debug(logCategories_debug_init),
       m_debug_logging_enabled(loggingOn == fmi3True ? true : false),
-      m_instanceEnvironment(instanceEnvironment),
       m_modelIdentifier(FMU_MODEL_IDENTIFIER),
+      m_fmuType(fmiInterfaceType),
+      m_instanceEnvironment(instanceEnvironment),
+      m_logMessage(logMessage),
       m_fmuMachineState(FmuMachineState::instantiated),
-      m_logCategories_enabled(logCategories_init),
-      m_logCategories_debug(logCategories_debug_init) {
+      m_logCategories_enabled(logCategories_init) {
+    // resolve the log categories once, so that checking whether a message has to be sent is just an indexed lookup
+    for (const auto& lc : m_logCategories_enabled) {
+        m_logCategoryIds[lc.first] = static_cast<int>(m_logCategoryNames.size());
+        m_logCategoryNames.push_back(lc.first);
+    }
+    m_logCategoryActive.resize(m_logCategoryNames.size());
+    for (int id = 0; id < static_cast<int>(m_logCategoryNames.size()); ++id)
+        updateLogCategory(id);
+
     m_unitDefinitions["1"] = UnitDefinition("1");  // guarantee the existence of the default unit
     m_unitDefinitions[""] = UnitDefinition("");    // guarantee the existence of the unassigned unit
 
@@ -326,6 +522,19 @@ FmuComponentBase::FmuComponentBase(FmuType fmiInterfaceType,
                    FmuVariable::CausalityType::independent,                       //
                    FmuVariable::VariabilityType::continuous);
 
+#ifdef FMU_FORGE_REALTIME
+    EnableRealTimeMode(FMU_FORGE_REALTIME_BUDGET);
+#endif
+
+#ifdef FMU_FORGE_PROFILING
+    // reserved output, for importers that cannot collect the log
+    AddFmuVariable(std::make_pair(std::function<std::string()>([this]() { return GetProfileReport(); }),
+                                  std::function<void(std::string)>([](std::string) {})),
+                   "fmu_forge_profile", FmuVariable::Type::String, "1", "profile of the FMI functions",
+                   FmuVariable::CausalityType::output, FmuVariable::VariabilityType::discrete,
+                   FmuVariable::InitialType::exact);
+#endif
+
     // Parse URL according to https://datatracker.ietf.org/doc/html/rfc3986
     std::string m_resources_location_str = std::string(resourcePath);
 
@@ -377,6 +586,10 @@ void FmuComponentBase::initializeType(FmuType fmuType) {
             if (!is_modelexchange_available())
                 throw std::runtime_error("Requested ModelExchange FMU mode but it is not available.");
             break;
+        case FmuType::SCHEDULED_EXECUTION:
+            if (!is_scheduledexecution_available())
+                throw std::runtime_error("Requested ScheduledExecution FMU mode but it is not available.");
+            break;
         default:
             throw std::runtime_error("Requested unrecognized FMU type.");
             break;
@@ -385,13 +598,29 @@ void FmuComponentBase::initializeType(FmuType fmuType) {
 }
 
 void FmuComponentBase::SetDebugLogging(std::string cat, bool value) {
-    try {
-        m_logCategories_enabled[cat] = value;
-    } catch (const std::exception&) {
+    int id = GetLogCategoryId(cat);
+    if (id < 0) {
         sendToLog("The LogCategory \"" + cat +
                       "\" is not recognized by the FMU. Please check its availability in modelDescription.xml.\n",
                   fmi3Status::fmi3Error, "logStatusError");
+        return;
     }
+
+    m_logCategories_enabled[cat] = value;
+    updateLogCategory(id);
+}
+
+void FmuComponentBase::updateLogCategory(int msg_cat_id) {
+    const std::string& msg_cat = m_logCategoryNames[msg_cat_id];
+    m_logCategoryActive[msg_cat_id] =
+        m_logCategories_enabled[msg_cat] ||
+        (m_debug_logging_enabled && m_logCategories_debug.find(msg_cat) != m_logCategories_debug.end());
+}
+
+void FmuComponentBase::EnableAsyncLogging(size_t capacity) {
+    m_asyncLogSink.reset();
+    if (m_logMessage)
+        m_asyncLogSink.reset(new FmuAsyncLogSink(m_logMessage, m_instanceEnvironment, m_logCategoryNames, capacity));
 }
 
 const FmuVariableExport& FmuComponentBase::AddFmuVariable(const FmuVariableExport::VarbindType& varbind,
@@ -463,6 +692,11 @@ const FmuVariableExport& FmuComponentBase::AddFmuVariable(const FmuVariableExpor
     if (!ret.second)
         throw std::runtime_error("Developer error: cannot insert new variable into FMU.");
 
+    indexVariable(ret.first);
+    m_accessPlans.clear();
+    m_fmuStateLayoutValid = false;
+    m_stateLayoutValid = false;
+
     return *(ret.first);
 }
 
@@ -473,8 +707,22 @@ bool FmuComponentBase::RebindVariable(FmuVariableExport::VarbindType varbind, st
         newvar.Bind(varbind);
         m_variables.erase(*it);
 
+        // the new binding is accessed through the access plans
+        if (newvar.GetValueReference() < m_staticBindings.size())
+            m_staticBindings[newvar.GetValueReference()] = FmuStaticBinding();
+
         std::pair<std::set<FmuVariableExport>::iterator, bool> ret = m_variables.insert(newvar);
 
+        // the erased iterator is no longer valid: refresh the lookup table and drop the access plans
+        if (ret.second)
+            indexVariable(ret.first);
+        else
+            rebuildValrefIndex();
+        m_accessPlans.clear();
+        m_fmuStateLayoutValid = false;
+        m_stateLayoutValid = false;
+        m_stepStagesPrepared = false;
+
         return ret.second;
     }
 
@@ -504,7 +752,22 @@ void FmuComponentBase::addDerivative(const std::string& derivative_name,
             throw std::runtime_error("No state derivative variable with given name exists.");
     }
 
-    m_derivatives.insert({derivative_name, {state_name, dependency_names}});
+    if (findByName(state_name)->GetType() != FmuVariable::Type::Float64 ||
+        findByName(derivative_name)->GetType() != FmuVariable::Type::Float64)
+        throw std::runtime_error("Continuous states and their derivatives must be of type Float64.");
+
+    if (m_derivatives.insert({derivative_name, {state_name, dependency_names}}).second)
+        m_derivativeNames.push_back(derivative_name);
+    m_stateLayoutValid = false;
+    m_dependenciesPrepared = false;
+}
+
+void FmuComponentBase::SetStateNominal(const std::string& state_name, fmi3Float64 nominal) {
+    if (findByName(state_name) == m_variables.end())
+        throw std::runtime_error("No state variable with given name exists.");
+
+    m_stateNominals[state_name] = nominal;
+    m_stateLayoutValid = false;
 }
 
 std::string FmuComponentBase::isDerivative(const std::string& name) {
@@ -519,6 +782,40 @@ void FmuComponentBase::DeclareVariableDependencies(const std::string& variable_n
     addDependencies(variable_name, dependency_names);
 }
 
+fmi3ValueReference FmuComponentBase::AddModelPartition(const std::string& clock_name,
+                                                       fmi3Float64 interval,
+                                                       std::function<fmi3Status(fmi3Float64)> function,
+                                                       const std::string& description) {
+    if (findByName(clock_name) != m_variables.end())
+        throw std::runtime_error("Cannot add a clock with the same name of an FMU variable: " + clock_name);
+    for (const auto& partition : m_modelPartitions) {
+        if (partition.clock_name == clock_name)
+            throw std::runtime_error("Cannot add two model partitions with the same clock name: " + clock_name);
+    }
+    if (!(interval > 0))
+        throw std::runtime_error("The interval of clock '" + clock_name + "' must be positive.");
+
+    // clocks share the value references of the variables
+    FmuModelPartition partition;
+    partition.clock_name = clock_name;
+    partition.description = description;
+    partition.clock_valref = m_valrefCounter++;
+    partition.interval = interval;
+    partition.function = function;
+    m_modelPartitions.push_back(std::move(partition));
+
+    return m_modelPartitions.back().clock_valref;
+}
+
+const FmuComponentBase::FmuModelPartition* FmuComponentBase::findModelPartition(
+    fmi3ValueReference clockReference) const {
+    auto it = std::lower_bound(m_modelPartitions.begin(), m_modelPartitions.end(), clockReference,
+                               [](const FmuModelPartition& p, fmi3ValueReference vr) { return p.clock_valref < vr; });
+    if (it == m_modelPartitions.end() || it->clock_valref != clockReference)
+        return nullptr;
+    return &(*it);
+}
+
 void FmuComponentBase::addDependencies(const std::string& variable_name,
                                        const std::vector<std::string>& dependency_names) {
     // Check that a variable with specified name exists
@@ -542,142 +839,272 @@ void FmuComponentBase::addDependencies(const std::string& variable_name,
     } else {
         m_variableDependencies.insert({variable_name, dependency_names});
     }
+
+    // the inputs of the step stages include the declared dependencies
+    m_stepStagesPrepared = false;
+    m_dependenciesPrepared = false;
 }
 
 // -----------------------------------------------------------------------------
 
-void FmuComponentBase::ExportModelDescription(std::string path) {
-    preModelDescriptionExport();
+namespace {
 
-    // Create the XML document
-    rapidxml::xml_document<>* doc_ptr = new rapidxml::xml_document<>();
-
-    // Add the XML declaration
-    rapidxml::xml_node<>* declaration = doc_ptr->allocate_node(rapidxml::node_declaration);
-    declaration->append_attribute(doc_ptr->allocate_attribute("version", "1.0"));
-    declaration->append_attribute(doc_ptr->allocate_attribute("encoding", "UTF-8"));
-    doc_ptr->append_node(declaration);
-
-    // Create the root node
-    rapidxml::xml_node<>* rootNode = doc_ptr->allocate_node(rapidxml::node_element, "fmiModelDescription");
-    rootNode->append_attribute(doc_ptr->allocate_attribute("xmlns:xsi", "http://www.w3.org/2001/XMLSchema-instance"));
-    rootNode->append_attribute(doc_ptr->allocate_attribute("fmiVersion", fmi3GetVersion()));
-    rootNode->append_attribute(
-        doc_ptr->allocate_attribute("modelName", m_modelIdentifier.c_str()));  // modelName can be anything else
-    rootNode->append_attribute(doc_ptr->allocate_attribute("instantiationToken", m_instantiationToken.c_str()));
-    rootNode->append_attribute(doc_ptr->allocate_attribute("generationTool", "rapidxml"));
-    rootNode->append_attribute(doc_ptr->allocate_attribute("variableNamingConvention", "structured"));
-    doc_ptr->append_node(rootNode);
-
-    // Add CoSimulation node
-    if (is_cosimulation_available()) {
-        rapidxml::xml_node<>* coSimNode = doc_ptr->allocate_node(rapidxml::node_element, "CoSimulation");
-        coSimNode->append_attribute(doc_ptr->allocate_attribute("modelIdentifier", m_modelIdentifier.c_str()));
-        coSimNode->append_attribute(doc_ptr->allocate_attribute("canHandleVariableCommunicationStepSize", "true"));
-        coSimNode->append_attribute(doc_ptr->allocate_attribute("canInterpolateInputs", "true"));
-        coSimNode->append_attribute(doc_ptr->allocate_attribute("maxOutputDerivativeOrder", "1"));
-        coSimNode->append_attribute(doc_ptr->allocate_attribute("canGetAndSetFMUstate", "false"));
-        coSimNode->append_attribute(doc_ptr->allocate_attribute("canSerializeFMUstate", "false"));
-        coSimNode->append_attribute(doc_ptr->allocate_attribute("providesDirectionalDerivative", "false"));
-        rootNode->append_node(coSimNode);
-    }
-
-    // Add ModelExchange node
-    if (is_modelexchange_available()) {
-        rapidxml::xml_node<>* modExNode = doc_ptr->allocate_node(rapidxml::node_element, "ModelExchange");
-        modExNode->append_attribute(doc_ptr->allocate_attribute("modelIdentifier", m_modelIdentifier.c_str()));
-        modExNode->append_attribute(doc_ptr->allocate_attribute("needsExecutionTool", "false"));
-        modExNode->append_attribute(doc_ptr->allocate_attribute("completedIntegratorStepNotNeeded", "false"));
-        modExNode->append_attribute(doc_ptr->allocate_attribute("canBeInstantiatedOnlyOncePerProcess", "false"));
-        modExNode->append_attribute(doc_ptr->allocate_attribute("canNotUseMemoryManagementFunctions", "false"));
-        modExNode->append_attribute(doc_ptr->allocate_attribute("canGetAndSetFMUstate", "false"));
-        modExNode->append_attribute(doc_ptr->allocate_attribute("canSerializeFMUstate", "false"));
-        modExNode->append_attribute(doc_ptr->allocate_attribute("providesDirectionalDerivative", "false"));
-        rootNode->append_node(modExNode);
-    }
-
-    // NOTE: rapidxml does not copy the strings that we pass to print, but it just keeps the addresses until
-    // it's time to print them so we cannot use a temporary string to convert the number to string and then
-    // recycle it we cannot use std::vector because, in case of reallocation, it might move the array somewhere
-    // else thus invalidating the addresses. To address this, use a list that remains in scope for the duration.
-    std::list<std::string> stringbuf;
-
-    // Add UnitDefinitions node
-    rapidxml::xml_node<>* unitDefsNode = doc_ptr->allocate_node(rapidxml::node_element, "UnitDefinitions");
+// Streaming writer of XML documents, producing the same text as rapidxml::print (tab indentation, attribute values
+// quoted as by rapidxml) without building the document tree. Output is buffered and written in large blocks.
+class XmlStreamWriter {
+  public:
+    XmlStreamWriter(const std::string& filename) : m_file(filename, std::ios::binary) {
+        m_buffer.reserve(2 * flush_size);
+    }
 
-    for (auto& ud_pair : m_unitDefinitions) {
-        auto& ud = ud_pair.second;
-        rapidxml::xml_node<>* unitNode = doc_ptr->allocate_node(rapidxml::node_element, "Unit");
-        unitNode->append_attribute(doc_ptr->allocate_attribute("name", ud.name.c_str()));
+    ~XmlStreamWriter() { Flush(); }
 
-        rapidxml::xml_node<>* baseUnitNode = doc_ptr->allocate_node(rapidxml::node_element, "BaseUnit");
-        if (ud.kg != 0) {
-            stringbuf.push_back(std::to_string(ud.kg));
-            baseUnitNode->append_attribute(doc_ptr->allocate_attribute("kg", stringbuf.back().c_str()));
-        }
-        if (ud.m != 0) {
-            stringbuf.push_back(std::to_string(ud.m));
-            baseUnitNode->append_attribute(doc_ptr->allocate_attribute("m", stringbuf.back().c_str()));
-        }
-        if (ud.s != 0) {
-            stringbuf.push_back(std::to_string(ud.s));
-            baseUnitNode->append_attribute(doc_ptr->allocate_attribute("s", stringbuf.back().c_str()));
-        }
-        if (ud.A != 0) {
-            stringbuf.push_back(std::to_string(ud.A));
-            baseUnitNode->append_attribute(doc_ptr->allocate_attribute("A", stringbuf.back().c_str()));
+    void Declaration(const char* version, const char* encoding) {
+        m_buffer += "<?xml";
+        Attribute("version", version);
+        Attribute("encoding", encoding);
+        m_buffer += "?>\n";
+    }
+
+    /// Start an element; its attributes must be added before any child element.
+    void StartElement(const char* name) {
+        closeStartTag();
+        m_buffer.append(m_stack.size(), '\t');
+        m_buffer += '<';
+        m_buffer += name;
+        m_stack.push_back(name);
+        m_open = true;
+    }
+
+    void EndElement() {
+        if (m_open) {
+            m_buffer += "/>\n";
+            m_open = false;
+        } else {
+            m_buffer.append(m_stack.size() - 1, '\t');
+            m_buffer += "</";
+            m_buffer += m_stack.back();
+            m_buffer += ">\n";
         }
-        if (ud.K != 0) {
-            stringbuf.push_back(std::to_string(ud.K));
-            baseUnitNode->append_attribute(doc_ptr->allocate_attribute("K", stringbuf.back().c_str()));
+        m_stack.pop_back();
+        if (m_buffer.size() > flush_size)
+            Flush();
+    }
+
+    /// Add an attribute to the current element (the value is used up to its first null character, as in rapidxml).
+    void Attribute(const char* name, const char* value) {
+        size_t size = std::strlen(value);
+        m_buffer += ' ';
+        m_buffer += name;
+        m_buffer += '=';
+        // values containing double quotes are delimited by single quotes
+        char quote = std::memchr(value, '"', size) ? '\'' : '"';
+        m_buffer += quote;
+        for (const char* c = value; c != value + size; ++c) {
+            switch (*c) {
+                case '<':
+                    m_buffer += "&lt;";
+                    break;
+                case '>':
+                    m_buffer += "&gt;";
+                    break;
+                case '&':
+                    m_buffer += "&amp;";
+                    break;
+                case '\'':
+                    m_buffer += quote == '"' ? "'" : "&apos;";
+                    break;
+                case '"':
+                    m_buffer += quote == '\'' ? "\"" : "&quot;";
+                    break;
+                default:
+                    m_buffer += *c;
+            }
         }
-        if (ud.mol != 0) {
-            stringbuf.push_back(std::to_string(ud.mol));
-            baseUnitNode->append_attribute(doc_ptr->allocate_attribute("mol", stringbuf.back().c_str()));
+        m_buffer += quote;
+    }
+
+    void Attribute(const char* name, const std::string& value) { Attribute(name, value.c_str()); }
+
+    template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    void Attribute(const char* name, T value) {
+        m_scratch.clear();
+        append_value(m_scratch, value);
+        Attribute(name, m_scratch);
+    }
+
+    /// Terminate the document (rapidxml ends the printed document with an empty line).
+    void EndDocument() {
+        m_buffer += '\n';
+        Flush();
+    }
+
+    void Flush() {
+        m_file.write(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+    }
+
+  private:
+    static const size_t flush_size = 1 << 16;
+
+    void closeStartTag() {
+        if (m_open) {
+            m_buffer += ">\n";
+            m_open = false;
         }
-        if (ud.cd != 0) {
-            stringbuf.push_back(std::to_string(ud.cd));
-            baseUnitNode->append_attribute(doc_ptr->allocate_attribute("cd", stringbuf.back().c_str()));
+    }
+
+    std::ofstream m_file;
+    std::string m_buffer;
+    std::string m_scratch;
+    std::vector<const char*> m_stack;  ///< names of the open elements
+    bool m_open = false;  ///< start tag of the current element not closed yet
+};
+
+}  // namespace
+
+void FmuComponentBase::ExportModelDescription(std::string path) {
+    addRealTimeVariables();
+    preModelDescriptionExport();
+
+    // Check that dependencies are defined for all variables that require them
+    for (const auto& var : m_variables) {
+        auto causality = var.GetCausality();
+        auto initial = var.GetInitial();
+
+        if (m_variableDependencies.find(var.GetName()) == m_variableDependencies.end()) {
+            if (causality == FmuVariable::CausalityType::output &&
+                (initial == FmuVariable::InitialType::approx || initial == FmuVariable::InitialType::calculated)) {
+                std::string msg =
+                    "Dependencies required for an 'output' variable with initial='approx' or 'calculated' (" +
+                    var.GetName() + ").";
+                std::cout << "ERROR: " << msg << std::endl;
+                throw std::runtime_error(msg);
+            }
+
+            if (causality == FmuVariable::CausalityType::calculatedParameter) {
+                std::string msg = "Dependencies required for a 'calculatedParameter' variable (" + var.GetName() + ").";
+                std::cout << "ERROR: " << msg << std::endl;
+                throw std::runtime_error(msg);
+            }
         }
-        if (ud.rad != 0) {
-            stringbuf.push_back(std::to_string(ud.rad));
-            baseUnitNode->append_attribute(doc_ptr->allocate_attribute("rad", stringbuf.back().c_str()));
+    }
+
+    // The XML document is written while it is generated, with no intermediate document tree
+    XmlStreamWriter xml(path + "/modelDescription.xml");
+
+    xml.Declaration("1.0", "UTF-8");
+
+    // Root node
+    xml.StartElement("fmiModelDescription");
+    xml.Attribute("xmlns:xsi", "http://www.w3.org/2001/XMLSchema-instance");
+    xml.Attribute("fmiVersion", fmi3GetVersion());
+    xml.Attribute("modelName", m_modelIdentifier);  // modelName can be anything else
+    xml.Attribute("instantiationToken", m_instantiationToken);
+    xml.Attribute("generationTool", "rapidxml");
+    xml.Attribute("variableNamingConvention", "structured");
+
+    // CoSimulation node
+    if (is_cosimulation_available()) {
+        xml.StartElement("CoSimulation");
+        xml.Attribute("modelIdentifier", m_modelIdentifier);
+        xml.Attribute("canHandleVariableCommunicationStepSize", "true");
+        xml.Attribute("canInterpolateInputs", "true");
+        xml.Attribute("maxOutputDerivativeOrder", "1");
+        xml.Attribute("canGetAndSetFMUState", m_canGetAndSetFMUState ? "true" : "false");
+        xml.Attribute("canSerializeFMUState", m_canSerializeFMUState ? "true" : "false");
+        xml.Attribute("providesDirectionalDerivatives", m_providesDirectionalDerivatives ? "true" : "false");
+        xml.Attribute("providesAdjointDerivatives", m_providesAdjointDerivatives ? "true" : "false");
+        if (m_providesIntermediateUpdate) {
+            xml.Attribute("providesIntermediateUpdate", "true");
+            if (m_canReturnEarlyAfterIntermediateUpdate) {
+                xml.Attribute("mightReturnEarlyFromDoStep", "true");
+                xml.Attribute("canReturnEarlyAfterIntermediateUpdate", "true");
+            }
         }
-        unitNode->append_node(baseUnitNode);
+        xml.EndElement();
+    }
+
+    // ModelExchange node
+    if (is_modelexchange_available()) {
+        xml.StartElement("ModelExchange");
+        xml.Attribute("modelIdentifier", m_modelIdentifier);
+        xml.Attribute("needsExecutionTool", "false");
+        xml.Attribute("completedIntegratorStepNotNeeded", "false");
+        xml.Attribute("canBeInstantiatedOnlyOncePerProcess", "false");
+        xml.Attribute("canNotUseMemoryManagementFunctions", "false");
+        xml.Attribute("canGetAndSetFMUState", m_canGetAndSetFMUState ? "true" : "false");
+        xml.Attribute("canSerializeFMUState", m_canSerializeFMUState ? "true" : "false");
+        xml.Attribute("providesDirectionalDerivatives", m_providesDirectionalDerivatives ? "true" : "false");
+        xml.Attribute("providesAdjointDerivatives", m_providesAdjointDerivatives ? "true" : "false");
+        xml.EndElement();
+    }
 
-        unitDefsNode->append_node(unitNode);
+    // ScheduledExecution node
+    if (is_scheduledexecution_available()) {
+        xml.StartElement("ScheduledExecution");
+        xml.Attribute("modelIdentifier", m_modelIdentifier);
+        xml.Attribute("needsExecutionTool", "false");
+        xml.Attribute("canBeInstantiatedOnlyOncePerProcess", "false");
+        xml.Attribute("canNotUseMemoryManagementFunctions", "false");
+        xml.Attribute("canGetAndSetFMUState", m_canGetAndSetFMUState ? "true" : "false");
+        xml.Attribute("canSerializeFMUState", m_canSerializeFMUState ? "true" : "false");
+        xml.Attribute("providesDirectionalDerivatives", m_providesDirectionalDerivatives ? "true" : "false");
+        xml.Attribute("providesAdjointDerivatives", m_providesAdjointDerivatives ? "true" : "false");
+        xml.EndElement();
+    }
+
+    // UnitDefinitions node
+    xml.StartElement("UnitDefinitions");
+    for (auto& ud_pair : m_unitDefinitions) {
+        auto& ud = ud_pair.second;
+        xml.StartElement("Unit");
+        xml.Attribute("name", ud.name);
+
+        xml.StartElement("BaseUnit");
+        if (ud.kg != 0)
+            xml.Attribute("kg", ud.kg);
+        if (ud.m != 0)
+            xml.Attribute("m", ud.m);
+        if (ud.s != 0)
+            xml.Attribute("s", ud.s);
+        if (ud.A != 0)
+            xml.Attribute("A", ud.A);
+        if (ud.K != 0)
+            xml.Attribute("K", ud.K);
+        if (ud.mol != 0)
+            xml.Attribute("mol", ud.mol);
+        if (ud.cd != 0)
+            xml.Attribute("cd", ud.cd);
+        if (ud.rad != 0)
+            xml.Attribute("rad", ud.rad);
+        xml.EndElement();
+
+        xml.EndElement();
     }
-    rootNode->append_node(unitDefsNode);
+    xml.EndElement();
 
-    // Add LogCategories node
-    rapidxml::xml_node<>* logCategoriesNode = doc_ptr->allocate_node(rapidxml::node_element, "LogCategories");
+    // LogCategories node
+    xml.StartElement("LogCategories");
     for (auto& lc : m_logCategories_enabled) {
-        rapidxml::xml_node<>* logCategoryNode = doc_ptr->allocate_node(rapidxml::node_element, "Category");
-        logCategoryNode->append_attribute(doc_ptr->allocate_attribute("name", lc.first.c_str()));
-        logCategoryNode->append_attribute(doc_ptr->allocate_attribute(
-            "description", m_logCategories_debug.find(lc.first) == m_logCategories_debug.end() ? "NotDebugCategory"
-                                                                                               : "DebugCategory"));
-        logCategoriesNode->append_node(logCategoryNode);
-    }
-    rootNode->append_node(logCategoriesNode);
-
-    // Add DefaultExperiment node
-    std::string startTime_str = std::to_string(m_startTime);
-    std::string stopTime_str = std::to_string(m_stopTime);
-    std::string stepSize_str = std::to_string(m_stepSize);
-    std::string tolerance_str = std::to_string(m_tolerance);
-
-    rapidxml::xml_node<>* defaultExpNode = doc_ptr->allocate_node(rapidxml::node_element, "DefaultExperiment");
-    defaultExpNode->append_attribute(doc_ptr->allocate_attribute("startTime", startTime_str.c_str()));
-    defaultExpNode->append_attribute(doc_ptr->allocate_attribute("stopTime", stopTime_str.c_str()));
+        xml.StartElement("Category");
+        xml.Attribute("name", lc.first);
+        xml.Attribute("description", m_logCategories_debug.find(lc.first) == m_logCategories_debug.end()
+                                         ? "NotDebugCategory"
+                                         : "DebugCategory");
+        xml.EndElement();
+    }
+    xml.EndElement();
+
+    // DefaultExperiment node
+    xml.StartElement("DefaultExperiment");
+    xml.Attribute("startTime", std::to_string(m_startTime));
+    xml.Attribute("stopTime", std::to_string(m_stopTime));
     if (m_stepSize > 0)
-        defaultExpNode->append_attribute(doc_ptr->allocate_attribute("stepSize", stepSize_str.c_str()));
+        xml.Attribute("stepSize", std::to_string(m_stepSize));
     if (m_tolerance > 0)
-        defaultExpNode->append_attribute(doc_ptr->allocate_attribute("tolerance", tolerance_str.c_str()));
-    rootNode->append_node(defaultExpNode);
-
-    // Add ModelVariables node
-    rapidxml::xml_node<>* modelVarsNode = doc_ptr->allocate_node(rapidxml::node_element, "ModelVariables");
+        xml.Attribute("tolerance", std::to_string(m_tolerance));
+    xml.EndElement();
 
     // TODO: move elsewhere
     const std::unordered_map<FmuVariable::Type, std::string> Type_strings = {
@@ -730,370 +1157,2177 @@ void FmuComponentBase::ExportModelDescription(std::string path) {
             outputValrefs.push_back(valref);
     }
 
-    // Traverse all variables and create XML nodes
+    // ModelVariables node
+    xml.StartElement("ModelVariables");
+
+    std::string value;  // reused for the formatting of start values
     for (auto it = m_variables.begin(); it != m_variables.end(); ++it) {
-        // Create the variable node (node name is the variable type)
-        rapidxml::xml_node<>* varNode =
-            doc_ptr->allocate_node(rapidxml::node_element, Type_strings.at(it->GetType()).c_str());
-
-        // Add variable node attributes
-        varNode->append_attribute(doc_ptr->allocate_attribute("name", it->GetName().c_str()));
-        stringbuf.push_back(std::to_string(it->GetValueReference()));
-        varNode->append_attribute(doc_ptr->allocate_attribute("valueReference", stringbuf.back().c_str()));
-        varNode->append_attribute(
-            doc_ptr->allocate_attribute("causality", CausalityType_strings.at(it->GetCausality()).c_str()));
-        varNode->append_attribute(
-            doc_ptr->allocate_attribute("variability", VariabilityType_strings.at(it->GetVariability()).c_str()));
+        // Variable node (node name is the variable type)
+        xml.StartElement(Type_strings.at(it->GetType()).c_str());
+
+        // Variable node attributes
+        xml.Attribute("name", it->GetName());
+        xml.Attribute("valueReference", it->GetValueReference());
+        xml.Attribute("causality", CausalityType_strings.at(it->GetCausality()));
+        xml.Attribute("variability", VariabilityType_strings.at(it->GetVariability()));
         if (it->GetInitial() != FmuVariable::InitialType::none)
-            varNode->append_attribute(
-                doc_ptr->allocate_attribute("initial", InitialType_strings.at(it->GetInitial()).c_str()));
+            xml.Attribute("initial", InitialType_strings.at(it->GetInitial()));
         if ((it->GetType() == FmuVariable::Type::Float64 || it->GetType() == FmuVariable::Type::Float32) &&
             !it->GetUnitName().empty())
-            varNode->append_attribute(doc_ptr->allocate_attribute("unit", it->GetUnitName().c_str()));
+            xml.Attribute("unit", it->GetUnitName());
+
+        // For all variables but String and Binary, the start value is given as an attribute of the variable element
+        bool start_elements =
+            it->GetType() == FmuVariable::Type::String || it->GetType() == FmuVariable::Type::Binary;
+        if (it->IsStartValueExposed() && !start_elements) {
+            value.clear();
+            it->AppendStartValAsString(value, GetVariableSize(*it));
+            xml.Attribute("start", value);
+        }
+
+        // Check if this variable is the derivative of another variable
+        auto state_name = isDerivative(it->GetName());
+        if (!state_name.empty())
+            xml.Attribute("derivative", allValrefs[state_name]);
+
+        if (!it->GetDescription().empty())
+            xml.Attribute("description", it->GetDescription());
+
+        // Expose Dimension node (if array)
+        for (auto& dim : it->GetDimensions()) {
+            xml.StartElement("Dimension");
+            xml.Attribute(dim.second ? "start" : "valueReference", std::to_string(dim.first));
+            xml.EndElement();
+        }
+
+        // String and Binary start values are given as Start elements
+        if (it->IsStartValueExposed() && start_elements) {
+            for (size_t el_sel = 0; el_sel < GetVariableSize(*it); ++el_sel) {
+                xml.StartElement("Start");
+                value.clear();
+                it->AppendStartValAsString(value, el_sel);
+                xml.Attribute("value", value);
+                xml.EndElement();
+            }
+        }
+
+        xml.EndElement();
+    }
+
+    // Clock nodes: periodic input clocks activating the model partitions
+    if (is_scheduledexecution_available()) {
+        for (const auto& partition : m_modelPartitions) {
+            xml.StartElement("Clock");
+            xml.Attribute("name", partition.clock_name);
+            xml.Attribute("valueReference", partition.clock_valref);
+            xml.Attribute("causality", "input");
+            xml.Attribute("variability", "discrete");
+            xml.Attribute("intervalVariability", "constant");
+            value.clear();
+            append_value(value, partition.interval);
+            xml.Attribute("intervalDecimal", value);
+            if (!partition.description.empty())
+                xml.Attribute("description", partition.description);
+            xml.EndElement();
+        }
+    }
+
+    xml.EndElement();
+
+    // ModelStructure node
+    xml.StartElement("ModelStructure");
+
+    //      ...Outputs
+    for (int valref : outputValrefs) {
+        xml.StartElement("Output");
+        xml.Attribute("valueReference", valref);
+
+        // outputs without declared dependencies depend on all the knowns
+        auto deps = m_variableDependencies.find(findByValref(valref)->GetName());
+        if (deps != m_variableDependencies.end()) {
+            value.clear();
+            for (const auto& d : deps->second) {
+                append_value(value, allValrefs[d]);
+                value += ' ';
+            }
+            xml.Attribute("dependencies", value);
+        }
+
+        xml.EndElement();
+    }
+
+    //     ...Derivatives (in the order of the continuous states)
+    for (const auto& name : m_derivativeNames) {
+        const auto& d = *m_derivatives.find(name);
+        xml.StartElement("ContinuousStateDerivative");
+        xml.Attribute("valueReference", allValrefs[d.first]);
+
+        value.clear();
+        for (const auto& dep : d.second.second) {
+            append_value(value, allValrefs[dep]);
+            value += ' ';
+        }
+        xml.Attribute("dependencies", value);
+
+        //// TODO: dependeciesKind
+
+        xml.EndElement();
+    }
+
+    //     ...InitialUnknowns
+    for (const auto& v : m_variableDependencies) {
+        xml.StartElement("InitialUnknown");
+        xml.Attribute("valueReference", allValrefs[v.first]);
+        value.clear();
+        for (const auto& d : v.second) {
+            append_value(value, allValrefs[d]);
+            value += ' ';
+        }
+        xml.Attribute("dependencies", value);
+        xml.EndElement();
+    }
+
+    xml.EndElement();
+
+    xml.EndElement();
+    xml.EndDocument();
+
+    postModelDescriptionExport();
+}
+
+// -----------------------------------------------------------------------------
+
+const std::vector<size_t>& FmuComponentBase::GetVariableDimensions(fmi3ValueReference valref) const {
+    return GetVariableDimensions(*findByValref(valref));
+}
+
+size_t FmuComponentBase::GetVariableSize(const FmuVariable& var) const {
+    if (var.IsScalar())
+        return 1;
+
+    return getVariableShape(var).size;
+}
+
+void FmuComponentBase::executePreStepCallbacks() {
+    FMU_PROFILE_SCOPE(this, "preStepCallbacks");
+    runStepStages(m_preStepStages);
+}
+
+void FmuComponentBase::executePostStepCallbacks() {
+    FMU_PROFILE_SCOPE(this, "postStepCallbacks");
+    runStepStages(m_postStepStages);
+}
+
+namespace {
+
+// Compare the current value of a variable with the copy taken at the last execution of a stage, updating the copy.
+// Returns true if the value changed.
+struct FmuValueChangeVisitor {
+    std::string& last;
+    size_t count;
+
+    bool update(const void* data, size_t size) const {
+        if (last.size() == size && (size == 0 || std::memcmp(last.data(), data, size) == 0))
+            return false;
+        last.assign(static_cast<const char*>(data), size);
+        return true;
+    }
+
+    template <typename T>
+    bool operator()(T* ptr) const {
+        return update(ptr, count * sizeof(T));
+    }
+
+    template <typename T>
+    bool operator()(const FmuSpan<T>& span) const {
+        return update(span.data, std::min(count, span.size) * sizeof(T));
+    }
+
+    template <typename T>
+    bool operator()(std::vector<T>* vec) const {
+        return update(vec->data(), vec->size() * sizeof(T));
+    }
+
+    template <typename T>
+    bool operator()(const FunGetSet<T>& fun) const {
+        T val = fun.first();
+        return update(&val, sizeof(T));
+    }
+
+    template <typename T>
+    bool operator()(const FunGetSetArray<T>& fun) const {
+        std::unique_ptr<T[]> values(new T[count]);
+        fun.first(values.get(), count);
+        return update(values.get(), count * sizeof(T));
+    }
+
+    bool operator()(std::string* ptr) const {
+        std::string cur;
+        for (size_t i = 0; i < count; ++i)
+            cur.append(ptr[i].c_str(), ptr[i].size() + 1);
+        return update(cur.data(), cur.size());
+    }
+
+    bool operator()(std::vector<fmi3Byte>* ptr) const {
+        std::string cur;
+        for (size_t i = 0; i < count; ++i) {
+            size_t size = ptr[i].size();
+            cur.append(reinterpret_cast<const char*>(&size), sizeof(size));
+            cur.append(reinterpret_cast<const char*>(ptr[i].data()), size);
+        }
+        return update(cur.data(), cur.size());
+    }
+
+    bool operator()(FmuBinaryBuffer* ptr) const {
+        std::string cur;
+        for (size_t i = 0; i < count; ++i) {
+            cur.append(reinterpret_cast<const char*>(&ptr[i].size), sizeof(size_t));
+            cur.append(reinterpret_cast<const char*>(ptr[i].data), ptr[i].size);
+        }
+        return update(cur.data(), cur.size());
+    }
+
+    bool operator()(const FunGetSet<std::string>& fun) const {
+        std::string val = fun.first();
+        return update(val.data(), val.size());
+    }
+};
+
+}  // namespace
+
+void FmuComponentBase::addStepStage(std::vector<FmuStepStage>& stages,
+                                    std::function<void(void)> function,
+                                    const std::vector<std::string>& outputs,
+                                    const std::vector<std::string>& inputs) {
+    for (const auto& name : outputs)
+        if (findByName(name) == m_variables.end())
+            throw std::runtime_error("No output variable named '" + name + "' exists for the step stage.");
+    for (const auto& name : inputs)
+        if (findByName(name) == m_variables.end())
+            throw std::runtime_error("No input variable named '" + name + "' exists for the step stage.");
+
+    FmuStepStage stage;
+    stage.function = function;
+    stage.output_names = outputs;
+    stage.input_names = inputs;
+#ifdef FMU_FORGE_PROFILING
+    stage.profile_name = std::string(&stages == &m_preStepStages ? "preStep" : "postStep") + "[" +
+                         std::to_string(stages.size()) + "]";
+    for (size_t i = 0; i < outputs.size(); ++i)
+        stage.profile_name += (i == 0 ? " " : ",") + outputs[i];
+#endif
+    stages.push_back(std::move(stage));
+
+    m_stepStagesPrepared = false;
+}
+
+void FmuComponentBase::prepareStepStages(std::vector<FmuStepStage>& stages) {
+    // resolve the inputs: explicit ones plus the declared dependencies of the outputs
+    for (auto& stage : stages) {
+        std::set<std::string> names(stage.input_names.begin(), stage.input_names.end());
+        for (const auto& output : stage.output_names) {
+            auto deps = m_variableDependencies.find(output);
+            if (deps != m_variableDependencies.end())
+                names.insert(deps->second.begin(), deps->second.end());
+        }
+        stage.inputs.clear();
+        for (const auto& name : names)
+            stage.inputs.push_back(findByName(name));
+        stage.last_values.assign(stage.inputs.size(), std::string());
+        stage.dirty = true;
+
+        // stages without known inputs are always executed
+        stage.conditional = !stage.inputs.empty();
+    }
+
+    // sort the stages in dependency order (Kahn's algorithm, ties broken by insertion order)
+    std::unordered_map<std::string, size_t> producers;
+    for (size_t i = 0; i < stages.size(); ++i)
+        for (const auto& output : stages[i].output_names)
+            producers[output] = i;
+
+    std::vector<std::vector<size_t>> consumers(stages.size());
+    std::vector<size_t> num_producers(stages.size(), 0);
+    for (size_t i = 0; i < stages.size(); ++i) {
+        std::set<size_t> stage_producers;
+        for (const auto& input : stages[i].inputs) {
+            auto producer = producers.find(input->GetName());
+            if (producer != producers.end() && producer->second != i)
+                stage_producers.insert(producer->second);
+        }
+        for (size_t p : stage_producers)
+            consumers[p].push_back(i);
+        num_producers[i] = stage_producers.size();
+    }
+
+    std::set<size_t> ready;
+    for (size_t i = 0; i < stages.size(); ++i)
+        if (num_producers[i] == 0)
+            ready.insert(i);
+
+    std::vector<FmuStepStage> sorted;
+    sorted.reserve(stages.size());
+    while (!ready.empty()) {
+        size_t i = *ready.begin();
+        ready.erase(ready.begin());
+        sorted.push_back(std::move(stages[i]));
+        for (size_t c : consumers[i])
+            if (--num_producers[c] == 0)
+                ready.insert(c);
+    }
+
+    if (sorted.size() != stages.size())
+        throw std::runtime_error("The step stages have circular dependencies.");
+
+    stages = std::move(sorted);
+}
+
+void FmuComponentBase::runStepStages(std::vector<FmuStepStage>& stages) {
+    if (!m_stepStagesPrepared) {
+        prepareStepStages(m_preStepStages);
+        prepareStepStages(m_postStepStages);
+        m_stepStagesPrepared = true;
+    }
+
+    for (auto& stage : stages) {
+        if (stage.conditional) {
+            // every input is visited, so that all the stored values are kept up to date
+            bool changed = stage.dirty;
+            for (size_t i = 0; i < stage.inputs.size(); ++i) {
+                const auto& input = stage.inputs[i];
+                FmuValueChangeVisitor visitor{stage.last_values[i], GetVariableSize(*input)};
+                changed = varns::visit(visitor, input->m_varbind) || changed;
+            }
+            stage.dirty = false;
+
+            if (!changed) {
+                ++m_stepStagesSkipped;
+                continue;
+            }
+        }
+
+#ifdef FMU_FORGE_PROFILING
+        FmuProfileScope scope(stage.profile);
+#endif
+        stage.function();
+    }
+}
+
+void FmuComponentBase::invalidateStepStages() {
+    for (auto& stage : m_preStepStages)
+        stage.dirty = true;
+    for (auto& stage : m_postStepStages)
+        stage.dirty = true;
+}
+
+void FmuComponentBase::bindStaticVariable(const FmuVariableExport& variable, void* data) {
+    if (!variable.IsScalar() || variable.GetCausality() == FmuVariable::CausalityType::structuralParameter)
+        return;
+
+    fmi3ValueReference vr = variable.GetValueReference();
+    if (vr >= m_staticBindings.size())
+        m_staticBindings.resize(vr + 1);
+    m_staticBindings[vr].data = data;
+    m_staticBindings[vr].type = variable.GetType();
+}
+
+void FmuComponentBase::trackBinaryReference(const FmuVariableExport& variable) {
+    if (!varns::holds_alternative<FmuBinaryBuffer*>(variable.m_varbind))
+        return;
+
+    FmuBinaryBuffer* buffer = varns::get<FmuBinaryBuffer*>(variable.m_varbind);
+    size_t count = GetVariableSize(variable);
+    for (size_t i = 0; i < count; ++i) {
+        if (buffer[i].reference) {
+            m_binaryReferences.push_back(std::make_pair(buffer, count));
+            return;
+        }
+    }
+}
+
+void FmuComponentBase::releaseBinaryReferences() {
+    for (const auto& ref : m_binaryReferences) {
+        for (size_t i = 0; i < ref.second; ++i) {
+            FmuBinaryBuffer& buffer = ref.first[i];
+            // values restored from an FMU state are owned by the FMU
+            if (buffer.reference && buffer.data != buffer.storage.data()) {
+                buffer.data = nullptr;
+                buffer.size = 0;
+            }
+        }
+    }
+    m_binaryReferences.clear();
+}
+
+std::set<FmuVariableExport>::iterator FmuComponentBase::findByValref(fmi3ValueReference vr) {
+    if (vr >= m_valrefIndex.size())
+        return m_variables.end();
+    return m_valrefIndex[vr];
+}
+
+std::set<FmuVariableExport>::const_iterator FmuComponentBase::findByValref(fmi3ValueReference vr) const {
+    if (vr >= m_valrefIndex.size())
+        return m_variables.end();
+    return m_valrefIndex[vr];
+}
+
+void FmuComponentBase::indexVariable(std::set<FmuVariableExport>::iterator it) {
+    // value references are assigned sequentially, thus the lookup table is dense
+    fmi3ValueReference vr = it->GetValueReference();
+    if (vr >= m_valrefIndex.size())
+        m_valrefIndex.resize(vr + 1, m_variables.end());
+    m_valrefIndex[vr] = it;
+}
+
+void FmuComponentBase::rebuildValrefIndex() {
+    m_valrefIndex.assign(m_valrefIndex.size(), m_variables.end());
+    for (auto it = m_variables.begin(); it != m_variables.end(); ++it)
+        indexVariable(it);
+    m_accessPlans.clear();
+    m_fmuStateLayoutValid = false;
+    m_stateLayoutValid = false;
+    m_stepStagesPrepared = false;
+}
+
+FmuComponentBase::FmuVariableAccessPlan* FmuComponentBase::getAccessPlan(const fmi3ValueReference vrs[],
+                                                                         size_t nvr,
+                                                                         const std::type_info& value_type,
+                                                                         const char* caller) {
+    // maximum number of cached plans; when exceeded the cache is flushed
+    static const size_t max_access_plans = 256;
+
+    // hash of the value type, the address and the content of the value reference array (FNV-1a)
+    size_t hash = value_type.hash_code() ^ reinterpret_cast<size_t>(vrs);
+    for (size_t s = 0; s < nvr; ++s) {
+        hash ^= static_cast<size_t>(vrs[s]);
+        hash *= static_cast<size_t>(1099511628211ULL);
+    }
+
+    auto range = m_accessPlans.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const auto& plan_vrs = it->second.vrs;
+        if (plan_vrs.size() == nvr && std::equal(plan_vrs.begin(), plan_vrs.end(), vrs)) {
+            ++m_accessPlanHits;
+            return &it->second;
+        }
+    }
+
+    ++m_accessPlanMisses;
+
+    // in real-time mode, new plans are built in the reserved plan instead of being cached
+    if (m_realTimeReady && nvr <= m_realTimeAccessPlan.vrs.capacity()) {
+        m_realTimeAccessPlan.vrs.clear();
+        m_realTimeAccessPlan.variables.clear();
+        m_realTimeAccessPlan.sizes.clear();
+        m_realTimeAccessPlan.data.clear();
+        m_realTimeAccessPlan.dynamic_sizes = false;
+        m_realTimeAccessPlan.structural = false;
+        m_realTimeAccessPlan.data_resolved = false;
+        m_realTimeAccessPlan.set_checked = false;
+        return buildAccessPlan(m_realTimeAccessPlan, vrs, nvr, caller) ? &m_realTimeAccessPlan : nullptr;
+    }
+
+    FmuVariableAccessPlan plan;
+    if (!buildAccessPlan(plan, vrs, nvr, caller))
+        return nullptr;
+
+    if (m_accessPlans.size() >= max_access_plans)
+        m_accessPlans.clear();
+
+    return &m_accessPlans.insert({hash, std::move(plan)})->second;
+}
+
+bool FmuComponentBase::buildAccessPlan(FmuVariableAccessPlan& plan,
+                                       const fmi3ValueReference vrs[],
+                                       size_t nvr,
+                                       const char* caller) {
+    plan.vrs.assign(vrs, vrs + nvr);
+    plan.variables.reserve(nvr);
+    plan.sizes.reserve(nvr);
+    plan.data.assign(nvr, nullptr);
+    for (size_t s = 0; s < nvr; ++s) {
+        auto it = findByValref(vrs[s]);
+        if (it == m_variables.end()) {
+            // requested a variable that does not exist
+            sendToLog(std::string(caller) + ": variable with value reference " + std::to_string(vrs[s]) +
+                          " does NOT exist.\n",
+                      fmi3Status::fmi3Error, "logStatusError");
+            return false;
+        }
+
+        size_t var_size;
+        if (!it->GetSize(var_size))
+            plan.dynamic_sizes = true;
+        if (it->GetCausality() == FmuVariable::CausalityType::structuralParameter)
+            plan.structural = true;
+        plan.variables.push_back(it);
+        plan.sizes.push_back(var_size);
+    }
+
+    return true;
+}
+
+bool FmuComponentBase::checkAccessPlanSetAllowed(FmuVariableAccessPlan& plan) {
+    if (!plan.set_checked || plan.set_allowed_state != m_fmuMachineState) {
+        plan.set_allowed = true;
+        for (const auto& it : plan.variables)
+            plan.set_allowed = plan.set_allowed && it->IsSetAllowed(m_fmuMachineState);
+        plan.set_allowed_state = m_fmuMachineState;
+        plan.set_checked = true;
+    }
+
+    if (plan.set_allowed)
+        return true;
+
+    // report the first variable that cannot be set
+    for (const auto& it : plan.variables) {
+        if (!it->IsSetAllowed(m_fmuMachineState)) {
+            sendToLog("fmi3SetVariable: variable with value reference " + std::to_string(it->GetValueReference()) +
+                          " NOT ALLOWED to be set in current state.\n",
+                      fmi3Status::fmi3Error, "logStatusError");
+            break;
+        }
+    }
+
+    return false;
+}
+
+std::set<FmuVariableExport>::iterator FmuComponentBase::findByName(const std::string& name) {
+    auto predicate_samename = [name](const FmuVariable& var) { return !var.GetName().compare(name); };
+    return std::find_if(m_variables.begin(), m_variables.end(), predicate_samename);
+}
+
+const std::vector<size_t>& FmuComponentBase::GetVariableDimensions(const FmuVariable& var) const {
+    // case of scalar variable
+    static const std::vector<size_t> scalar_dimensions = {1};
+    if (var.IsScalar())
+        return scalar_dimensions;
+
+    return getVariableShape(var).dimensions;
+}
+
+const FmuComponentBase::FmuVariableShape& FmuComponentBase::getVariableShape(const FmuVariable& var) const {
+    auto it_shape = m_variableShapes.find(var.GetValueReference());
+    if (it_shape != m_variableShapes.end())
+        return it_shape->second;
+
+    FmuVariableShape shape;
+    shape.size = 1;
+    for (const auto& d : var.GetDimensions()) {
+        if (d.second == true)
+            // the size of the current dimension is fixed
+            shape.dimensions.push_back(d.first);
+        else {
+            // the size of the current dimension is given by another variable
+            size_t cur_size;
+            auto it_dim = findByValref(static_cast<fmi3ValueReference>(d.first));
+            it_dim->GetValue(&cur_size, 1);
+            shape.dimensions.push_back(cur_size);
+        }
+        shape.size *= shape.dimensions.back();
+    }
+
+    return m_variableShapes.emplace(var.GetValueReference(), std::move(shape)).first->second;
+}
+
+// -----------------------------------------------------------------------------
+
+fmi3Status FmuComponentBase::EnterInitializationMode(fmi3Boolean toleranceDefined,
+                                                     fmi3Float64 tolerance,
+                                                     fmi3Float64 startTime,
+                                                     fmi3Boolean stopTimeDefined,
+                                                     fmi3Float64 stopTime) {
+    m_startTime = startTime;
+    m_stopTime = stopTime;
+    m_tolerance = tolerance;
+    m_toleranceDefined = toleranceDefined;
+    m_stopTimeDefined = stopTimeDefined;
+
+    m_fmuMachineState = FmuMachineState::initializationMode;
+
+    fmi3Status status = enterInitializationModeIMPL();
+
+    if (status == fmi3Status::fmi3Fatal) {
+        m_fmuMachineState = FmuMachineState::terminated;
+    }
+
+    return status;
+}
+
+fmi3Status FmuComponentBase::ExitInitializationMode() {
+    fmi3Status status = exitInitializationModeIMPL();
+    ++m_valuesEpoch;
+
+    switch (m_fmuType) {
+        case FmuType::MODEL_EXCHANGE:
+            m_fmuMachineState = FmuMachineState::continuousTimeMode;
+            break;
+        case FmuType::COSIMULATION:
+            m_fmuMachineState = m_eventModeUsed ? FmuMachineState::eventMode : FmuMachineState::stepMode;
+            break;
+        case FmuType::SCHEDULED_EXECUTION:
+            m_fmuMachineState = FmuMachineState::clockActivationMode;
+            break;
+    }
+
+    if (status == fmi3Status::fmi3Fatal) {
+        m_fmuMachineState = FmuMachineState::terminated;
+    }
+
+    if (m_realTime)
+        prepareRealTime();
+
+    return status;
+}
+
+void FmuComponentBase::EnableRealTimeMode(fmi3Float64 step_budget) {
+    m_realTimeBudget = step_budget;
+    m_realTime = true;
+}
+
+void FmuComponentBase::addRealTimeVariables() {
+    // added once the FMU is constructed, so that the value references of the FMU variables are not shifted
+    if (!m_realTime || m_realTimeVariablesAdded)
+        return;
+    m_realTimeVariablesAdded = true;
+
+    const size_t num_bins = FmuStepLatencyHistogram::num_bins;
+    AddFmuVariable(&m_realTimeBudget, "fmu_forge_rt_step_budget", FmuVariable::Type::Float64, "s",
+                   "budget of each step in real-time mode",
+                   FmuVariable::CausalityType::parameter, FmuVariable::VariabilityType::tunable,
+                   FmuVariable::InitialType::exact);
+    AddFmuVariable(&m_stepLatency.steps, "fmu_forge_rt_steps", FmuVariable::Type::UInt64, "1",
+                   "number of steps in real-time mode",
+                   FmuVariable::CausalityType::output, FmuVariable::VariabilityType::discrete,
+                   FmuVariable::InitialType::exact);
+    AddFmuVariable(&m_stepLatency.deadline_misses, "fmu_forge_rt_deadline_misses", FmuVariable::Type::UInt64, "1",
+                   "number of steps exceeding the budget",
+                   FmuVariable::CausalityType::output, FmuVariable::VariabilityType::discrete,
+                   FmuVariable::InitialType::exact);
+    AddFmuVariable(&m_stepLatency.last_latency, "fmu_forge_rt_last_latency", FmuVariable::Type::Float64, "s",
+                   "latency of the last step",
+                   FmuVariable::CausalityType::output, FmuVariable::VariabilityType::discrete,
+                   FmuVariable::InitialType::exact);
+    AddFmuVariable(&m_stepLatency.max_latency, "fmu_forge_rt_max_latency", FmuVariable::Type::Float64, "s",
+                   "maximum latency of the steps",
+                   FmuVariable::CausalityType::output, FmuVariable::VariabilityType::discrete,
+                   FmuVariable::InitialType::exact);
+    AddFmuVariable(m_stepLatency.bins.data(), "fmu_forge_rt_latency_histogram", FmuVariable::Type::UInt64,
+                   {{num_bins, true}}, "1", "histogram of the step latencies, in power of 2 bins of microseconds",
+                   FmuVariable::CausalityType::output, FmuVariable::VariabilityType::discrete,
+                   FmuVariable::InitialType::exact);
+}
+
+void FmuComponentBase::prepareRealTime() {
+    // step stages resolved and sorted, with the copies of their inputs taken at full size
+    if (!m_stepStagesPrepared) {
+        prepareStepStages(m_preStepStages);
+        prepareStepStages(m_postStepStages);
+        m_stepStagesPrepared = true;
+    }
+    for (auto* stages : {&m_preStepStages, &m_postStepStages}) {
+        for (auto& stage : *stages) {
+            if (!stage.conditional)
+                continue;
+            for (size_t i = 0; i < stage.inputs.size(); ++i) {
+                FmuValueChangeVisitor visitor{stage.last_values[i], GetVariableSize(*stage.inputs[i])};
+                varns::visit(visitor, stage.inputs[i]->m_varbind);
+            }
+            stage.dirty = true;  // still executed at the first step
+        }
+    }
+
+    // dimensions of all the arrays, references to the importer buffers and access plans
+    size_t num_binary_buffers = 0;
+    for (const auto& var : m_variables) {
+        GetVariableSize(var);
+        if (varns::holds_alternative<FmuBinaryBuffer*>(var.m_varbind))
+            ++num_binary_buffers;
+    }
+    m_binaryReferences.reserve(num_binary_buffers);
+
+    m_realTimeAccessPlan.vrs.reserve(m_variables.size());
+    m_realTimeAccessPlan.variables.reserve(m_variables.size());
+    m_realTimeAccessPlan.sizes.reserve(m_variables.size());
+    m_realTimeAccessPlan.data.reserve(m_variables.size());
+
+    m_realTimeReady = true;
+}
+
+fmi3Status FmuComponentBase::Terminate() {
+#ifdef FMU_FORGE_PROFILING
+    std::string report = GetProfileReport();
+
+    if (m_logMessage)
+        m_logMessage(m_instanceEnvironment, fmi3Status::fmi3OK, "logProfiling", report.c_str());
+
+    const char* profile_file = std::getenv("FMU_FORGE_PROFILE_FILE");
+    if (profile_file && *profile_file) {
+        std::ofstream out(profile_file, std::ios::app);
+        out << report;
+    }
+#endif
+
+    return fmi3Status::fmi3OK;
+}
+
+fmi3Status FmuComponentBase::UpdateDiscreteStates(fmi3Boolean* discreteStatesNeedUpdate,
+                                                  fmi3Boolean* terminateSimulation,
+                                                  fmi3Boolean* nominalsOfContinuousStatesChanged,
+                                                  fmi3Boolean* valuesOfContinuousStatesChanged,
+                                                  fmi3Boolean* nextEventTimeDefined,
+                                                  fmi3Float64* nextEventTime) {
+    fmi3Status status =
+        updateDiscreteStatesIMPL(discreteStatesNeedUpdate, terminateSimulation, nominalsOfContinuousStatesChanged,
+                                 valuesOfContinuousStatesChanged, nextEventTimeDefined, nextEventTime);
+
+    if (status == fmi3Status::fmi3Fatal) {
+        m_fmuMachineState = FmuMachineState::terminated;
+    }
+    return status;
+}
+
+fmi3Status FmuComponentBase::DoStep(fmi3Float64 currentCommunicationPoint,
+                                    fmi3Float64 communicationStepSize,
+                                    fmi3Boolean noSetFMUStatePriorToCurrentPoint,
+                                    fmi3Boolean* eventHandlingNeeded,
+                                    fmi3Boolean* terminateSimulation,
+                                    fmi3Boolean* earlyReturn,
+                                    fmi3Float64* lastSuccessfulTime) {
+    if (!m_realTime)
+        return doStep(currentCommunicationPoint, communicationStepSize, noSetFMUStatePriorToCurrentPoint,
+                      eventHandlingNeeded, terminateSimulation, earlyReturn, lastSuccessfulTime);
+
+    auto start = std::chrono::steady_clock::now();
+
+    fmi3Status status;
+    try {
+        status = doStep(currentCommunicationPoint, communicationStepSize, noSetFMUStatePriorToCurrentPoint,
+                        eventHandlingNeeded, terminateSimulation, earlyReturn, lastSuccessfulTime);
+    } catch (std::exception& e) {
+        sendToLog(std::string("fmi3DoStep: ") + e.what() + "\n", fmi3Status::fmi3Error, "logStatusError");
+        m_fmuMachineState = FmuMachineState::terminated;
+        status = fmi3Status::fmi3Error;
+    }
+
+    std::chrono::duration<fmi3Float64> latency = std::chrono::steady_clock::now() - start;
+    m_stepLatency.Add(latency.count(), m_realTimeBudget);
+
+    return status;
+}
+
+fmi3Status FmuComponentBase::doStep(fmi3Float64 currentCommunicationPoint,
+                                    fmi3Float64 communicationStepSize,
+                                    fmi3Boolean noSetFMUStatePriorToCurrentPoint,
+                                    fmi3Boolean* eventHandlingNeeded,
+                                    fmi3Boolean* terminateSimulation,
+                                    fmi3Boolean* earlyReturn,
+                                    fmi3Float64* lastSuccessfulTime) {
+    // invoke any pre step callbacks (e.g., to process input variables)
+    executePreStepCallbacks();
+
+    // defaults for a step completed up to its end time (doStepIMPL may return early through returnEarly)
+    *earlyReturn = fmi3False;
+    *lastSuccessfulTime = currentCommunicationPoint + communicationStepSize;
+    m_earlyReturnRequested = false;
+
+    fmi3Status status;
+    {
+        FMU_PROFILE_SCOPE(this, "doStepIMPL");
+        status = doStepIMPL(currentCommunicationPoint, communicationStepSize, noSetFMUStatePriorToCurrentPoint,
+                            eventHandlingNeeded, terminateSimulation, earlyReturn, lastSuccessfulTime);
+    }
+
+    // invoke any post step callbacks (e.g., to update auxiliary variables)
+    executePostStepCallbacks();
+
+    stepCompleted();
+
+    return status;
+}
+
+bool FmuComponentBase::intermediateUpdate(fmi3Float64 intermediateUpdateTime,
+                                          bool intermediateStepFinished,
+                                          bool canReturnEarly,
+                                          fmi3Float64* earlyReturnTime) {
+    if (!m_intermediateUpdate)
+        return false;
+
+    // the importer may read the outputs from the callback: lazy outputs have to be evaluated again
+    ++m_valuesEpoch;
+
+    const bool earlyReturnAllowed = canReturnEarly && m_earlyReturnAllowed;
+    fmi3Boolean earlyReturnRequested = fmi3False;
+    fmi3Float64 requestedTime = intermediateUpdateTime;
+
+    FmuMachineState machineState = m_fmuMachineState;
+    m_fmuMachineState = FmuMachineState::intermediateUpdateMode;
+    m_intermediateUpdate(m_instanceEnvironment, intermediateUpdateTime,
+                         fmi3False,                                        // intermediateVariableSetRequested
+                         fmi3True,                                         // intermediateVariableGetAllowed
+                         intermediateStepFinished ? fmi3True : fmi3False,  // intermediateStepFinished
+                         earlyReturnAllowed ? fmi3True : fmi3False,        // canReturnEarly
+                         &earlyReturnRequested, &requestedTime);
+    m_fmuMachineState = machineState;
+
+    m_earlyReturnRequested = earlyReturnAllowed && earlyReturnRequested == fmi3True;
+    if (m_earlyReturnRequested && earlyReturnTime)
+        *earlyReturnTime = requestedTime;
+
+    return m_earlyReturnRequested;
+}
+
+fmi3Status FmuComponentBase::CompletedIntegratorStep(fmi3Boolean noSetFMUStatePriorToCurrentPoint,
+                                                     fmi3Boolean* enterEventMode,
+                                                     fmi3Boolean* terminateSimulation) {
+    fmi3Status status =
+        completedIntegratorStepIMPL(noSetFMUStatePriorToCurrentPoint, enterEventMode, terminateSimulation);
+
+    stepCompleted();
+
+    return status;
+}
+
+fmi3Status FmuComponentBase::EnterContinuousTimeMode() {
+    m_fmuMachineState = FmuMachineState::continuousTimeMode;
+
+    return fmi3Status::fmi3OK;
+}
+
+fmi3Status FmuComponentBase::SetTime(fmi3Float64 time) {
+    m_time = time;
+    ++m_valuesEpoch;
+
+    fmi3Status status = setTimeIMPL(time);
+
+    //// TODO - anything else here?
+
+    return status;
+}
+
+fmi3Status FmuComponentBase::GetContinuousStates(fmi3Float64 continuousStates[], size_t nContinuousStates) {
+    fmi3Status status = getContinuousStatesIMPL(continuousStates, nContinuousStates);
+
+    //// TODO - interpret/process status?
+
+    return status;
+}
+
+fmi3Status FmuComponentBase::SetContinuousStates(const fmi3Float64 continuousStates[], size_t nContinuousStates) {
+    fmi3Status status = setContinuousStatesIMPL(continuousStates, nContinuousStates);
+    ++m_valuesEpoch;
+
+    //// TODO - interpret/process status?
+    ////   Set FMU machine state (m_fmuMachineState)
+
+    return status;
+}
+
+fmi3Status FmuComponentBase::GetDerivatives(fmi3Float64 derivatives[], size_t nContinuousStates) {
+    // invoke any pre step callbacks (e.g., to process input variables)
+    executePreStepCallbacks();
+
+    fmi3Status status = getDerivativesIMPL(derivatives, nContinuousStates);
+
+    // invoke any post step callbacks (e.g., to update auxiliary variables)
+    executePostStepCallbacks();
+
+    //// TODO - interpret/process status?
+    ////   Set FMU machine state (m_fmuMachineState)
+
+    return status;
+}
+
+fmi3Status FmuComponentBase::GetNominalsOfContinuousStates(fmi3Float64 nominals[], size_t nContinuousStates) {
+    if (!checkContinuousStateLayout(nContinuousStates, "fmi3GetNominalsOfContinuousStates"))
+        return fmi3Status::fmi3Error;
+
+    if (nContinuousStates > 0)
+        std::memcpy(nominals, m_stateLayout.nominals.data(), nContinuousStates * sizeof(fmi3Float64));
+
+    return fmi3Status::fmi3OK;
+}
+
+fmi3Status FmuComponentBase::GetNumberOfContinuousStates(size_t* nContinuousStates) {
+    if (!checkContinuousStateLayout(0, ""))
+        return fmi3Status::fmi3Error;
+
+    *nContinuousStates = m_stateLayout.size;
+
+    return fmi3Status::fmi3OK;
+}
+
+bool FmuComponentBase::checkContinuousStateLayout(size_t nContinuousStates, const std::string& caller) {
+    if (!m_stateLayoutValid) {
+        FmuContinuousStateLayout& layout = m_stateLayout;
+        layout = FmuContinuousStateLayout();
+
+        for (const auto& name : m_derivativeNames) {
+            auto derivative = findByName(name);
+            auto state = findByName(m_derivatives.find(name)->second.first);
+
+            size_t size = GetVariableSize(*state);
+            if (GetVariableSize(*derivative) != size) {
+                sendToLog("The state derivative '" + name + "' does not have the size of its state.\n",
+                          fmi3Status::fmi3Error, "logStatusError");
+                return false;
+            }
+
+            // getter|setter and std::vector bindings have no stable address
+            FmuBindingAddress<fmi3Float64> address{size};
+            layout.states.push_back(state);
+            layout.derivatives.push_back(derivative);
+            layout.sizes.push_back(size);
+            layout.state_data.push_back(static_cast<fmi3Float64*>(varns::visit(address, state->m_varbind)));
+            layout.derivative_data.push_back(static_cast<fmi3Float64*>(varns::visit(address, derivative->m_varbind)));
+
+            auto nominal = m_stateNominals.find(state->GetName());
+            layout.nominals.insert(layout.nominals.end(), size,
+                                   nominal != m_stateNominals.end() ? nominal->second : 1.0);
+            layout.size += size;
+        }
+
+        // a single copy is enough if each variable starts where the previous one ends
+        auto contiguous = [&layout](const std::vector<fmi3Float64*>& data) -> fmi3Float64* {
+            for (size_t i = 0; i < data.size(); ++i) {
+                if (!data[i] || (i > 0 && data[i] != data[i - 1] + layout.sizes[i - 1]))
+                    return nullptr;
+            }
+            return data.empty() ? nullptr : data.front();
+        };
+        layout.contiguous_states = contiguous(layout.state_data);
+        layout.contiguous_derivatives = contiguous(layout.derivative_data);
+
+        m_stateLayoutValid = true;
+    }
+
+    if (!caller.empty() && nContinuousStates != m_stateLayout.size) {
+        sendToLog(caller + ": requested " + std::to_string(nContinuousStates) + " continuous states, but the FMU has " +
+                      std::to_string(m_stateLayout.size) + ".\n",
+                  fmi3Status::fmi3Error, "logStatusError");
+        return false;
+    }
+
+    return true;
+}
+
+fmi3Status FmuComponentBase::readContinuousStateLayout(bool derivatives,
+                                                       fmi3Float64 values[],
+                                                       size_t nContinuousStates,
+                                                       const std::string& caller) {
+    if (!checkContinuousStateLayout(nContinuousStates, caller))
+        return fmi3Status::fmi3Error;
+
+    const FmuContinuousStateLayout& layout = m_stateLayout;
+    const fmi3Float64* contiguous = derivatives ? layout.contiguous_derivatives : layout.contiguous_states;
+    if (contiguous) {
+        std::memcpy(values, contiguous, layout.size * sizeof(fmi3Float64));
+        return fmi3Status::fmi3OK;
+    }
+
+    const auto& variables = derivatives ? layout.derivatives : layout.states;
+    const auto& data = derivatives ? layout.derivative_data : layout.state_data;
+    size_t offset = 0;
+    for (size_t i = 0; i < variables.size(); ++i) {
+        if (data[i])
+            std::memcpy(values + offset, data[i], layout.sizes[i] * sizeof(fmi3Float64));
+        else
+            variables[i]->GetValue(values + offset, layout.sizes[i]);
+        offset += layout.sizes[i];
+    }
+
+    return fmi3Status::fmi3OK;
+}
+
+fmi3Status FmuComponentBase::writeContinuousStateLayout(const fmi3Float64 values[],
+                                                        size_t nContinuousStates,
+                                                        const std::string& caller) {
+    if (!checkContinuousStateLayout(nContinuousStates, caller))
+        return fmi3Status::fmi3Error;
+
+    const FmuContinuousStateLayout& layout = m_stateLayout;
+    if (layout.contiguous_states) {
+        std::memcpy(layout.contiguous_states, values, layout.size * sizeof(fmi3Float64));
+        return fmi3Status::fmi3OK;
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < layout.states.size(); ++i) {
+        if (layout.state_data[i])
+            std::memcpy(layout.state_data[i], values + offset, layout.sizes[i] * sizeof(fmi3Float64));
+        else
+            layout.states[i]->SetValue(values + offset, layout.sizes[i]);
+        offset += layout.sizes[i];
+    }
+
+    return fmi3Status::fmi3OK;
+}
+
+fmi3Status FmuComponentBase::ActivateModelPartition(fmi3ValueReference clockReference, fmi3Float64 activationTime) {
+    // Partitions may be activated concurrently: only read-only data of the component is accessed here
+    if (m_fmuType != FmuType::SCHEDULED_EXECUTION || m_fmuMachineState != FmuMachineState::clockActivationMode) {
+        sendToLog("fmi3ActivateModelPartition: the FMU is not in Clock Activation Mode.\n", fmi3Status::fmi3Error,
+                  "logStatusError");
+        return fmi3Status::fmi3Error;
+    }
+
+    const FmuModelPartition* partition = findModelPartition(clockReference);
+    if (!partition) {
+        sendToLog("fmi3ActivateModelPartition: no model partition bound to the clock with valueReference " +
+                      std::to_string(clockReference) + ".\n",
+                  fmi3Status::fmi3Error, "logStatusError");
+        return fmi3Status::fmi3Error;
+    }
+
+    return partition->function(activationTime);
+}
+
+fmi3Status FmuComponentBase::GetClock(const fmi3ValueReference valueReferences[],
+                                      size_t nValueReferences,
+                                      fmi3Clock values[]) {
+    // all clocks are input clocks, activated by the importer: none of them ticks inside the FMU
+    for (size_t i = 0; i < nValueReferences; ++i) {
+        if (!findModelPartition(valueReferences[i])) {
+            sendToLog("fmi3GetClock: no clock with valueReference " + std::to_string(valueReferences[i]) + ".\n",
+                      fmi3Status::fmi3Error, "logStatusError");
+            return fmi3Status::fmi3Error;
+        }
+        values[i] = fmi3ClockInactive;
+    }
+    return fmi3Status::fmi3OK;
+}
+
+fmi3Status FmuComponentBase::GetIntervalDecimal(const fmi3ValueReference valueReferences[],
+                                                size_t nValueReferences,
+                                                fmi3Float64 intervals[],
+                                                fmi3IntervalQualifier qualifiers[]) {
+    for (size_t i = 0; i < nValueReferences; ++i) {
+        const FmuModelPartition* partition = findModelPartition(valueReferences[i]);
+        if (!partition) {
+            sendToLog("fmi3GetIntervalDecimal: no clock with valueReference " + std::to_string(valueReferences[i]) +
+                          ".\n",
+                      fmi3Status::fmi3Error, "logStatusError");
+            return fmi3Status::fmi3Error;
+        }
+        intervals[i] = partition->interval;
+        qualifiers[i] = fmi3IntervalUnchanged;
+    }
+    return fmi3Status::fmi3OK;
+}
+
+namespace {
+
+// Save the value of a variable bound through a getter|setter pair or a std::vector.
+struct FmuStateSaveVisitor {
+    fmi3Byte* data;
+    std::string* str;
+    size_t count;
+
+    template <typename T>
+    void operator()(T*) const {}
+
+    template <typename T>
+    void operator()(const FmuSpan<T>&) const {}
+
+    template <typename T>
+    void operator()(std::vector<T>* vec) const {
+        size_t n = std::min(count, vec->size());
+        if (n > 0)
+            std::memcpy(data, vec->data(), n * sizeof(T));
+        std::memset(data + n * sizeof(T), 0, (count - n) * sizeof(T));
+    }
+
+    template <typename T>
+    void operator()(const FunGetSet<T>& fun) const {
+        T val = fun.first();
+        std::memcpy(data, &val, sizeof(T));
+    }
+
+    // the layout aligns the storage of array functions to the element size
+    template <typename T>
+    void operator()(const FunGetSetArray<T>& fun) const {
+        fun.first(reinterpret_cast<T*>(data), count);
+    }
+
+    void operator()(const FunGetSet<std::string>& fun) const { *str = fun.first(); }
+};
+
+// Restore the value of a variable bound through a getter|setter pair or a std::vector.
+struct FmuStateRestoreVisitor {
+    const fmi3Byte* data;
+    const std::string* str;
+    size_t count;
+
+    template <typename T>
+    void operator()(T*) const {}
+
+    template <typename T>
+    void operator()(const FmuSpan<T>&) const {}
+
+    template <typename T>
+    void operator()(std::vector<T>* vec) const {
+        vec->resize(count);
+        if (count > 0)
+            std::memcpy(vec->data(), data, count * sizeof(T));
+    }
+
+    template <typename T>
+    void operator()(const FunGetSet<T>& fun) const {
+        T val;
+        std::memcpy(&val, data, sizeof(T));
+        fun.second(val);
+    }
+
+    template <typename T>
+    void operator()(const FunGetSetArray<T>& fun) const {
+        fun.second(reinterpret_cast<const T*>(data), count);
+    }
+
+    void operator()(const FunGetSet<std::string>& fun) const { fun.second(*str); }
+};
+
+// Serialization helpers (the serialized FMU state is meant to be restored by the same FMU binary)
+const std::uint64_t fmu_state_magic = 0x464d555354415445;  // "FMUSTATE"
+
+template <typename T>
+void serialize_pod(fmi3Byte*& dst, const T& val) {
+    std::memcpy(dst, &val, sizeof(T));
+    dst += sizeof(T);
+}
+
+void serialize_bytes(fmi3Byte*& dst, const void* src, size_t size) {
+    serialize_pod(dst, static_cast<std::uint64_t>(size));
+    if (size > 0)
+        std::memcpy(dst, src, size);
+    dst += size;
+}
+
+template <typename T>
+bool deserialize_pod(const fmi3Byte*& src, const fmi3Byte* end, T& val) {
+    if (static_cast<size_t>(end - src) < sizeof(T))
+        return false;
+    std::memcpy(&val, src, sizeof(T));
+    src += sizeof(T);
+    return true;
+}
+
+bool deserialize_size(const fmi3Byte*& src, const fmi3Byte* end, size_t& size) {
+    std::uint64_t size64;
+    if (!deserialize_pod(src, end, size64) || size64 > static_cast<std::uint64_t>(end - src))
+        return false;
+    size = static_cast<size_t>(size64);
+    return true;
+}
+
+}  // namespace
+
+struct FmuComponentBase::FmuStateLayoutVisitor {
+    FmuStateEntry& entry;
+
+    template <typename T>
+    void operator()(T* ptr) const {
+        entry.kind = FmuStateEntry::Kind::memory;
+        entry.address = ptr;
+        entry.elem_size = sizeof(T);
+    }
+
+    void operator()(std::string* ptr) const {
+        entry.kind = FmuStateEntry::Kind::string;
+        entry.address = ptr;
+    }
+
+    void operator()(std::vector<fmi3Byte>* ptr) const {
+        entry.kind = FmuStateEntry::Kind::binary;
+        entry.address = ptr;
+    }
+
+    void operator()(FmuBinaryBuffer* ptr) const {
+        entry.kind = FmuStateEntry::Kind::binary_buffer;
+        entry.address = ptr;
+    }
+
+    template <typename T>
+    void operator()(const FmuSpan<T>& span) const {
+        entry.kind = FmuStateEntry::Kind::memory;
+        entry.address = span.data;
+        entry.elem_size = sizeof(T);
+    }
+
+    template <typename T>
+    void operator()(std::vector<T>* ptr) const {
+        entry.kind = FmuStateEntry::Kind::vector;
+        entry.address = ptr;
+        entry.elem_size = sizeof(T);
+    }
+
+    template <typename T>
+    void operator()(const FunGetSet<T>&) const {
+        entry.kind = FmuStateEntry::Kind::function;
+        entry.elem_size = sizeof(T);
+    }
+
+    template <typename T>
+    void operator()(const FunGetSetArray<T>&) const {
+        entry.kind = FmuStateEntry::Kind::function;
+        entry.elem_size = sizeof(T);
+        entry.array_function = true;
+    }
+
+    void operator()(const FunGetSet<std::string>&) const {
+        entry.kind = FmuStateEntry::Kind::function_string;
+    }
+};
+
+void FmuComponentBase::updateFMUStateLayout(size_t& data_size, size_t& num_strings, size_t& num_binaries) {
+    if (!m_fmuStateLayoutValid) {
+        m_fmuStateLayout.clear();
+        for (auto it = m_variables.begin(); it != m_variables.end(); ++it) {
+            if (it->GetVariability() == FmuVariable::VariabilityType::constant)
+                continue;
+
+            FmuStateEntry entry;
+            entry.variable = it;
+            varns::visit(FmuStateLayoutVisitor{entry}, it->m_varbind);
+
+            // values computed by getter functions are not part of the state
+            bool is_function = entry.kind == FmuStateEntry::Kind::function ||
+                               entry.kind == FmuStateEntry::Kind::function_string;
+            if (is_function && (it->GetCausality() == FmuVariable::CausalityType::output ||
+                                it->GetCausality() == FmuVariable::CausalityType::calculatedParameter ||
+                                it->GetCausality() == FmuVariable::CausalityType::independent))
+                continue;
+
+            // getter|setter pairs only support scalar variables, bulk pairs are sized as any other array
+            bool is_scalar_function = is_function && !entry.array_function;
+            entry.fixed_size = is_scalar_function || it->GetSize(entry.count);
+            if (is_scalar_function)
+                entry.count = 1;
+
+            m_fmuStateLayout.push_back(entry);
+        }
+        m_fmuStateLayoutValid = true;
+    }
+
+    data_size = 0;
+    num_strings = 0;
+    num_binaries = 0;
+    for (auto& entry : m_fmuStateLayout) {
+        if (!entry.fixed_size)
+            entry.count = GetVariableSize(*entry.variable);
+
+        switch (entry.kind) {
+            case FmuStateEntry::Kind::memory:
+            case FmuStateEntry::Kind::function:
+            case FmuStateEntry::Kind::vector:
+                // keep values aligned, as bulk getters|setters access the snapshot data in place
+                data_size = (data_size + entry.elem_size - 1) / entry.elem_size * entry.elem_size;
+                entry.offset = data_size;
+                data_size += entry.count * entry.elem_size;
+                break;
+            case FmuStateEntry::Kind::string:
+            case FmuStateEntry::Kind::function_string:
+                entry.offset = num_strings;
+                num_strings += entry.count;
+                break;
+            case FmuStateEntry::Kind::binary:
+            case FmuStateEntry::Kind::binary_buffer:
+                entry.offset = num_binaries;
+                num_binaries += entry.count;
+                break;
+        }
+    }
+}
+
+FmuComponentBase::FmuStateSnapshot* FmuComponentBase::acquireFMUStateSnapshot() {
+    if (!m_fmuStatesPool.empty()) {
+        FmuStateSnapshot* snapshot = m_fmuStatesPool.back();
+        m_fmuStatesPool.pop_back();
+        return snapshot;
+    }
+
+    m_fmuStates.emplace_back(new FmuStateSnapshot());
+    m_fmuStatesPool.reserve(m_fmuStates.size());
+    return m_fmuStates.back().get();
+}
+
+fmi3Status FmuComponentBase::saveFMUState(FmuStateSnapshot& snapshot) {
+    size_t data_size, num_strings, num_binaries;
+    updateFMUStateLayout(data_size, num_strings, num_binaries);
+
+    snapshot.data.resize(data_size);
+    snapshot.strings.resize(num_strings);
+    snapshot.binaries.resize(num_binaries);
+
+    for (const auto& entry : m_fmuStateLayout) {
+        switch (entry.kind) {
+            case FmuStateEntry::Kind::memory:
+                std::memcpy(snapshot.data.data() + entry.offset, entry.address, entry.count * entry.elem_size);
+                break;
+            case FmuStateEntry::Kind::function:
+            case FmuStateEntry::Kind::vector:
+                varns::visit(FmuStateSaveVisitor{snapshot.data.data() + entry.offset, nullptr, entry.count},
+                             entry.variable->m_varbind);
+                break;
+            case FmuStateEntry::Kind::function_string:
+                varns::visit(FmuStateSaveVisitor{nullptr, &snapshot.strings[entry.offset], 1},
+                             entry.variable->m_varbind);
+                break;
+            case FmuStateEntry::Kind::string:
+                for (size_t i = 0; i < entry.count; ++i)
+                    snapshot.strings[entry.offset + i] = static_cast<const std::string*>(entry.address)[i];
+                break;
+            case FmuStateEntry::Kind::binary:
+                for (size_t i = 0; i < entry.count; ++i)
+                    snapshot.binaries[entry.offset + i] = static_cast<const std::vector<fmi3Byte>*>(entry.address)[i];
+                break;
+            case FmuStateEntry::Kind::binary_buffer:
+                for (size_t i = 0; i < entry.count; ++i) {
+                    const FmuBinaryBuffer& buffer = static_cast<const FmuBinaryBuffer*>(entry.address)[i];
+                    snapshot.binaries[entry.offset + i].assign(buffer.data, buffer.data + buffer.size);
+                }
+                break;
+        }
+    }
+
+    snapshot.time = m_time;
+    snapshot.stepSize = m_stepSize;
+    snapshot.machineState = m_fmuMachineState;
+
+    return getFMUStateIMPL(snapshot.internal);
+}
+
+bool FmuComponentBase::restoreFMUState(const FmuStateSnapshot& snapshot) {
+    size_t data_size, num_strings, num_binaries;
+    updateFMUStateLayout(data_size, num_strings, num_binaries);
+
+    if (snapshot.data.size() != data_size || snapshot.strings.size() != num_strings ||
+        snapshot.binaries.size() != num_binaries)
+        return false;
+
+    for (const auto& entry : m_fmuStateLayout) {
+        switch (entry.kind) {
+            case FmuStateEntry::Kind::memory:
+                std::memcpy(entry.address, snapshot.data.data() + entry.offset, entry.count * entry.elem_size);
+                break;
+            case FmuStateEntry::Kind::function:
+            case FmuStateEntry::Kind::vector:
+                varns::visit(FmuStateRestoreVisitor{snapshot.data.data() + entry.offset, nullptr, entry.count},
+                             entry.variable->m_varbind);
+                break;
+            case FmuStateEntry::Kind::function_string:
+                varns::visit(FmuStateRestoreVisitor{nullptr, &snapshot.strings[entry.offset], 1},
+                             entry.variable->m_varbind);
+                break;
+            case FmuStateEntry::Kind::string:
+                for (size_t i = 0; i < entry.count; ++i)
+                    static_cast<std::string*>(entry.address)[i] = snapshot.strings[entry.offset + i];
+                break;
+            case FmuStateEntry::Kind::binary:
+                for (size_t i = 0; i < entry.count; ++i)
+                    static_cast<std::vector<fmi3Byte>*>(entry.address)[i] = snapshot.binaries[entry.offset + i];
+                break;
+            case FmuStateEntry::Kind::binary_buffer:
+                // the restored value is owned by the FMU, also for buffers referencing the importer
+                for (size_t i = 0; i < entry.count; ++i) {
+                    FmuBinaryBuffer& buffer = static_cast<FmuBinaryBuffer*>(entry.address)[i];
+                    buffer.storage = snapshot.binaries[entry.offset + i];
+                    buffer.data = buffer.storage.data();
+                    buffer.size = buffer.storage.size();
+                }
+                break;
+        }
+    }
+
+    // structural parameters may have been restored, and the outputs of the step stages as well
+    InvalidateVariableSizes();
+    invalidateStepStages();
+    ++m_valuesEpoch;
+
+    m_time = snapshot.time;
+    m_stepSize = snapshot.stepSize;
+
+    return true;
+}
+
+fmi3Status FmuComponentBase::GetFMUState(fmi3FMUState* FMUState) {
+    if (!m_canGetAndSetFMUState) {
+        sendToLog("fmi3GetFMUState: the FMU does not support getting and setting the FMU state.\n",
+                  fmi3Status::fmi3Error, "logStatusError");
+        return fmi3Status::fmi3Error;
+    }
+
+    if (!IsFMUStateSettable()) {
+        sendToLog("fmi3GetFMUState: the FMU state cannot be retrieved in the current FMU machine state.\n",
+                  fmi3Status::fmi3Error, "logStatusError");
+        return fmi3Status::fmi3Error;
+    }
+
+    // a non-null FMUState is a previously returned state that must be overwritten
+    FmuStateSnapshot* snapshot =
+        *FMUState ? static_cast<FmuStateSnapshot*>(*FMUState) : acquireFMUStateSnapshot();
+
+    fmi3Status status = saveFMUState(*snapshot);
+
+    *FMUState = snapshot;
+
+    return status;
+}
+
+fmi3Status FmuComponentBase::SetFMUState(fmi3FMUState FMUState) {
+    if (!m_canGetAndSetFMUState || !FMUState) {
+        sendToLog("fmi3SetFMUState: the FMU does not support setting the FMU state or the FMU state is invalid.\n",
+                  fmi3Status::fmi3Error, "logStatusError");
+        return fmi3Status::fmi3Error;
+    }
+
+    if (!IsFMUStateSettable()) {
+        sendToLog("fmi3SetFMUState: the FMU state cannot be set in the current FMU machine state.\n",
+                  fmi3Status::fmi3Error, "logStatusError");
+        return fmi3Status::fmi3Error;
+    }
+
+    const FmuStateSnapshot* snapshot = static_cast<const FmuStateSnapshot*>(FMUState);
+
+    if (!restoreFMUState(*snapshot)) {
+        sendToLog("fmi3SetFMUState: the FMU state does not match the current FMU variables.\n",
+                  fmi3Status::fmi3Error, "logStatusError");
+        return fmi3Status::fmi3Error;
+    }
+    m_fmuMachineState = snapshot->machineState;
+
+    return setFMUStateIMPL(snapshot->internal);
+}
+
+void FmuComponentBase::SaveResetState() {
+    addRealTimeVariables();
+
+    m_resetState.reset(new FmuStateSnapshot());
+    if (saveFMUState(*m_resetState) > fmi3Status::fmi3Warning)
+        m_resetState.reset();
+}
+
+fmi3Status FmuComponentBase::Reset() {
+    if (!m_resetState) {
+        sendToLog("fmi3Reset: no instantiation state is available to reset the FMU.\n", fmi3Status::fmi3Error,
+                  "logStatusError");
+        return fmi3Status::fmi3Error;
+    }
+
+    // references to the buffers of the importer are dropped before being overwritten by the restored values
+    releaseBinaryReferences();
+
+    if (!restoreFMUState(*m_resetState)) {
+        sendToLog("fmi3Reset: the FMU variables changed since instantiation.\n", fmi3Status::fmi3Error,
+                  "logStatusError");
+        return fmi3Status::fmi3Error;
+    }
+
+    std::fill(m_modified.begin(), m_modified.end(), 0);
+    m_earlyReturnRequested = false;
+    m_realTimeReady = false;  // structural parameters may be set again
+    m_fmuMachineState = FmuMachineState::instantiated;
+
+    fmi3Status status = setFMUStateIMPL(m_resetState->internal);
+    if (status > fmi3Status::fmi3Warning)
+        return status;
+
+    return std::max(status, resetIMPL());
+}
+
+fmi3Status FmuComponentBase::FreeFMUState(fmi3FMUState* FMUState) {
+    if (!FMUState || !*FMUState)
+        return fmi3Status::fmi3OK;
+
+    // the snapshot is kept, with its buffers, for later use
+    m_fmuStatesPool.push_back(static_cast<FmuStateSnapshot*>(*FMUState));
+    *FMUState = nullptr;
+
+    return fmi3Status::fmi3OK;
+}
+
+fmi3Status FmuComponentBase::SerializedFMUStateSize(fmi3FMUState FMUState, size_t* size) {
+    if (!m_canSerializeFMUState || !FMUState) {
+        sendToLog("fmi3SerializedFMUStateSize: the FMU does not support serialization or the FMU state is invalid.\n",
+                  fmi3Status::fmi3Error, "logStatusError");
+        return fmi3Status::fmi3Error;
+    }
+
+    const FmuStateSnapshot* snapshot = static_cast<const FmuStateSnapshot*>(FMUState);
+
+    size_t total = sizeof(fmu_state_magic) + sizeof(snapshot->time) + sizeof(snapshot->stepSize) +
+                   sizeof(std::int32_t);
+    total += sizeof(std::uint64_t) + snapshot->data.size();
+    total += sizeof(std::uint64_t);
+    for (const auto& str : snapshot->strings)
+        total += sizeof(std::uint64_t) + str.size();
+    total += sizeof(std::uint64_t);
+    for (const auto& bin : snapshot->binaries)
+        total += sizeof(std::uint64_t) + bin.size();
+    total += sizeof(std::uint64_t) + snapshot->internal.size();
+
+    *size = total;
+
+    return fmi3Status::fmi3OK;
+}
+
+fmi3Status FmuComponentBase::SerializeFMUState(fmi3FMUState FMUState, fmi3Byte serializedState[], size_t size) {
+    size_t required_size;
+    fmi3Status status = SerializedFMUStateSize(FMUState, &required_size);
+    if (status != fmi3Status::fmi3OK)
+        return status;
+
+    if (size < required_size) {
+        sendToLog("fmi3SerializeFMUState: the provided buffer is too small.\n", fmi3Status::fmi3Error,
+                  "logStatusError");
+        return fmi3Status::fmi3Error;
+    }
+
+    const FmuStateSnapshot* snapshot = static_cast<const FmuStateSnapshot*>(FMUState);
+
+    fmi3Byte* dst = serializedState;
+    serialize_pod(dst, fmu_state_magic);
+    serialize_pod(dst, snapshot->time);
+    serialize_pod(dst, snapshot->stepSize);
+    serialize_pod(dst, static_cast<std::int32_t>(snapshot->machineState));
+    serialize_bytes(dst, snapshot->data.data(), snapshot->data.size());
+    serialize_pod(dst, static_cast<std::uint64_t>(snapshot->strings.size()));
+    for (const auto& str : snapshot->strings)
+        serialize_bytes(dst, str.data(), str.size());
+    serialize_pod(dst, static_cast<std::uint64_t>(snapshot->binaries.size()));
+    for (const auto& bin : snapshot->binaries)
+        serialize_bytes(dst, bin.data(), bin.size());
+    serialize_bytes(dst, snapshot->internal.data(), snapshot->internal.size());
+
+    return fmi3Status::fmi3OK;
+}
+
+fmi3Status FmuComponentBase::DeserializeFMUState(const fmi3Byte serializedState[],
+                                                 size_t size,
+                                                 fmi3FMUState* FMUState) {
+    if (!m_canSerializeFMUState) {
+        sendToLog("fmi3DeserializeFMUState: the FMU does not support serialization of the FMU state.\n",
+                  fmi3Status::fmi3Error, "logStatusError");
+        return fmi3Status::fmi3Error;
+    }
 
-        // Expose Dimension node (if array)
-        if (it->GetDimensions().size() > 0) {
-            for (auto& dim : it->GetDimensions()) {
-                rapidxml::xml_node<>* dimNode = doc_ptr->allocate_node(rapidxml::node_element, "Dimension");
-                if (dim.second == true) {
-                    stringbuf.push_back(std::to_string(dim.first));
-                    dimNode->append_attribute(doc_ptr->allocate_attribute("start", stringbuf.back().c_str()));
-                } else {
-                    stringbuf.push_back(std::to_string(dim.first));
-                    dimNode->append_attribute(doc_ptr->allocate_attribute("valueReference", stringbuf.back().c_str()));
-                }
-                varNode->append_node(dimNode);
-            }
-        }
+    FmuStateSnapshot* snapshot = acquireFMUStateSnapshot();
 
-        // Expose start values
-        if (it->IsStartValueExposed()) {
-            if (it->GetType() == FmuVariable::Type::String || it->GetType() == FmuVariable::Type::Binary) {
-                for (auto el_sel = 0; el_sel < GetVariableSize(*it); ++el_sel) {
-                    rapidxml::xml_node<>* startNode = doc_ptr->allocate_node(rapidxml::node_element, "Start");
-                    stringbuf.push_back(it->GetStartValAsString(el_sel));
-                    startNode->append_attribute(doc_ptr->allocate_attribute("value", stringbuf.back().c_str()));
-                    varNode->append_node(startNode);
-                }
-            } else {
-                // For all other variables, the start value is given as an attribute of the variable element
-                stringbuf.push_back(it->GetStartValAsString(GetVariableSize(*it)));
-                varNode->append_attribute(doc_ptr->allocate_attribute("start", stringbuf.back().c_str()));
-            }
+    const fmi3Byte* src = serializedState;
+    const fmi3Byte* end = serializedState + size;
+
+    std::uint64_t magic;
+    std::int32_t machine_state;
+    size_t len;
+    bool valid = deserialize_pod(src, end, magic) && magic == fmu_state_magic &&  //
+                 deserialize_pod(src, end, snapshot->time) &&                      //
+                 deserialize_pod(src, end, snapshot->stepSize) &&                  //
+                 deserialize_pod(src, end, machine_state);
+
+    valid = valid && deserialize_size(src, end, len);
+    if (valid) {
+        snapshot->data.assign(src, src + len);
+        src += len;
+    }
+
+    valid = valid && deserialize_size(src, end, len);
+    if (valid)
+        snapshot->strings.resize(len);
+    for (size_t i = 0; valid && i < snapshot->strings.size(); ++i) {
+        valid = deserialize_size(src, end, len);
+        if (valid) {
+            snapshot->strings[i].assign(reinterpret_cast<const char*>(src), len);
+            src += len;
         }
+    }
 
-        // Check if this variable is the derivative of another variable
-        auto state_name = isDerivative(it->GetName());
-        if (!state_name.empty()) {
-            auto state_valref = allValrefs[state_name];
-            stringbuf.push_back(std::to_string(state_valref));
-            varNode->append_attribute(doc_ptr->allocate_attribute("derivative", stringbuf.back().c_str()));
+    valid = valid && deserialize_size(src, end, len);
+    if (valid)
+        snapshot->binaries.resize(len);
+    for (size_t i = 0; valid && i < snapshot->binaries.size(); ++i) {
+        valid = deserialize_size(src, end, len);
+        if (valid) {
+            snapshot->binaries[i].assign(src, src + len);
+            src += len;
         }
+    }
 
-        if (!it->GetDescription().empty())
-            varNode->append_attribute(doc_ptr->allocate_attribute("description", it->GetDescription().c_str()));
+    valid = valid && deserialize_size(src, end, len);
+    if (valid) {
+        snapshot->internal.assign(src, src + len);
+        src += len;
+    }
 
-        // Append the current variable node
-        modelVarsNode->append_node(varNode);
+    if (!valid) {
+        m_fmuStatesPool.push_back(snapshot);
+        sendToLog("fmi3DeserializeFMUState: the serialized FMU state is corrupted or incompatible.\n",
+                  fmi3Status::fmi3Error, "logStatusError");
+        return fmi3Status::fmi3Error;
     }
 
-    rootNode->append_node(modelVarsNode);
+    snapshot->machineState = static_cast<FmuMachineState>(machine_state);
+    *FMUState = snapshot;
 
-    // Check that dependencies are defined for all variables that require them
-    for (const auto& var : m_variables) {
-        auto causality = var.GetCausality();
-        auto initial = var.GetInitial();
+    return fmi3Status::fmi3OK;
+}
 
-        if (m_variableDependencies.find(var.GetName()) == m_variableDependencies.end()) {
-            if (causality == FmuVariable::CausalityType::output &&
-                (initial == FmuVariable::InitialType::approx || initial == FmuVariable::InitialType::calculated)) {
-                std::string msg =
-                    "Dependencies required for an 'output' variable with initial='approx' or 'calculated' (" +
-                    var.GetName() + ").";
-                std::cout << "ERROR: " << msg << std::endl;
-                throw std::runtime_error(msg);
-            }
+// -----------------------------------------------------------------------------
 
-            if (causality == FmuVariable::CausalityType::calculatedParameter) {
-                std::string msg = "Dependencies required for a 'calculatedParameter' variable (" + var.GetName() + ").";
-                std::cout << "ERROR: " << msg << std::endl;
-                throw std::runtime_error(msg);
-            }
-        }
+fmi3Status FmuComponentBase::GetDirectionalDerivative(const fmi3ValueReference unknowns[],
+                                                      size_t nUnknowns,
+                                                      const fmi3ValueReference knowns[],
+                                                      size_t nKnowns,
+                                                      const fmi3Float64 seed[],
+                                                      size_t nSeed,
+                                                      fmi3Float64 sensitivity[],
+                                                      size_t nSensitivity) {
+    if (m_fmuMachineState == FmuMachineState::instantiated || m_fmuMachineState == FmuMachineState::terminated) {
+        sendToLog("fmi3GetDirectionalDerivative: partial derivatives are not available in the current FMU machine "
+                  "state.\n",
+                  fmi3Status::fmi3Error, "logStatusError");
+        return fmi3Status::fmi3Error;
     }
 
-    // Add ModelStructure node
-    rapidxml::xml_node<>* modelStructNode = doc_ptr->allocate_node(rapidxml::node_element, "ModelStructure");
+    if (!collectDerivativeVariables(unknowns, nUnknowns, m_derivativeUnknowns, "fmi3GetDirectionalDerivative") ||
+        !collectDerivativeVariables(knowns, nKnowns, m_derivativeKnowns, "fmi3GetDirectionalDerivative"))
+        return fmi3Status::fmi3Error;
 
-    //      ...Outputs
-    for (int valref : outputValrefs) {
-        rapidxml::xml_node<>* outputNode = doc_ptr->allocate_node(rapidxml::node_element, "Output");
-        stringbuf.push_back(std::to_string(valref));
-        outputNode->append_attribute(doc_ptr->allocate_attribute("valueReference", stringbuf.back().c_str()));
-        modelStructNode->append_node(outputNode);
+    if (nSeed != m_derivativeKnowns.offsets.back() || nSensitivity != m_derivativeUnknowns.offsets.back()) {
+        sendToLog("fmi3GetDirectionalDerivative: nSeed must match the size of the knowns and nSensitivity the size of "
+                  "the unknowns.\n",
+                  fmi3Status::fmi3Error, "logStatusError");
+        return fmi3Status::fmi3Error;
     }
 
-    //     ...Derivatives
-    for (const auto& d : m_derivatives) {
-        rapidxml::xml_node<>* derivativeNode =
-            doc_ptr->allocate_node(rapidxml::node_element, "ContinuousStateDerivative");
-
-        stringbuf.push_back(std::to_string(allValrefs[d.first]));
-        derivativeNode->append_attribute(doc_ptr->allocate_attribute("valueReference", stringbuf.back().c_str()));
+    return getDirectionalDerivativeIMPL(unknowns, nUnknowns, knowns, nKnowns, seed, nSeed, sensitivity, nSensitivity);
+}
 
-        std::string dependencies = "";
-        for (const auto& dep : d.second.second) {
-            dependencies += std::to_string(allValrefs[dep]) + " ";
-        }
-        stringbuf.push_back(dependencies);
-        derivativeNode->append_attribute(doc_ptr->allocate_attribute("dependencies", stringbuf.back().c_str()));
+fmi3Status FmuComponentBase::GetAdjointDerivative(const fmi3ValueReference unknowns[],
+                                                  size_t nUnknowns,
+                                                  const fmi3ValueReference knowns[],
+                                                  size_t nKnowns,
+                                                  const fmi3Float64 seed[],
+                                                  size_t nSeed,
+                                                  fmi3Float64 sensitivity[],
+                                                  size_t nSensitivity) {
+    if (m_fmuMachineState == FmuMachineState::instantiated || m_fmuMachineState == FmuMachineState::terminated) {
+        sendToLog("fmi3GetAdjointDerivative: partial derivatives are not available in the current FMU machine state.\n",
+                  fmi3Status::fmi3Error, "logStatusError");
+        return fmi3Status::fmi3Error;
+    }
 
-        //// TODO: dependeciesKind
+    if (!collectDerivativeVariables(unknowns, nUnknowns, m_derivativeUnknowns, "fmi3GetAdjointDerivative") ||
+        !collectDerivativeVariables(knowns, nKnowns, m_derivativeKnowns, "fmi3GetAdjointDerivative"))
+        return fmi3Status::fmi3Error;
 
-        modelStructNode->append_node(derivativeNode);
+    if (nSeed != m_derivativeUnknowns.offsets.back() || nSensitivity != m_derivativeKnowns.offsets.back()) {
+        sendToLog("fmi3GetAdjointDerivative: nSeed must match the size of the unknowns and nSensitivity the size of "
+                  "the knowns.\n",
+                  fmi3Status::fmi3Error, "logStatusError");
+        return fmi3Status::fmi3Error;
     }
 
-    //     ...InitialUnknowns
-    for (const auto& v : m_variableDependencies) {
-        rapidxml::xml_node<>* unknownNode = doc_ptr->allocate_node(rapidxml::node_element, "InitialUnknown");
-        auto v_index = allValrefs[v.first];
-        stringbuf.push_back(std::to_string(v_index));
-        unknownNode->append_attribute(doc_ptr->allocate_attribute("valueReference", stringbuf.back().c_str()));
-        std::string dependencies = "";
-        for (const auto& d : v.second) {
-            auto d_index = allValrefs[d];
-            dependencies += std::to_string(d_index) + " ";
+    return getAdjointDerivativeIMPL(unknowns, nUnknowns, knowns, nKnowns, seed, nSeed, sensitivity, nSensitivity);
+}
+
+bool FmuComponentBase::collectDerivativeVariables(const fmi3ValueReference vrs[],
+                                                  size_t nvr,
+                                                  DerivativeVariables& collected,
+                                                  const std::string& caller) {
+    auto& variables = collected.variables;
+    auto& offsets = collected.offsets;
+    variables.clear();
+    offsets.assign(1, 0);
+    for (size_t i = 0; i < nvr; ++i) {
+        auto it = findByValref(vrs[i]);
+        if (it == m_variables.end() || it->GetType() != FmuVariable::Type::Float64) {
+            sendToLog(caller + ": variable with valueReference " + std::to_string(vrs[i]) +
+                          " does not exist or is not of type Float64.\n",
+                      fmi3Status::fmi3Error, "logStatusError");
+            return false;
         }
-        stringbuf.push_back(dependencies);
-        unknownNode->append_attribute(doc_ptr->allocate_attribute("dependencies", stringbuf.back().c_str()));
-        modelStructNode->append_node(unknownNode);
+        variables.push_back(it);
+        offsets.push_back(offsets.back() + GetVariableSize(*it));
     }
+    return true;
+}
 
-    rootNode->append_node(modelStructNode);
+bool FmuComponentBase::isDependentOn(const FmuVariableExport& unknown, const FmuVariableExport& known) const {
+    if (unknown.GetValueReference() == known.GetValueReference())
+        return true;
 
-    // Save the XML document to a file
-    std::ofstream outFile(path + "/modelDescription.xml");
-    outFile << *doc_ptr;
-    outFile.close();
+    bool declared = false;
 
-    delete doc_ptr;
+    auto derivative = m_derivatives.find(unknown.GetName());
+    if (derivative != m_derivatives.end()) {
+        declared = true;
+        const auto& names = derivative->second.second;
+        if (std::find(names.begin(), names.end(), known.GetName()) != names.end())
+            return true;
+    }
 
-    postModelDescriptionExport();
+    auto dependencies = m_variableDependencies.find(unknown.GetName());
+    if (dependencies != m_variableDependencies.end()) {
+        declared = true;
+        const auto& names = dependencies->second;
+        if (std::find(names.begin(), names.end(), known.GetName()) != names.end())
+            return true;
+    }
+
+    // without declared dependencies the unknown depends on all the knowns
+    return !declared;
 }
 
-// -----------------------------------------------------------------------------
+void FmuComponentBase::prepareVariableDependencies() {
+    if (m_dependenciesPrepared)
+        return;
 
-std::vector<size_t> FmuComponentBase::GetVariableDimensions(fmi3ValueReference valref) const {
-    return GetVariableDimensions(*findByValref(valref));
+    std::map<fmi3ValueReference, std::vector<fmi3ValueReference>> rows;
+    auto add_row = [&](const std::string& name, const std::vector<std::string>& dependency_names) {
+        auto& row = rows[findByName(name)->GetValueReference()];
+        for (const auto& dependency_name : dependency_names)
+            row.push_back(findByName(dependency_name)->GetValueReference());
+    };
+    for (const auto& d : m_derivatives)
+        add_row(d.first, d.second.second);
+    for (const auto& d : m_variableDependencies)
+        add_row(d.first, d.second);
+
+    m_dependents.clear();
+    m_dependencyOffsets.assign(1, 0);
+    m_independents.clear();
+    for (auto& row : rows) {
+        std::sort(row.second.begin(), row.second.end());
+        row.second.erase(std::unique(row.second.begin(), row.second.end()), row.second.end());
+        m_dependents.push_back(row.first);
+        m_independents.insert(m_independents.end(), row.second.begin(), row.second.end());
+        m_dependencyOffsets.push_back(m_independents.size());
+    }
+
+    m_dependenciesPrepared = true;
 }
 
-size_t FmuComponentBase::GetVariableSize(const FmuVariable& var) const {
-    if (var.GetDimensions().size() == 0)
-        return 1;
+bool FmuComponentBase::findVariableDependencies(fmi3ValueReference valueReference,
+                                                size_t& row,
+                                                const std::string& caller) {
+    prepareVariableDependencies();
 
-    size_t size = 1;
-    for (const auto& dim : GetVariableDimensions(var)) {
-        size *= dim;
+    auto it = std::lower_bound(m_dependents.begin(), m_dependents.end(), valueReference);
+    if (it != m_dependents.end() && *it == valueReference) {
+        row = static_cast<size_t>(it - m_dependents.begin());
+        return true;
     }
-    return size;
+
+    if (findByValref(valueReference) == m_variables.end())
+        sendToLog(caller + ": variable with valueReference " + std::to_string(valueReference) + " does not exist.\n",
+                  fmi3Status::fmi3Error, "logStatusError");
+    else
+        sendToLog(caller + ": variable with valueReference " + std::to_string(valueReference) +
+                      " has no declared dependencies (it depends on all the knowns).\n",
+                  fmi3Status::fmi3Error, "logStatusError");
+    return false;
 }
 
-void FmuComponentBase::executePreStepCallbacks() {
-    for (auto& callb : m_preStepCallbacks) {
-        callb();
-    }
+fmi3Status FmuComponentBase::GetNumberOfVariableDependencies(fmi3ValueReference valueReference,
+                                                             size_t* nDependencies) {
+    size_t row;
+    if (!findVariableDependencies(valueReference, row, "fmi3GetNumberOfVariableDependencies"))
+        return fmi3Status::fmi3Error;
+
+    *nDependencies = m_dependencyOffsets[row + 1] - m_dependencyOffsets[row];
+    return fmi3Status::fmi3OK;
 }
 
-void FmuComponentBase::executePostStepCallbacks() {
-    for (auto& callb : m_postStepCallbacks) {
-        callb();
+fmi3Status FmuComponentBase::GetVariableDependencies(fmi3ValueReference dependent,
+                                                     size_t elementIndicesOfDependent[],
+                                                     fmi3ValueReference independents[],
+                                                     size_t elementIndicesOfIndependents[],
+                                                     fmi3DependencyKind dependencyKinds[],
+                                                     size_t nDependencies) {
+    size_t row;
+    if (!findVariableDependencies(dependent, row, "fmi3GetVariableDependencies"))
+        return fmi3Status::fmi3Error;
+
+    size_t begin = m_dependencyOffsets[row];
+    if (nDependencies != m_dependencyOffsets[row + 1] - begin) {
+        sendToLog("fmi3GetVariableDependencies: nDependencies must match fmi3GetNumberOfVariableDependencies.\n",
+                  fmi3Status::fmi3Error, "logStatusError");
+        return fmi3Status::fmi3Error;
     }
-}
 
-std::set<FmuVariableExport>::iterator FmuComponentBase::findByValref(fmi3ValueReference vr) {
-    auto predicate_samevalref = [vr](const FmuVariable& var) { return var.GetValueReference() == vr; };
-    return std::find_if(m_variables.begin(), m_variables.end(), predicate_samevalref);
+    for (size_t i = 0; i < nDependencies; ++i) {
+        elementIndicesOfDependent[i] = 0;
+        independents[i] = m_independents[begin + i];
+        elementIndicesOfIndependents[i] = 0;
+        dependencyKinds[i] = fmi3Dependent;
+    }
+    return fmi3Status::fmi3OK;
 }
 
-std::set<FmuVariableExport>::const_iterator FmuComponentBase::findByValref(fmi3ValueReference vr) const {
-    auto predicate_samevalref = [vr](const FmuVariable& var) { return var.GetValueReference() == vr; };
-    return std::find_if(m_variables.begin(), m_variables.end(), predicate_samevalref);
+namespace {
+
+void read_float64_variables(const std::vector<std::set<FmuVariableExport>::iterator>& variables,
+                            const std::vector<size_t>& offsets,
+                            std::vector<fmi3Float64>& values) {
+    values.resize(offsets.back());
+    for (size_t i = 0; i < variables.size(); ++i)
+        variables[i]->GetValue(values.data() + offsets[i], offsets[i + 1] - offsets[i]);
 }
 
-std::set<FmuVariableExport>::iterator FmuComponentBase::findByName(const std::string& name) {
-    auto predicate_samename = [name](const FmuVariable& var) { return !var.GetName().compare(name); };
-    return std::find_if(m_variables.begin(), m_variables.end(), predicate_samename);
+void write_float64_variables(const std::vector<std::set<FmuVariableExport>::iterator>& variables,
+                             const std::vector<size_t>& offsets,
+                             const std::vector<fmi3Float64>& values) {
+    for (size_t i = 0; i < variables.size(); ++i)
+        variables[i]->SetValue(values.data() + offsets[i], offsets[i + 1] - offsets[i]);
 }
 
-std::vector<size_t> FmuComponentBase::GetVariableDimensions(const FmuVariable& var) const {
-    auto dim = var.GetDimensions();
+}  // namespace
 
-    // case of scalar variable
-    if (dim.size() == 0)
-        return std::vector<size_t>({1});
+fmi3Status FmuComponentBase::computeDirectionalDerivativeFD(const DerivativeVariables& unknowns,
+                                                            const DerivativeVariables& knowns,
+                                                            const fmi3Float64 seed[],
+                                                            size_t nSeed,
+                                                            fmi3Float64 sensitivity[],
+                                                            size_t nSensitivity) {
+    std::vector<fmi3Float64> x0, x, f0, f;
+    read_float64_variables(knowns.variables, knowns.offsets, x0);
 
-    std::vector<size_t> sizes;
-    for (const auto& d : dim) {
-        if (d.second == true)
-            // the size of the current dimension is fixed
-            sizes.push_back(d.first);
-        else {
-            // the size of the current dimension is given by another variable
-            size_t cur_size;
-            auto it_dim = findByValref(static_cast<fmi3ValueReference>(d.first));
-            it_dim->GetValue(&cur_size, 1);
-            sizes.push_back(cur_size);
-        }
+    double x_norm = 1;
+    double seed_norm = 0;
+    for (size_t j = 0; j < nSeed; ++j) {
+        x_norm = std::max(x_norm, std::abs(x0[j]));
+        seed_norm = std::max(seed_norm, std::abs(seed[j]));
     }
 
-    return sizes;
-}
+    if (seed_norm == 0) {
+        std::fill(sensitivity, sensitivity + nSensitivity, 0.0);
+        return fmi3Status::fmi3OK;
+    }
 
-// -----------------------------------------------------------------------------
+    // single perturbation along the seed direction
+    const double h = std::sqrt(std::numeric_limits<double>::epsilon()) * x_norm / seed_norm;
+
+    fmi3Status status = evaluateUnknownsIMPL();
+    if (status > fmi3Status::fmi3Warning)
+        return status;
+    read_float64_variables(unknowns.variables, unknowns.offsets, f0);
+
+    x = x0;
+    for (size_t j = 0; j < nSeed; ++j)
+        x[j] += h * seed[j];
+    write_float64_variables(knowns.variables, knowns.offsets, x);
+    ++m_valuesEpoch;  // lazy outputs must see the perturbed knowns
+    status = std::max(status, evaluateUnknownsIMPL());
+    if (status > fmi3Status::fmi3Warning) {
+        write_float64_variables(knowns.variables, knowns.offsets, x0);
+        ++m_valuesEpoch;
+        return status;
+    }
+    read_float64_variables(unknowns.variables, unknowns.offsets, f);
 
-fmi3Status FmuComponentBase::EnterInitializationMode(fmi3Boolean toleranceDefined,
-                                                     fmi3Float64 tolerance,
-                                                     fmi3Float64 startTime,
-                                                     fmi3Boolean stopTimeDefined,
-                                                     fmi3Float64 stopTime) {
-    m_startTime = startTime;
-    m_stopTime = stopTime;
-    m_tolerance = tolerance;
-    m_toleranceDefined = toleranceDefined;
-    m_stopTimeDefined = stopTimeDefined;
+    for (size_t i = 0; i < nSensitivity; ++i)
+        sensitivity[i] = (f[i] - f0[i]) / h;
 
-    m_fmuMachineState = FmuMachineState::initializationMode;
+    // restore the knowns and the corresponding unknowns
+    write_float64_variables(knowns.variables, knowns.offsets, x0);
+    ++m_valuesEpoch;
+    status = std::max(status, evaluateUnknownsIMPL());
 
-    fmi3Status status = enterInitializationModeIMPL();
+    return status;
+}
 
-    if (status == fmi3Status::fmi3Fatal) {
-        m_fmuMachineState = FmuMachineState::terminated;
+fmi3Status FmuComponentBase::computeAdjointDerivativeFD(const DerivativeVariables& unknowns,
+                                                        const DerivativeVariables& knowns,
+                                                        const fmi3Float64 seed[],
+                                                        size_t nSeed,
+                                                        fmi3Float64 sensitivity[],
+                                                        size_t nSensitivity) {
+    std::vector<fmi3Float64> jacobian;
+    fmi3Status status = computeJacobianFD(unknowns, knowns, jacobian);
+    if (status > fmi3Status::fmi3Warning)
+        return status;
+
+    std::fill(sensitivity, sensitivity + nSensitivity, 0.0);
+    for (size_t i = 0; i < nSeed; ++i) {
+        for (size_t j = 0; j < nSensitivity; ++j)
+            sensitivity[j] += jacobian[i * nSensitivity + j] * seed[i];
     }
 
     return status;
 }
 
-fmi3Status FmuComponentBase::ExitInitializationMode() {
-    fmi3Status status = exitInitializationModeIMPL();
-
-    switch (m_fmuType) {
-        case FmuType::MODEL_EXCHANGE:
-            m_fmuMachineState = FmuMachineState::continuousTimeMode;
-            break;
-        case FmuType::COSIMULATION:
-            m_fmuMachineState = m_eventModeUsed ? FmuMachineState::eventMode : FmuMachineState::stepMode;
-            break;
-        case FmuType::SCHEDULED_EXECUTION:
-            m_fmuMachineState = FmuMachineState::clockActivationMode;
-            break;
+fmi3Status FmuComponentBase::computeJacobianFD(const DerivativeVariables& unknowns,
+                                               const DerivativeVariables& knowns,
+                                               std::vector<fmi3Float64>& jacobian) {
+    const auto& unknowns_vars = unknowns.variables;
+    const auto& unknowns_offsets = unknowns.offsets;
+    const auto& knowns_vars = knowns.variables;
+    const auto& knowns_offsets = knowns.offsets;
+    const size_t nUnknowns = unknowns_vars.size();
+    const size_t nKnowns = knowns_vars.size();
+
+    const size_t n_rows = unknowns_offsets.back();
+    const size_t n_cols = knowns_offsets.back();
+    jacobian.assign(n_rows * n_cols, 0.0);
+
+    // sparsity pattern, by variable
+    std::vector<std::vector<size_t>> dependent_unknowns(nKnowns);
+    for (size_t k = 0; k < nKnowns; ++k) {
+        for (size_t u = 0; u < nUnknowns; ++u) {
+            if (isDependentOn(*unknowns_vars[u], *knowns_vars[k]))
+                dependent_unknowns[k].push_back(u);
+        }
     }
 
-    if (status == fmi3Status::fmi3Fatal) {
-        m_fmuMachineState = FmuMachineState::terminated;
+    // greedy coloring of the known variables: knowns sharing a color do not affect any common unknown
+    std::vector<size_t> colors(nKnowns);
+    std::vector<std::vector<bool>> colors_used_by_unknown(nUnknowns);
+    size_t n_colors = 0;
+    for (size_t k = 0; k < nKnowns; ++k) {
+        size_t color = 0;
+        bool conflict = true;
+        while (conflict) {
+            conflict = false;
+            for (auto u : dependent_unknowns[k]) {
+                if (color < colors_used_by_unknown[u].size() && colors_used_by_unknown[u][color]) {
+                    conflict = true;
+                    ++color;
+                    break;
+                }
+            }
+        }
+        colors[k] = color;
+        n_colors = std::max(n_colors, color + 1);
+        for (auto u : dependent_unknowns[k]) {
+            if (colors_used_by_unknown[u].size() <= color)
+                colors_used_by_unknown[u].resize(color + 1, false);
+            colors_used_by_unknown[u][color] = true;
+        }
     }
 
-    return status;
-}
+    std::vector<fmi3Float64> x0, x, f0, f, h(n_cols);
+    read_float64_variables(knowns_vars, knowns_offsets, x0);
+    for (size_t j = 0; j < n_cols; ++j)
+        h[j] = std::sqrt(std::numeric_limits<double>::epsilon()) * std::max(1.0, std::abs(x0[j]));
+
+    fmi3Status status = evaluateUnknownsIMPL();
+    if (status > fmi3Status::fmi3Warning)
+        return status;
+    read_float64_variables(unknowns_vars, unknowns_offsets, f0);
+
+    // the elements of an array variable affect the same unknowns: perturb them one at a time, together with the
+    // elements with the same index of the other knowns with the same color
+    size_t max_known_size = 0;
+    for (size_t k = 0; k < nKnowns; ++k)
+        max_known_size = std::max(max_known_size, knowns_offsets[k + 1] - knowns_offsets[k]);
+
+    for (size_t color = 0; color < n_colors; ++color) {
+        for (size_t el = 0; el < max_known_size; ++el) {
+            x = x0;
+            bool perturbed = false;
+            for (size_t k = 0; k < nKnowns; ++k) {
+                if (colors[k] == color && knowns_offsets[k] + el < knowns_offsets[k + 1]) {
+                    x[knowns_offsets[k] + el] += h[knowns_offsets[k] + el];
+                    perturbed = true;
+                }
+            }
+            if (!perturbed)
+                continue;
+
+            write_float64_variables(knowns_vars, knowns_offsets, x);
+            ++m_valuesEpoch;
+            status = std::max(status, evaluateUnknownsIMPL());
+            if (status > fmi3Status::fmi3Warning) {
+                write_float64_variables(knowns_vars, knowns_offsets, x0);
+                ++m_valuesEpoch;
+                return status;
+            }
+            read_float64_variables(unknowns_vars, unknowns_offsets, f);
+
+            for (size_t k = 0; k < nKnowns; ++k) {
+                if (colors[k] != color || knowns_offsets[k] + el >= knowns_offsets[k + 1])
+                    continue;
+                size_t col = knowns_offsets[k] + el;
+                for (auto u : dependent_unknowns[k]) {
+                    for (size_t row = unknowns_offsets[u]; row < unknowns_offsets[u + 1]; ++row)
+                        jacobian[row * n_cols + col] = (f[row] - f0[row]) / h[col];
+                }
+            }
+        }
+    }
 
-fmi3Status FmuComponentBase::UpdateDiscreteStates(fmi3Boolean* discreteStatesNeedUpdate,
-                                                  fmi3Boolean* terminateSimulation,
-                                                  fmi3Boolean* nominalsOfContinuousStatesChanged,
-                                                  fmi3Boolean* valuesOfContinuousStatesChanged,
-                                                  fmi3Boolean* nextEventTimeDefined,
-                                                  fmi3Float64* nextEventTime) {
-    fmi3Status status =
-        updateDiscreteStatesIMPL(discreteStatesNeedUpdate, terminateSimulation, nominalsOfContinuousStatesChanged,
-                                 valuesOfContinuousStatesChanged, nextEventTimeDefined, nextEventTime);
+    // restore the knowns and the corresponding unknowns
+    write_float64_variables(knowns_vars, knowns_offsets, x0);
+    ++m_valuesEpoch;
+    status = std::max(status, evaluateUnknownsIMPL());
 
-    if (status == fmi3Status::fmi3Fatal) {
-        m_fmuMachineState = FmuMachineState::terminated;
-    }
     return status;
 }
 
-fmi3Status FmuComponentBase::DoStep(fmi3Float64 currentCommunicationPoint,
-                                    fmi3Float64 communicationStepSize,
-                                    fmi3Boolean noSetFMUStatePriorToCurrentPoint,
-                                    fmi3Boolean* eventHandlingNeeded,
-                                    fmi3Boolean* terminateSimulation,
-                                    fmi3Boolean* earlyReturn,
-                                    fmi3Float64* lastSuccessfulTime) {
-    // invoke any pre step callbacks (e.g., to process input variables)
-    executePreStepCallbacks();
+// -----------------------------------------------------------------------------
 
-    fmi3Status status = doStepIMPL(currentCommunicationPoint, communicationStepSize, noSetFMUStatePriorToCurrentPoint,
-                                   eventHandlingNeeded, terminateSimulation, earlyReturn, lastSuccessfulTime);
+void FmuComponentBase::addUnitDefinition(const UnitDefinition& unit_definition) {
+    m_unitDefinitions[unit_definition.name] = unit_definition;
+}
 
-    // invoke any post step callbacks (e.g., to update auxiliary variables)
-    executePostStepCallbacks();
+void FmuComponentBase::sendToLog(const std::string& msg, fmi3Status status, const std::string& msg_cat) {
+    int id = GetLogCategoryId(msg_cat);
+    assert(id >= 0 && ("Developer warning: the category \"" + msg_cat + "\" is not recognized by the FMU").c_str());
 
-    return status;
+    if (id >= 0)
+        sendToLog(msg, status, id);
+    else if (m_logMessage)
+        m_logMessage(m_instanceEnvironment, status, msg_cat.c_str(), msg.c_str());
 }
 
-fmi3Status FmuComponentBase::CompletedIntegratorStep(fmi3Boolean noSetFMUStatePriorToCurrentPoint,
-                                                     fmi3Boolean* enterEventMode,
-                                                     fmi3Boolean* terminateSimulation) {
-    fmi3Status status =
-        completedIntegratorStepIMPL(noSetFMUStatePriorToCurrentPoint, enterEventMode, terminateSimulation);
+void FmuComponentBase::sendToLog(const std::string& msg, fmi3Status status, int msg_cat_id) {
+    if (!isLogEnabled(msg_cat_id) || !m_logMessage)
+        return;
 
-    return status;
+    if (m_asyncLogSink)
+        m_asyncLogSink->Push(msg, status, msg_cat_id);
+    else
+        m_logMessage(m_instanceEnvironment, status, m_logCategoryNames[msg_cat_id].c_str(), msg.c_str());
 }
 
-fmi3Status FmuComponentBase::SetTime(fmi3Float64 time) {
-    m_time = time;
+#ifdef FMU_FORGE_PROFILING
 
-    fmi3Status status = setTimeIMPL(time);
+// -----------------------------------------------------------------------------
 
-    //// TODO - anything else here?
+namespace {
 
-    return status;
+std::mutex& profileMutex() {
+    static std::mutex mutex;
+    return mutex;
 }
 
-fmi3Status FmuComponentBase::GetContinuousStates(fmi3Float64 continuousStates[], size_t nContinuousStates) {
-    fmi3Status status = getContinuousStatesIMPL(continuousStates, nContinuousStates);
-
-    //// TODO - interpret/process status?
-
-    return status;
+std::vector<std::string>& profileNames() {
+    static std::vector<std::string> names;
+    return names;
 }
 
-fmi3Status FmuComponentBase::SetContinuousStates(const fmi3Float64 continuousStates[], size_t nContinuousStates) {
-    fmi3Status status = setContinuousStatesIMPL(continuousStates, nContinuousStates);
+}  // namespace
 
-    //// TODO - interpret/process status?
-    ////   Set FMU machine state (m_fmuMachineState)
+size_t FmuProfileRegister(const char* name) {
+    std::lock_guard<std::mutex> lock(profileMutex());
+    profileNames().push_back(name);
+    return profileNames().size() - 1;
+}
 
-    return status;
+std::string FmuProfileName(size_t id) {
+    std::lock_guard<std::mutex> lock(profileMutex());
+    return id < profileNames().size() ? profileNames()[id] : std::string("?");
 }
 
-fmi3Status FmuComponentBase::GetDerivatives(fmi3Float64 derivatives[], size_t nContinuousStates) {
-    // invoke any pre step callbacks (e.g., to process input variables)
-    executePreStepCallbacks();
+std::string FmuComponentBase::GetProfileReport() const {
+    typedef std::pair<std::string, const FmuProfileCounter*> Row;
+    std::vector<Row> functions;
+    std::vector<Row> stages;
+    for (size_t id = 0; id < m_profileCounters.size(); ++id)
+        if (m_profileCounters[id].calls > 0)
+            functions.push_back({FmuProfileName(id), &m_profileCounters[id]});
+    for (const auto* pipeline : {&m_preStepStages, &m_postStepStages})
+        for (const auto& stage : *pipeline)
+            if (stage.profile.calls > 0)
+                stages.push_back({stage.profile_name, &stage.profile});
 
-    fmi3Status status = getDerivativesIMPL(derivatives, nContinuousStates);
+    std::ostringstream ss;
+    ss << "Profile of FMU instance '" << m_instanceName << "'\n";
 
-    // invoke any post step callbacks (e.g., to update auxiliary variables)
-    executePostStepCallbacks();
+    auto print = [&ss](const char* title, std::vector<Row>& rows) {
+        std::sort(rows.begin(), rows.end(),
+                  [](const Row& a, const Row& b) { return a.second->time > b.second->time; });
+        ss << title << "\n";
+        ss << "  " << std::left << std::setw(40) << "name" << std::right << std::setw(12) << "calls" << std::setw(14)
+           << "total [ms]" << std::setw(14) << "mean [us]" << "\n";
+        for (const auto& row : rows) {
+            double total = std::chrono::duration<double, std::milli>(row.second->time).count();
+            double mean = std::chrono::duration<double, std::micro>(row.second->time).count() / row.second->calls;
+            ss << "  " << std::left << std::setw(40) << row.first << std::right << std::setw(12) << row.second->calls
+               << std::fixed << std::setprecision(3) << std::setw(14) << total << std::setw(14) << mean << "\n";
+        }
+    };
 
-    //// TODO - interpret/process status?
-    ////   Set FMU machine state (m_fmuMachineState)
+    print("FMI functions:", functions);
+    if (!stages.empty())
+        print("Step callbacks:", stages);
 
-    return status;
+    return ss.str();
 }
 
-void FmuComponentBase::addUnitDefinition(const UnitDefinition& unit_definition) {
-    m_unitDefinitions[unit_definition.name] = unit_definition;
+void FmuComponentBase::ResetProfile() {
+    // counters are reset in place, since they may be referenced by the scopes being profiled
+    for (auto& counter : m_profileCounters)
+        counter = FmuProfileCounter();
+    for (auto* pipeline : {&m_preStepStages, &m_postStepStages})
+        for (auto& stage : *pipeline)
+            stage.profile = FmuProfileCounter();
 }
 
-void FmuComponentBase::sendToLog(std::string msg, fmi3Status status, std::string msg_cat) {
-    assert(m_logCategories_enabled.find(msg_cat) != m_logCategories_enabled.end() &&
-           ("Developer warning: the category \"" + msg_cat + "\" is not recognized by the FMU").c_str());
+#endif
 
-    if (m_logCategories_enabled.find(msg_cat) == m_logCategories_enabled.end() ||                        //
-        m_logCategories_enabled[msg_cat] ||                                                              //
-        (m_debug_logging_enabled && m_logCategories_debug.find(msg_cat) != m_logCategories_debug.end())  //
-    ) {
-        m_logMessage(m_instanceEnvironment, status, msg_cat.c_str(), msg.c_str());
+// =============================================================================
+
+FmuAsyncLogSink::FmuAsyncLogSink(fmi3LogMessageCallback logMessage,
+                                 fmi3InstanceEnvironment instanceEnvironment,
+                                 const std::vector<std::string>& categories,
+                                 size_t capacity)
+    : m_logMessage(logMessage),
+      m_instanceEnvironment(instanceEnvironment),
+      m_categories(categories),
+      m_slots(std::max<size_t>(capacity, 1) + 1),  // one slot is always left empty to tell a full buffer apart
+      m_head(0),
+      m_tail(0),
+      m_dropped(0),
+      m_dropped_total(0),
+      m_stop(false) {
+    m_worker = std::thread(&FmuAsyncLogSink::run, this);
+}
+
+FmuAsyncLogSink::~FmuAsyncLogSink() {
+    m_stop.store(true, std::memory_order_release);
+    m_worker.join();
+}
+
+bool FmuAsyncLogSink::Push(const std::string& msg, fmi3Status status, int category) {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    size_t next = head + 1 == m_slots.size() ? 0 : head + 1;
+    if (next == m_tail.load(std::memory_order_acquire)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        m_dropped_total.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    Slot& slot = m_slots[head];
+    slot.status = status;
+    slot.category = category;
+    slot.msg.assign(msg);  // reuses the capacity of the slot
+    m_head.store(next, std::memory_order_release);
+    return true;
+}
+
+void FmuAsyncLogSink::run() {
+    while (true) {
+        // read the stop flag before draining: messages pushed before the flag was set are always delivered
+        bool stop = m_stop.load(std::memory_order_acquire);
+
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        while (tail != m_head.load(std::memory_order_acquire)) {
+            const Slot& slot = m_slots[tail];
+            m_logMessage(m_instanceEnvironment, slot.status, m_categories[slot.category].c_str(), slot.msg.c_str());
+            tail = tail + 1 == m_slots.size() ? 0 : tail + 1;
+            m_tail.store(tail, std::memory_order_release);
+        }
+
+        size_t dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0) {
+            std::string msg = std::to_string(dropped) + " log messages dropped: the asynchronous log buffer is full.\n";
+            m_logMessage(m_instanceEnvironment, fmi3Status::fmi3Warning, "logStatusWarning", msg.c_str());
+        }
+
+        if (stop)
+            break;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
 }
 
@@ -1116,6 +3350,7 @@ fmi3Status fmi3SetDebugLogging(fmi3Instance instance,
                                fmi3Boolean loggingOn,
                                size_t nCategories,
                                const fmi3String categories[]) {
+    FMU_PROFILE_FUNCTION(instance);
     FmuComponentBase* fmu_ptr = reinterpret_cast<FmuComponentBase*>(instance);
     for (auto cs = 0; cs < nCategories; ++cs) {
         fmu_ptr->SetDebugLogging(categories[cs], loggingOn == fmi3True ? true : false);
@@ -1135,6 +3370,11 @@ fmi3Instance fmi3InstantiateModelExchange(fmi3String instanceName,
                                           fmi3LogMessageCallback logMessage) {
     FmuComponentBase* fmu_ptr = fmi3InstantiateIMPL(FmuType::MODEL_EXCHANGE, instanceName, instantiationToken,
                                                     resourcePath, visible, loggingOn, instanceEnvironment, logMessage);
+    if (!fmu_ptr)
+        return nullptr;
+
+    fmu_ptr->SaveResetState();
+
     return reinterpret_cast<void*>(fmu_ptr);
 }
 
@@ -1156,7 +3396,8 @@ fmi3Instance fmi3InstantiateCoSimulation(fmi3String instanceName,
         return nullptr;
 
     //// RADU TODO - set cosimulation-specific flags on the FMU (based on input arguments)
-    fmu_ptr->SetIntermediateUpdateCallback(intermediateUpdate);
+    fmu_ptr->SetIntermediateUpdateCallback(intermediateUpdate, earlyReturnAllowed == fmi3True);
+    fmu_ptr->SaveResetState();
 
     return reinterpret_cast<void*>(fmu_ptr);
 }
@@ -1171,10 +3412,24 @@ fmi3Instance fmi3InstantiateScheduledExecution(fmi3String instanceName,
                                                fmi3ClockUpdateCallback clockUpdate,
                                                fmi3LockPreemptionCallback lockPreemption,
                                                fmi3UnlockPreemptionCallback unlockPreemption) {
-    // Not supported in fmu-forge
-    logMessage(instanceEnvironment, fmi3Status::fmi3Error, "logStatusError",
-               "fmu-forge does not currently support the ScheduledExecution interface.\n");
-    return nullptr;
+    FmuComponentBase* fmu_ptr = nullptr;
+    try {
+        fmu_ptr = fmi3InstantiateIMPL(FmuType::SCHEDULED_EXECUTION, instanceName, instantiationToken, resourcePath,
+                                      visible, loggingOn, instanceEnvironment, logMessage);
+    } catch (std::exception& e) {
+        // e.g. the FMU does not implement the ScheduledExecution interface
+        if (logMessage)
+            logMessage(instanceEnvironment, fmi3Status::fmi3Error, "logStatusError",
+                       (std::string(e.what()) + "\n").c_str());
+        return nullptr;
+    }
+    if (!fmu_ptr)
+        return nullptr;
+
+    fmu_ptr->SetScheduledExecutionCallbacks(clockUpdate, lockPreemption, unlockPreemption);
+    fmu_ptr->SaveResetState();
+
+    return reinterpret_cast<void*>(fmu_ptr);
 }
 
 void fmi3FreeInstance(fmi3Instance instance) {
@@ -1189,11 +3444,13 @@ fmi3Status fmi3EnterInitializationMode(fmi3Instance instance,
                                        fmi3Float64 startTime,
                                        fmi3Boolean stopTimeDefined,
                                        fmi3Float64 stopTime) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->EnterInitializationMode(toleranceDefined, tolerance,
                                                                                   startTime, stopTimeDefined, stopTime);
 }
 
 fmi3Status fmi3ExitInitializationMode(fmi3Instance instance) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->ExitInitializationMode();
 }
 
@@ -1202,11 +3459,13 @@ fmi3Status fmi3EnterEventMode(fmi3Instance instance) {
 }
 
 fmi3Status fmi3Terminate(fmi3Instance instance) {
-    return fmi3Status::fmi3OK;
+    FMU_PROFILE_FUNCTION(instance);
+    return reinterpret_cast<FmuComponentBase*>(instance)->Terminate();
 }
 
 fmi3Status fmi3Reset(fmi3Instance instance) {
-    return fmi3Status::fmi3OK;
+    FMU_PROFILE_FUNCTION(instance);
+    return reinterpret_cast<FmuComponentBase*>(instance)->Reset();
 }
 
 // ------ Getting variable values
@@ -1216,6 +3475,7 @@ fmi3Status fmi3GetFloat32(fmi3Instance instance,
                           size_t nValueReferences,
                           fmi3Float32 values[],
                           size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3GetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1225,6 +3485,7 @@ fmi3Status fmi3GetFloat64(fmi3Instance instance,
                           size_t nValueReferences,
                           fmi3Float64 values[],
                           size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3GetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1234,6 +3495,7 @@ fmi3Status fmi3GetInt8(fmi3Instance instance,
                        size_t nValueReferences,
                        fmi3Int8 values[],
                        size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3GetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1243,6 +3505,7 @@ fmi3Status fmi3GetUInt8(fmi3Instance instance,
                         size_t nValueReferences,
                         fmi3UInt8 values[],
                         size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3GetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1252,6 +3515,7 @@ fmi3Status fmi3GetInt16(fmi3Instance instance,
                         size_t nValueReferences,
                         fmi3Int16 values[],
                         size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3GetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1261,6 +3525,7 @@ fmi3Status fmi3GetUInt16(fmi3Instance instance,
                          size_t nValueReferences,
                          fmi3UInt16 values[],
                          size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3GetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1270,6 +3535,7 @@ fmi3Status fmi3GetInt32(fmi3Instance instance,
                         size_t nValueReferences,
                         fmi3Int32 values[],
                         size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3GetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1279,6 +3545,7 @@ fmi3Status fmi3GetUInt32(fmi3Instance instance,
                          size_t nValueReferences,
                          fmi3UInt32 values[],
                          size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3GetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1288,6 +3555,7 @@ fmi3Status fmi3GetInt64(fmi3Instance instance,
                         size_t nValueReferences,
                         fmi3Int64 values[],
                         size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3GetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1297,6 +3565,7 @@ fmi3Status fmi3GetUInt64(fmi3Instance instance,
                          size_t nValueReferences,
                          fmi3UInt64 values[],
                          size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3GetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1306,6 +3575,7 @@ fmi3Status fmi3GetBoolean(fmi3Instance instance,
                           size_t nValueReferences,
                           fmi3Boolean values[],
                           size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3GetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1315,6 +3585,7 @@ fmi3Status fmi3GetString(fmi3Instance instance,
                          size_t nValueReferences,
                          fmi3String values[],
                          size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3GetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1325,6 +3596,7 @@ fmi3Status fmi3GetBinary(fmi3Instance instance,
                          size_t valueSizes[],
                          fmi3Binary values[],
                          size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3GetVariable(valueReferences, nValueReferences, valueSizes,
                                                                           values, nValues);
 }
@@ -1333,8 +3605,8 @@ fmi3Status fmi3GetClock(fmi3Instance instance,
                         const fmi3ValueReference valueReferences[],
                         size_t nValueReferences,
                         fmi3Clock values[]) {
-    //// RADU TODO
-    return fmi3Status::fmi3Error;
+    FMU_PROFILE_FUNCTION(instance);
+    return reinterpret_cast<FmuComponentBase*>(instance)->GetClock(valueReferences, nValueReferences, values);
 }
 
 // ------ Setting variable values
@@ -1344,6 +3616,7 @@ fmi3Status fmi3SetFloat32(fmi3Instance instance,
                           size_t nValueReferences,
                           const fmi3Float32 values[],
                           size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3SetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1353,6 +3626,7 @@ fmi3Status fmi3SetFloat64(fmi3Instance instance,
                           size_t nValueReferences,
                           const fmi3Float64 values[],
                           size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3SetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1362,6 +3636,7 @@ fmi3Status fmi3SetInt8(fmi3Instance instance,
                        size_t nValueReferences,
                        const fmi3Int8 values[],
                        size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3SetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1371,6 +3646,7 @@ fmi3Status fmi3SetUInt8(fmi3Instance instance,
                         size_t nValueReferences,
                         const fmi3UInt8 values[],
                         size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3SetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1380,6 +3656,7 @@ fmi3Status fmi3SetInt16(fmi3Instance instance,
                         size_t nValueReferences,
                         const fmi3Int16 values[],
                         size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3SetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1389,6 +3666,7 @@ fmi3Status fmi3SetUInt16(fmi3Instance instance,
                          size_t nValueReferences,
                          const fmi3UInt16 values[],
                          size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3SetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1398,6 +3676,7 @@ fmi3Status fmi3SetInt32(fmi3Instance instance,
                         size_t nValueReferences,
                         const fmi3Int32 values[],
                         size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3SetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1407,6 +3686,7 @@ fmi3Status fmi3SetUInt32(fmi3Instance instance,
                          size_t nValueReferences,
                          const fmi3UInt32 values[],
                          size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3SetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1416,6 +3696,7 @@ fmi3Status fmi3SetInt64(fmi3Instance instance,
                         size_t nValueReferences,
                         const fmi3Int64 values[],
                         size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3SetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1425,6 +3706,7 @@ fmi3Status fmi3SetUInt64(fmi3Instance instance,
                          size_t nValueReferences,
                          const fmi3UInt64 values[],
                          size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3SetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1434,6 +3716,7 @@ fmi3Status fmi3SetBoolean(fmi3Instance instance,
                           size_t nValueReferences,
                           const fmi3Boolean values[],
                           size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3SetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1443,6 +3726,7 @@ fmi3Status fmi3SetString(fmi3Instance instance,
                          size_t nValueReferences,
                          const fmi3String values[],
                          size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3SetVariable(valueReferences, nValueReferences, values,
                                                                           nValues);
 }
@@ -1453,6 +3737,7 @@ fmi3Status fmi3SetBinary(fmi3Instance instance,
                          const size_t valueSizes[],
                          const fmi3Binary values[],
                          size_t nValues) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->fmi3SetVariable(valueReferences, nValueReferences, valueSizes,
                                                                           values, nValues);
 }
@@ -1470,7 +3755,9 @@ fmi3Status fmi3SetClock(fmi3Instance instance,
 fmi3Status fmi3GetNumberOfVariableDependencies(fmi3Instance instance,
                                                fmi3ValueReference valueReference,
                                                size_t* nDependencies) {
-    return fmi3Status::fmi3Error;
+    FMU_PROFILE_FUNCTION(instance);
+    return reinterpret_cast<FmuComponentBase*>(instance)->GetNumberOfVariableDependencies(valueReference,
+                                                                                         nDependencies);
 }
 
 fmi3Status fmi3GetVariableDependencies(fmi3Instance instance,
@@ -1480,34 +3767,43 @@ fmi3Status fmi3GetVariableDependencies(fmi3Instance instance,
                                        size_t elementIndicesOfIndependents[],
                                        fmi3DependencyKind dependencyKinds[],
                                        size_t nDependencies) {
-    return fmi3Status::fmi3Error;
+    FMU_PROFILE_FUNCTION(instance);
+    return reinterpret_cast<FmuComponentBase*>(instance)->GetVariableDependencies(
+        dependent, elementIndicesOfDependent, independents, elementIndicesOfIndependents, dependencyKinds,
+        nDependencies);
 }
 
 // ------ Getting and setting the internal FMU state
 
 fmi3Status fmi3GetFMUState(fmi3Instance instance, fmi3FMUState* FMUState) {
-    return fmi3Status::fmi3Error;
+    FMU_PROFILE_FUNCTION(instance);
+    return reinterpret_cast<FmuComponentBase*>(instance)->GetFMUState(FMUState);
 }
 fmi3Status fmi3SetFMUState(fmi3Instance instance, fmi3FMUState FMUState) {
-    return fmi3Status::fmi3Error;
+    FMU_PROFILE_FUNCTION(instance);
+    return reinterpret_cast<FmuComponentBase*>(instance)->SetFMUState(FMUState);
 }
 fmi3Status fmi3FreeFMUState(fmi3Instance instance, fmi3FMUState* FMUState) {
-    return fmi3Status::fmi3Error;
+    FMU_PROFILE_FUNCTION(instance);
+    return reinterpret_cast<FmuComponentBase*>(instance)->FreeFMUState(FMUState);
 }
 fmi3Status fmi3SerializedFMUStateSize(fmi3Instance instance, fmi3FMUState FMUState, size_t* size) {
-    return fmi3Status::fmi3Error;
+    FMU_PROFILE_FUNCTION(instance);
+    return reinterpret_cast<FmuComponentBase*>(instance)->SerializedFMUStateSize(FMUState, size);
 }
 fmi3Status fmi3SerializeFMUState(fmi3Instance instance,
                                  fmi3FMUState FMUState,
                                  fmi3Byte serializedState[],
                                  size_t size) {
-    return fmi3Status::fmi3Error;
+    FMU_PROFILE_FUNCTION(instance);
+    return reinterpret_cast<FmuComponentBase*>(instance)->SerializeFMUState(FMUState, serializedState, size);
 }
 fmi3Status fmi3DeserializeFMUState(fmi3Instance instance,
                                    const fmi3Byte serializedState[],
                                    size_t size,
                                    fmi3FMUState* FMUState) {
-    return fmi3Status::fmi3Error;
+    FMU_PROFILE_FUNCTION(instance);
+    return reinterpret_cast<FmuComponentBase*>(instance)->DeserializeFMUState(serializedState, size, FMUState);
 }
 
 // ------ Getting partial derivatives
@@ -1520,7 +3816,9 @@ fmi3Status fmi3GetDirectionalDerivative(fmi3Instance instance,
                                         size_t nSeed,
                                         fmi3Float64 sensitivity[],
                                         size_t nSensitivity) {
-    return fmi3Status::fmi3Error;
+    FMU_PROFILE_FUNCTION(instance);
+    return reinterpret_cast<FmuComponentBase*>(instance)->GetDirectionalDerivative(
+        unknowns, nUnknowns, knowns, nKnowns, seed, nSeed, sensitivity, nSensitivity);
 }
 
 fmi3Status fmi3GetAdjointDerivative(fmi3Instance instance,
@@ -1532,7 +3830,9 @@ fmi3Status fmi3GetAdjointDerivative(fmi3Instance instance,
                                     size_t nSeed,
                                     fmi3Float64 sensitivity[],
                                     size_t nSensitivity) {
-    return fmi3Status::fmi3Error;
+    FMU_PROFILE_FUNCTION(instance);
+    return reinterpret_cast<FmuComponentBase*>(instance)->GetAdjointDerivative(
+        unknowns, nUnknowns, knowns, nKnowns, seed, nSeed, sensitivity, nSensitivity);
 }
 
 // ------ Entering and exiting the Configuration or Reconfiguration Mode
@@ -1554,7 +3854,9 @@ fmi3Status fmi3GetIntervalDecimal(fmi3Instance instance,
                                   size_t nValueReferences,
                                   fmi3Float64 intervals[],
                                   fmi3IntervalQualifier qualifiers[]) {
-    return fmi3Status::fmi3Error;
+    FMU_PROFILE_FUNCTION(instance);
+    return reinterpret_cast<FmuComponentBase*>(instance)->GetIntervalDecimal(valueReferences, nValueReferences,
+                                                                             intervals, qualifiers);
 }
 fmi3Status fmi3GetIntervalFraction(fmi3Instance instance,
                                    const fmi3ValueReference valueReferences[],
@@ -1613,6 +3915,7 @@ fmi3Status fmi3UpdateDiscreteStates(fmi3Instance instance,
                                     fmi3Boolean* valuesOfContinuousStatesChanged,
                                     fmi3Boolean* nextEventTimeDefined,
                                     fmi3Float64* nextEventTime) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->UpdateDiscreteStates(
         discreteStatesNeedUpdate, terminateSimulation, nominalsOfContinuousStatesChanged,
         valuesOfContinuousStatesChanged, nextEventTimeDefined, nextEventTime);
@@ -1623,30 +3926,35 @@ fmi3Status fmi3UpdateDiscreteStates(fmi3Instance instance,
 // ------ Model Exchange
 
 fmi3Status fmi3EnterContinuousTimeMode(fmi3Instance instance) {
-    return fmi3Status::fmi3Error;
+    FMU_PROFILE_FUNCTION(instance);
+    return reinterpret_cast<FmuComponentBase*>(instance)->EnterContinuousTimeMode();
 }
 
 fmi3Status fmi3CompletedIntegratorStep(fmi3Instance instance,
                                        fmi3Boolean noSetFMUStatePriorToCurrentPoint,
                                        fmi3Boolean* enterEventMode,
                                        fmi3Boolean* terminateSimulation) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->CompletedIntegratorStep(noSetFMUStatePriorToCurrentPoint,
                                                                                   enterEventMode, terminateSimulation);
 }
 
 fmi3Status fmi3SetTime(fmi3Instance instance, fmi3Float64 time) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->SetTime(time);
 }
 
 fmi3Status fmi3SetContinuousStates(fmi3Instance instance,
                                    const fmi3Float64 continuousStates[],
                                    size_t nContinuousStates) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->SetContinuousStates(continuousStates, nContinuousStates);
 }
 
 fmi3Status fmi3GetContinuousStateDerivatives(fmi3Instance instance,
                                              fmi3Float64 derivatives[],
                                              size_t nContinuousStates) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->GetDerivatives(derivatives, nContinuousStates);
 }
 
@@ -1655,11 +3963,12 @@ fmi3Status fmi3GetEventIndicators(fmi3Instance instance, fmi3Float64 eventIndica
 }
 
 fmi3Status fmi3GetContinuousStates(fmi3Instance instance, fmi3Float64 continuousStates[], size_t nContinuousStates) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->GetContinuousStates(continuousStates, nContinuousStates);
 }
 
 fmi3Status fmi3GetNominalsOfContinuousStates(fmi3Instance instance, fmi3Float64 nominals[], size_t nContinuousStates) {
-    return fmi3Status::fmi3Error;
+    return reinterpret_cast<FmuComponentBase*>(instance)->GetNominalsOfContinuousStates(nominals, nContinuousStates);
 }
 
 fmi3Status fmi3GetNumberOfEventIndicators(fmi3Instance instance, size_t* nEventIndicators) {
@@ -1667,7 +3976,7 @@ fmi3Status fmi3GetNumberOfEventIndicators(fmi3Instance instance, size_t* nEventI
 }
 
 fmi3Status fmi3GetNumberOfContinuousStates(fmi3Instance instance, size_t* nContinuousStates) {
-    return fmi3Status::fmi3Error;
+    return reinterpret_cast<FmuComponentBase*>(instance)->GetNumberOfContinuousStates(nContinuousStates);
 }
 
 // ------ Co-Simulation
@@ -1693,6 +4002,7 @@ fmi3Status fmi3DoStep(fmi3Instance instance,
                       fmi3Boolean* terminateSimulation,
                       fmi3Boolean* earlyReturn,
                       fmi3Float64* lastSuccessfulTime) {
+    FMU_PROFILE_FUNCTION(instance);
     return reinterpret_cast<FmuComponentBase*>(instance)->DoStep(currentCommunicationPoint, communicationStepSize,
                                                                  noSetFMUStatePriorToCurrentPoint, eventHandlingNeeded,
                                                                  terminateSimulation, earlyReturn, lastSuccessfulTime);
@@ -1703,5 +4013,6 @@ fmi3Status fmi3DoStep(fmi3Instance instance,
 fmi3Status fmi3ActivateModelPartition(fmi3Instance instance,
                                       fmi3ValueReference clockReference,
                                       fmi3Float64 activationTime) {
-    return fmi3Status::fmi3Error;
+    // not profiled: partitions run concurrently, while the profile counters are not thread-safe
+    return reinterpret_cast<FmuComponentBase*>(instance)->ActivateModelPartition(clockReference, activationTime);
 }
@@ -16,7 +16,14 @@
 #ifndef FMUTOOLS_FMI3_EXPORT_H
 #define FMUTOOLS_FMI3_EXPORT_H
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <thread>
 #include <vector>
 #include <array>
 #include <map>
@@ -27,6 +34,8 @@
 #include <unordered_set>
 #include <functional>
 #include <list>
+#include <memory>
+#include <typeinfo>
 #include <sstream>
 
 #include "FmuToolsUnitDefinitions.h"
@@ -67,8 +76,236 @@ bool FMI3_Export createModelDescription(const std::string& path, std::string& er
 template <class T>
 using FunGetSet = std::pair<std::function<T(void)>, std::function<void(T)>>;
 
+/// Send a message to the logger only if the log category (given by its id, see GetLogCategoryId) is enabled.
+/// The message expression is not evaluated at all otherwise. To be used inside FmuComponentBase member functions.
+#define FMU_LOG(cat_id, status, msg)            \
+    do {                                          \
+        if (isLogEnabled(cat_id))                 \
+            sendToLog((msg), (status), (cat_id)); \
+    } while (0)
+
+#ifdef FMU_FORGE_PROFILING
+
+/// Number of calls and accumulated wall time of a profiled function.
+struct FmuProfileCounter {
+    std::uint64_t calls = 0;
+    std::chrono::steady_clock::duration time = std::chrono::steady_clock::duration::zero();
+};
+
+/// Add a call, and the wall time spent in the enclosing scope, to a profile counter.
+class FmuProfileScope {
+  public:
+    explicit FmuProfileScope(FmuProfileCounter& counter)
+        : m_counter(counter), m_start(std::chrono::steady_clock::now()) {}
+
+    ~FmuProfileScope() {
+        ++m_counter.calls;
+        m_counter.time += std::chrono::steady_clock::now() - m_start;
+    }
+
+  private:
+    FmuProfileCounter& m_counter;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+/// Register a profiled function and return its id (shared by all the instances of the FMU).
+size_t FmuProfileRegister(const char* name);
+
+/// Return the name of a profiled function.
+std::string FmuProfileName(size_t id);
+
+/// Profile the enclosing scope under the given name; 'fmu' is the FmuComponentBase instance.
+    #define FMU_PROFILE_SCOPE(fmu, name)                                                     \
+        static const size_t fmu_profile_id = fmu_forge::fmi3::FmuProfileRegister(name);     \
+        fmu_forge::fmi3::FmuProfileScope fmu_profile_scope((fmu)->getProfileCounter(fmu_profile_id))
+
+#else
+
+    #define FMU_PROFILE_SCOPE(fmu, name)
+
+#endif
+
+/// Profile the enclosing FMI function, called on the given instance (no-op unless FMU_FORGE_PROFILING is defined).
+#define FMU_PROFILE_FUNCTION(instance) \
+    FMU_PROFILE_SCOPE(reinterpret_cast<fmu_forge::fmi3::FmuComponentBase*>(instance), __func__)
+
+#ifndef FMU_FORGE_REALTIME_BUDGET
+    /// Default budget [s] of each DoStep, for FMUs built with FMU_FORGE_REALTIME.
+    #define FMU_FORGE_REALTIME_BUDGET 1e-3
+#endif
+
+/// Statistics of the DoStep latencies of an FMU in real-time mode (see FmuComponentBase::EnableRealTimeMode).
+/// Bin 0 counts the steps shorter than 1 us, bin k the steps in [2^(k-1), 2^k) us; the last bin also counts all the
+/// longer steps.
+struct FmuStepLatencyHistogram {
+    static const size_t num_bins = 32;
+
+    std::array<fmi3UInt64, num_bins> bins = {};
+    fmi3UInt64 steps = 0;
+    fmi3UInt64 deadline_misses = 0;  ///< steps longer than the budget
+    fmi3Float64 last_latency = 0;    ///< [s]
+    fmi3Float64 max_latency = 0;     ///< [s]
+
+    void Add(fmi3Float64 latency, fmi3Float64 budget) {
+        auto us = static_cast<std::uint64_t>(latency * 1e6);
+        size_t bin = 0;
+        while (us && bin < num_bins - 1) {
+            us >>= 1;
+            ++bin;
+        }
+        ++bins[bin];
+        ++steps;
+        if (latency > budget)
+            ++deadline_misses;
+        last_latency = latency;
+        max_latency = std::max(max_latency, latency);
+    }
+
+    void Clear() { *this = FmuStepLatencyHistogram(); }
+};
+
 bool is_pointer_variant(const FmuVariableBindType& myVariant);
 
+/// FMI type of a numeric or boolean value of type T (Type::Unknown for all other types).
+template <class T>
+struct FmuTypeOf {
+    static constexpr FmuVariable::Type value = FmuVariable::Type::Unknown;
+};
+template <>
+struct FmuTypeOf<fmi3Float32> {
+    static constexpr FmuVariable::Type value = FmuVariable::Type::Float32;
+};
+template <>
+struct FmuTypeOf<fmi3Float64> {
+    static constexpr FmuVariable::Type value = FmuVariable::Type::Float64;
+};
+template <>
+struct FmuTypeOf<fmi3Int8> {
+    static constexpr FmuVariable::Type value = FmuVariable::Type::Int8;
+};
+template <>
+struct FmuTypeOf<fmi3UInt8> {
+    static constexpr FmuVariable::Type value = FmuVariable::Type::UInt8;
+};
+template <>
+struct FmuTypeOf<fmi3Int16> {
+    static constexpr FmuVariable::Type value = FmuVariable::Type::Int16;
+};
+template <>
+struct FmuTypeOf<fmi3UInt16> {
+    static constexpr FmuVariable::Type value = FmuVariable::Type::UInt16;
+};
+template <>
+struct FmuTypeOf<fmi3Int32> {
+    static constexpr FmuVariable::Type value = FmuVariable::Type::Int32;
+};
+template <>
+struct FmuTypeOf<fmi3UInt32> {
+    static constexpr FmuVariable::Type value = FmuVariable::Type::UInt32;
+};
+template <>
+struct FmuTypeOf<fmi3Int64> {
+    static constexpr FmuVariable::Type value = FmuVariable::Type::Int64;
+};
+template <>
+struct FmuTypeOf<fmi3UInt64> {
+    static constexpr FmuVariable::Type value = FmuVariable::Type::UInt64;
+};
+template <>
+struct FmuTypeOf<fmi3Boolean> {
+    static constexpr FmuVariable::Type value = FmuVariable::Type::Boolean;
+};
+
+/// Visitor writing values into the binding of a variable of type T (see FmuVariableExport::SetValue).
+/// Bound types match the FMI type exactly, thus contiguous bindings are filled through memcpy.
+template <class T>
+struct FmuBindingWriter {
+    const T* values;
+    size_t nValues;
+
+    void operator()(T* ptr) const {
+        if (nValues > 0)
+            std::memcpy(ptr, values, nValues * sizeof(T));
+    }
+
+    void operator()(const FmuSpan<T>& span) const {
+        if (nValues > span.size)
+            throw std::runtime_error("SetValue: the number of values exceeds the size of the bound buffer.");
+        if (nValues > 0)
+            std::memcpy(span.data, values, nValues * sizeof(T));
+    }
+
+    /// The vector is resized to the number of values (e.g. dimensions depending on a structural parameter).
+    void operator()(std::vector<T>* vec) const {
+        vec->resize(nValues);
+        if (nValues > 0)
+            std::memcpy(vec->data(), values, nValues * sizeof(T));
+    }
+
+    // TODO: consider multi-dimensional variables
+    void operator()(const FunGetSet<T>& fun) const { fun.second(*values); }
+
+    void operator()(const FunGetSetArray<T>& fun) const { fun.second(values, nValues); }
+
+    template <class U>
+    void operator()(const U&) const {
+        throw std::runtime_error("SetValue: the variable is not bound to values of the requested type.");
+    }
+};
+
+/// Visitor reading values from the binding of a variable of type T (see FmuVariableExport::GetValue).
+/// Bound types match the FMI type exactly, thus contiguous bindings are read through memcpy.
+template <class T>
+struct FmuBindingReader {
+    T* values;
+    size_t nValues;
+
+    void operator()(T* ptr) const {
+        if (nValues > 0)
+            std::memcpy(values, ptr, nValues * sizeof(T));
+    }
+
+    void operator()(const FmuSpan<T>& span) const {
+        if (nValues > span.size)
+            throw std::runtime_error("GetValue: the number of values exceeds the size of the bound buffer.");
+        if (nValues > 0)
+            std::memcpy(values, span.data, nValues * sizeof(T));
+    }
+
+    void operator()(std::vector<T>* vec) const {
+        if (nValues > vec->size())
+            throw std::runtime_error("GetValue: the number of values exceeds the size of the bound vector.");
+        if (nValues > 0)
+            std::memcpy(values, vec->data(), nValues * sizeof(T));
+    }
+
+    // TODO: consider multi-dimensional variables
+    void operator()(const FunGetSet<T>& fun) const { *values = fun.first(); }
+
+    void operator()(const FunGetSetArray<T>& fun) const { fun.first(values, nValues); }
+
+    template <class U>
+    void operator()(const U&) const {
+        throw std::runtime_error("GetValue: the variable is not bound to values of the requested type.");
+    }
+};
+
+/// Visitor returning the address of the memory bound to a variable of type T, if stable and large enough to hold
+/// 'size' values (0: unknown size), or nullptr for all other bindings.
+template <class T>
+struct FmuBindingAddress {
+    size_t size;
+
+    void* operator()(T* ptr) const { return ptr; }
+
+    void* operator()(const FmuSpan<T>& span) const { return size > 0 && size <= span.size ? span.data : nullptr; }
+
+    template <class U>
+    void* operator()(const U&) const {
+        return nullptr;
+    }
+};
+
 // =============================================================================
 
 /// Implementation of an FMU variable for export (generation of model description XML).
@@ -105,31 +342,22 @@ class FmuVariableExport : public FmuVariable {
     template <typename fmi3VarType,
               typename = typename std::enable_if<!std::is_same<fmi3VarType, fmi3String>::value>::type>
     void SetValue(const fmi3VarType* values, size_t nValues) const {
-        if (is_pointer_variant(m_varbind)) {
-            assert((nValues == 0 || (IsScalar() && nValues == 1) || m_dimensions.size() > 0) &&
-                   ("Requested to get the value of " + std::to_string(nValues) +
-                    " coefficients for variable with valueReference: " + std::to_string(m_valueReference) +
-                    " but it seems that it is a scalar.")
-                       .c_str());
-
-            fmi3VarType* varptr_this = varns::get<fmi3VarType*>(m_varbind);
-
-            // try to fetch the dimension of the variable
-            if (nValues == 0) {
-                bool success = GetSize(nValues);
-                if (!success)
-                    throw std::runtime_error(
-                        "SetValue has been called with 'nValues==0', but the variable dimensions are given by other "
-                        "variables and cannot be determined automatically.");
-            }
-
-            for (size_t size = 0; size < nValues; size++) {
-                varptr_this[size] = values[size];
-            }
-        } else {
-            // TODO: consider multi-dimensional variables
-            varns::get<FunGetSet<fmi3VarType>>(m_varbind).second(*values);
+        assert((nValues == 0 || (IsScalar() && nValues == 1) || m_dimensions.size() > 0) &&
+               ("Requested to get the value of " + std::to_string(nValues) +
+                " coefficients for variable with valueReference: " + std::to_string(m_valueReference) +
+                " but it seems that it is a scalar.")
+                   .c_str());
+
+        // try to fetch the dimension of the variable
+        if (nValues == 0) {
+            bool success = GetSize(nValues);
+            if (!success)
+                throw std::runtime_error(
+                    "SetValue has been called with 'nValues==0', but the variable dimensions are given by other "
+                    "variables and cannot be determined automatically.");
         }
+
+        varns::visit(FmuBindingWriter<fmi3VarType>{values, nValues}, m_varbind);
     }
 
     /// Set the value of this FMU variable of type fmi3String.
@@ -146,32 +374,23 @@ class FmuVariableExport : public FmuVariable {
     template <typename fmi3VarType,
               typename = typename std::enable_if<!std::is_same<fmi3VarType, fmi3String>::value>::type>
     void GetValue(fmi3VarType* varptr_ext, size_t nValues) const {
-        if (is_pointer_variant(m_varbind)) {
-            assert(((IsScalar() && nValues == 1) || m_dimensions.size() > 0) &&
-                   ("Requested to get the value of " + std::to_string(nValues) +
-                    " coefficients for variable with valueReference: " + std::to_string(m_valueReference) +
-                    " but it seems that it is a scalar.")
-                       .c_str());
-
-            fmi3VarType* varptr_this = varns::get<fmi3VarType*>(m_varbind);
-
-            // try to fetch the dimension of the variable
-            if (nValues == 0) {
-                bool success = GetSize(nValues);
-                if (!success)
-                    throw std::runtime_error(
-                        "GetValue has been called with 'nValues==0', but the variable dimensions are given by other "
-                        "variables and cannot be determined automatically.");
-            }
-
-            // copy the values from the binded variable to the external variable provided by the user
-            for (size_t size = 0; size < nValues; size++) {
-                varptr_ext[size] = varptr_this[size];
-            }
-        } else {
-            // TODO: consider multi-dimensional variables
-            *varptr_ext = varns::get<FunGetSet<fmi3VarType>>(m_varbind).first();
+        assert(((IsScalar() && nValues == 1) || m_dimensions.size() > 0) &&
+               ("Requested to get the value of " + std::to_string(nValues) +
+                " coefficients for variable with valueReference: " + std::to_string(m_valueReference) +
+                " but it seems that it is a scalar.")
+                   .c_str());
+
+        // try to fetch the dimension of the variable
+        if (nValues == 0) {
+            bool success = GetSize(nValues);
+            if (!success)
+                throw std::runtime_error(
+                    "GetValue has been called with 'nValues==0', but the variable dimensions are given by other "
+                    "variables and cannot be determined automatically.");
         }
+
+        // copy the values from the bound variable to the external variable provided by the user
+        varns::visit(FmuBindingReader<fmi3VarType>{varptr_ext, nValues}, m_varbind);
     }
 
     /// Get the *location* of the fmi3String variable.
@@ -182,6 +401,7 @@ class FmuVariableExport : public FmuVariable {
 
     /// Get the *location* and *size* of the fmi3Binary variable.
     /// WARNING: fmi3Binary content is NOT copied. Only the pointer to the fmi3Binary is returned.
+    /// For variables bound to FmuBinaryBuffer, the 'data' and 'size' members are returned as they are.
     /// 'varptr_ext' and 'valueSize_ptr' are expected to point to two pre-allocated spaces of size equal to the number
     /// of Dimensions of the FMU variable (or 1 if scalar) and not to the size of the variable itself. FMU developers
     /// using non-standard FMI variable types should re-implement this method.
@@ -200,6 +420,8 @@ class FmuVariableExport : public FmuVariable {
 
     VarbindType m_varbind;  ///< value of this variable
 
+    mutable std::string m_getterString;  ///< last value returned by a string getter (kept alive for the importer)
+
     /// Convert the start value to a string.
     /// In case of arrays it concatenates the values with space delimitations.
     /// However, in the case of Binary or String data (that basically are arrays of arrays of chars|bytes),
@@ -207,6 +429,9 @@ class FmuVariableExport : public FmuVariable {
     /// elements contained in the array should be picked.
     std::string GetStartValAsString(size_t size_id = 0) const;
 
+    /// Append the start value, as returned by GetStartValAsString, to the given string.
+    void AppendStartValAsString(std::string& out, size_t size_id = 0) const;
+
     friend class FmuComponentBase;
 };
 
@@ -216,7 +441,7 @@ class FmuVariableExport : public FmuVariable {
 template <typename T>
 void variant_to_string(const T* varb, size_t size, std::stringstream& ss) {
     for (size_t s = 0; s < size; ++s) {
-        ss << *varb;
+        ss << varb[s];
         if (s + 1 < size)
             ss << " ";
     }
@@ -228,14 +453,83 @@ void variant_to_string(const FunGetSet<T> varb, size_t size, std::stringstream&
     ss << varb.first();
 }
 
+/// Returns a string representation of the variable value (contiguous buffer case).
+template <typename T>
+void variant_to_string(const FmuSpan<T>& varb, size_t size, std::stringstream& ss) {
+    variant_to_string(static_cast<const T*>(varb.data), std::min(size, varb.size), ss);
+}
+
+/// Returns a string representation of the variable value (std::vector pointer case).
+template <typename T>
+void variant_to_string(const std::vector<T>* varb, size_t size, std::stringstream& ss) {
+    variant_to_string(varb->data(), std::min(size, varb->size()), ss);
+}
+
+/// Returns a string representation of the variable value (bulk getter|setter case).
+template <typename T>
+void variant_to_string(const FunGetSetArray<T> varb, size_t size, std::stringstream& ss) {
+    std::unique_ptr<T[]> values(new T[size]);
+    varb.first(values.get(), size);
+    variant_to_string(static_cast<const T*>(values.get()), size, ss);
+}
+
 /// Returns a string representation of the variable type (std::string pointer case).
 void variant_to_string(const std::string* varb, size_t id, std::stringstream& ss);
 void variant_to_string(const std::vector<fmi3Byte>* varb, size_t id, std::stringstream& ss);
+void variant_to_string(const FmuBinaryBuffer* varb, size_t id, std::stringstream& ss);
 
 void variant_to_string(const FunGetSet<std::string> varb, size_t size, std::stringstream& ss);
 
 // =============================================================================
 
+/// Single-producer single-consumer ring buffer delivering log messages to the logger callback on a worker thread.
+/// The producer (the thread calling the FMU functions) never blocks and, once the slots have grown to the typical
+/// message length, does not allocate. Messages pushed while the buffer is full are dropped and counted; the count
+/// is reported through the logger as soon as the worker catches up.
+class FmuAsyncLogSink {
+  public:
+    FmuAsyncLogSink(fmi3LogMessageCallback logMessage,
+                    fmi3InstanceEnvironment instanceEnvironment,
+                    const std::vector<std::string>& categories,
+                    size_t capacity);
+
+    /// Deliver all the pending messages and stop the worker thread.
+    ~FmuAsyncLogSink();
+
+    FmuAsyncLogSink(const FmuAsyncLogSink&) = delete;
+    FmuAsyncLogSink& operator=(const FmuAsyncLogSink&) = delete;
+
+    /// Queue a message of the given category (index in the list of categories).
+    /// Return false if the buffer is full and the message has been dropped.
+    bool Push(const std::string& msg, fmi3Status status, int category);
+
+    /// Return the number of messages dropped so far.
+    size_t GetNumDropped() const { return m_dropped_total.load(std::memory_order_relaxed); }
+
+  private:
+    struct Slot {
+        fmi3Status status;
+        int category;
+        std::string msg;
+    };
+
+    void run();
+
+    fmi3LogMessageCallback m_logMessage;
+    fmi3InstanceEnvironment m_instanceEnvironment;
+    const std::vector<std::string>& m_categories;
+
+    std::vector<Slot> m_slots;
+    std::atomic<size_t> m_head;           ///< next slot to be written (producer)
+    std::atomic<size_t> m_tail;           ///< next slot to be read (consumer)
+    std::atomic<size_t> m_dropped;        ///< messages dropped and not yet reported
+    std::atomic<size_t> m_dropped_total;  ///< messages dropped since creation
+    std::atomic<bool> m_stop;
+    std::thread m_worker;
+};
+
+// =============================================================================
+
 /// Base class for an FMU component (used for export).
 /// (1) This class provides support for:
 /// - defining FMU variables (cauality, variability, start value, etc)
@@ -261,6 +555,14 @@ class FmuComponentBase {
     /// Enable/disable the logging for a specific log category.
     virtual void SetDebugLogging(std::string cat, bool val);
 
+    /// Deliver log messages to the logger callback from a worker thread, through a ring buffer of the given capacity.
+    /// The logger callback provided by the importer must tolerate being called from a thread other than the one
+    /// calling the FMU functions. Messages are dropped (and counted) if the buffer is full.
+    void EnableAsyncLogging(size_t capacity = 1024);
+
+    /// Deliver the pending messages and go back to calling the logger callback synchronously.
+    void DisableAsyncLogging() { m_asyncLogSink.reset(); }
+
     /// Create the modelDescription.xml file in the given location \a path.
     void ExportModelDescription(std::string path);
 
@@ -268,27 +570,32 @@ class FmuComponentBase {
 
     template <class T>
     fmi3Status fmi3GetVariable(const fmi3ValueReference vrs[], size_t nvr, T values[], size_t nValues) {
-        //// when multiple variables are requested it might be better to iterate through scalarVariables just once
-        //// and check if they match any of the nvr requested variables
-        size_t values_idx = 0;
-        for (size_t s = 0; s < nvr; ++s) {
-            auto it = this->findByValref(vrs[s]);
+        try {
+            if (!m_staticBindings.empty() && getStaticVariables(vrs, nvr, values, nValues))
+                return fmi3Status::fmi3OK;
 
-            if (it == this->m_variables.end()) {
-                // requested a variable that does not exist
-                auto msg =
-                    "fmi3GetVariable: variable with value reference " + std::to_string(vrs[s]) + " does NOT exist.\n";
-                sendToLog(msg, fmi3Status::fmi3Error, "logStatusError");
+            FmuVariableAccessPlan* plan = getAccessPlan(vrs, nvr, typeid(T), "fmi3GetVariable");
+            if (!plan)
                 return fmi3Status::fmi3Error;
-            } else {
-                size_t var_size = GetVariableSize(*it);
-                it->GetValue(&values[values_idx], var_size);
+            resolveAccessPlan(*plan, static_cast<const T*>(values));
+
+            size_t values_idx = 0;
+            for (size_t s = 0; s < nvr; ++s) {
+                size_t var_size = plan->dynamic_sizes ? GetVariableSize(*plan->variables[s]) : plan->sizes[s];
+                if (plan->data[s]) {
+                    std::memcpy(&values[values_idx], plan->data[s], var_size * sizeof(T));
+                } else {
+                    plan->variables[s]->GetValue(&values[values_idx], var_size);
+                }
                 values_idx += var_size;
             }
-        }
 
-        fmi3Status status = (values_idx == nValues) ? fmi3Status::fmi3OK : fmi3Status::fmi3Error;
-        return status;
+            fmi3Status status = (values_idx == nValues) ? fmi3Status::fmi3OK : fmi3Status::fmi3Error;
+            return status;
+        } catch (std::exception& e) {
+            sendToLog(std::string("fmi3GetVariable: ") + e.what() + "\n", fmi3Status::fmi3Error, "logStatusError");
+            return fmi3Status::fmi3Error;
+        }
     }
 
     fmi3Status fmi3GetVariable(const fmi3ValueReference vrs[],
@@ -296,56 +603,58 @@ class FmuComponentBase {
                                size_t valueSizes[],
                                fmi3Binary values[],
                                size_t nValues) {
-        //// when multiple variables are requested it might be better to iterate through scalarVariables just once
-        //// and check if they match any of the nvr requested variables
-        size_t values_idx = 0;
-        for (size_t s = 0; s < nvr; ++s) {
-            auto it = this->findByValref(vrs[s]);
-
-            if (it == this->m_variables.end()) {
-                // requested a variable that does not exist
-                auto msg =
-                    "fmi3GetVariable: variable with value reference " + std::to_string(vrs[s]) + " does NOT exist.\n";
-                sendToLog(msg, fmi3Status::fmi3Error, "logStatusError");
+        try {
+            FmuVariableAccessPlan* plan = getAccessPlan(vrs, nvr, typeid(fmi3Binary), "fmi3GetVariable");
+            if (!plan)
                 return fmi3Status::fmi3Error;
-            } else {
-                size_t var_size = GetVariableSize(*it);
-                it->GetValue(&values[values_idx], var_size, &valueSizes[values_idx]);
+
+            size_t values_idx = 0;
+            for (size_t s = 0; s < nvr; ++s) {
+                size_t var_size = plan->dynamic_sizes ? GetVariableSize(*plan->variables[s]) : plan->sizes[s];
+                plan->variables[s]->GetValue(&values[values_idx], var_size, &valueSizes[values_idx]);
                 values_idx += var_size;
             }
-        }
 
-        fmi3Status status = (values_idx == nValues) ? fmi3Status::fmi3OK : fmi3Status::fmi3Error;
-        return status;
+            fmi3Status status = (values_idx == nValues) ? fmi3Status::fmi3OK : fmi3Status::fmi3Error;
+            return status;
+        } catch (std::exception& e) {
+            sendToLog(std::string("fmi3GetVariable: ") + e.what() + "\n", fmi3Status::fmi3Error, "logStatusError");
+            return fmi3Status::fmi3Error;
+        }
     }
 
     template <class T>
     fmi3Status fmi3SetVariable(const fmi3ValueReference vrs[], size_t nvr, const T values[], size_t nValues) {
-        size_t values_idx = 0;
-        for (size_t s = 0; s < nvr; ++s) {
-            std::set<FmuVariableExport>::iterator it = this->findByValref(vrs[s]);
+        try {
+            if (!m_staticBindings.empty() && setStaticVariables(vrs, nvr, values, nValues))
+                return fmi3Status::fmi3OK;
 
-            if (it == this->m_variables.end()) {
-                // requested a variable that does not exist
-                auto msg =
-                    "fmi3SetVariable: variable with value reference " + std::to_string(vrs[s]) + " does NOT exist.\n";
-                sendToLog(msg, fmi3Status::fmi3Error, "logStatusError");
-                return fmi3Status::fmi3Error;
-            } else if (!it->IsSetAllowed(this->m_fmuMachineState)) {
-                // requested variable cannot be set in the current FMU state
-                auto msg = "fmi3SetVariable: variable with value reference " + std::to_string(vrs[s]) +
-                           " NOT ALLOWED to be set in current state.\n";
-                sendToLog(msg, fmi3Status::fmi3Error, "logStatusError");
+            FmuVariableAccessPlan* plan = getAccessPlan(vrs, nvr, typeid(T), "fmi3SetVariable");
+            if (!plan || !checkAccessPlanSetAllowed(*plan))
                 return fmi3Status::fmi3Error;
-            } else {
-                size_t var_size = GetVariableSize(*it);
-                it->SetValue(&values[values_idx], var_size);
+            resolveAccessPlan(*plan, values);
+
+            size_t values_idx = 0;
+            for (size_t s = 0; s < nvr; ++s) {
+                size_t var_size = plan->dynamic_sizes ? GetVariableSize(*plan->variables[s]) : plan->sizes[s];
+                if (plan->data[s]) {
+                    std::memcpy(plan->data[s], &values[values_idx], var_size * sizeof(T));
+                } else {
+                    plan->variables[s]->SetValue(&values[values_idx], var_size);
+                }
                 values_idx += var_size;
             }
-        }
 
-        fmi3Status status = (values_idx == nValues) ? fmi3Status::fmi3OK : fmi3Status::fmi3Error;
-        return status;
+            if (plan->structural)
+                InvalidateVariableSizes();
+            markModified(*plan);
+
+            fmi3Status status = (values_idx == nValues) ? fmi3Status::fmi3OK : fmi3Status::fmi3Error;
+            return status;
+        } catch (std::exception& e) {
+            sendToLog(std::string("fmi3SetVariable: ") + e.what() + "\n", fmi3Status::fmi3Error, "logStatusError");
+            return fmi3Status::fmi3Error;
+        }
     }
 
     fmi3Status fmi3SetVariable(const fmi3ValueReference vrs[],
@@ -353,33 +662,37 @@ class FmuComponentBase {
                                const size_t valueSizes[],
                                const fmi3Binary values[],
                                size_t nValues) {
-        size_t values_idx = 0;
-        for (size_t s = 0; s < nvr; ++s) {
-            std::set<FmuVariableExport>::iterator it = this->findByValref(vrs[s]);
-
-            if (it == this->m_variables.end()) {
-                // requested a variable that does not exist
-                auto msg =
-                    "fmi3SetVariable: variable with value reference " + std::to_string(vrs[s]) + " does NOT exist.\n";
-                sendToLog(msg, fmi3Status::fmi3Error, "logStatusError");
-                return fmi3Status::fmi3Error;
-            } else if (!it->IsSetAllowed(this->m_fmuMachineState)) {
-                // requested variable cannot be set in the current FMU state
-                auto msg = "fmi3SetVariable: variable with value reference " + std::to_string(vrs[s]) +
-                           " NOT ALLOWED to be set in current state.\n";
-                sendToLog(msg, fmi3Status::fmi3Error, "logStatusError");
+        try {
+            FmuVariableAccessPlan* plan = getAccessPlan(vrs, nvr, typeid(fmi3Binary), "fmi3SetVariable");
+            if (!plan || !checkAccessPlanSetAllowed(*plan))
                 return fmi3Status::fmi3Error;
-            } else {
-                size_t var_size = GetVariableSize(*it);
-                it->SetValue(&values[values_idx], var_size, &valueSizes[values_idx]);
+
+            size_t values_idx = 0;
+            for (size_t s = 0; s < nvr; ++s) {
+                size_t var_size = plan->dynamic_sizes ? GetVariableSize(*plan->variables[s]) : plan->sizes[s];
+                plan->variables[s]->SetValue(&values[values_idx], var_size, &valueSizes[values_idx]);
+                trackBinaryReference(*plan->variables[s]);
                 values_idx += var_size;
             }
-        }
 
-        fmi3Status status = (values_idx == nValues) ? fmi3Status::fmi3OK : fmi3Status::fmi3Error;
-        return status;
+            if (plan->structural)
+                InvalidateVariableSizes();
+            markModified(*plan);
+
+            fmi3Status status = (values_idx == nValues) ? fmi3Status::fmi3OK : fmi3Status::fmi3Error;
+            return status;
+        } catch (std::exception& e) {
+            sendToLog(std::string("fmi3SetVariable: ") + e.what() + "\n", fmi3Status::fmi3Error, "logStatusError");
+            return fmi3Status::fmi3Error;
+        }
     }
 
+    /// Return the number of fmi3Get|fmi3Set calls that reused a cached access plan.
+    size_t GetAccessPlanHits() const { return m_accessPlanHits; }
+
+    /// Return the number of fmi3Get|fmi3Set calls that required the creation of a new access plan.
+    size_t GetAccessPlanMisses() const { return m_accessPlanMisses; }
+
     /// Adds a scalar variable to the list of variables of the FMU.
     /// The start value is automatically grabbed from the variable itself.
     const FmuVariableExport& AddFmuVariable(
@@ -410,10 +723,16 @@ class FmuComponentBase {
 
     /// Declare a state derivative variables, specifying the corresponding state and dependencies on other variables.
     /// Calls to this function must be made *after* all FMU variables were defined.
+    /// The continuous states are ordered as declared; unless getContinuousStatesIMPL, setContinuousStatesIMPL and
+    /// getDerivativesIMPL are overridden, their values are exchanged directly with the state and derivative variables
+    /// (a single copy if the states, and the derivatives, are bound to contiguous memory).
     void DeclareStateDerivative(const std::string& derivative_name,
                                 const std::string& state_name,
                                 const std::vector<std::string>& dependency_names);
 
+    /// Set the nominal value of a continuous state (1 by default), applied to all of its values.
+    void SetStateNominal(const std::string& state_name, fmi3Float64 nominal);
+
     /// Declare variable dependencies.
     /// Calls to this function must be made *after* all FMU variables were defined.
     void DeclareVariableDependencies(const std::string& variable_name,
@@ -423,11 +742,123 @@ class FmuComponentBase {
 
     /// Add a function to be executed before doStep (co-simulation FMU) or before getDerivatives (model exchange FMU).
     /// Such functions can be used to implement FMU-specific pre-processing of input variables.
-    void AddPreStepFunction(std::function<void(void)> function) { m_preStepCallbacks.push_back(function); }
+    /// The function is executed unconditionally; see AddPreStepStage for a function that is skipped if unneeded.
+    void AddPreStepFunction(std::function<void(void)> function) { addStepStage(m_preStepStages, function); }
 
     /// Add a function to be executed after doStep (co-simulation FMU) or after getDerivatives (model exchange FMU).
     /// Such functions can be used to implement FMU-specific post-processing to prepare output variables.
-    void AddPostStepFunction(std::function<void(void)> function) { m_postStepCallbacks.push_back(function); }
+    /// The function is executed unconditionally; see AddPostStepStage for a function that is skipped if unneeded.
+    void AddPostStepFunction(std::function<void(void)> function) { addStepStage(m_postStepStages, function); }
+
+    /// Add a stage to the pre-step pipeline, writing the 'outputs' variables from the 'inputs' variables.
+    /// The inputs of the stage also include the dependencies declared for its outputs (DeclareVariableDependencies).
+    /// Stages are executed in dependency order (a stage reading the outputs of another one runs after it) and are
+    /// skipped if none of their inputs changed since their last execution; stages without inputs are never skipped.
+    void AddPreStepStage(std::function<void(void)> function,
+                         const std::vector<std::string>& outputs,
+                         const std::vector<std::string>& inputs = {}) {
+        addStepStage(m_preStepStages, function, outputs, inputs);
+    }
+
+    /// Add a stage to the post-step pipeline, writing the 'outputs' variables from the 'inputs' variables.
+    /// The inputs of the stage also include the dependencies declared for its outputs (DeclareVariableDependencies).
+    /// Stages are executed in dependency order (a stage reading the outputs of another one runs after it) and are
+    /// skipped if none of their inputs changed since their last execution; stages without inputs are never skipped.
+    void AddPostStepStage(std::function<void(void)> function,
+                          const std::vector<std::string>& outputs,
+                          const std::vector<std::string>& inputs = {}) {
+        addStepStage(m_postStepStages, function, outputs, inputs);
+    }
+
+    /// Return the number of stage executions skipped because their inputs did not change.
+    size_t GetNumSkippedStepStages() const { return m_stepStagesSkipped; }
+
+    /// Add a model partition, executed at each activation of a periodic input clock (ScheduledExecution interface).
+    /// A Clock variable named 'clock_name', with constant interval 'interval' [s], is added to the model description
+    /// and the importer activates the partition through fmi3ActivateModelPartition, which calls 'function' with the
+    /// activation time. Partitions bound to different clocks can be activated concurrently, from different threads:
+    /// data shared among partitions must be protected (e.g. through LockPreemption/UnlockPreemption).
+    /// Return the value reference of the clock.
+    fmi3ValueReference AddModelPartition(const std::string& clock_name,
+                                         fmi3Float64 interval,
+                                         std::function<fmi3Status(fmi3Float64)> function,
+                                         const std::string& description = "");
+
+    /// Return the number of model partitions.
+    size_t GetNumModelPartitions() const { return m_modelPartitions.size(); }
+
+    /// Prevent the importer from preempting the current model partition (e.g. while accessing shared data).
+    /// No effect if the FMU is not instantiated as ScheduledExecution.
+    void LockPreemption() const {
+        if (m_lockPreemption)
+            m_lockPreemption();
+    }
+
+    /// Allow again the preemption of the current model partition.
+    void UnlockPreemption() const {
+        if (m_unlockPreemption)
+            m_unlockPreemption();
+    }
+
+    /// Return true if the variable has been set (through fmi3Set or MarkVariableModified) since the last step.
+    /// Flags are cleared after each doStep (co-simulation FMU) or completed integrator step (model exchange FMU).
+    bool IsVariableModified(fmi3ValueReference vr) const { return vr < m_modified.size() && m_modified[vr]; }
+
+    /// Flag a variable as modified since the last step; to be called by the model when it changes a variable itself.
+    void MarkVariableModified(fmi3ValueReference vr) {
+        if (vr >= m_modified.size())
+            m_modified.resize(m_valrefIndex.size() > vr ? m_valrefIndex.size() : vr + 1, 0);
+        m_modified[vr] = 1;
+        ++m_valuesEpoch;
+    }
+
+    /// Build a getter for an output whose value is expensive to compute: 'compute' is evaluated only when the variable
+    /// is requested through fmi3Get, and the value is memoized until the next step or change of the variables.
+    /// The returned getter|setter pair is meant to be bound through AddFmuVariable (the setter does nothing).
+    template <typename T>
+    FunGetSet<T> MakeLazyGetter(std::function<T(void)> compute) {
+        struct Memo {
+            size_t epoch = 0;
+            bool valid = false;
+            T value;
+        };
+        auto memo = std::make_shared<Memo>();
+        return FunGetSet<T>(
+            [this, memo, compute]() -> T {
+                if (!memo->valid || memo->epoch != m_valuesEpoch) {
+                    memo->value = compute();
+                    memo->epoch = m_valuesEpoch;
+                    memo->valid = true;
+                }
+                return memo->value;
+            },
+            [](T) {});
+    }
+
+    /// Build a bulk getter for an array output whose values are expensive to compute (see MakeLazyGetter).
+    template <typename T>
+    FunGetSetArray<T> MakeLazyArrayGetter(std::function<void(T*, size_t)> compute) {
+        struct Memo {
+            size_t epoch = 0;
+            bool valid = false;
+            size_t size = 0;
+            std::unique_ptr<T[]> values;
+        };
+        auto memo = std::make_shared<Memo>();
+        return FunGetSetArray<T>(
+            [this, memo, compute](T* values, size_t size) {
+                if (!memo->valid || memo->epoch != m_valuesEpoch || memo->size != size) {
+                    if (memo->size != size)
+                        memo->values.reset(new T[size]);
+                    memo->size = size;
+                    compute(memo->values.get(), size);
+                    memo->epoch = m_valuesEpoch;
+                    memo->valid = true;
+                }
+                std::copy(memo->values.get(), memo->values.get() + size, values);
+            },
+            [](const T*, size_t) {});
+    }
 
   protected:
     // This section declares the virtual methods that a concrete FMU must implement.
@@ -437,6 +868,7 @@ class FmuComponentBase {
 
     virtual bool is_cosimulation_available() const = 0;
     virtual bool is_modelexchange_available() const = 0;
+    virtual bool is_scheduledexecution_available() const { return false; }
 
     virtual void preModelDescriptionExport() {}
     virtual void postModelDescriptionExport() {}
@@ -481,35 +913,100 @@ class FmuComponentBase {
 
     virtual fmi3Status setTimeIMPL(fmi3Float64 time) { return fmi3Status::fmi3OK; }
 
+    /// Get the values of the continuous states; by default, they are read from the declared state variables.
     virtual fmi3Status getContinuousStatesIMPL(fmi3Float64 continuousStates[], size_t nContinuousStates) {
-        if (is_modelexchange_available())
-            throw std::runtime_error("An FMU for model exchange must implement getContinuousStatesIMPL");
-
-        return fmi3Status::fmi3OK;
+        return readContinuousStateLayout(false, continuousStates, nContinuousStates, "fmi3GetContinuousStates");
     }
 
+    /// Set the values of the continuous states; by default, they are written to the declared state variables.
     virtual fmi3Status setContinuousStatesIMPL(const fmi3Float64 continuousStates[], size_t nContinuousStates) {
-        if (is_modelexchange_available())
-            throw std::runtime_error("An FMU for model exchange must implement setContinuousStatesIMPL");
-
-        return fmi3Status::fmi3OK;
+        return writeContinuousStateLayout(continuousStates, nContinuousStates, "fmi3SetContinuousStates");
     }
 
+    /// Get the derivatives of the continuous states; by default, they are read from the declared derivative
+    /// variables, which are expected to be updated by the pre-step functions.
     virtual fmi3Status getDerivativesIMPL(fmi3Float64 derivatives[], size_t nContinuousStates) {
-        if (is_modelexchange_available())
-            throw std::runtime_error("An FMU for model exchange must implement getDerivativesIMPL");
-
-        return fmi3Status::fmi3OK;
+        return readContinuousStateLayout(true, derivatives, nContinuousStates, "fmi3GetContinuousStateDerivatives");
     }
 
     virtual fmi3Status enterInitializationModeIMPL() { return fmi3Status::fmi3OK; }
     virtual fmi3Status exitInitializationModeIMPL() { return fmi3Status::fmi3OK; }
 
+    /// Save any model-internal data that is not bound to an FMU variable but is part of the FMU state.
+    /// The buffer is reused across calls on the same FMU state, so that its capacity can be recycled.
+    virtual fmi3Status getFMUStateIMPL(std::vector<fmi3Byte>& /*internal_state*/) { return fmi3Status::fmi3OK; }
+
+    /// Restore the model-internal data saved by getFMUStateIMPL.
+    virtual fmi3Status setFMUStateIMPL(const std::vector<fmi3Byte>& /*internal_state*/) { return fmi3Status::fmi3OK; }
+
+    /// Reset any model-internal data not covered by getFMUStateIMPL|setFMUStateIMPL (see Reset).
+    virtual fmi3Status resetIMPL() { return fmi3Status::fmi3OK; }
+
+    /// Compute the directional derivative 'sensitivity = J * seed', with J the Jacobian of the unknowns with respect
+    /// to the knowns. Arguments are already checked for consistency.
+    /// The default implementation uses finite differences (see computeDirectionalDerivativeFD) on the variables
+    /// already collected by GetDirectionalDerivative.
+    virtual fmi3Status getDirectionalDerivativeIMPL(const fmi3ValueReference /*unknowns*/[],
+                                                    size_t /*nUnknowns*/,
+                                                    const fmi3ValueReference /*knowns*/[],
+                                                    size_t /*nKnowns*/,
+                                                    const fmi3Float64 seed[],
+                                                    size_t nSeed,
+                                                    fmi3Float64 sensitivity[],
+                                                    size_t nSensitivity) {
+        return computeDirectionalDerivativeFD(m_derivativeUnknowns, m_derivativeKnowns, seed, nSeed, sensitivity,
+                                              nSensitivity);
+    }
+
+    /// Compute the adjoint derivative 'sensitivity = J^T * seed', with J the Jacobian of the unknowns with respect
+    /// to the knowns. Arguments are already checked for consistency.
+    /// The default implementation uses finite differences (see computeAdjointDerivativeFD) on the variables already
+    /// collected by GetAdjointDerivative.
+    virtual fmi3Status getAdjointDerivativeIMPL(const fmi3ValueReference /*unknowns*/[],
+                                                size_t /*nUnknowns*/,
+                                                const fmi3ValueReference /*knowns*/[],
+                                                size_t /*nKnowns*/,
+                                                const fmi3Float64 seed[],
+                                                size_t nSeed,
+                                                fmi3Float64 sensitivity[],
+                                                size_t nSensitivity) {
+        return computeAdjointDerivativeFD(m_derivativeUnknowns, m_derivativeKnowns, seed, nSeed, sensitivity,
+                                          nSensitivity);
+    }
+
+    /// Update the unknowns after the knowns have been perturbed by the finite differences approximation.
+    /// The default implementation executes the pre-step and post-step callbacks.
+    virtual fmi3Status evaluateUnknownsIMPL() {
+        executePreStepCallbacks();
+        executePostStepCallbacks();
+        return fmi3Status::fmi3OK;
+    }
+
   public:
-    void SetIntermediateUpdateCallback(fmi3IntermediateUpdateCallback intermediateUpdate) {
+    /// Set the callback used to notify intermediate updates from within doStepIMPL (see intermediateUpdate).
+    /// Early returns are only requested to the importer if allowed at instantiation.
+    void SetIntermediateUpdateCallback(fmi3IntermediateUpdateCallback intermediateUpdate,
+                                       bool earlyReturnAllowed = false) {
         m_intermediateUpdate = intermediateUpdate;
+        m_earlyReturnAllowed = earlyReturnAllowed;
+    }
+
+    void SetScheduledExecutionCallbacks(fmi3ClockUpdateCallback clockUpdate,
+                                        fmi3LockPreemptionCallback lockPreemption,
+                                        fmi3UnlockPreemptionCallback unlockPreemption) {
+        m_clockUpdate = clockUpdate;
+        m_lockPreemption = lockPreemption;
+        m_unlockPreemption = unlockPreemption;
     }
 
+    // Scheduled Execution: model partitions and clocks
+    fmi3Status ActivateModelPartition(fmi3ValueReference clockReference, fmi3Float64 activationTime);
+    fmi3Status GetClock(const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3Clock values[]);
+    fmi3Status GetIntervalDecimal(const fmi3ValueReference valueReferences[],
+                                  size_t nValueReferences,
+                                  fmi3Float64 intervals[],
+                                  fmi3IntervalQualifier qualifiers[]);
+
     fmi3Status EnterInitializationMode(fmi3Boolean toleranceDefined,
                                        fmi3Float64 tolerance,
                                        fmi3Float64 startTime,
@@ -518,6 +1015,11 @@ class FmuComponentBase {
 
     fmi3Status ExitInitializationMode();
 
+    /// Terminate the simulation.
+    /// If compiled with FMU_FORGE_PROFILING, the profile report is sent to the logger (category "logProfiling") and
+    /// appended to the file named by the FMU_FORGE_PROFILE_FILE environment variable, if set.
+    fmi3Status Terminate();
+
     // Common FMI function.
     // These functions are used to implement the actual common functions imposed by the FMI3 standard.
     // In turn, they call overrides of virtual methods provided by a concrete FMU.
@@ -547,10 +1049,93 @@ class FmuComponentBase {
     fmi3Status CompletedIntegratorStep(fmi3Boolean noSetFMUStatePriorToCurrentPoint,
                                        fmi3Boolean* enterEventMode,
                                        fmi3Boolean* terminateSimulation);
+    fmi3Status EnterContinuousTimeMode();
     fmi3Status SetTime(const fmi3Float64 time);
     fmi3Status GetContinuousStates(fmi3Float64 continuousStates[], size_t nContinuousStates);
     fmi3Status SetContinuousStates(const fmi3Float64 continuousStates[], size_t nContinuousStates);
     fmi3Status GetDerivatives(fmi3Float64 derivatives[], size_t nContinuousStates);
+    fmi3Status GetNominalsOfContinuousStates(fmi3Float64 nominals[], size_t nContinuousStates);
+    fmi3Status GetNumberOfContinuousStates(size_t* nContinuousStates);
+
+    // FMU state FMI functions.
+    // The FMU state includes the values of all the non-constant FMU variables (except for outputs and calculated
+    // parameters bound through getter|setter functions), the current time and the FMU machine state, plus any
+    // additional model-internal data provided by getFMUStateIMPL.
+
+    fmi3Status GetFMUState(fmi3FMUState* FMUState);
+    fmi3Status SetFMUState(fmi3FMUState FMUState);
+    fmi3Status FreeFMUState(fmi3FMUState* FMUState);
+
+    /// Take the snapshot restored by Reset (called once the FMU is instantiated).
+    /// The snapshot is taken independently of the support for getting and setting the FMU state.
+    void SaveResetState();
+
+    /// Bring the FMU back to the instantiated state, restoring the variable values and the model-internal data
+    /// (see getFMUStateIMPL) saved at instantiation, then calling resetIMPL.
+    fmi3Status Reset();
+    fmi3Status SerializedFMUStateSize(fmi3FMUState FMUState, size_t* size);
+    fmi3Status SerializeFMUState(fmi3FMUState FMUState, fmi3Byte serializedState[], size_t size);
+    fmi3Status DeserializeFMUState(const fmi3Byte serializedState[], size_t size, fmi3FMUState* FMUState);
+
+    // Partial derivatives FMI functions.
+    // These functions call getDirectionalDerivativeIMPL and getAdjointDerivativeIMPL that, unless overridden by a
+    // concrete FMU with analytic implementations, approximate the derivatives through finite differences.
+
+    fmi3Status GetDirectionalDerivative(const fmi3ValueReference unknowns[],
+                                        size_t nUnknowns,
+                                        const fmi3ValueReference knowns[],
+                                        size_t nKnowns,
+                                        const fmi3Float64 seed[],
+                                        size_t nSeed,
+                                        fmi3Float64 sensitivity[],
+                                        size_t nSensitivity);
+    fmi3Status GetAdjointDerivative(const fmi3ValueReference unknowns[],
+                                    size_t nUnknowns,
+                                    const fmi3ValueReference knowns[],
+                                    size_t nKnowns,
+                                    const fmi3Float64 seed[],
+                                    size_t nSeed,
+                                    fmi3Float64 sensitivity[],
+                                    size_t nSensitivity);
+
+    // Variable dependency FMI functions.
+    // Dependencies are those declared through DeclareStateDerivative and DeclareVariableDependencies, on whole
+    // variables (element index 0) and of kind fmi3Dependent. A variable without declared dependencies depends on all
+    // the knowns: both functions then return fmi3Error and the importer must assume a dense dependency.
+
+    fmi3Status GetNumberOfVariableDependencies(fmi3ValueReference valueReference, size_t* nDependencies);
+    fmi3Status GetVariableDependencies(fmi3ValueReference dependent,
+                                       size_t elementIndicesOfDependent[],
+                                       fmi3ValueReference independents[],
+                                       size_t elementIndicesOfIndependents[],
+                                       fmi3DependencyKind dependencyKinds[],
+                                       size_t nDependencies);
+
+#ifdef FMU_FORGE_PROFILING
+    /// Return the counter of a profiled function (see FMU_PROFILE_SCOPE).
+    FmuProfileCounter& getProfileCounter(size_t id) {
+        if (id >= m_profileCounters.size())
+            m_profileCounters.resize(id + 1);
+        return m_profileCounters[id];
+    }
+
+    /// Return a report of the number of calls and wall time of the FMI functions and of each step callback.
+    /// The report is also available through the "fmu_forge_profile" string output variable.
+    std::string GetProfileReport() const;
+
+    /// Reset all the profile counters.
+    void ResetProfile();
+#endif
+
+    /// Check if the FMU runs in real-time mode (see EnableRealTimeMode).
+    bool IsRealTimeMode() const { return m_realTime; }
+
+    /// Return the statistics of the DoStep latencies (real-time mode only).
+    /// The same statistics are available to the importer through the "fmu_forge_rt_*" output variables.
+    const FmuStepLatencyHistogram& GetStepLatencyHistogram() const { return m_stepLatency; }
+
+    /// Clear the statistics of the DoStep latencies.
+    void ResetStepLatencyHistogram() { m_stepLatency.Clear(); }
 
   protected:
     /// Add a declaration of a state derivative.
@@ -567,10 +1152,26 @@ class FmuComponentBase {
 
     void initializeType(FmuType fmuType);
 
+    /// Run the FMU in real-time mode, with the given budget [s] for each DoStep.
+    /// Once initialized (ExitInitializationMode), all the buffers used by fmi3Get|fmi3Set and DoStep are reserved,
+    /// so that these functions do not allocate, and exceptions thrown by DoStep are reported as fmi3Error.
+    /// The latency of DoStep is recorded in a histogram, together with the number of steps exceeding the budget; both
+    /// are exposed through the "fmu_forge_rt_*" variables, while "fmu_forge_rt_step_budget" updates the budget.
+    /// Exceptions to the guarantees: strings longer than the previous values, enabled log categories and errors.
+    /// Must be called in the constructor of the FMU; implied by FMU_FORGE_REALTIME (CMake option FMU_REALTIME).
+    void EnableRealTimeMode(fmi3Float64 step_budget);
+
     void addUnitDefinition(const UnitDefinition& unit_definition);
 
     void clearUnitDefinitions() { m_unitDefinitions.clear(); }
 
+    /// Enable the support for getting|setting and serializing the FMU state.
+    /// The corresponding capability flags are advertised in the model description.
+    void setFMUStateSupport(bool canGetAndSetFMUState, bool canSerializeFMUState) {
+        m_canGetAndSetFMUState = canGetAndSetFMUState;
+        m_canSerializeFMUState = canGetAndSetFMUState && canSerializeFMUState;
+    }
+
     bool IsInitialized() const {
         return m_fmuMachineState == FmuMachineState::eventMode ||
                m_fmuMachineState == FmuMachineState::continuousTimeMode ||
@@ -590,18 +1191,287 @@ class FmuComponentBase {
     /// - a msg_cat was enabled by `SetDebugLogging(msg_cat, true)`
     /// - the FMU was instantiated with `loggingOn=fmi3True` and a msg_cat has been labelled as a debugging category;
     /// FMUs generated by this library provides a Description which reports if the category is debug.
-    void sendToLog(std::string msg, fmi3Status status, std::string msg_cat);
+    void sendToLog(const std::string& msg, fmi3Status status, const std::string& msg_cat);
+
+    /// Send message to the logger function, given the id of the log category (see GetLogCategoryId).
+    /// Prefer the FMU_LOG macro, which does not even build the message if the category is disabled.
+    void sendToLog(const std::string& msg, fmi3Status status, int msg_cat_id);
+
+    /// Return the id of a log category, resolved once at construction, or -1 if the category is not known.
+    int GetLogCategoryId(const std::string& msg_cat) const {
+        auto it = m_logCategoryIds.find(msg_cat);
+        return it == m_logCategoryIds.end() ? -1 : it->second;
+    }
+
+    /// Check if messages of the given log category would be sent to the logger.
+    bool isLogEnabled(int msg_cat_id) const {
+        return msg_cat_id >= 0 && static_cast<size_t>(msg_cat_id) < m_logCategoryActive.size() &&
+               m_logCategoryActive[msg_cat_id];
+    }
 
     std::set<FmuVariableExport>::iterator findByValref(fmi3ValueReference vr);
     std::set<FmuVariableExport>::const_iterator findByValref(fmi3ValueReference vr) const;
     std::set<FmuVariableExport>::iterator findByName(const std::string& name);
 
+    /// Resolved list of variables requested by an fmi3Get|fmi3Set call.
+    /// Masters usually request the same list of value references at every step: the plan caches the result of the
+    /// variable lookup, the variable sizes and the address of the bound memory, if any.
+    struct FmuVariableAccessPlan {
+        std::vector<fmi3ValueReference> vrs;                           ///< requested value references
+        std::vector<std::set<FmuVariableExport>::iterator> variables;  ///< variables matching the value references
+        std::vector<size_t> sizes;  ///< number of values of each variable (unused if dynamic_sizes)
+        std::vector<void*> data;    ///< address of bound memory (nullptr if not stable, e.g. getter|setter binding)
+        bool dynamic_sizes = false;  ///< at least one variable has dimensions depending on other variables
+        bool structural = false;     ///< at least one variable is a structural parameter
+        bool data_resolved = false;  ///< data has been evaluated
+        bool set_checked = false;    ///< set_allowed has been evaluated
+        bool set_allowed = false;    ///< all the variables can be set in set_allowed_state
+        FmuMachineState set_allowed_state = FmuMachineState::instantiated;  ///< state in which set_allowed is valid
+    };
+
+    /// Retrieve the cached access plan for the given list of value references or create a new one.
+    /// Returns nullptr (after logging an error) if any of the value references does not exist.
+    FmuVariableAccessPlan* getAccessPlan(const fmi3ValueReference vrs[],
+                                         size_t nvr,
+                                         const std::type_info& value_type,
+                                         const char* caller);
+
+    /// Fill an access plan for the given list of value references (false if any of them does not exist).
+    bool buildAccessPlan(FmuVariableAccessPlan& plan, const fmi3ValueReference vrs[], size_t nvr, const char* caller);
+
+    /// Check that all the variables of the plan can be set in the current FMU state.
+    bool checkAccessPlanSetAllowed(FmuVariableAccessPlan& plan);
+
+    /// Evaluate the address of the bound memory of the variables in the plan.
+    template <class T>
+    void resolveAccessPlan(FmuVariableAccessPlan& plan, const T*) {
+        if (plan.data_resolved)
+            return;
+        for (size_t s = 0; s < plan.variables.size(); ++s) {
+            FmuBindingAddress<T> address{plan.dynamic_sizes ? 0 : plan.sizes[s]};
+            plan.data[s] = varns::visit(address, plan.variables[s]->m_varbind);
+        }
+        plan.data_resolved = true;
+    }
+
+    /// Strings are always accessed through FmuVariableExport.
+    void resolveAccessPlan(FmuVariableAccessPlan& plan, const fmi3String*) { plan.data_resolved = true; }
+
+    /// Snapshot of the FMU state (returned to the master as fmi3FMUState).
+    struct FmuStateSnapshot {
+        std::vector<fmi3Byte> data;                  ///< values of variables bound to memory or getter|setter pairs
+        std::vector<std::string> strings;            ///< values of String variables
+        std::vector<std::vector<fmi3Byte>> binaries;  ///< values of Binary variables
+        std::vector<fmi3Byte> internal;              ///< model-internal data (see getFMUStateIMPL)
+        fmi3Float64 time = 0;
+        fmi3Float64 stepSize = 0;
+        FmuMachineState machineState = FmuMachineState::instantiated;
+    };
+
+    /// Description of how a variable is stored in an FmuStateSnapshot.
+    struct FmuStateEntry {
+        enum class Kind { memory, function, vector, string, function_string, binary, binary_buffer };
+
+        std::set<FmuVariableExport>::iterator variable;
+        Kind kind = Kind::memory;
+        void* address = nullptr;  ///< address of the bound memory (all kinds except Kind::function*)
+        size_t elem_size = 0;     ///< size of a single value, in bytes (Kind::memory, Kind::function)
+        bool fixed_size = true;   ///< the number of values does not depend on other variables
+        bool array_function = false;  ///< bulk getter|setter pair (Kind::function)
+        size_t count = 0;         ///< number of values
+        size_t offset = 0;        ///< offset in the snapshot buffer corresponding to kind
+    };
+
+    /// Visitor classifying the binding of a variable into an FmuStateEntry.
+    struct FmuStateLayoutVisitor;
+
+    /// Update the FMU state layout and return the buffer sizes required by a snapshot.
+    void updateFMUStateLayout(size_t& data_size, size_t& num_strings, size_t& num_binaries);
+
+    /// Save the values of the non-constant variables, the time and the machine state into the snapshot.
+    fmi3Status saveFMUState(FmuStateSnapshot& snapshot);
+
+    /// Restore the values and the time saved by saveFMUState; return false if the snapshot does not match the
+    /// current variables. The machine state and the model-internal data are left to the caller.
+    bool restoreFMUState(const FmuStateSnapshot& snapshot);
+
+    /// Get a snapshot from the pool (or allocate a new one, if the pool is empty).
+    FmuStateSnapshot* acquireFMUStateSnapshot();
+
+    /// Resolve fmi3Get|fmi3Set calls on a scalar variable through a typed direct access to 'data' (the bound
+    /// memory), instead of the access plans (see FmuComponentStatic). Structural parameters are not bound.
+    void bindStaticVariable(const FmuVariableExport& variable, void* data);
+
+    /// Scalar variable accessed directly through its address (see bindStaticVariable).
+    struct FmuStaticBinding {
+        void* data = nullptr;
+        FmuVariable::Type type = FmuVariable::Type::Unknown;  ///< Type::Unknown if not bound
+    };
+
+    /// Check if the value reference is bound to a typed direct access of type 'type'.
+    bool isStaticallyBound(fmi3ValueReference vr, FmuVariable::Type type) const {
+        return vr < m_staticBindings.size() && m_staticBindings[vr].type == type;
+    }
+
+    /// Get the values of statically bound variables; return false, leaving the call to the access plans, if any
+    /// of the variables is not bound to values of type T.
+    template <class T>
+    bool getStaticVariables(const fmi3ValueReference vrs[], size_t nvr, T values[], size_t nValues) const {
+        if (nvr != nValues)
+            return false;
+        for (size_t s = 0; s < nvr; ++s) {
+            if (!isStaticallyBound(vrs[s], FmuTypeOf<T>::value))
+                return false;
+            values[s] = *static_cast<const T*>(m_staticBindings[vrs[s]].data);
+        }
+        return true;
+    }
+
+    /// Set the values of statically bound variables; return false, without setting any value, if any of the
+    /// variables is not bound to values of type T or cannot be set in the current FMU state.
+    template <class T>
+    bool setStaticVariables(const fmi3ValueReference vrs[], size_t nvr, const T values[], size_t nValues) {
+        if (nvr != nValues)
+            return false;
+        for (size_t s = 0; s < nvr; ++s) {
+            if (!isStaticallyBound(vrs[s], FmuTypeOf<T>::value) ||
+                !m_valrefIndex[vrs[s]]->IsSetAllowed(m_fmuMachineState))
+                return false;
+        }
+        for (size_t s = 0; s < nvr; ++s) {
+            *static_cast<T*>(m_staticBindings[vrs[s]].data) = values[s];
+            MarkVariableModified(vrs[s]);
+        }
+        return true;
+    }
+
+    /// Layout of the continuous states and of their derivatives, in the order of DeclareStateDerivative.
+    struct FmuContinuousStateLayout {
+        std::vector<std::set<FmuVariableExport>::iterator> states;
+        std::vector<std::set<FmuVariableExport>::iterator> derivatives;
+        std::vector<size_t> sizes;                      ///< number of values of each state
+        std::vector<fmi3Float64*> state_data;           ///< bound memory of each state (nullptr if not stable)
+        std::vector<fmi3Float64*> derivative_data;      ///< bound memory of each derivative (nullptr if not stable)
+        std::vector<fmi3Float64> nominals;              ///< nominal values of all the continuous states
+        fmi3Float64* contiguous_states = nullptr;       ///< start of the states, if stored contiguously
+        fmi3Float64* contiguous_derivatives = nullptr;  ///< start of the derivatives, if stored contiguously
+        size_t size = 0;                                ///< number of continuous states
+    };
+
+    /// Update the continuous state layout, if needed, and check the number of continuous states requested.
+    bool checkContinuousStateLayout(size_t nContinuousStates, const std::string& caller);
+
+    /// Copy the values of the continuous states (or of their derivatives) from the declared variables.
+    fmi3Status readContinuousStateLayout(bool derivatives,
+                                         fmi3Float64 values[],
+                                         size_t nContinuousStates,
+                                         const std::string& caller);
+
+    /// Copy the values of the continuous states to the declared state variables.
+    fmi3Status writeContinuousStateLayout(const fmi3Float64 values[],
+                                          size_t nContinuousStates,
+                                          const std::string& caller);
+
+    /// Enable the advertisement of partial derivatives in the model description.
+    void setDirectionalDerivativeSupport(bool providesDirectionalDerivatives, bool providesAdjointDerivatives) {
+        m_providesDirectionalDerivatives = providesDirectionalDerivatives;
+        m_providesAdjointDerivatives = providesAdjointDerivatives;
+    }
+
+    /// Enable the advertisement of intermediate updates in the model description (co-simulation only).
+    /// If 'canReturnEarly', doStepIMPL may also end the step before its end time upon request of the importer.
+    void setIntermediateUpdateSupport(bool canReturnEarly) {
+        m_providesIntermediateUpdate = true;
+        m_canReturnEarlyAfterIntermediateUpdate = canReturnEarly;
+    }
+
+    /// Notify the importer of an intermediate update from within doStepIMPL (co-simulation only).
+    /// The solver loop is expected to update m_time and the outputs before the call, so that the importer can read
+    /// them from the callback; lazy outputs are invalidated. If 'canReturnEarly' and the importer allowed it at
+    /// instantiation, the importer may request to end the step: in that case the function returns true and, if not
+    /// null, 'earlyReturnTime' receives the time requested for the early return (see returnEarly).
+    /// Returns false if no intermediate update callback was provided.
+    bool intermediateUpdate(fmi3Float64 intermediateUpdateTime,
+                            bool intermediateStepFinished,
+                            bool canReturnEarly,
+                            fmi3Float64* earlyReturnTime = nullptr);
+
+    /// Check if the importer requested to return early from the current step, at the last intermediate update.
+    bool earlyReturnRequested() const { return m_earlyReturnRequested; }
+
+    /// End the current step early at the given time, setting the corresponding outputs of doStepIMPL.
+    /// Set also 'eventHandlingNeeded' if the step is ended at an event.
+    fmi3Status returnEarly(fmi3Float64 time, fmi3Boolean* earlyReturn, fmi3Float64* lastSuccessfulTime) {
+        m_time = time;
+        *earlyReturn = fmi3True;
+        *lastSuccessfulTime = time;
+        return fmi3Status::fmi3OK;
+    }
+
+    /// Float64 variables of a partial derivative request, with the offsets of their values.
+    /// The offsets vector has one more element than the variables, the last one being the total number of values.
+    struct DerivativeVariables {
+        std::vector<std::set<FmuVariableExport>::iterator> variables;
+        std::vector<size_t> offsets;
+    };
+
+    /// Approximate the directional derivative by forward finite differences along the seed direction.
+    /// Evaluation of the unknowns is interrupted at the first failure of evaluateUnknownsIMPL, whose status is
+    /// returned after restoring the knowns.
+    fmi3Status computeDirectionalDerivativeFD(const DerivativeVariables& unknowns,
+                                              const DerivativeVariables& knowns,
+                                              const fmi3Float64 seed[],
+                                              size_t nSeed,
+                                              fmi3Float64 sensitivity[],
+                                              size_t nSensitivity);
+
+    /// Approximate the adjoint derivative from the Jacobian returned by computeJacobianFD.
+    fmi3Status computeAdjointDerivativeFD(const DerivativeVariables& unknowns,
+                                          const DerivativeVariables& knowns,
+                                          const fmi3Float64 seed[],
+                                          size_t nSeed,
+                                          fmi3Float64 sensitivity[],
+                                          size_t nSensitivity);
+
+    /// Approximate by forward finite differences the Jacobian of the unknowns with respect to the knowns.
+    /// Knowns that do not affect the same unknowns (according to DeclareStateDerivative and
+    /// DeclareVariableDependencies) are perturbed together, so that the number of evaluations is given by the number
+    /// of colors of the sparsity pattern. Unknowns without declared dependencies are assumed to depend on all knowns.
+    /// The Jacobian is returned as a dense row-major matrix.
+    /// As for computeDirectionalDerivativeFD, the first failure of evaluateUnknownsIMPL is returned.
+    fmi3Status computeJacobianFD(const DerivativeVariables& unknowns,
+                                 const DerivativeVariables& knowns,
+                                 std::vector<fmi3Float64>& jacobian);
+
+    /// Collect the Float64 variables with given value references and the offsets of their values.
+    bool collectDerivativeVariables(const fmi3ValueReference vrs[],
+                                    size_t nvr,
+                                    DerivativeVariables& collected,
+                                    const std::string& caller);
+
+    /// Check if the unknown variable depends on the known variable, according to the declared dependencies.
+    bool isDependentOn(const FmuVariableExport& unknown, const FmuVariableExport& known) const;
+
+    /// Build the compressed sparse row structure of the declared dependencies, if not up to date.
+    void prepareVariableDependencies();
+
+    /// Return the row of the declared dependencies of a variable, logging an error if there is none.
+    bool findVariableDependencies(fmi3ValueReference valueReference, size_t& row, const std::string& caller);
+
+    /// Register the variable pointed by \a it in the value reference lookup table.
+    void indexVariable(std::set<FmuVariableExport>::iterator it);
+
+    /// Rebuild the value reference lookup table from scratch.
+    /// Must be called if m_variables is modified without passing through AddFmuVariable or RebindVariable.
+    void rebuildValrefIndex();
+
     /// Get the current dimensions of a variable.
-    std::vector<size_t> GetVariableDimensions(const FmuVariable& var) const;
+    /// Dimensions are resolved once and cached until a structural parameter is set (see InvalidateVariableSizes).
+    const std::vector<size_t>& GetVariableDimensions(const FmuVariable& var) const;
 
     /// Get the current dimensions of a variable given its valueReference.
     /// If the dimension depends on another variables, these variables needs to be added first.
-    std::vector<size_t> GetVariableDimensions(fmi3ValueReference valref) const;
+    const std::vector<size_t>& GetVariableDimensions(fmi3ValueReference valref) const;
 
     /// Get the current total size of a variable.
     size_t GetVariableSize(const FmuVariable& var) const;
@@ -609,9 +1479,78 @@ class FmuComponentBase {
     /// Get the current total size of a variable.
     size_t GetVariableSize(fmi3ValueReference valref) const { return GetVariableSize(*findByValref(valref)); }
 
+    /// Discard the cached dimensions of the variables.
+    /// Automatically called when a structural parameter is set through fmi3Set or restored from an FMU state, it must
+    /// be called if the model changes a structural parameter by itself.
+    void InvalidateVariableSizes() {
+        m_variableShapes.clear();
+        m_stateLayoutValid = false;
+    }
+
     void executePreStepCallbacks();
     void executePostStepCallbacks();
 
+    /// Function to be executed before or after the step, with the variables it reads and writes.
+    struct FmuStepStage {
+        std::function<void(void)> function;
+        std::vector<std::string> output_names;
+        std::vector<std::string> input_names;                       ///< explicit inputs (dependencies excluded)
+        bool conditional = false;                                   ///< skipped if the inputs did not change
+        std::vector<std::set<FmuVariableExport>::iterator> inputs;  ///< all the inputs, resolved by prepareStepStages
+        std::vector<std::string> last_values;                       ///< input values at the last execution
+        bool dirty = true;                                          ///< execution forced at the next run
+#ifdef FMU_FORGE_PROFILING
+        std::string profile_name;  ///< name of the stage in the profile report
+        FmuProfileCounter profile;
+#endif
+    };
+
+    /// Model partition, activated by a periodic input clock (ScheduledExecution).
+    struct FmuModelPartition {
+        std::string clock_name;
+        std::string description;
+        fmi3ValueReference clock_valref;
+        fmi3Float64 interval;
+        std::function<fmi3Status(fmi3Float64)> function;
+    };
+
+    /// Find the model partition bound to the given clock (nullptr if none).
+    const FmuModelPartition* findModelPartition(fmi3ValueReference clockReference) const;
+
+    void addStepStage(std::vector<FmuStepStage>& stages,
+                      std::function<void(void)> function,
+                      const std::vector<std::string>& outputs = {},
+                      const std::vector<std::string>& inputs = {});
+
+    /// Resolve the inputs of the stages and sort them in dependency order.
+    void prepareStepStages(std::vector<FmuStepStage>& stages);
+
+    /// Execute the stages whose inputs changed.
+    void runStepStages(std::vector<FmuStepStage>& stages);
+
+    /// Force the execution of all the stages at the next run (e.g. after the FMU state has been restored).
+    void invalidateStepStages();
+
+    /// Flag the variables of the plan as modified since the last step.
+    void markModified(const FmuVariableAccessPlan& plan) {
+        for (auto vr : plan.vrs)
+            MarkVariableModified(vr);
+    }
+
+    /// Clear the modified flags and discard the values memoized by lazy getters (a step has been taken).
+    /// Binary inputs referencing the buffers of the importer are released (see FmuBinaryBuffer).
+    void stepCompleted() {
+        std::fill(m_modified.begin(), m_modified.end(), 0);
+        ++m_valuesEpoch;
+        releaseBinaryReferences();
+    }
+
+    /// Keep track of a variable bound to FmuBinaryBuffer referencing the buffer of the importer.
+    void trackBinaryReference(const FmuVariableExport& variable);
+
+    /// Drop the references to the buffers of the importer taken by fmi3SetBinary since the last step.
+    void releaseBinaryReferences();
+
     std::string m_instanceName;
     std::string m_instantiationToken;
     std::string m_resources_location;
@@ -640,25 +1579,294 @@ class FmuComponentBase {
     unsigned int m_valrefCounter = 0;
 
     std::set<FmuVariableExport> m_variables;
+    std::vector<std::set<FmuVariableExport>::iterator> m_valrefIndex;  ///< lookup table, indexed by value reference
+
+    std::unordered_multimap<size_t, FmuVariableAccessPlan> m_accessPlans;  ///< cached access plans, by hash
+
+    /// Resolved dimensions of an array variable.
+    struct FmuVariableShape {
+        std::vector<size_t> dimensions;
+        size_t size;
+    };
+
+    /// Get the resolved dimensions of an array variable, evaluating them if not cached.
+    const FmuVariableShape& getVariableShape(const FmuVariable& var) const;
+
+    mutable std::unordered_map<fmi3ValueReference, FmuVariableShape> m_variableShapes;  ///< cached array dimensions
+
+    bool m_canGetAndSetFMUState = false;
+    bool m_canSerializeFMUState = false;
+    std::vector<FmuStateEntry> m_fmuStateLayout;  ///< layout of the variables in the FMU state snapshots
+    bool m_fmuStateLayoutValid = false;           ///< the layout matches the current set of variables
+    std::vector<std::unique_ptr<FmuStateSnapshot>> m_fmuStates;  ///< all snapshots allocated by this FMU
+    std::vector<FmuStateSnapshot*> m_fmuStatesPool;              ///< snapshots available for reuse
+    std::unique_ptr<FmuStateSnapshot> m_resetState;              ///< snapshot taken at instantiation (see Reset)
+
+    FmuContinuousStateLayout m_stateLayout;  ///< layout of the continuous states
+    std::vector<FmuStaticBinding> m_staticBindings;  ///< typed direct access, indexed by value reference
+    bool m_stateLayoutValid = false;         ///< the layout matches the current variables and dimensions
+
+    bool m_providesIntermediateUpdate = false;
+    bool m_canReturnEarlyAfterIntermediateUpdate = false;
+    bool m_earlyReturnAllowed = false;    ///< early return allowed by the importer at instantiation
+    bool m_earlyReturnRequested = false;  ///< early return requested at the last intermediate update
+
+    bool m_providesDirectionalDerivatives = false;
+    bool m_providesAdjointDerivatives = false;
+    size_t m_accessPlanHits = 0;
+    size_t m_accessPlanMisses = 0;
+
+    /// Add the reserved "fmu_forge_rt_*" variables (real-time mode, once the FMU is constructed).
+    void addRealTimeVariables();
+
+    /// Reserve all the buffers used by fmi3Get|fmi3Set and DoStep (real-time mode, at ExitInitializationMode).
+    void prepareRealTime();
+
+    /// Step of the FMU, timed by DoStep in real-time mode.
+    fmi3Status doStep(fmi3Float64 currentCommunicationPoint,
+                      fmi3Float64 communicationStepSize,
+                      fmi3Boolean noSetFMUStatePriorToCurrentPoint,
+                      fmi3Boolean* eventHandlingNeeded,
+                      fmi3Boolean* terminateSimulation,
+                      fmi3Boolean* earlyReturn,
+                      fmi3Float64* lastSuccessfulTime);
+
+    bool m_realTime = false;                     ///< real-time mode enabled (see EnableRealTimeMode)
+    bool m_realTimeVariablesAdded = false;       ///< reserved variables added (see addRealTimeVariables)
+    bool m_realTimeReady = false;                ///< buffers reserved (initialization completed)
+    fmi3Float64 m_realTimeBudget = 0;            ///< budget of each DoStep [s]
+    FmuStepLatencyHistogram m_stepLatency;       ///< DoStep latencies (real-time mode)
+    FmuVariableAccessPlan m_realTimeAccessPlan;  ///< reused, instead of caching new plans (real-time mode)
     std::unordered_map<std::string, UnitDefinition> m_unitDefinitions;
     std::unordered_map<std::string, std::pair<std::string, std::vector<std::string>>> m_derivatives;
+    std::vector<std::string> m_derivativeNames;  ///< state derivatives, in the order of the continuous states
+    std::unordered_map<std::string, fmi3Float64> m_stateNominals;
     std::unordered_map<std::string, std::vector<std::string>> m_variableDependencies;
 
-    std::list<std::function<void(void)>> m_preStepCallbacks;
-    std::list<std::function<void(void)>> m_postStepCallbacks;
+    /// variables of the current GetDirectionalDerivative|GetAdjointDerivative call (buffers reused across calls)
+    DerivativeVariables m_derivativeUnknowns;
+    DerivativeVariables m_derivativeKnowns;
+
+    /// declared dependencies (m_derivatives and m_variableDependencies) in compressed sparse row form: the independents
+    /// of m_dependents[i] are in m_independents, from m_dependencyOffsets[i] to m_dependencyOffsets[i+1]
+    std::vector<fmi3ValueReference> m_dependents;  ///< by increasing value reference
+    std::vector<size_t> m_dependencyOffsets;
+    std::vector<fmi3ValueReference> m_independents;  ///< by increasing value reference, in each row
+    bool m_dependenciesPrepared = false;
+
+    std::vector<FmuStepStage> m_preStepStages;   ///< pre-step pipeline, in execution order once prepared
+    std::vector<FmuStepStage> m_postStepStages;  ///< post-step pipeline, in execution order once prepared
+    bool m_stepStagesPrepared = false;           ///< stage inputs are resolved and stages sorted
+    size_t m_stepStagesSkipped = 0;
+
+    std::vector<FmuModelPartition> m_modelPartitions;  ///< model partitions, by increasing clock value reference
+
+    std::vector<std::uint8_t> m_modified;  ///< variable modified since the last step, indexed by value reference
+    size_t m_valuesEpoch = 0;              ///< changed by steps and variable updates; lazy getters memoize per epoch
+
+    /// binary inputs referencing the buffers of the importer (address and number of values)
+    std::vector<std::pair<FmuBinaryBuffer*, size_t>> m_binaryReferences;
+
+#ifdef FMU_FORGE_PROFILING
+    std::deque<FmuProfileCounter> m_profileCounters;  ///< indexed by profiled function id (references stay valid)
+#endif
 
     fmi3InstanceEnvironment m_instanceEnvironment;
     fmi3LogMessageCallback m_logMessage;
-    fmi3IntermediateUpdateCallback m_intermediateUpdate;
+    fmi3IntermediateUpdateCallback m_intermediateUpdate = nullptr;
     // The following callbacks are used only for ScheduledExecution
-    ////fmi3LockPreemptionCallback m_lockPreemption;
-    ////fmi3UnlockPreemptionCallback m_unlockPreemption;
+    fmi3ClockUpdateCallback m_clockUpdate = nullptr;
+    fmi3LockPreemptionCallback m_lockPreemption = nullptr;
+    fmi3UnlockPreemptionCallback m_unlockPreemption = nullptr;
 
     FmuMachineState m_fmuMachineState;
 
     std::unordered_map<std::string, bool> m_logCategories_enabled;
 
+    /// Update the flag of the given log category, merging the enabled and debug settings.
+    void updateLogCategory(int msg_cat_id);
+
+    std::vector<std::string> m_logCategoryNames;            ///< log category names, indexed by id
+    std::unordered_map<std::string, int> m_logCategoryIds;  ///< log category ids, by name
+    std::vector<std::uint8_t> m_logCategoryActive;          ///< messages of the category are sent, indexed by id
+
     bool expose_variable_start_values_whenever_possible = true;
+
+    std::unique_ptr<FmuAsyncLogSink> m_asyncLogSink;  ///< asynchronous sink (destroyed first, flushing the messages)
+};
+
+// -----------------------------------------------------------------------------
+
+/// Scalar variable bound to a member of the model, described at compile time (see FmuComponentStatic).
+template <class Model>
+struct FmuStaticVariable {
+    /// Pointer to the bound member, of the type given by 'type'.
+    union Member {
+        fmi3Float32 Model::*float32;
+        fmi3Float64 Model::*float64;
+        fmi3Int8 Model::*int8;
+        fmi3UInt8 Model::*uint8;
+        fmi3Int16 Model::*int16;
+        fmi3UInt16 Model::*uint16;
+        fmi3Int32 Model::*int32;
+        fmi3UInt32 Model::*uint32;
+        fmi3Int64 Model::*int64;
+        fmi3UInt64 Model::*uint64;
+        fmi3Boolean Model::*boolean;
+
+        constexpr Member(fmi3Float32 Model::*m) : float32(m) {}
+        constexpr Member(fmi3Float64 Model::*m) : float64(m) {}
+        constexpr Member(fmi3Int8 Model::*m) : int8(m) {}
+        constexpr Member(fmi3UInt8 Model::*m) : uint8(m) {}
+        constexpr Member(fmi3Int16 Model::*m) : int16(m) {}
+        constexpr Member(fmi3UInt16 Model::*m) : uint16(m) {}
+        constexpr Member(fmi3Int32 Model::*m) : int32(m) {}
+        constexpr Member(fmi3UInt32 Model::*m) : uint32(m) {}
+        constexpr Member(fmi3Int64 Model::*m) : int64(m) {}
+        constexpr Member(fmi3UInt64 Model::*m) : uint64(m) {}
+        constexpr Member(fmi3Boolean Model::*m) : boolean(m) {}
+    };
+
+    template <class T>
+    constexpr FmuStaticVariable(const char* name,
+                                T Model::*member,
+                                const char* unitname = "",
+                                const char* description = "",
+                                FmuVariable::CausalityType causality = FmuVariable::CausalityType::local,
+                                FmuVariable::VariabilityType variability = FmuVariable::VariabilityType::continuous,
+                                FmuVariable::InitialType initial = FmuVariable::InitialType::automatic)
+        : name(name),
+          type(FmuTypeOf<T>::value),
+          member(member),
+          unitname(unitname),
+          description(description),
+          causality(causality),
+          variability(variability),
+          initial(initial) {}
+
+    /// Return the typed address of the bound member of the given model.
+    template <class T>
+    T* Address(Model& model) const {
+        return static_cast<T*>(Address(model));
+    }
+
+    /// Return the address of the bound member of the given model.
+    void* Address(Model& model) const {
+        switch (type) {
+            case FmuVariable::Type::Float32:
+                return &(model.*member.float32);
+            case FmuVariable::Type::Float64:
+                return &(model.*member.float64);
+            case FmuVariable::Type::Int8:
+                return &(model.*member.int8);
+            case FmuVariable::Type::UInt8:
+                return &(model.*member.uint8);
+            case FmuVariable::Type::Int16:
+                return &(model.*member.int16);
+            case FmuVariable::Type::UInt16:
+                return &(model.*member.uint16);
+            case FmuVariable::Type::Int32:
+                return &(model.*member.int32);
+            case FmuVariable::Type::UInt32:
+                return &(model.*member.uint32);
+            case FmuVariable::Type::Int64:
+                return &(model.*member.int64);
+            case FmuVariable::Type::UInt64:
+                return &(model.*member.uint64);
+            case FmuVariable::Type::Boolean:
+                return &(model.*member.boolean);
+            default:
+                return nullptr;
+        }
+    }
+
+    const char* name;
+    FmuVariable::Type type;
+    Member member;
+    const char* unitname;
+    const char* description;
+    FmuVariable::CausalityType causality;
+    FmuVariable::VariabilityType variability;
+    FmuVariable::InitialType initial;
+};
+
+/// Base class of FMUs whose scalar variables are declared at compile time, as a table of descriptors in the
+/// 'static_variables' member of the model:
+///
+///     class MyFmu : public FmuComponentStatic<MyFmu> {
+///         ...
+///         fmi3Float64 x = 0;
+///         static constexpr FmuStaticVariable<MyFmu> static_variables[] = {
+///             {"x", &MyFmu::x, "m", "position", FmuVariable::CausalityType::output}};
+///     };
+///     constexpr FmuStaticVariable<MyFmu> MyFmu::static_variables[];
+///
+/// The variables of the table are registered as any other variable, in the order of the table (thus included in
+/// the model description, in the FMU state, etc.), and fmi3Get|fmi3Set calls on them access the members directly,
+/// without going through the variable bindings nor the access plans.
+/// Further variables, e.g. arrays or strings, can be added by the model through AddFmuVariable.
+template <class Model>
+class FmuComponentStatic : public FmuComponentBase {
+  public:
+    FmuComponentStatic(FmuType fmiInterfaceType,
+                       fmi3String instanceName,
+                       fmi3String instantiationToken,
+                       fmi3String resourcePath,
+                       fmi3Boolean visible,
+                       fmi3Boolean loggingOn,
+                       fmi3InstanceEnvironment instanceEnvironment,
+                       fmi3LogMessageCallback logMessage,
+                       const std::unordered_map<std::string, bool>& logCategories_init,
+                       const std::unordered_set<std::string>& logCategories_debug_init)
+        : FmuComponentBase(fmiInterfaceType,
+                           instanceName,
+                           instantiationToken,
+                           resourcePath,
+                           visible,
+                           loggingOn,
+                           instanceEnvironment,
+                           logMessage,
+                           logCategories_init,
+                           logCategories_debug_init) {
+        // only the addresses of the members are taken, the model is constructed afterwards
+        Model& model = static_cast<Model&>(*this);
+        for (const auto& var : Model::static_variables) {
+            const FmuVariableExport& variable = AddFmuVariable(
+                bindingOf(var, model), var.name, var.type, var.unitname, var.description, var.causality,
+                var.variability, var.initial);
+            bindStaticVariable(variable, var.Address(model));
+        }
+    }
+
+  private:
+    static FmuVariableBindType bindingOf(const FmuStaticVariable<Model>& var, Model& model) {
+        switch (var.type) {
+            case FmuVariable::Type::Float32:
+                return var.template Address<fmi3Float32>(model);
+            case FmuVariable::Type::Float64:
+                return var.template Address<fmi3Float64>(model);
+            case FmuVariable::Type::Int8:
+                return var.template Address<fmi3Int8>(model);
+            case FmuVariable::Type::UInt8:
+                return var.template Address<fmi3UInt8>(model);
+            case FmuVariable::Type::Int16:
+                return var.template Address<fmi3Int16>(model);
+            case FmuVariable::Type::UInt16:
+                return var.template Address<fmi3UInt16>(model);
+            case FmuVariable::Type::Int32:
+                return var.template Address<fmi3Int32>(model);
+            case FmuVariable::Type::UInt32:
+                return var.template Address<fmi3UInt32>(model);
+            case FmuVariable::Type::Int64:
+                return var.template Address<fmi3Int64>(model);
+            case FmuVariable::Type::UInt64:
+                return var.template Address<fmi3UInt64>(model);
+            case FmuVariable::Type::Boolean:
+                return var.template Address<fmi3Boolean>(model);
+            default:
+                throw std::runtime_error("Unsupported type of static variable: " + std::string(var.name));
+        }
+    }
 };
 
 // -----------------------------------------------------------------------------
@@ -18,17 +18,28 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <cassert>
+#include <array>
+#include <unordered_map>
+#include <memory>
+#include <functional>
+#include <random>
 #include <fstream>
 #include <sstream>
 #include <cstdarg>
+#include <cstdlib>
 #include <iostream>
 #include <system_error>
 #include <algorithm>
 #include <iterator>
+#include <mutex>
 
 #include "FmuToolsRuntimeLinking.h"
 #include "FmuToolsImportCommon.h"
+#include "FmuToolsVariableTrie.h"
 #include "fmi3/FmuToolsVariable.h"
+#include "fmi3/FmuToolsTracer.h"
+#include "fmi3/FmuToolsStepWorker.h"
 
 namespace fmu_forge {
 namespace fmi3 {
@@ -37,7 +48,7 @@ namespace fmi3 {
 /// @{
 
 #define LOAD_FMI_FUNCTION(funcName)                                                                    \
-    this->_##funcName = (funcName##TYPE*)get_function_ptr(this->dynlib_handle, #funcName);             \
+    this->_##funcName = (funcName##TYPE*)get_function_ptr(m_library->dynlib_handle, #funcName);        \
     if (!this->_##funcName)                                                                            \
         throw std::runtime_error(std::string(std::string("Could not find ") + std::string(#funcName) + \
                                              std::string(" in the FMU library. Wrong or outdated FMU?")));
@@ -62,67 +73,374 @@ class FmuVariableImport : public FmuVariable {
     bool IsState() const { return m_is_state; }
     bool IsDeriv() const { return m_is_deriv; }
 
+    /// Start values declared in the model description, as written in the XML (one entry per element; Binary values
+    /// are hex-encoded). Empty if no start value is given.
+    const std::vector<std::string>& GetStartValues() const { return m_start_values; }
+
   private:
     bool m_is_state;  ///< true if this is a state variable
     bool m_is_deriv;  ///< true if this is a state derivative variable
+    std::vector<std::string> m_start_values;  ///< start values from the model description
 
     friend class FmuUnit;
 };
 
+/// Clock of an imported FMU, activating a model partition (ScheduledExecution interface).
+/// Clocks are listed separately from the FMU variables, since they have no value to get or set.
+struct FmuClockImport {
+    std::string name;
+    fmi3ValueReference valueReference;
+    fmi3Float64 interval;  ///< value of the 'intervalDecimal' attribute (0 if not given)
+    std::string description;
+};
+
+/// Dependencies of the unknowns of an FMU (outputs, continuous state derivatives, event indicators and clocked states)
+/// on the knowns, in compressed sparse row form (see FmuUnit::LoadDependencies).
+/// Dependencies are on whole variables; an unknown whose dependencies are not declared depends on all the knowns.
+struct FmuDependencyGraph {
+    std::vector<fmi3ValueReference> unknowns;      ///< by increasing value reference
+    std::vector<uint8_t> declared;                 ///< dependencies of the unknown are declared
+    std::vector<size_t> offsets;                   ///< independents of unknowns[i]: from offsets[i] to offsets[i+1]
+    std::vector<fmi3ValueReference> independents;  ///< by increasing value reference, in each row
+    std::vector<fmi3DependencyKind> kinds;         ///< kind of each dependency (fmi3Dependent if not declared)
+
+    /// Return the row of an unknown, or unknowns.size() if not found.
+    size_t Find(fmi3ValueReference unknown) const {
+        auto it = std::lower_bound(unknowns.begin(), unknowns.end(), unknown);
+        return it != unknowns.end() && *it == unknown ? static_cast<size_t>(it - unknowns.begin()) : unknowns.size();
+    }
+
+    void Clear() {
+        unknowns.clear();
+        declared.clear();
+        offsets.assign(1, 0);
+        independents.clear();
+        kinds.clear();
+    }
+};
+
+/// Non-owning view of the bytes of a fmi3Binary value (see FmuUnit::SetVariable and FmuUnit::GetVariable).
+struct FmuBinaryView {
+    const fmi3Byte* data;
+    size_t size;
+};
+
+// =============================================================================
+
+/// Trie of the FMU variables, by their hierarchical names.
+typedef FmuVariableTrie<FmuVariableImport*> FmuVariableTree;
+
 // =============================================================================
 
-/// Class for a node in a tree of FMU variables.
-/// The tree is constructed by analyzing the flat list of variables in the XML.
-/// In the XML one has the flattened list such as for example
-///     myobject.mysubobjetct.pos
-///     myobject.mysubobjetct.dir
-/// so the tree will contain:
-///     myobject
-///          mysubobject
-///                pos
-///                dir
-class FmuVariableTreeNode {
+/// Table of the FMI functions of an FMU shared library.
+struct FmuFunctions {
+    fmi3GetVersionTYPE* _fmi3GetVersion;
+    fmi3SetDebugLoggingTYPE* _fmi3SetDebugLogging;
+    fmi3InstantiateModelExchangeTYPE* _fmi3InstantiateModelExchange;
+    fmi3InstantiateCoSimulationTYPE* _fmi3InstantiateCoSimulation;
+    fmi3InstantiateScheduledExecutionTYPE* _fmi3InstantiateScheduledExecution;
+    fmi3FreeInstanceTYPE* _fmi3FreeInstance;
+    fmi3EnterInitializationModeTYPE* _fmi3EnterInitializationMode;
+    fmi3ExitInitializationModeTYPE* _fmi3ExitInitializationMode;
+    fmi3EnterEventModeTYPE* _fmi3EnterEventMode;
+    fmi3TerminateTYPE* _fmi3Terminate;
+    fmi3ResetTYPE* _fmi3Reset;
+    fmi3GetFloat32TYPE* _fmi3GetFloat32;
+    fmi3GetFloat64TYPE* _fmi3GetFloat64;
+    fmi3GetInt8TYPE* _fmi3GetInt8;
+    fmi3GetUInt8TYPE* _fmi3GetUInt8;
+    fmi3GetInt16TYPE* _fmi3GetInt16;
+    fmi3GetUInt16TYPE* _fmi3GetUInt16;
+    fmi3GetInt32TYPE* _fmi3GetInt32;
+    fmi3GetUInt32TYPE* _fmi3GetUInt32;
+    fmi3GetInt64TYPE* _fmi3GetInt64;
+    fmi3GetUInt64TYPE* _fmi3GetUInt64;
+    fmi3GetBooleanTYPE* _fmi3GetBoolean;
+    fmi3GetStringTYPE* _fmi3GetString;
+    fmi3GetBinaryTYPE* _fmi3GetBinary;
+    fmi3GetClockTYPE* _fmi3GetClock;
+    fmi3SetFloat32TYPE* _fmi3SetFloat32;
+    fmi3SetFloat64TYPE* _fmi3SetFloat64;
+    fmi3SetInt8TYPE* _fmi3SetInt8;
+    fmi3SetUInt8TYPE* _fmi3SetUInt8;
+    fmi3SetInt16TYPE* _fmi3SetInt16;
+    fmi3SetUInt16TYPE* _fmi3SetUInt16;
+    fmi3SetInt32TYPE* _fmi3SetInt32;
+    fmi3SetUInt32TYPE* _fmi3SetUInt32;
+    fmi3SetInt64TYPE* _fmi3SetInt64;
+    fmi3SetUInt64TYPE* _fmi3SetUInt64;
+    fmi3SetBooleanTYPE* _fmi3SetBoolean;
+    fmi3SetStringTYPE* _fmi3SetString;
+    fmi3SetBinaryTYPE* _fmi3SetBinary;
+    fmi3SetClockTYPE* _fmi3SetClock;
+    fmi3GetNumberOfVariableDependenciesTYPE* _fmi3GetNumberOfVariableDependencies;
+    fmi3GetVariableDependenciesTYPE* _fmi3GetVariableDependencies;
+    fmi3GetFMUStateTYPE* _fmi3GetFMUState;
+    fmi3SetFMUStateTYPE* _fmi3SetFMUState;
+    fmi3FreeFMUStateTYPE* _fmi3FreeFMUState;
+    fmi3SerializedFMUStateSizeTYPE* _fmi3SerializedFMUStateSize;
+    fmi3SerializeFMUStateTYPE* _fmi3SerializeFMUState;
+    fmi3DeserializeFMUStateTYPE* _fmi3DeserializeFMUState;
+    fmi3GetDirectionalDerivativeTYPE* _fmi3GetDirectionalDerivative;
+    fmi3GetAdjointDerivativeTYPE* _fmi3GetAdjointDerivative;
+    fmi3EnterConfigurationModeTYPE* _fmi3EnterConfigurationMode;
+    fmi3ExitConfigurationModeTYPE* _fmi3ExitConfigurationMode;
+    fmi3GetIntervalDecimalTYPE* _fmi3GetIntervalDecimal;
+    fmi3GetIntervalFractionTYPE* _fmi3GetIntervalFraction;
+    fmi3GetShiftDecimalTYPE* _fmi3GetShiftDecimal;
+    fmi3GetShiftFractionTYPE* _fmi3GetShiftFraction;
+    fmi3SetIntervalDecimalTYPE* _fmi3SetIntervalDecimal;
+    fmi3SetIntervalFractionTYPE* _fmi3SetIntervalFraction;
+    fmi3SetShiftDecimalTYPE* _fmi3SetShiftDecimal;
+    fmi3SetShiftFractionTYPE* _fmi3SetShiftFraction;
+    fmi3EvaluateDiscreteStatesTYPE* _fmi3EvaluateDiscreteStates;
+    fmi3UpdateDiscreteStatesTYPE* _fmi3UpdateDiscreteStates;
+    fmi3EnterContinuousTimeModeTYPE* _fmi3EnterContinuousTimeMode;
+    fmi3CompletedIntegratorStepTYPE* _fmi3CompletedIntegratorStep;
+    fmi3SetTimeTYPE* _fmi3SetTime;
+    fmi3SetContinuousStatesTYPE* _fmi3SetContinuousStates;
+    fmi3GetContinuousStateDerivativesTYPE* _fmi3GetContinuousStateDerivatives;
+    fmi3GetEventIndicatorsTYPE* _fmi3GetEventIndicators;
+    fmi3GetContinuousStatesTYPE* _fmi3GetContinuousStates;
+    fmi3GetNominalsOfContinuousStatesTYPE* _fmi3GetNominalsOfContinuousStates;
+    fmi3GetNumberOfEventIndicatorsTYPE* _fmi3GetNumberOfEventIndicators;
+    fmi3GetNumberOfContinuousStatesTYPE* _fmi3GetNumberOfContinuousStates;
+    fmi3EnterStepModeTYPE* _fmi3EnterStepMode;
+    fmi3GetOutputDerivativesTYPE* _fmi3GetOutputDerivatives;
+    fmi3DoStepTYPE* _fmi3DoStep;
+    fmi3ActivateModelPartitionTYPE* _fmi3ActivateModelPartition;
+};
+
+// -----------------------------------------------------------------------------
+
+/// Immutable part of an imported FMU: parsed model description, variables, shared library and FMI function table.
+/// It is created when an FmuUnit is loaded and can be shared by many FmuUnit objects (see FmuUnit::GetLibrary and
+/// FmuUnit::LoadShared), which then only hold their FMU instance and per-instance data. Once shared, the library is
+/// never modified: loading the FMU again in a unit creates a new library.
+class FmuLibrary {
   public:
-    std::string object_name;
+    // since FMI3.0 has unique varRefs we can use them for indexing instead of strings
+    typedef std::map<fmi3ValueReference, FmuVariableImport> VarList;
+
+    FmuLibrary()
+        : has_cosimulation(false),
+          has_model_exchange(false),
+          has_scheduled_execution(false),
+          m_resources_extracted(false),
+          m_nx(0),
+          dynlib_handle(nullptr),
+          functions() {
+        // default binaries directory in FMU unzipped directory
+        m_bin_directory = "/binaries/" + std::string(FMI3_PLATFORM);
+    }
+
+    FmuLibrary(const FmuLibrary&) = delete;
+    FmuLibrary& operator=(const FmuLibrary&) = delete;
+
+  private:
+    std::string modelName;
+    std::string instantiationToken;
+    std::string fmiVersion;
+    std::string description;
+    std::string generationTool;
+    std::string generationDateAndTime;
+    std::string variableNamingConvention;
+    std::string numberOfEventIndicators;
+
+    bool has_cosimulation;
+    std::string info_cosim_modelIdentifier;
+    std::string info_cosim_needsExecutionTool;
+    std::string info_cosim_canHandleVariableCommunicationStepSize;
+    std::string info_cosim_canInterpolateInputs;
+    std::string info_cosim_maxOutputDerivativeOrder;
+    std::string info_cosim_canRunAsynchronuously;
+    std::string info_cosim_canBeInstantiatedOnlyOncePerProcess;
+    std::string info_cosim_canNotUseMemoryManagementFunctions;
+    std::string info_cosim_canGetAndSetFMUState;
+    std::string info_cosim_canSerializeFMUState;
+
+    bool has_model_exchange;
+    std::string info_modex_modelIdentifier;
+    std::string info_modex_needsExecutionTool;
+    std::string info_modex_completedIntegratorStepNotNeeded;
+    std::string info_modex_canBeInstantiatedOnlyOncePerProcess;
+    std::string info_modex_canNotUseMemoryManagementFunctions;
+    std::string info_modex_canGetAndSetFMUState;
+    std::string info_modex_canSerializeFMUState;
+    std::string info_modex_providesDirectionalDerivatives;
+    std::string info_modex_providesAdjointDerivatives;
+
+    bool has_scheduled_execution;
+    std::string info_sched_modelIdentifier;
+    std::string info_sched_needsExecutionTool;
+    std::string info_sched_canBeInstantiatedOnlyOncePerProcess;
 
-    std::map<std::string, FmuVariableTreeNode> children;
-    FmuVariableImport* leaf = nullptr;
+    std::vector<FmuClockImport> m_clocks;  ///< clocks, in order of declaration
 
-    FmuVariableTreeNode() {}
+    VarList m_variables;  ///< FMU variables (in lazy mode, only the ones accessed so far)
+
+    /// Entry of the index of FMU variables.
+    struct VariableEntry {
+        fmi3ValueReference valref;
+        FmuVariableImport* variable;       ///< FMU variable (null until created, in lazy mode)
+        const rapidxml::xml_node<>* node;  ///< XML node of the variable (lazy mode only)
+        bool is_state;                     ///< state flag, for the lazy creation of the variable
+    };
+
+    /// Value references, indexed by name. Keys refer to the names interned in FmuStringPool, thus not copied.
+    std::unordered_map<std::reference_wrapper<const std::string>,
+                       fmi3ValueReference,
+                       std::hash<std::string>,
+                       std::equal_to<std::string>>
+        m_valrefsByName;
+    std::vector<VariableEntry> m_variablesByValref;  ///< sorted by value reference
+
+    FmuVariableTree tree_variables;
+
+    /// Source of the model description: mapped file or in-memory buffer, and the XML document parsed from it.
+    /// Kept alive in lazy mode, since the index of variables refers to its nodes.
+    struct ModelDescriptionSource {
+        std::unique_ptr<MappedFile> file;  ///< memory-mapped model description file
+        std::vector<char> buffer;          ///< in-memory (null-terminated) model description, if no file
+        rapidxml::xml_document<> doc;
+
+        const char* text() const { return file ? file->data() : buffer.data(); }
+    };
+
+    std::string m_directory;
+    std::string m_bin_directory;
+
+    FmuType m_fmuType;
+
+    std::shared_ptr<ModelDescriptionSource> m_xml_source;  ///< model description kept alive in lazy mode
+
+    std::string m_archive;       ///< FMU archive, if loaded in memory (see LoadInMemory)
+    bool m_resources_extracted;  ///< resources of the FMU archive extracted in m_directory
+    std::mutex m_resources_mutex;
+
+    size_t m_nx;  ///< number of state variables
+
+    DYNLIB_HANDLE dynlib_handle;
+    FmuFunctions functions;  ///< FMI functions bound from the shared library
+
+    friend class FmuUnit;
 };
 
-// =============================================================================
+// -----------------------------------------------------------------------------
 
 /// Class for managing an impoerted FMU.
 /// Provides functions to parse the model description XML file, load the shared library in run-time, set/get variables,
 /// and invoke FMI functions on the FMU.
-class FmuUnit {
+class FmuUnit : public FmuFunctions {
   public:
-    // since FMI3.0 has unique varRefs we can use them for indexing instead of strings
-    typedef std::map<fmi3ValueReference, FmuVariableImport> VarList;
+    typedef FmuLibrary::VarList VarList;
 
     FmuUnit();
-    virtual ~FmuUnit() {}
+    virtual ~FmuUnit();
 
     /// Enable/disable verbose messages during FMU loading.
     void SetVerbose(bool verbose) { m_verbose = verbose; }
 
+    /// Enable/disable lazy loading of the model variables (default: disabled); to be set before loading the FMU.
+    /// In lazy mode the variable nodes of the model description are only indexed (value reference, name and state
+    /// flags) and each FmuVariableImport record is created on first access, keeping the model description in memory
+    /// in the meantime. Listing all variables (GetVariablesList) or the variables tree creates all records.
+    void SetLazyVariables(bool lazy) { m_lazy = lazy; }
+
+    /// Enable/disable the binary cache of the parsed model description (default: disabled).
+    /// When enabled, LoadUnzipped restores the model description from a compact binary file written next to
+    /// modelDescription.xml by a previous load, as long as it was created from an identical XML (same size and hash,
+    /// thus same instantiationToken); otherwise the XML is parsed and the cache is (re)written. A cache hit creates all
+    /// variable records, regardless of SetLazyVariables.
+    void SetModelDescriptionCache(bool enable) { m_xml_cache = enable; }
+
+    /// Trace the calls to the FMI functions of this FMU with the given tracer; to be set before loading the FMU.
+    /// The FMI function pointers (_fmi3XXX) are replaced by wrappers recording the latency of each call, in a tracer
+    /// channel named 'name' (default: model identifier). The same tracer can be shared by several FMUs.
+    void SetTracer(std::shared_ptr<FmuTracer> tracer, const std::string& name = "") {
+        m_tracer = tracer;
+        m_traceName = name;
+    }
+
+    /// Return the tracer channel of this FMU (nullptr if not traced).
+    const FmuTraceChannel* GetTraceChannel() const { return m_traceChannel; }
+
     /// Load the FMU, optionally defining where the FMU will be unzipped (default is the temporary folder).
     void Load(FmuType fmuType,
               const std::string& fmupath,
               const std::string& unzipdir = fs::temp_directory_path().generic_string() + std::string("/_fmu_temp"));
 
+    /// Load the FMU through the persistent extraction cache (see UnzipFmuCached).
+    /// An FMU already extracted by a previous load, possibly from another process, is not unzipped again.
+    /// The unzipped folder is shared and must not be modified.
+    void LoadCached(FmuType fmuType,
+                    const std::string& fmupath,
+                    const std::string& cachedir = fs::temp_directory_path().generic_string() +
+                                                  std::string("/_fmu_cache"));
+
+    /// Load the FMU without extracting its shared library to disk.
+    /// The model description and the shared library are read in memory directly from the FMU archive, and the
+    /// library is linked from memory (see RuntimeLinkLibraryFromMemory). The 'resources' folder of the archive, if
+    /// any, is extracted in 'resourcesdir' only when the FMU is instantiated with its default resource location.
+    void LoadInMemory(FmuType fmuType,
+                      const std::string& fmupath,
+                      const std::string& resourcesdir = fs::temp_directory_path().generic_string() +
+                                                        std::string("/_fmu_temp"));
+
+    /// Load only the model description, reading it in memory directly from the FMU archive.
+    /// The FMU is neither extracted nor linked: metadata and variables are available, but the FMU cannot be
+    /// instantiated. Use Load, LoadCached or LoadUnzipped to load the complete FMU.
+    void LoadModelDescription(const std::string& fmupath);
+
     /// Load the FMU from the specified directory, assuming it has been already unzipped.
     virtual void LoadUnzipped(FmuType fmuType, const std::string& directory);
 
+    /// Load the FMU from the library of another FmuUnit, already loaded (see GetLibrary).
+    /// The model description is not parsed and the shared library is not linked again: variables and FMI functions
+    /// are shared with the other units, and this unit only holds its own FMU instance. The FMU type and the folder of
+    /// the unzipped FMU are the ones of the library.
+    void LoadShared(std::shared_ptr<FmuLibrary> library);
+
+    /// Return the library of the loaded FMU, to be shared with other FmuUnit objects (see LoadShared).
+    /// In lazy mode all variable records are created first, since a shared library is never modified.
+    std::shared_ptr<FmuLibrary> GetLibrary();
+
     /// Return the folder in which the FMU has been unzipped.
-    std::string GetUnzippedFolder() const { return m_directory; }
+    std::string GetUnzippedFolder() const { return m_library->m_directory; }
 
     /// Return version number of header files.
     std::string GetVersion() const;
 
     /// Return the number of state variables.
-    size_t GetNumStates() const { return m_nx; }
+    size_t GetNumStates() const { return m_library->m_nx; }
+
+    /// Check if the FMU, as loaded, can be instantiated only once per process.
+    bool CanBeInstantiatedOnlyOncePerProcess() const {
+        const std::string& flag = m_library->m_fmuType == FmuType::MODEL_EXCHANGE
+                                      ? m_library->info_modex_canBeInstantiatedOnlyOncePerProcess
+                                  : m_library->m_fmuType == FmuType::SCHEDULED_EXECUTION
+                                      ? m_library->info_sched_canBeInstantiatedOnlyOncePerProcess
+                                      : m_library->info_cosim_canBeInstantiatedOnlyOncePerProcess;
+        return flag == "true";
+    }
+
+    /// Check if the Co-Simulation FMU, as loaded, can handle variable communication step sizes.
+    bool CanHandleVariableCommunicationStepSize() const {
+        return m_library->info_cosim_canHandleVariableCommunicationStepSize == "true";
+    }
+
+    /// Check if the FMU, as loaded, can get and set its state.
+    bool CanGetAndSetFMUState() const {
+        const std::string& flag = m_library->m_fmuType == FmuType::MODEL_EXCHANGE
+                                      ? m_library->info_modex_canGetAndSetFMUState
+                                      : m_library->info_cosim_canGetAndSetFMUState;
+        return flag == "true";
+    }
+
+    /// Return the maximum order of the output derivatives provided by the Co-Simulation FMU (0 if none).
+    int GetMaxOutputDerivativeOrder() const {
+        return std::atoi(m_library->info_cosim_maxOutputDerivativeOrder.c_str());
+    }
 
     /// Instantiate the model.
     void Instantiate(const std::string& instanceName,
@@ -134,32 +452,70 @@ class FmuUnit {
     void Instantiate(const std::string& instanceName, bool logging = false, bool visible = false);
 
     /// Get the list of FMU variables.
-    const VarList& GetVariablesList() const { return m_variables; }
+    const VarList& GetVariablesList() const {
+        materializeVariables();
+        return m_library->m_variables;
+    }
+
+    /// Get the FMU variable with the given value reference.
+    /// Throws an exception if the variable is not found.
+    const FmuVariableImport& GetVariableInfo(fmi3ValueReference valref) const { return findVariable(valref); }
 
     /// Get the value reference of a variable from its name.
     /// Throws an exception if the variable is not found.
     fmi3ValueReference GetValueReference(const std::string& varname) const {
-        for (auto& var : m_variables) {
-            if (var.second.GetName() == varname)
-                return var.first;
-        }
-        throw std::runtime_error("Variable not found: " + varname);
+        auto it = m_library->m_valrefsByName.find(varname);
+        if (it == m_library->m_valrefsByName.end())
+            throw std::runtime_error("Variable not found: " + varname);
+        return it->second;
     }
 
     /// Get the value reference of a variable from its name.
     /// Return true if the variable is found, false otherwise. No throw.
     bool GetValueReference(const std::string& varname, fmi3ValueReference& valueref) const noexcept(true) {
-        for (auto& var : m_variables) {
-            if (var.second.GetName() == varname) {
-                valueref = var.first;
-                return true;
-            }
-        }
-        return false;
+        auto it = m_library->m_valrefsByName.find(varname);
+        if (it == m_library->m_valrefsByName.end())
+            return false;
+        valueref = it->second;
+        return true;
     }
 
     /// Print the tree of variables
-    void PrintVariablesTree(int tab) { PrintVariablesTree(&tree_variables, tab); }
+    void PrintVariablesTree(int tab) { PrintVariablesTree(GetVariablesTree().Root(), tab); }
+
+    /// Return the trie of the variables, by their hierarchical names (e.g. for the variables under a given prefix).
+    /// In lazy mode, the trie is built on first use.
+    const FmuVariableTree& GetVariablesTree() {
+        if (m_library->tree_variables.Empty())
+            BuildVariablesTree();
+        return m_library->tree_variables;
+    }
+
+    /// Get the clocks of the FMU (ScheduledExecution interface).
+    const std::vector<FmuClockImport>& GetClocks() const { return m_library->m_clocks; }
+
+    /// Load the dependency graph of the unknowns from the <ModelStructure> element of the model description.
+    /// Unknowns listed more than once (e.g. an output that is also a state derivative) merge their dependencies.
+    void LoadDependencies();
+
+    /// Load the dependency graph of the outputs and of the continuous state derivatives from the instance
+    /// (fmi3GetVariableDependencies), taking into account the current values of the structural parameters.
+    /// Unknowns for which the FMU reports no dependency information are left undeclared.
+    /// Return fmi3Error, leaving the graph empty, if the FMU is not instantiated.
+    fmi3Status LoadDependenciesFromInstance();
+
+    /// Return the dependency graph (empty if not loaded, see LoadDependencies).
+    const FmuDependencyGraph& GetDependencies() const { return m_dependencies; }
+
+    /// Check if the unknown depends on the known, according to the dependency graph.
+    /// Return true (conservatively) if the dependencies of the unknown are not declared or not loaded.
+    bool DependsOn(fmi3ValueReference unknown, fmi3ValueReference known) const;
+
+    /// Return the inputs on which the output depends directly (all the inputs if its dependencies are not declared).
+    std::vector<fmi3ValueReference> GetFeedthroughInputs(fmi3ValueReference output) const;
+
+    /// Check if the output has direct feedthrough, i.e. depends directly on some input.
+    bool HasDirectFeedthrough(fmi3ValueReference output) const;
 
     /// Set debug logging level.
     fmi3Status SetDebugLogging(fmi3Boolean loggingOn, const std::vector<std::string>& logCategories);
@@ -173,12 +529,80 @@ class FmuUnit {
 
     fmi3Status ExitInitializationMode();
 
+    /// Bring the instance back to a clean start state for a new run, avoiding a new instantiation: reset the FMU,
+    /// set again the start values of the model description (structural parameters first), then enter the
+    /// initialization mode. Only the variables that can be set while instantiated are set; the values are parsed
+    /// once and reused by later calls.
+    fmi3Status Recycle(fmi3Boolean toleranceDefined,
+                       fmi3Float64 tolerance,
+                       fmi3Float64 startTime,
+                       fmi3Boolean stopTimeDefined,
+                       fmi3Float64 stopTime);
+
+    /// Enable a ring of 'capacity' checkpoints of the FMU state (see Checkpoint and Rollback), optionally keeping
+    /// each checkpoint also in serialized form. The FMU state handles are allocated here, on the current instance,
+    /// and then overwritten in place by each checkpoint.
+    /// Return false, leaving checkpoints disabled, if the FMU does not declare canGetAndSetFMUState (or
+    /// canSerializeFMUState, if 'serialize' is requested).
+    bool EnableCheckpoints(size_t capacity, bool serialize = false);
+
+    /// Free the FMU state handles of the checkpoints. Handles are owned by the instance: this must be called before
+    /// freeing the instance only to release them earlier.
+    void DisableCheckpoints();
+
+    /// Check if checkpoints are enabled (see EnableCheckpoints).
+    bool HasCheckpoints() const { return !m_checkpoints.empty(); }
+
+    /// Save the FMU state, at the given time, as the most recent checkpoint; the oldest checkpoint is overwritten
+    /// once the ring is full.
+    fmi3Status Checkpoint(fmi3Float64 time = 0);
+
+    /// Restore the FMU state of the n-th most recent checkpoint (0: the last one); the more recent checkpoints are
+    /// discarded, while the restored one is kept, so that a rejected step can be rolled back again.
+    fmi3Status Rollback(size_t n = 0);
+
+    /// Return the number of checkpoints available for Rollback.
+    size_t GetNumCheckpoints() const { return m_checkpointCount; }
+
+    /// Return the time of the n-th most recent checkpoint (0: the last one).
+    fmi3Float64 GetCheckpointTime(size_t n = 0) const { return checkpointSlot(n).time; }
+
+    /// Return the serialized FMU state of the n-th most recent checkpoint (empty if serialization is disabled).
+    const std::vector<fmi3Byte>& GetSerializedCheckpoint(size_t n = 0) const { return checkpointSlot(n).serialized; }
+
+    /// Return the memory used by the most recent checkpoint, in bytes, as the size of its serialized FMU state
+    /// (0 if there are no checkpoints or the FMU cannot serialize its state).
+    size_t GetCheckpointMemory() const;
+
     /// Advance state of the FMU from currentCommunicationPoint to currentCommunicationPoint+communicationStepSize.
     /// Available only for an FMU that implements the Co-Simulation interface.
     fmi3Status DoStep(fmi3Float64 currentCommunicationPoint,
                       fmi3Float64 communicationStepSize,
                       fmi3Boolean noSetFMUStatePriorToCurrentPoint);
 
+    /// Allow DoStepAsync on an FMU known to be thread-safe per instance, even if its model description does not
+    /// declare canRunAsynchronuously (default: disabled).
+    void SetAsyncStepAllowed(bool allowed) { m_asyncStepAllowed = allowed; }
+
+    /// Start DoStep on a worker thread dedicated to this FMU instance and return immediately, so that the caller can
+    /// overlap its own computations with the step. No other function of this FMU must be called until the returned
+    /// handle reports the step as completed (see FmuStepHandle::Wait).
+    /// Available only for a Co-Simulation FMU declaring canRunAsynchronuously, or allowed by SetAsyncStepAllowed.
+    FmuStepHandle DoStepAsync(fmi3Float64 currentCommunicationPoint,
+                              fmi3Float64 communicationStepSize,
+                              fmi3Boolean noSetFMUStatePriorToCurrentPoint);
+
+    /// Advance state of the FMU, as DoStep, also returning the event and early return flags.
+    /// The FMU may return early (see 'lastSuccessfulTime') only if early_return_allowed was set before Instantiate and
+    /// the intermediate_update_callback requested it.
+    fmi3Status DoStep(fmi3Float64 currentCommunicationPoint,
+                      fmi3Float64 communicationStepSize,
+                      fmi3Boolean noSetFMUStatePriorToCurrentPoint,
+                      fmi3Boolean* eventHandlingNeeded,
+                      fmi3Boolean* terminateSimulation,
+                      fmi3Boolean* earlyReturn,
+                      fmi3Float64* lastSuccessfulTime);
+
     /// Set a new time instant and re-initialize caching of variables that depend on time.
     /// Available only for an FMU that implements the Model Exchange interface.
     fmi3Status SetTime(const fmi3Float64 time);
@@ -196,46 +620,41 @@ class FmuUnit {
     /// Available only for an FMU that iplements the Model Exchange interface.
     fmi3Status GetContinuousStateDerivatives(fmi3Float64 derivatives[], size_t nx);
 
-    /// Get the current dimensions of a variable.
-    std::vector<size_t> GetVariableDimensions(const FmuVariable& var) const {
-        auto dim = var.GetDimensions();
+    /// Run the model partition activated by the given clock, at the given time.
+    /// Available only for an FMU loaded as ScheduledExecution; partitions of different clocks can be activated
+    /// concurrently, from different threads.
+    fmi3Status ActivateModelPartition(fmi3ValueReference clockReference, fmi3Float64 activationTime);
 
+    /// Get the current dimensions of a variable.
+    /// Dimensions are resolved once and cached until a structural parameter is set (see InvalidateVariableSizes).
+    const std::vector<size_t>& GetVariableDimensions(const FmuVariable& var) const {
         // case of scalar variable
-        if (dim.size() == 0)
-            return std::vector<size_t>({1});
-
-        std::vector<size_t> sizes;
-        for (const auto& d : dim) {
-            if (d.second == true)
-                // the size of the current dimension is fixed
-                sizes.push_back(d.first);
-            else {
-                // the size of the current dimension is given by another variable
-                size_t cur_size;
-                GetVariable(static_cast<fmi3ValueReference>(d.first), cur_size);
-                sizes.push_back(cur_size);
-            }
-        }
+        static const std::vector<size_t> scalar_dimensions = {1};
+        if (var.IsScalar())
+            return scalar_dimensions;
 
-        return sizes;
+        return getVariableShape(var).dimensions;
     }
 
-    std::vector<size_t> GetVariableDimensions(fmi3ValueReference valref) const {
-        return GetVariableDimensions(m_variables.at(valref));
+    const std::vector<size_t>& GetVariableDimensions(fmi3ValueReference valref) const {
+        return GetVariableDimensions(findVariable(valref));
     }
+
     /// Get the current total size of a variable.
     size_t GetVariableSize(const FmuVariable& var) const {
-        if (var.GetDimensions().size() == 0)
+        if (var.IsScalar())
             return 1;
 
-        size_t size = 1;
-        for (const auto& dim : GetVariableDimensions(var)) {
-            size *= dim;
-        }
-        return size;
+        return getVariableShape(var).size;
     };
 
-    size_t GetVariableSize(fmi3ValueReference valref) const { return GetVariableSize(m_variables.at(valref)); }
+    size_t GetVariableSize(fmi3ValueReference valref) const { return GetVariableSize(findVariable(valref)); }
+
+    /// Discard the cached dimensions of the variables.
+    /// Automatically called when a structural parameter is set through SetVariable or FmuVariableGroup and when
+    /// instantiating or initializing the FMU; it must be called if structural parameters are set through the raw
+    /// _fmi3Set functions.
+    void InvalidateVariableSizes() { m_variableShapes.clear(); }
 
     /// Set the value of a variable.
     /// Values will be fetched from 'values' assuming its dimensions, memory alignment and allocation are according
@@ -262,6 +681,15 @@ class FmuUnit {
 
     fmi3Status SetVariable(fmi3ValueReference vr, const std::vector<std::string>& values_vect) noexcept(false);
 
+    /// Set the value of a scalar fmi3String variable.
+    fmi3Status SetVariable(fmi3ValueReference vr, const std::string& value) noexcept(false);
+
+    /// Set the value of a scalar fmi3Binary variable from a view of its bytes; no copy happens.
+    fmi3Status SetVariable(fmi3ValueReference vr, const FmuBinaryView& value) noexcept(false);
+
+    /// Set the value of an array of fmi3Binary variables from views of the bytes of its elements; no copy happens.
+    fmi3Status SetVariable(fmi3ValueReference vr, const std::vector<FmuBinaryView>& values) noexcept(false);
+
     /// Get the value of a variable.
     /// The 'values' pointer could either point to single scalar variable or to an array of variables.
     /// In this latter case, the array should be pre-allocated with size given by GetVariableSize(); at this point, such
@@ -337,6 +765,17 @@ class FmuUnit {
     /// Get the value from an array of fmi3String variable in the shape of an std::vector<std::string>.
     fmi3Status GetVariable(fmi3ValueReference vr, std::vector<std::string>& values_vect) const noexcept(false);
 
+    /// Get the value of a scalar fmi3String variable, copied in 'value' (reusing its storage).
+    fmi3Status GetVariable(fmi3ValueReference vr, std::string& value) const noexcept(false);
+
+    /// Get a view of the bytes of a scalar fmi3Binary variable; no copy happens.
+    /// As allowed by the FMI standard, the view is valid only until the next call to a function of the FMU.
+    fmi3Status GetVariable(fmi3ValueReference vr, FmuBinaryView& value) const noexcept(false);
+
+    /// Get views of the bytes of the elements of an array of fmi3Binary variables; no copy happens.
+    /// As allowed by the FMI standard, the views are valid only until the next call to a function of the FMU.
+    fmi3Status GetVariable(fmi3ValueReference vr, std::vector<FmuBinaryView>& values) const noexcept(false);
+
     template <typename... Args>
     fmi3Status SetVariable(const std::string& str, Args&&... args) {
         fmi3ValueReference vr = GetValueReference(str);
@@ -350,150 +789,321 @@ class FmuUnit {
     }
 
   protected:
-    std::string modelName;
-    std::string instantiationToken;
-    std::string fmiVersion;
-    std::string description;
-    std::string generationTool;
-    std::string generationDateAndTime;
-    std::string variableNamingConvention;
-    std::string numberOfEventIndicators;
+    // Attributes of the model description, as parsed; they are stored in the library shared by all the units of the
+    // same FMU and read-only for derived classes.
+    const std::string& modelName() const { return m_library->modelName; }
+    const std::string& instantiationToken() const { return m_library->instantiationToken; }
+    const std::string& fmiVersion() const { return m_library->fmiVersion; }
+    const std::string& description() const { return m_library->description; }
+    const std::string& generationTool() const { return m_library->generationTool; }
+    const std::string& generationDateAndTime() const { return m_library->generationDateAndTime; }
+    const std::string& variableNamingConvention() const { return m_library->variableNamingConvention; }
+    const std::string& numberOfEventIndicators() const { return m_library->numberOfEventIndicators; }
+
+    bool has_cosimulation() const { return m_library->has_cosimulation; }
+    const std::string& info_cosim_modelIdentifier() const { return m_library->info_cosim_modelIdentifier; }
+    const std::string& info_cosim_needsExecutionTool() const { return m_library->info_cosim_needsExecutionTool; }
+    const std::string& info_cosim_canHandleVariableCommunicationStepSize() const {
+        return m_library->info_cosim_canHandleVariableCommunicationStepSize;
+    }
+    const std::string& info_cosim_canInterpolateInputs() const { return m_library->info_cosim_canInterpolateInputs; }
+    const std::string& info_cosim_maxOutputDerivativeOrder() const {
+        return m_library->info_cosim_maxOutputDerivativeOrder;
+    }
+    const std::string& info_cosim_canRunAsynchronuously() const { return m_library->info_cosim_canRunAsynchronuously; }
+    const std::string& info_cosim_canBeInstantiatedOnlyOncePerProcess() const {
+        return m_library->info_cosim_canBeInstantiatedOnlyOncePerProcess;
+    }
+    const std::string& info_cosim_canNotUseMemoryManagementFunctions() const {
+        return m_library->info_cosim_canNotUseMemoryManagementFunctions;
+    }
+    const std::string& info_cosim_canGetAndSetFMUState() const { return m_library->info_cosim_canGetAndSetFMUState; }
+    const std::string& info_cosim_canSerializeFMUState() const { return m_library->info_cosim_canSerializeFMUState; }
+
+    bool has_model_exchange() const { return m_library->has_model_exchange; }
+    const std::string& info_modex_modelIdentifier() const { return m_library->info_modex_modelIdentifier; }
+    const std::string& info_modex_needsExecutionTool() const { return m_library->info_modex_needsExecutionTool; }
+    const std::string& info_modex_completedIntegratorStepNotNeeded() const {
+        return m_library->info_modex_completedIntegratorStepNotNeeded;
+    }
+    const std::string& info_modex_canBeInstantiatedOnlyOncePerProcess() const {
+        return m_library->info_modex_canBeInstantiatedOnlyOncePerProcess;
+    }
+    const std::string& info_modex_canNotUseMemoryManagementFunctions() const {
+        return m_library->info_modex_canNotUseMemoryManagementFunctions;
+    }
+    const std::string& info_modex_canGetAndSetFMUState() const { return m_library->info_modex_canGetAndSetFMUState; }
+    const std::string& info_modex_canSerializeFMUState() const { return m_library->info_modex_canSerializeFMUState; }
+    const std::string& info_modex_providesDirectionalDerivatives() const {
+        return m_library->info_modex_providesDirectionalDerivatives;
+    }
+    const std::string& info_modex_providesAdjointDerivatives() const {
+        return m_library->info_modex_providesAdjointDerivatives;
+    }
 
-    bool has_cosimulation;
-    std::string info_cosim_modelIdentifier;
-    std::string info_cosim_needsExecutionTool;
-    std::string info_cosim_canHandleVariableCommunicationStepSize;
-    std::string info_cosim_canInterpolateInputs;
-    std::string info_cosim_maxOutputDerivativeOrder;
-    std::string info_cosim_canRunAsynchronuously;
-    std::string info_cosim_canBeInstantiatedOnlyOncePerProcess;
-    std::string info_cosim_canNotUseMemoryManagementFunctions;
-    std::string info_cosim_canGetAndSetFMUstate;
-    std::string info_cosim_canSerializeFMUstate;
+    bool has_scheduled_execution() const { return m_library->has_scheduled_execution; }
+    const std::string& info_sched_modelIdentifier() const { return m_library->info_sched_modelIdentifier; }
+    const std::string& info_sched_needsExecutionTool() const { return m_library->info_sched_needsExecutionTool; }
+    const std::string& info_sched_canBeInstantiatedOnlyOncePerProcess() const {
+        return m_library->info_sched_canBeInstantiatedOnlyOncePerProcess;
+    }
 
-    bool has_model_exchange;
-    std::string info_modex_modelIdentifier;
-    std::string info_modex_needsExecutionTool;
-    std::string info_modex_completedIntegratorStepNotNeeded;
-    std::string info_modex_canBeInstantiatedOnlyOncePerProcess;
-    std::string info_modex_canNotUseMemoryManagementFunctions;
-    std::string info_modex_canGetAndSetFMUState;
-    std::string info_modex_canSerializeFMUstate;
-    std::string info_modex_providesDirectionalDerivative;
+    /// Resolved dimensions of an array variable.
+    struct FmuVariableShape {
+        std::vector<size_t> dimensions;
+        size_t size;
+    };
 
-    bool has_scheduled_execution;
+    /// Get the resolved dimensions of an array variable, evaluating them if not cached.
+    const FmuVariableShape& getVariableShape(const FmuVariable& var) const {
+        auto it_shape = m_variableShapes.find(var.GetValueReference());
+        if (it_shape != m_variableShapes.end())
+            return it_shape->second;
+
+        FmuVariableShape shape;
+        shape.size = 1;
+        for (const auto& d : var.GetDimensions()) {
+            if (d.second == true)
+                // the size of the current dimension is fixed
+                shape.dimensions.push_back(d.first);
+            else {
+                // the size of the current dimension is given by another variable
+                size_t cur_size;
+                GetVariable(static_cast<fmi3ValueReference>(d.first), cur_size);
+                shape.dimensions.push_back(cur_size);
+            }
+            shape.size *= shape.dimensions.back();
+        }
+
+        return m_variableShapes.emplace(var.GetValueReference(), std::move(shape)).first->second;
+    }
+
+    /// Invalidate the cached dimensions if the variable being set is a structural parameter.
+    void onSetVariable(const FmuVariable& var) {
+        if (var.GetCausality() == FmuVariable::CausalityType::structuralParameter)
+            InvalidateVariableSizes();
+    }
+
+    mutable std::unordered_map<fmi3ValueReference, FmuVariableShape> m_variableShapes;  ///< cached array dimensions
+
+    // Buffers of the string and binary exchanges, reused across calls to avoid allocations
+    mutable std::vector<fmi3String> m_stringBuffer;
+    mutable std::vector<fmi3Binary> m_binaryBuffer;
+    mutable std::vector<size_t> m_binarySizeBuffer;
+
+    /// Start value of a variable, converted to the type of the variable (see Recycle).
+    struct StartValue {
+        fmi3ValueReference valref;
+        FmuVariable::Type type;
+        size_t count;                                ///< number of values
+        std::vector<fmi3Byte> data;                  ///< values of numeric and Boolean variables
+        std::vector<std::string> strings;            ///< values of String variables
+        std::vector<std::vector<fmi3Byte>> binaries;  ///< values of Binary variables
+    };
+
+    /// Convert the start values of the settable variables, structural parameters first.
+    void prepareStartValues();
+
+    /// Set a start value through the fmi3Set function of its type.
+    fmi3Status applyStartValue(const StartValue& start);
+
+    std::vector<StartValue> m_startValues;  ///< start values set by Recycle
+    bool m_startValuesPrepared = false;
+
+    /// Slot of the checkpoint ring (see EnableCheckpoints).
+    struct CheckpointSlot {
+        fmi3FMUState state = nullptr;      ///< FMU state handle, overwritten in place by each checkpoint
+        std::vector<fmi3Byte> serialized;  ///< serialized FMU state (if enabled)
+        fmi3Float64 time = 0;
+    };
+
+    /// Return the slot of the n-th most recent checkpoint.
+    const CheckpointSlot& checkpointSlot(size_t n) const;
 
-    VarList m_variables;  ///< FMU variables
+    std::vector<CheckpointSlot> m_checkpoints;  ///< checkpoint ring, empty if disabled
+    size_t m_checkpointNext = 0;                ///< slot of the next checkpoint
+    size_t m_checkpointCount = 0;               ///< number of valid checkpoints
+    bool m_checkpointSerialize = false;         ///< keep the checkpoints also in serialized form
 
-    FmuVariableTreeNode tree_variables;
+    /// Dependencies of an unknown (independent and kind), null if not declared.
+    typedef std::unique_ptr<std::vector<std::pair<fmi3ValueReference, fmi3DependencyKind>>> DependencyRow;
+
+    /// Build the dependency graph from the dependencies of each unknown.
+    void buildDependencies(std::map<fmi3ValueReference, DependencyRow>& rows);
+
+    FmuDependencyGraph m_dependencies;         ///< dependency graph (see LoadDependencies)
+    std::vector<fmi3ValueReference> m_inputs;  ///< input variables, by value reference (with the dependency graph)
 
   public:
     fmi3LogMessageCallback log_message_callback;
     fmi3ClockUpdateCallback clock_update_callback;
-    fmi3IntermediateUpdateCallback intermediate_update_callback;
+    fmi3IntermediateUpdateCallback intermediate_update_callback;  ///< receives this FmuUnit as instance environment
     fmi3LockPreemptionCallback lock_preemption_callback;
     fmi3UnlockPreemptionCallback unlock_preemption_callback;
+    bool early_return_allowed;  ///< allow a Co-Simulation FMU to return early from DoStep
 
     fmi3Instance instance;
 
-    fmi3GetVersionTYPE* _fmi3GetVersion;
-    fmi3SetDebugLoggingTYPE* _fmi3SetDebugLogging;
-    fmi3InstantiateModelExchangeTYPE* _fmi3InstantiateModelExchange;
-    fmi3InstantiateCoSimulationTYPE* _fmi3InstantiateCoSimulation;
-    fmi3InstantiateScheduledExecutionTYPE* _fmi3InstantiateScheduledExecution;
-    fmi3FreeInstanceTYPE* _fmi3FreeInstance;
-    fmi3EnterInitializationModeTYPE* _fmi3EnterInitializationMode;
-    fmi3ExitInitializationModeTYPE* _fmi3ExitInitializationMode;
-    fmi3EnterEventModeTYPE* _fmi3EnterEventMode;
-    fmi3TerminateTYPE* _fmi3Terminate;
-    fmi3ResetTYPE* _fmi3Reset;
-    fmi3GetFloat32TYPE* _fmi3GetFloat32;
-    fmi3GetFloat64TYPE* _fmi3GetFloat64;
-    fmi3GetInt8TYPE* _fmi3GetInt8;
-    fmi3GetUInt8TYPE* _fmi3GetUInt8;
-    fmi3GetInt16TYPE* _fmi3GetInt16;
-    fmi3GetUInt16TYPE* _fmi3GetUInt16;
-    fmi3GetInt32TYPE* _fmi3GetInt32;
-    fmi3GetUInt32TYPE* _fmi3GetUInt32;
-    fmi3GetInt64TYPE* _fmi3GetInt64;
-    fmi3GetUInt64TYPE* _fmi3GetUInt64;
-    fmi3GetBooleanTYPE* _fmi3GetBoolean;
-    fmi3GetStringTYPE* _fmi3GetString;
-    fmi3GetBinaryTYPE* _fmi3GetBinary;
-    fmi3GetClockTYPE* _fmi3GetClock;
-    fmi3SetFloat32TYPE* _fmi3SetFloat32;
-    fmi3SetFloat64TYPE* _fmi3SetFloat64;
-    fmi3SetInt8TYPE* _fmi3SetInt8;
-    fmi3SetUInt8TYPE* _fmi3SetUInt8;
-    fmi3SetInt16TYPE* _fmi3SetInt16;
-    fmi3SetUInt16TYPE* _fmi3SetUInt16;
-    fmi3SetInt32TYPE* _fmi3SetInt32;
-    fmi3SetUInt32TYPE* _fmi3SetUInt32;
-    fmi3SetInt64TYPE* _fmi3SetInt64;
-    fmi3SetUInt64TYPE* _fmi3SetUInt64;
-    fmi3SetBooleanTYPE* _fmi3SetBoolean;
-    fmi3SetStringTYPE* _fmi3SetString;
-    fmi3SetBinaryTYPE* _fmi3SetBinary;
-    fmi3SetClockTYPE* _fmi3SetClock;
-    fmi3GetNumberOfVariableDependenciesTYPE* _fmi3GetNumberOfVariableDependencies;
-    fmi3GetVariableDependenciesTYPE* _fmi3GetVariableDependencies;
-    fmi3GetFMUStateTYPE* _fmi3GetFMUState;
-    fmi3SetFMUStateTYPE* _fmi3SetFMUState;
-    fmi3FreeFMUStateTYPE* _fmi3FreeFMUState;
-    fmi3SerializedFMUStateSizeTYPE* _fmi3SerializedFMUStateSize;
-    fmi3SerializeFMUStateTYPE* _fmi3SerializeFMUState;
-    fmi3DeserializeFMUStateTYPE* _fmi3DeserializeFMUState;
-    fmi3GetDirectionalDerivativeTYPE* _fmi3GetDirectionalDerivative;
-    fmi3GetAdjointDerivativeTYPE* _fmi3GetAdjointDerivative;
-    fmi3EnterConfigurationModeTYPE* _fmi3EnterConfigurationMode;
-    fmi3ExitConfigurationModeTYPE* _fmi3ExitConfigurationMode;
-    fmi3GetIntervalDecimalTYPE* _fmi3GetIntervalDecimal;
-    fmi3GetIntervalFractionTYPE* _fmi3GetIntervalFraction;
-    fmi3GetShiftDecimalTYPE* _fmi3GetShiftDecimal;
-    fmi3GetShiftFractionTYPE* _fmi3GetShiftFraction;
-    fmi3SetIntervalDecimalTYPE* _fmi3SetIntervalDecimal;
-    fmi3SetIntervalFractionTYPE* _fmi3SetIntervalFraction;
-    fmi3SetShiftDecimalTYPE* _fmi3SetShiftDecimal;
-    fmi3SetShiftFractionTYPE* _fmi3SetShiftFraction;
-    fmi3EvaluateDiscreteStatesTYPE* _fmi3EvaluateDiscreteStates;
-    fmi3UpdateDiscreteStatesTYPE* _fmi3UpdateDiscreteStates;
-    fmi3EnterContinuousTimeModeTYPE* _fmi3EnterContinuousTimeMode;
-    fmi3CompletedIntegratorStepTYPE* _fmi3CompletedIntegratorStep;
-    fmi3SetTimeTYPE* _fmi3SetTime;
-    fmi3SetContinuousStatesTYPE* _fmi3SetContinuousStates;
-    fmi3GetContinuousStateDerivativesTYPE* _fmi3GetContinuousStateDerivatives;
-    fmi3GetEventIndicatorsTYPE* _fmi3GetEventIndicators;
-    fmi3GetContinuousStatesTYPE* _fmi3GetContinuousStates;
-    fmi3GetNominalsOfContinuousStatesTYPE* _fmi3GetNominalsOfContinuousStates;
-    fmi3GetNumberOfEventIndicatorsTYPE* _fmi3GetNumberOfEventIndicators;
-    fmi3GetNumberOfContinuousStatesTYPE* _fmi3GetNumberOfContinuousStates;
-    fmi3EnterStepModeTYPE* _fmi3EnterStepMode;
-    fmi3GetOutputDerivativesTYPE* _fmi3GetOutputDerivatives;
-    fmi3DoStepTYPE* _fmi3DoStep;
-    fmi3ActivateModelPartitionTYPE* _fmi3ActivateModelPartition;
-
   private:
-    /// Parse XML and create the list of variables.
+    typedef FmuLibrary::VariableEntry VariableEntry;
+    typedef FmuLibrary::ModelDescriptionSource ModelDescriptionSource;
+
+    /// Read the model description file from the unzipped folder and parse it.
     void LoadXML();
 
+    /// Parse the model description and create the list (or, in lazy mode, the index) of variables.
+    void ParseXML(const std::shared_ptr<ModelDescriptionSource>& source);
+
+    /// Create the FMU variable described by the given XML node.
+    FmuVariableImport parseVariable(const rapidxml::xml_node<>* var_node) const;
+
+    /// Create the records of all variables not yet accessed (lazy mode) and release the model description.
+    void materializeVariables() const;
+
+    /// Return the model description attributes stored as strings, in a fixed order.
+    std::vector<std::string*> modelDescriptionStrings();
+
+    /// Restore the parsed model description from the binary cache file.
+    /// Return false, leaving the FMU unchanged, if the cache is missing, corrupted or does not match the given key.
+    bool LoadXMLCache(const std::string& cache_filename, uint64_t xml_size, uint64_t xml_hash);
+
+    /// Write the parsed model description to the binary cache file. Failures (e.g. read-only folder) are ignored.
+    void SaveXMLCache(const std::string& cache_filename, uint64_t xml_size, uint64_t xml_hash);
+
     /// Load the shared library in run-time and do the dynamic linking to the required FMU functions.
     void LoadSharedLibrary(FmuType fmuType);
 
+    /// Check that the FMU supports the given interface type.
+    void CheckFmuType(FmuType fmuType) const;
+
+    /// Extract the resources of an FMU loaded in memory, if not done already.
+    void ExtractResources();
+
     /// Construct a tree of variables from the flat variable list.
     void BuildVariablesTree();
 
+    /// Construct the lookup tables (by name and by value reference) from the flat variable list.
+    void BuildVariablesIndex();
+
+    /// Find a variable by its value reference.
+    /// Throws std::out_of_range if the variable is not found.
+    FmuVariableImport& findVariable(fmi3ValueReference vr);
+    const FmuVariableImport& findVariable(fmi3ValueReference vr) const;
+    VariableEntry& findEntry(fmi3ValueReference vr) const;
+
+    /// Bind the FMI functions of the library to this unit, interposing the tracer if any.
+    void BindFunctions(const std::string& modelIdentifier);
+
     /// Print the tree of variables (recursive).
-    void PrintVariablesTree(FmuVariableTreeNode* mynode, int tab);
+    void PrintVariablesTree(FmuVariableTree::NodeId node, int tab);
 
-    std::string m_directory;
-    std::string m_bin_directory;
+    std::shared_ptr<FmuLibrary> m_library;  ///< model description, variables and shared library
 
-    FmuType m_fmuType;
     bool m_verbose;
+    bool m_lazy;       ///< lazy creation of the variable records
+    bool m_xml_cache;  ///< use the binary cache of the parsed model description
 
-    size_t m_nx;  ///< number of state variables
+    bool m_asyncStepAllowed;
+    std::unique_ptr<FmuStepWorker> m_stepWorker;  ///< created by the first DoStepAsync
 
-    DYNLIB_HANDLE dynlib_handle;
+    std::shared_ptr<FmuTracer> m_tracer;  ///< tracer of the FMI calls (optional)
+    std::string m_traceName;
+    FmuTraceChannel* m_traceChannel;
+};
+
+// -----------------------------------------------------------------------------
+
+/// Group of FMU variables that are exchanged together with an imported FMU.
+/// Variables are partitioned by type and their values are stored in contiguous buffers, so that Fetch() and Push()
+/// issue a single fmi3Get|fmi3Set call for each variable type in the group, regardless of the number of variables.
+/// Sizes of array variables are evaluated when the group is created: if they depend on structural parameters, the
+/// group must be created again once these parameters are changed.
+class FmuVariableGroup {
+  public:
+    /// Create a group of variables from their names.
+    FmuVariableGroup(FmuUnit& fmu, const std::vector<std::string>& varnames);
+
+    /// Create a group of variables from their value references.
+    FmuVariableGroup(FmuUnit& fmu, const std::vector<fmi3ValueReference>& valrefs);
+
+    /// Get the values of all the variables in the group from the FMU.
+    fmi3Status Fetch();
+
+    /// Set the values of all the variables in the group into the FMU.
+    fmi3Status Push();
+
+    /// Return the number of variables in the group.
+    size_t GetNumVariables() const { return m_members.size(); }
+
+    /// Return the number of values of the i-th variable of the group.
+    size_t GetSize(size_t i) const { return m_members[i].size; }
+
+    /// Return the type of the i-th variable of the group.
+    FmuVariable::Type GetType(size_t i) const { return m_blocks[m_members[i].block].type; }
+
+    /// Return an untyped pointer to the values of the i-th variable of the group.
+    /// The values take GetSize(i) * FmuVariable::GetTypeSize(GetType(i)) bytes.
+    void* RawValues(size_t i) {
+        const Member& member = m_members[i];
+        TypeBlock& block = m_blocks[member.block];
+        return reinterpret_cast<char*>(block.buffer.data()) + member.offset * FmuVariable::GetTypeSize(block.type);
+    }
+
+    /// Return a pointer to the values of the i-th variable of the group.
+    /// T must match the FMI type of the variable (e.g. fmi3Float64 for a Float64 variable).
+    template <class T>
+    T* Values(size_t i) {
+        const Member& member = m_members[i];
+        assert(sizeof(T) == FmuVariable::GetTypeSize(m_blocks[member.block].type) &&
+               "Wrong type requested for FMU variable.");
+        return reinterpret_cast<T*>(m_blocks[member.block].buffer.data()) + member.offset;
+    }
+
+    /// Return the value (or the k-th value, for array variables) of the i-th variable of the group.
+    template <class T>
+    T GetValue(size_t i, size_t k = 0) {
+        return Values<T>(i)[k];
+    }
+
+    /// Set the value (or the k-th value, for array variables) of the i-th variable of the group.
+    /// The value is sent to the FMU only with the next call to Push().
+    template <class T>
+    void SetValue(size_t i, const T& value, size_t k = 0) {
+        Values<T>(i)[k] = value;
+    }
+
+    /// Return the sizes of the values of the i-th variable of the group (only for Binary variables).
+    /// Sizes are updated by Fetch() and must be set by the user before calling Push().
+    size_t* BinarySizes(size_t i) {
+        const Member& member = m_members[i];
+        return m_blocks[member.block].valueSizes.data() + member.offset;
+    }
+
+  private:
+    /// Variables of the group sharing the same type.
+    struct TypeBlock {
+        FmuVariable::Type type;
+        std::vector<fmi3ValueReference> valrefs;  ///< value references of the variables in the block
+        size_t nValues = 0;                       ///< total number of values of the variables in the block
+        std::vector<std::uint64_t> buffer;        ///< storage for the values (8-byte aligned)
+        std::vector<size_t> valueSizes;           ///< sizes of the values (only for Binary variables)
+    };
+
+    /// Location of a variable within the type blocks.
+    struct Member {
+        size_t block;   ///< index of the type block
+        size_t offset;  ///< offset of the first value within the block buffer
+        size_t size;    ///< number of values
+    };
+
+    void addVariable(fmi3ValueReference vr);
+    void allocate();
+
+    FmuUnit& m_fmu;
+    std::vector<Member> m_members;
+    std::vector<TypeBlock> m_blocks;
+    std::array<int, static_cast<size_t>(FmuVariable::Type::Unknown)> m_blockIndex;  ///< block of each type (-1: none)
+    bool m_structural = false;  ///< the group contains structural parameters
 };
 
 // -----------------------------------------------------------------------------
@@ -512,9 +1122,29 @@ bool areStringsEqual(const char* str, size_t strSize, const char* fixedString) {
     }
 }
 
-FmuUnit::FmuUnit() : has_cosimulation(false), has_model_exchange(false), m_nx(0), m_verbose(false) {
-    // default binaries directory in FMU unzipped directory
-    m_bin_directory = "/binaries/" + std::string(FMI3_PLATFORM);
+FmuUnit::FmuUnit()
+    : FmuFunctions(),
+      m_library(std::make_shared<FmuLibrary>()),
+      m_verbose(false),
+      m_lazy(false),
+      m_xml_cache(false),
+      m_asyncStepAllowed(false),
+      m_traceChannel(nullptr) {
+    clock_update_callback = nullptr;
+    intermediate_update_callback = nullptr;
+    lock_preemption_callback = nullptr;
+    unlock_preemption_callback = nullptr;
+    early_return_allowed = false;
+    instance = nullptr;
+}
+
+FmuUnit::~FmuUnit() {
+    // complete any asynchronous step before releasing this unit
+    m_stepWorker.reset();
+
+    // the instance is not freed: just stop tracing it
+    if (m_traceChannel && instance && FmuTracer::FindChannel(instance) == m_traceChannel)
+        FmuTracer::UnregisterInstance(instance);
 }
 
 void FmuUnit::Load(FmuType fmuType, const std::string& filepath, const std::string& unzipdir) {
@@ -532,9 +1162,48 @@ void FmuUnit::Load(FmuType fmuType, const std::string& filepath, const std::stri
     }
 }
 
+void FmuUnit::LoadModelDescription(const std::string& fmupath) {
+    if (m_verbose)
+        std::cout << "Reading model description from FMU: " << fmupath << std::endl;
+
+    auto source = std::make_shared<ModelDescriptionSource>();
+    source->buffer = ReadFmuArchiveEntry(fmupath, "modelDescription.xml");
+
+    m_library = std::make_shared<FmuLibrary>();
+    ParseXML(source);
+}
+
+void FmuUnit::LoadCached(FmuType fmuType, const std::string& fmupath, const std::string& cachedir) {
+    std::string unzipdir = UnzipFmuCached(fmupath, cachedir);
+
+    if (m_verbose) {
+        std::cout << "Loading FMU: " << fmupath << std::endl;
+        std::cout << "  cached in: " << unzipdir << std::endl;
+    }
+
+    LoadUnzipped(fmuType, unzipdir);
+}
+
+void FmuUnit::LoadInMemory(FmuType fmuType, const std::string& fmupath, const std::string& resourcesdir) {
+    LoadModelDescription(fmupath);
+
+    m_library->m_fmuType = fmuType;
+    m_library->m_directory = resourcesdir;
+    m_library->m_archive = fmupath;
+
+    CheckFmuType(fmuType);
+    LoadSharedLibrary(fmuType);
+
+    // In lazy mode the variables tree is built on demand, since it needs all variable records
+    if (!m_library->m_xml_source)
+        BuildVariablesTree();
+}
+
 void FmuUnit::LoadUnzipped(FmuType fmuType, const std::string& directory) {
-    m_fmuType = fmuType;
-    m_directory = directory;
+    // a new library, since the current one may be shared with other units
+    m_library = std::make_shared<FmuLibrary>();
+    m_library->m_fmuType = fmuType;
+    m_library->m_directory = directory;
 
     try {
         LoadXML();
@@ -542,12 +1211,7 @@ void FmuUnit::LoadUnzipped(FmuType fmuType, const std::string& directory) {
         throw;
     }
 
-    if (fmuType == FmuType::COSIMULATION && !has_cosimulation)
-        throw std::runtime_error("Attempting to load Co-Simulation FMU, but not a CS FMU.");
-    if (fmuType == FmuType::MODEL_EXCHANGE && !has_model_exchange)
-        throw std::runtime_error("Attempting to load as Model Exchange, but not an ME FMU.");
-    if (fmuType == FmuType::SCHEDULED_EXECUTION && !has_scheduled_execution)
-        throw std::runtime_error("Attempting to load as Scheduled Execution, but not an SE FMU.");
+    CheckFmuType(fmuType);
 
     try {
         LoadSharedLibrary(fmuType);
@@ -555,95 +1219,359 @@ void FmuUnit::LoadUnzipped(FmuType fmuType, const std::string& directory) {
         throw;
     }
 
-    BuildVariablesTree();
+    // In lazy mode the variables tree is built on demand, since it needs all variable records
+    if (!m_library->m_xml_source)
+        BuildVariablesTree();
+}
+
+void FmuUnit::LoadShared(std::shared_ptr<FmuLibrary> library) {
+    if (!library || !library->dynlib_handle)
+        throw std::runtime_error("Cannot load the FMU from a library that has not been loaded.");
+
+    m_library = library;
+    InvalidateVariableSizes();
+
+    const std::string& modelIdentifier = m_library->m_fmuType == FmuType::MODEL_EXCHANGE
+                                             ? m_library->info_modex_modelIdentifier
+                                         : m_library->m_fmuType == FmuType::SCHEDULED_EXECUTION
+                                             ? m_library->info_sched_modelIdentifier
+                                             : m_library->info_cosim_modelIdentifier;
+    BindFunctions(modelIdentifier);
+
+    if (m_verbose)
+        std::cout << "Loaded FMU " << modelIdentifier << " from a shared library" << std::endl;
+}
+
+std::shared_ptr<FmuLibrary> FmuUnit::GetLibrary() {
+    // no lazy creation of records nor tree once the library is shared
+    materializeVariables();
+    GetVariablesTree();
+    return m_library;
+}
+
+void FmuUnit::CheckFmuType(FmuType fmuType) const {
+    if (fmuType == FmuType::COSIMULATION && !m_library->has_cosimulation)
+        throw std::runtime_error("Attempting to load Co-Simulation FMU, but not a CS FMU.");
+    if (fmuType == FmuType::MODEL_EXCHANGE && !m_library->has_model_exchange)
+        throw std::runtime_error("Attempting to load as Model Exchange, but not an ME FMU.");
+    if (fmuType == FmuType::SCHEDULED_EXECUTION && !m_library->has_scheduled_execution)
+        throw std::runtime_error("Attempting to load as Scheduled Execution, but not an SE FMU.");
+}
+
+void FmuUnit::ExtractResources() {
+    if (m_library->m_archive.empty())
+        return;
+
+    // units sharing the library may be instantiated concurrently
+    std::lock_guard<std::mutex> lock(m_library->m_resources_mutex);
+    if (m_library->m_resources_extracted)
+        return;
+
+    // Only the resources are extracted (overwriting existing files); nothing is written if the archive has none
+    if (m_verbose)
+        std::cout << "Extracting FMU resources in: " << m_library->m_directory << std::endl;
+    ExtractFmuArchive(m_library->m_archive, m_library->m_directory, "resources/");
+    m_library->m_resources_extracted = true;
 }
 
 void FmuUnit::LoadXML() {
-    std::string xml_filename = m_directory + "/modelDescription.xml";
+    std::string xml_filename = m_library->m_directory + "/modelDescription.xml";
     if (m_verbose)
         std::cout << "Loading model description file: " << xml_filename << std::endl;
 
-    rapidxml::xml_document<>* doc_ptr = new rapidxml::xml_document<>();
+    auto source = std::make_shared<ModelDescriptionSource>();
+    source->file.reset(new MappedFile(xml_filename));
+
+    if (!m_xml_cache) {
+        ParseXML(source);
+        return;
+    }
+
+    std::string cache_filename = m_library->m_directory + "/modelDescription.fmucache";
+    uint64_t xml_size = source->file->size();
+    uint64_t xml_hash = HashBytes(source->file->data(), source->file->size());
+    if (LoadXMLCache(cache_filename, xml_size, xml_hash)) {
+        if (m_verbose)
+            std::cout << "  Model description restored from cache: " << cache_filename << std::endl;
+        return;
+    }
 
-    // Read the xml file into a vector
-    std::ifstream file(xml_filename);
+    ParseXML(source);
+    SaveXMLCache(cache_filename, xml_size, xml_hash);
+}
 
-    if (!file.good())
-        throw std::runtime_error("Cannot find file: " + xml_filename + "\n");
+// Binary cache of the parsed model description: header (magic, format version, size and hash of the XML), the
+// model description strings, the interface flags, and the list of variables.
+static const uint32_t FMU_XML_CACHE_MAGIC = 0x43444D46;  // "FMDC"
+static const uint32_t FMU_XML_CACHE_VERSION = 3;
+
+std::vector<std::string*> FmuUnit::modelDescriptionStrings() {
+    return {&m_library->modelName,
+            &m_library->instantiationToken,
+            &m_library->fmiVersion,
+            &m_library->description,
+            &m_library->generationTool,
+            &m_library->generationDateAndTime,
+            &m_library->variableNamingConvention,
+            &m_library->numberOfEventIndicators,
+            &m_library->info_cosim_modelIdentifier,
+            &m_library->info_cosim_needsExecutionTool,
+            &m_library->info_cosim_canHandleVariableCommunicationStepSize,
+            &m_library->info_cosim_canInterpolateInputs,
+            &m_library->info_cosim_maxOutputDerivativeOrder,
+            &m_library->info_cosim_canRunAsynchronuously,
+            &m_library->info_cosim_canBeInstantiatedOnlyOncePerProcess,
+            &m_library->info_cosim_canNotUseMemoryManagementFunctions,
+            &m_library->info_cosim_canGetAndSetFMUState,
+            &m_library->info_cosim_canSerializeFMUState,
+            &m_library->info_modex_modelIdentifier,
+            &m_library->info_modex_needsExecutionTool,
+            &m_library->info_modex_completedIntegratorStepNotNeeded,
+            &m_library->info_modex_canBeInstantiatedOnlyOncePerProcess,
+            &m_library->info_modex_canNotUseMemoryManagementFunctions,
+            &m_library->info_modex_canGetAndSetFMUState,
+            &m_library->info_modex_canSerializeFMUState,
+            &m_library->info_modex_providesDirectionalDerivatives,
+            &m_library->info_modex_providesAdjointDerivatives,
+            &m_library->info_sched_modelIdentifier,
+            &m_library->info_sched_needsExecutionTool,
+            &m_library->info_sched_canBeInstantiatedOnlyOncePerProcess};
+}
 
-    std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    buffer.push_back('\0');
+bool FmuUnit::LoadXMLCache(const std::string& cache_filename, uint64_t xml_size, uint64_t xml_hash) {
+    std::error_code ec;
+    if (!fs::exists(cache_filename, ec))
+        return false;
 
-    // Parse the buffer using the xml file parsing library into doc
-    doc_ptr->parse<0>(&buffer[0]);
+    try {
+        MappedFile cache(cache_filename);
+        BinaryReader reader(cache.data(), cache.size());
+
+        if (reader.Read<uint32_t>() != FMU_XML_CACHE_MAGIC || reader.Read<uint32_t>() != FMU_XML_CACHE_VERSION ||
+            reader.Read<uint64_t>() != xml_size || reader.Read<uint64_t>() != xml_hash)
+            return false;
+
+        // Read everything in temporaries first, so that a corrupted cache leaves the FMU unchanged
+        auto strings = modelDescriptionStrings();
+        std::vector<std::string> string_values(strings.size());
+        for (auto& str : string_values)
+            str = reader.ReadString();
+
+        bool cosim = reader.Read<uint8_t>() != 0;
+        bool modex = reader.Read<uint8_t>() != 0;
+        bool sched = reader.Read<uint8_t>() != 0;
+        uint64_t nx = reader.Read<uint64_t>();
+
+        VarList variables;
+        uint64_t num_variables = reader.Read<uint64_t>();
+        for (uint64_t i = 0; i < num_variables; i++) {
+            auto valref = reader.Read<fmi3ValueReference>();
+            auto type = static_cast<FmuVariable::Type>(reader.Read<uint8_t>());
+            auto causality = static_cast<FmuVariable::CausalityType>(reader.Read<uint8_t>());
+            auto variability = static_cast<FmuVariable::VariabilityType>(reader.Read<uint8_t>());
+            auto initial = static_cast<FmuVariable::InitialType>(reader.Read<uint8_t>());
+            bool is_state = reader.Read<uint8_t>() != 0;
+            bool is_deriv = reader.Read<uint8_t>() != 0;
+            std::string name = reader.ReadString();
+            std::string unit = reader.ReadString();
+            std::string var_description = reader.ReadString();
+
+            FmuVariable::DimensionsArrayType dimensions(reader.Read<uint32_t>());
+            for (auto& dim : dimensions) {
+                dim.first = reader.Read<uint64_t>();
+                dim.second = reader.Read<uint8_t>() != 0;
+            }
+
+            std::vector<std::string> start_values(reader.Read<uint32_t>());
+            for (auto& value : start_values)
+                value = reader.ReadString();
+
+            FmuVariableImport var(name, type, dimensions, causality, variability, initial);
+            var.SetValueReference(valref);
+            var.SetUnitName(unit);
+            var.SetDescription(var_description);
+            var.m_is_state = is_state;
+            var.m_is_deriv = is_deriv;
+            var.m_start_values = std::move(start_values);
+            variables[valref] = var;
+        }
+
+        std::vector<FmuClockImport> clocks(reader.Read<uint64_t>());
+        for (auto& clock : clocks) {
+            clock.valueReference = reader.Read<fmi3ValueReference>();
+            clock.interval = reader.Read<fmi3Float64>();
+            clock.name = reader.ReadString();
+            clock.description = reader.ReadString();
+        }
+
+        if (!reader.AtEnd())
+            return false;
+
+        for (size_t i = 0; i < strings.size(); i++)
+            *strings[i] = std::move(string_values[i]);
+        m_library->has_cosimulation = cosim;
+        m_library->has_model_exchange = modex;
+        m_library->has_scheduled_execution = sched;
+        m_library->m_nx = static_cast<size_t>(nx);
+        m_library->m_variables = std::move(variables);
+        m_library->m_clocks = std::move(clocks);
+        m_library->m_xml_source.reset();
+        BuildVariablesIndex();
+    } catch (std::exception&) {
+        return false;
+    }
+
+    return true;
+}
+
+void FmuUnit::SaveXMLCache(const std::string& cache_filename, uint64_t xml_size, uint64_t xml_hash) {
+    BinaryWriter writer;
+    writer.Write(FMU_XML_CACHE_MAGIC);
+    writer.Write(FMU_XML_CACHE_VERSION);
+    writer.Write(xml_size);
+    writer.Write(xml_hash);
+
+    for (const auto str : modelDescriptionStrings())
+        writer.WriteString(*str);
+
+    writer.Write(static_cast<uint8_t>(m_library->has_cosimulation));
+    writer.Write(static_cast<uint8_t>(m_library->has_model_exchange));
+    writer.Write(static_cast<uint8_t>(m_library->has_scheduled_execution));
+    writer.Write(static_cast<uint64_t>(m_library->m_nx));
+
+    const VarList& variables = GetVariablesList();
+    writer.Write(static_cast<uint64_t>(variables.size()));
+    for (const auto& iv : variables) {
+        const FmuVariableImport& var = iv.second;
+        writer.Write(iv.first);
+        writer.Write(static_cast<uint8_t>(var.GetType()));
+        writer.Write(static_cast<uint8_t>(var.GetCausality()));
+        writer.Write(static_cast<uint8_t>(var.GetVariability()));
+        writer.Write(static_cast<uint8_t>(var.GetInitial()));
+        writer.Write(static_cast<uint8_t>(var.IsState()));
+        writer.Write(static_cast<uint8_t>(var.IsDeriv()));
+        writer.WriteString(var.GetName());
+        writer.WriteString(var.GetUnitName());
+        writer.WriteString(var.GetDescription());
+
+        const auto& dimensions = var.GetDimensions();
+        writer.Write(static_cast<uint32_t>(dimensions.size()));
+        for (const auto& dim : dimensions) {
+            writer.Write(static_cast<uint64_t>(dim.first));
+            writer.Write(static_cast<uint8_t>(dim.second));
+        }
+
+        writer.Write(static_cast<uint32_t>(var.GetStartValues().size()));
+        for (const auto& value : var.GetStartValues())
+            writer.WriteString(value);
+    }
+
+    writer.Write(static_cast<uint64_t>(m_library->m_clocks.size()));
+    for (const auto& clock : m_library->m_clocks) {
+        writer.Write(clock.valueReference);
+        writer.Write(clock.interval);
+        writer.WriteString(clock.name);
+        writer.WriteString(clock.description);
+    }
+
+    // Write in a temporary file and atomically replace the cache, since other processes may be reading it
+    std::random_device rd;
+    std::string tmp_filename = cache_filename + ".tmp" + std::to_string(rd());
+    {
+        std::ofstream file(tmp_filename, std::ios::binary | std::ios::trunc);
+        if (!file.good())
+            return;
+        file.write(writer.GetData().data(), static_cast<std::streamsize>(writer.GetData().size()));
+        if (!file.good()) {
+            file.close();
+            std::error_code ec;
+            fs::remove(tmp_filename, ec);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(tmp_filename, cache_filename, ec);
+    if (ec) {
+        fs::remove(tmp_filename, ec);
+    } else if (m_verbose) {
+        std::cout << "  Model description cached in: " << cache_filename << std::endl;
+    }
+}
+
+void FmuUnit::ParseXML(const std::shared_ptr<ModelDescriptionSource>& source) {
+    // Parse in non-destructive mode: the source text is never modified (it can be a read-only memory mapping) and
+    // names and values are referenced in place instead of being copied and null-terminated
+    auto& doc = source->doc;
+    doc.parse<rapidxml::parse_non_destructive>(const_cast<char*>(source->text()));
 
     // Find the root node
-    auto root_node = doc_ptr->first_node("fmiModelDescription");
+    auto root_node = doc.first_node("fmiModelDescription");
     if (!root_node)
         throw std::runtime_error("Not a valid FMU. Missing <fmiModelDescription> in XML. \n");
 
     if (auto attr = root_node->first_attribute("modelName")) {
-        modelName = attr->value();
+        m_library->modelName = XmlString(attr);
     }
     if (auto attr = root_node->first_attribute("instantiationToken")) {
-        instantiationToken = attr->value();
+        m_library->instantiationToken = XmlString(attr);
     }
     if (auto attr = root_node->first_attribute("fmiVersion")) {
-        fmiVersion = attr->value();
+        m_library->fmiVersion = XmlString(attr);
     }
     if (auto attr = root_node->first_attribute("description")) {
-        description = attr->value();
+        m_library->description = XmlString(attr);
     }
     if (auto attr = root_node->first_attribute("generationTool")) {
-        generationTool = attr->value();
+        m_library->generationTool = XmlString(attr);
     }
     if (auto attr = root_node->first_attribute("generationDateAndTime")) {
-        generationDateAndTime = attr->value();
+        m_library->generationDateAndTime = XmlString(attr);
     }
     if (auto attr = root_node->first_attribute("variableNamingConvention")) {
-        variableNamingConvention = attr->value();
+        m_library->variableNamingConvention = XmlString(attr);
     }
     if (auto attr = root_node->first_attribute("numberOfEventIndicators")) {
-        numberOfEventIndicators = attr->value();
+        m_library->numberOfEventIndicators = XmlString(attr);
     }
 
-    if (fmiVersion.compare("3.0") != 0)
+    if (m_library->fmiVersion.compare("3.0") != 0)
         throw std::runtime_error("Not an FMI 3.0 FMU");
 
     // Find the cosimulation node
     auto cosimulation_node = root_node->first_node("CoSimulation");
     if (cosimulation_node) {
         if (auto attr = cosimulation_node->first_attribute("modelIdentifier")) {
-            info_cosim_modelIdentifier = attr->value();
+            m_library->info_cosim_modelIdentifier = XmlString(attr);
         }
         if (auto attr = cosimulation_node->first_attribute("needsExecutionTool")) {
-            info_cosim_needsExecutionTool = attr->value();
+            m_library->info_cosim_needsExecutionTool = XmlString(attr);
         }
         if (auto attr = cosimulation_node->first_attribute("canHandleVariableCommunicationStepSize")) {
-            info_cosim_canHandleVariableCommunicationStepSize = attr->value();
+            m_library->info_cosim_canHandleVariableCommunicationStepSize = XmlString(attr);
         }
         if (auto attr = cosimulation_node->first_attribute("canInterpolateInputs")) {
-            info_cosim_canInterpolateInputs = attr->value();
+            m_library->info_cosim_canInterpolateInputs = XmlString(attr);
         }
         if (auto attr = cosimulation_node->first_attribute("maxOutputDerivativeOrder")) {
-            info_cosim_maxOutputDerivativeOrder = attr->value();
+            m_library->info_cosim_maxOutputDerivativeOrder = XmlString(attr);
         }
         if (auto attr = cosimulation_node->first_attribute("canRunAsynchronuously")) {
-            info_cosim_canRunAsynchronuously = attr->value();
+            m_library->info_cosim_canRunAsynchronuously = XmlString(attr);
         }
         if (auto attr = cosimulation_node->first_attribute("canBeInstantiatedOnlyOncePerProcess")) {
-            info_cosim_canBeInstantiatedOnlyOncePerProcess = attr->value();
+            m_library->info_cosim_canBeInstantiatedOnlyOncePerProcess = XmlString(attr);
         }
         if (auto attr = cosimulation_node->first_attribute("canNotUseMemoryManagementFunctions")) {
-            info_cosim_canNotUseMemoryManagementFunctions = attr->value();
+            m_library->info_cosim_canNotUseMemoryManagementFunctions = XmlString(attr);
         }
-        if (auto attr = cosimulation_node->first_attribute("canGetAndSetFMUstate")) {
-            info_cosim_canGetAndSetFMUstate = attr->value();
+        if (auto attr = cosimulation_node->first_attribute("canGetAndSetFMUState")) {
+            m_library->info_cosim_canGetAndSetFMUState = XmlString(attr);
         }
-        if (auto attr = cosimulation_node->first_attribute("canSerializeFMUstate")) {
-            info_cosim_canSerializeFMUstate = attr->value();
+        if (auto attr = cosimulation_node->first_attribute("canSerializeFMUState")) {
+            m_library->info_cosim_canSerializeFMUState = XmlString(attr);
         }
-        has_cosimulation = true;
+        m_library->has_cosimulation = true;
 
         if (m_verbose)
             std::cout << "  Found CS interface" << std::endl;
@@ -653,37 +1581,58 @@ void FmuUnit::LoadXML() {
     auto modelexchange_node = root_node->first_node("ModelExchange");
     if (modelexchange_node) {
         if (auto attr = modelexchange_node->first_attribute("modelIdentifier")) {
-            info_modex_modelIdentifier = attr->value();
+            m_library->info_modex_modelIdentifier = XmlString(attr);
         }
         if (auto attr = modelexchange_node->first_attribute("needsExecutionTool")) {
-            info_modex_needsExecutionTool = attr->value();
+            m_library->info_modex_needsExecutionTool = XmlString(attr);
         }
         if (auto attr = modelexchange_node->first_attribute("completedIntegratorStepNotNeeded")) {
-            info_modex_completedIntegratorStepNotNeeded = attr->value();
+            m_library->info_modex_completedIntegratorStepNotNeeded = XmlString(attr);
         }
 
         if (auto attr = modelexchange_node->first_attribute("canBeInstantiatedOnlyOncePerProcess")) {
-            info_modex_canBeInstantiatedOnlyOncePerProcess = attr->value();
+            m_library->info_modex_canBeInstantiatedOnlyOncePerProcess = XmlString(attr);
         }
         if (auto attr = modelexchange_node->first_attribute("canNotUseMemoryManagementFunctions")) {
-            info_modex_canNotUseMemoryManagementFunctions = attr->value();
+            m_library->info_modex_canNotUseMemoryManagementFunctions = XmlString(attr);
         }
         if (auto attr = modelexchange_node->first_attribute("canGetAndSetFMUState")) {
-            info_modex_canGetAndSetFMUState = attr->value();
+            m_library->info_modex_canGetAndSetFMUState = XmlString(attr);
+        }
+        if (auto attr = modelexchange_node->first_attribute("canSerializeFMUState")) {
+            m_library->info_modex_canSerializeFMUState = XmlString(attr);
         }
-        if (auto attr = modelexchange_node->first_attribute("canSerializeFMUstate")) {
-            info_modex_canSerializeFMUstate = attr->value();
+        if (auto attr = modelexchange_node->first_attribute("providesDirectionalDerivatives")) {
+            m_library->info_modex_providesDirectionalDerivatives = XmlString(attr);
         }
-        if (auto attr = modelexchange_node->first_attribute("providesDirectionalDerivative")) {
-            info_modex_providesDirectionalDerivative = attr->value();
+        if (auto attr = modelexchange_node->first_attribute("providesAdjointDerivatives")) {
+            m_library->info_modex_providesAdjointDerivatives = XmlString(attr);
         }
-        has_model_exchange = true;
+        m_library->has_model_exchange = true;
 
         if (m_verbose)
             std::cout << "  Found ME interface" << std::endl;
     }
 
-    if (!has_cosimulation && !has_model_exchange) {
+    // Find the scheduled execution node
+    auto scheduledexecution_node = root_node->first_node("ScheduledExecution");
+    if (scheduledexecution_node) {
+        if (auto attr = scheduledexecution_node->first_attribute("modelIdentifier")) {
+            m_library->info_sched_modelIdentifier = XmlString(attr);
+        }
+        if (auto attr = scheduledexecution_node->first_attribute("needsExecutionTool")) {
+            m_library->info_sched_needsExecutionTool = XmlString(attr);
+        }
+        if (auto attr = scheduledexecution_node->first_attribute("canBeInstantiatedOnlyOncePerProcess")) {
+            m_library->info_sched_canBeInstantiatedOnlyOncePerProcess = XmlString(attr);
+        }
+        m_library->has_scheduled_execution = true;
+
+        if (m_verbose)
+            std::cout << "  Found SE interface" << std::endl;
+    }
+
+    if (!m_library->has_cosimulation && !m_library->has_model_exchange && !m_library->has_scheduled_execution) {
         throw std::runtime_error(
             "Not a valid FMU. Missing <CoSimulation>, <ModelExchange> or <ScheduledExecution> in XML. \n");
     }
@@ -697,169 +1646,76 @@ void FmuUnit::LoadXML() {
     std::vector<int> state_valref;
     std::vector<int> deriv_valref;
 
-    // Iterate over the variable nodes and load container of FMU variables
-    for (auto var_node = variables_node->first_node(); var_node; var_node = var_node->next_sibling()) {
-        // Get variable name
-        std::string var_name;
+    m_library->m_variables.clear();
+    m_library->m_variablesByValref.clear();
+    m_library->m_valrefsByName.clear();
+    m_library->m_clocks.clear();
 
-        if (auto attr = var_node->first_attribute("name"))
-            var_name = attr->value();
-        else
-            throw std::runtime_error("Cannot find 'name' property in variable.");
-
-        // Get variable attributes
-        fmi3ValueReference valref = 0;
-        std::string description = "";
-        std::string variability = "";
-        std::string causality = "";
-        std::string initial = "";
-
-        // valueReference is 1-based
+    // Iterate over the variable nodes and load container of FMU variables.
+    // In lazy mode, only the value reference, the name and the derivative attribute are read: the variable nodes are
+    // indexed and the full records are created on first access.
+    for (auto var_node = variables_node->first_node(); var_node; var_node = var_node->next_sibling()) {
+        fmi3ValueReference valref;
         if (auto attr = var_node->first_attribute("valueReference"))
-            valref = std::stoul(attr->value());
+            valref = static_cast<fmi3ValueReference>(XmlToUnsigned(attr));
         else
             throw std::runtime_error("Cannot find 'valueReference' property in variable.");
 
-        if (auto attr = var_node->first_attribute("description"))
-            description = attr->value();
-
-        if (auto attr = var_node->first_attribute("variability"))
-            variability = attr->value();
-
-        if (auto attr = var_node->first_attribute("causality"))
-            causality = attr->value();
-
-        if (auto attr = var_node->first_attribute("initial"))
-            initial = attr->value();
-
-        FmuVariable::CausalityType causality_enum;
-        FmuVariable::VariabilityType variability_enum;
-        FmuVariable::InitialType initial_enum;
-
-        if (causality.empty())
-            causality_enum = FmuVariable::CausalityType::local;
-        else if (!causality.compare("parameter"))
-            causality_enum = FmuVariable::CausalityType::parameter;
-        else if (!causality.compare("calculatedParameter"))
-            causality_enum = FmuVariable::CausalityType::calculatedParameter;
-        else if (!causality.compare("input"))
-            causality_enum = FmuVariable::CausalityType::input;
-        else if (!causality.compare("output"))
-            causality_enum = FmuVariable::CausalityType::output;
-        else if (!causality.compare("local"))
-            causality_enum = FmuVariable::CausalityType::local;
-        else if (!causality.compare("independent"))
-            causality_enum = FmuVariable::CausalityType::independent;
-        else
-            throw std::runtime_error("causality is badly formatted.");
-
-        if (variability.empty())
-            variability_enum = FmuVariable::VariabilityType::continuous;
-        else if (!variability.compare("constant"))
-            variability_enum = FmuVariable::VariabilityType::constant;
-        else if (!variability.compare("fixed"))
-            variability_enum = FmuVariable::VariabilityType::fixed;
-        else if (!variability.compare("tunable"))
-            variability_enum = FmuVariable::VariabilityType::tunable;
-        else if (!variability.compare("discrete"))
-            variability_enum = FmuVariable::VariabilityType::discrete;
-        else if (!variability.compare("continuous"))
-            variability_enum = FmuVariable::VariabilityType::continuous;
-        else
-            throw std::runtime_error("variability is badly formatted.");
-
-        if (initial.empty())
-            initial_enum = FmuVariable::InitialType::none;
-        else if (!initial.compare("exact"))
-            initial_enum = FmuVariable::InitialType::exact;
-        else if (!initial.compare("approx"))
-            initial_enum = FmuVariable::InitialType::approx;
-        else if (!initial.compare("calculated"))
-            initial_enum = FmuVariable::InitialType::calculated;
-        else
-            throw std::runtime_error("variability is badly formatted.");
-
-        FmuVariable::DimensionsArrayType dimensions;
-        for (auto node_dim = var_node->first_node("Dimension"); node_dim;
-             node_dim = node_dim->next_sibling("Dimension")) {
-            if (auto node_dim_startsize = node_dim->first_attribute("start")) {
-                dimensions.push_back(std::make_pair(std::stoul(node_dim_startsize->value()), true));
-            } else if (auto node_dim_vrsize = node_dim->first_attribute("valueReference")) {
-                dimensions.push_back(std::make_pair(std::stoul(node_dim_vrsize->value()), false));
-            } else
-                throw std::runtime_error("Dimension must have either 'start' or 'valueReference' attribute.");
-        }
-
-        // Get variable type
-        FmuVariable::Type var_type;
-
-        if (areStringsEqual(var_node->name(), var_node->name_size(), "Float32")) {
-            var_type = FmuVariable::Type::Float32;
-        } else if (areStringsEqual(var_node->name(), var_node->name_size(), "Float64")) {
-            var_type = FmuVariable::Type::Float64;
-        } else if (areStringsEqual(var_node->name(), var_node->name_size(), "Int8")) {
-            var_type = FmuVariable::Type::Int8;
-        } else if (areStringsEqual(var_node->name(), var_node->name_size(), "UInt8")) {
-            var_type = FmuVariable::Type::UInt8;
-        } else if (areStringsEqual(var_node->name(), var_node->name_size(), "Int16")) {
-            var_type = FmuVariable::Type::Int16;
-        } else if (areStringsEqual(var_node->name(), var_node->name_size(), "UInt16")) {
-            var_type = FmuVariable::Type::UInt16;
-        } else if (areStringsEqual(var_node->name(), var_node->name_size(), "Int32")) {
-            var_type = FmuVariable::Type::Int32;
-        } else if (areStringsEqual(var_node->name(), var_node->name_size(), "UInt32")) {
-            var_type = FmuVariable::Type::UInt32;
-        } else if (areStringsEqual(var_node->name(), var_node->name_size(), "Int64")) {
-            var_type = FmuVariable::Type::Int64;
-        } else if (areStringsEqual(var_node->name(), var_node->name_size(), "UInt64")) {
-            var_type = FmuVariable::Type::UInt64;
-        } else if (areStringsEqual(var_node->name(), var_node->name_size(), "Boolean")) {
-            var_type = FmuVariable::Type::Boolean;
-        } else if (areStringsEqual(var_node->name(), var_node->name_size(), "String")) {
-            var_type = FmuVariable::Type::String;
-        } else if (areStringsEqual(var_node->name(), var_node->name_size(), "Binary")) {
-            var_type = FmuVariable::Type::Binary;
-        } else {
-            std::cerr << "Unknown variable type: " + std::string(var_node->name()) << std::endl;
-            throw std::runtime_error("Unknown variable type: " + std::string(var_node->name()));
+        // Clocks have no value: they are not FMU variables
+        if (areStringsEqual(var_node->name(), var_node->name_size(), "Clock")) {
+            FmuClockImport clock;
+            clock.valueReference = valref;
+            if (auto attr = var_node->first_attribute("name"))
+                clock.name = XmlString(attr);
+            clock.interval = 0;
+            if (auto attr = var_node->first_attribute("intervalDecimal"))
+                clock.interval = std::stod(XmlString(attr));
+            if (auto attr = var_node->first_attribute("description"))
+                clock.description = XmlString(attr);
+            m_library->m_clocks.push_back(std::move(clock));
+            continue;
         }
 
-        // Check if variable is a derivative, check for unit and start value
-        bool is_deriv = false;
-        std::string unit = "";
-
         if (auto attr = var_node->first_attribute("derivative")) {
-            state_valref.push_back(std::stoul(attr->value()));
+            state_valref.push_back(static_cast<int>(XmlToUnsigned(attr)));
             deriv_valref.push_back(valref);
-            is_deriv = true;
-        }
-        if (auto attr = var_node->first_attribute("unit")) {
-            unit = attr->value();
         }
-        if (auto attr = var_node->first_attribute("start")) {
-            //// TODO
+
+        if (m_lazy) {
+            auto attr = var_node->first_attribute("name");
+            if (!attr)
+                throw std::runtime_error("Cannot find 'name' property in variable.");
+            m_library->m_valrefsByName[FmuStringPool::Intern(XmlString(attr))] = valref;
+            m_library->m_variablesByValref.push_back({valref, nullptr, var_node, false});
+        } else {
+            m_library->m_variables[valref] = parseVariable(var_node);
         }
+    }
 
-        // Create and cache the new variable (also caching its value reference)
-        FmuVariableImport var(var_name, var_type, dimensions, causality_enum, variability_enum, initial_enum);
-        var.m_is_deriv = is_deriv;
-        var.SetValueReference(valref);
+    m_library->m_nx = state_valref.size();
+    if (deriv_valref.size() != m_library->m_nx)
+        throw std::runtime_error("Incompatible number of states and state derivatives in XML file.");
 
-        m_variables[valref] = var;
-    }
+    if (m_lazy) {
+        std::sort(m_library->m_variablesByValref.begin(), m_library->m_variablesByValref.end(),
+                  [](const VariableEntry& a, const VariableEntry& b) { return a.valref < b.valref; });
 
-    // Traverse the list of state value references and mark the corresponding FMU variable as a state
-    for (const auto& si : state_valref) {
-        m_variables.at(si).m_is_state = true;
+        // Mark the index entries of the state variables; the source is kept alive for the lazy creation of records
+        for (const auto& si : state_valref) {
+            findEntry(static_cast<fmi3ValueReference>(si)).is_state = true;
+        }
+        m_library->m_xml_source = source;
+    } else {
+        // Traverse the list of state value references and mark the corresponding FMU variable as a state
+        for (const auto& si : state_valref) {
+            m_library->m_variables.at(si).m_is_state = true;
+        }
+        BuildVariablesIndex();
     }
 
-    m_nx = state_valref.size();
-    if (deriv_valref.size() != m_nx)
-        throw std::runtime_error("Incompatible number of states and state derivatives in XML file.");
-
     if (m_verbose) {
-        std::cout << "  Found " << m_variables.size() << " FMU variables" << std::endl;
-        if (m_nx > 0) {
+        std::cout << "  Found " << m_library->m_variablesByValref.size() << " FMU variables" << std::endl;
+        if (m_library->m_nx > 0) {
             std::cout << "     States      ";
             std::copy(state_valref.begin(), state_valref.end(), std::ostream_iterator<int>(std::cout, " "));
             std::cout << std::endl;
@@ -868,30 +1724,208 @@ void FmuUnit::LoadXML() {
             std::cout << std::endl;
         }
     }
+}
+
+FmuVariableImport FmuUnit::parseVariable(const rapidxml::xml_node<>* var_node) const {
+    // Get variable name
+    std::string var_name;
+
+    if (auto attr = var_node->first_attribute("name"))
+        var_name = XmlString(attr);
+    else
+        throw std::runtime_error("Cannot find 'name' property in variable.");
+
+    // Get variable attributes
+    fmi3ValueReference valref = 0;
+    std::string description = "";
+    std::string variability = "";
+    std::string causality = "";
+    std::string initial = "";
+
+    // valueReference is 1-based
+    if (auto attr = var_node->first_attribute("valueReference"))
+        valref = static_cast<fmi3ValueReference>(XmlToUnsigned(attr));
+    else
+        throw std::runtime_error("Cannot find 'valueReference' property in variable.");
+
+    if (auto attr = var_node->first_attribute("description"))
+        description = XmlString(attr);
+
+    if (auto attr = var_node->first_attribute("variability"))
+        variability = XmlString(attr);
+
+    if (auto attr = var_node->first_attribute("causality"))
+        causality = XmlString(attr);
+
+    if (auto attr = var_node->first_attribute("initial"))
+        initial = XmlString(attr);
+
+    FmuVariable::CausalityType causality_enum;
+    FmuVariable::VariabilityType variability_enum;
+    FmuVariable::InitialType initial_enum;
+
+    if (causality.empty())
+        causality_enum = FmuVariable::CausalityType::local;
+    else if (!causality.compare("parameter"))
+        causality_enum = FmuVariable::CausalityType::parameter;
+    else if (!causality.compare("calculatedParameter"))
+        causality_enum = FmuVariable::CausalityType::calculatedParameter;
+    else if (!causality.compare("input"))
+        causality_enum = FmuVariable::CausalityType::input;
+    else if (!causality.compare("output"))
+        causality_enum = FmuVariable::CausalityType::output;
+    else if (!causality.compare("local"))
+        causality_enum = FmuVariable::CausalityType::local;
+    else if (!causality.compare("independent"))
+        causality_enum = FmuVariable::CausalityType::independent;
+    else if (!causality.compare("structuralParameter"))
+        causality_enum = FmuVariable::CausalityType::structuralParameter;
+    else
+        throw std::runtime_error("causality is badly formatted.");
+
+    if (variability.empty())
+        variability_enum = FmuVariable::VariabilityType::continuous;
+    else if (!variability.compare("constant"))
+        variability_enum = FmuVariable::VariabilityType::constant;
+    else if (!variability.compare("fixed"))
+        variability_enum = FmuVariable::VariabilityType::fixed;
+    else if (!variability.compare("tunable"))
+        variability_enum = FmuVariable::VariabilityType::tunable;
+    else if (!variability.compare("discrete"))
+        variability_enum = FmuVariable::VariabilityType::discrete;
+    else if (!variability.compare("continuous"))
+        variability_enum = FmuVariable::VariabilityType::continuous;
+    else
+        throw std::runtime_error("variability is badly formatted.");
+
+    if (initial.empty())
+        initial_enum = FmuVariable::InitialType::none;
+    else if (!initial.compare("exact"))
+        initial_enum = FmuVariable::InitialType::exact;
+    else if (!initial.compare("approx"))
+        initial_enum = FmuVariable::InitialType::approx;
+    else if (!initial.compare("calculated"))
+        initial_enum = FmuVariable::InitialType::calculated;
+    else
+        throw std::runtime_error("variability is badly formatted.");
+
+    FmuVariable::DimensionsArrayType dimensions;
+    for (auto node_dim = var_node->first_node("Dimension"); node_dim;
+         node_dim = node_dim->next_sibling("Dimension")) {
+        if (auto node_dim_startsize = node_dim->first_attribute("start")) {
+            dimensions.push_back(std::make_pair(static_cast<size_t>(XmlToUnsigned(node_dim_startsize)), true));
+        } else if (auto node_dim_vrsize = node_dim->first_attribute("valueReference")) {
+            dimensions.push_back(std::make_pair(static_cast<size_t>(XmlToUnsigned(node_dim_vrsize)), false));
+        } else
+            throw std::runtime_error("Dimension must have either 'start' or 'valueReference' attribute.");
+    }
+
+    // Get variable type
+    FmuVariable::Type var_type;
+
+    if (areStringsEqual(var_node->name(), var_node->name_size(), "Float32")) {
+        var_type = FmuVariable::Type::Float32;
+    } else if (areStringsEqual(var_node->name(), var_node->name_size(), "Float64")) {
+        var_type = FmuVariable::Type::Float64;
+    } else if (areStringsEqual(var_node->name(), var_node->name_size(), "Int8")) {
+        var_type = FmuVariable::Type::Int8;
+    } else if (areStringsEqual(var_node->name(), var_node->name_size(), "UInt8")) {
+        var_type = FmuVariable::Type::UInt8;
+    } else if (areStringsEqual(var_node->name(), var_node->name_size(), "Int16")) {
+        var_type = FmuVariable::Type::Int16;
+    } else if (areStringsEqual(var_node->name(), var_node->name_size(), "UInt16")) {
+        var_type = FmuVariable::Type::UInt16;
+    } else if (areStringsEqual(var_node->name(), var_node->name_size(), "Int32")) {
+        var_type = FmuVariable::Type::Int32;
+    } else if (areStringsEqual(var_node->name(), var_node->name_size(), "UInt32")) {
+        var_type = FmuVariable::Type::UInt32;
+    } else if (areStringsEqual(var_node->name(), var_node->name_size(), "Int64")) {
+        var_type = FmuVariable::Type::Int64;
+    } else if (areStringsEqual(var_node->name(), var_node->name_size(), "UInt64")) {
+        var_type = FmuVariable::Type::UInt64;
+    } else if (areStringsEqual(var_node->name(), var_node->name_size(), "Boolean")) {
+        var_type = FmuVariable::Type::Boolean;
+    } else if (areStringsEqual(var_node->name(), var_node->name_size(), "String")) {
+        var_type = FmuVariable::Type::String;
+    } else if (areStringsEqual(var_node->name(), var_node->name_size(), "Binary")) {
+        var_type = FmuVariable::Type::Binary;
+    } else {
+        std::string type_name(var_node->name(), var_node->name_size());
+        std::cerr << "Unknown variable type: " + type_name << std::endl;
+        throw std::runtime_error("Unknown variable type: " + type_name);
+    }
+
+    // Check if variable is a derivative, check for unit and start value
+    bool is_deriv = false;
+    std::string unit = "";
+
+    if (var_node->first_attribute("derivative")) {
+        is_deriv = true;
+    }
+    if (auto attr = var_node->first_attribute("unit")) {
+        unit = XmlString(attr);
+    }
+
+    // Start values are given by the 'start' attribute (space-separated for arrays), or by <Start value="..."/>
+    // children for String and Binary variables
+    std::vector<std::string> start_values;
+    if (auto attr = var_node->first_attribute("start")) {
+        std::istringstream start_stream(XmlString(attr));
+        std::string value;
+        while (start_stream >> value)
+            start_values.push_back(value);
+    }
+    for (auto node_start = var_node->first_node("Start"); node_start; node_start = node_start->next_sibling("Start")) {
+        if (auto attr = node_start->first_attribute("value"))
+            start_values.push_back(XmlString(attr));
+    }
 
-    delete doc_ptr;
+    // Create the new variable (also caching its value reference)
+    FmuVariableImport var(var_name, var_type, dimensions, causality_enum, variability_enum, initial_enum);
+    var.m_is_deriv = is_deriv;
+    var.m_start_values = std::move(start_values);
+    var.SetValueReference(valref);
+
+    return var;
 }
 
 void FmuUnit::LoadSharedLibrary(FmuType fmuType) {
     std::string modelIdentifier;
     switch (fmuType) {
         case FmuType::COSIMULATION:
-            modelIdentifier = info_cosim_modelIdentifier;
+            modelIdentifier = m_library->info_cosim_modelIdentifier;
             break;
         case FmuType::MODEL_EXCHANGE:
-            modelIdentifier = info_modex_modelIdentifier;
+            modelIdentifier = m_library->info_modex_modelIdentifier;
+            break;
+        case FmuType::SCHEDULED_EXECUTION:
+            modelIdentifier = m_library->info_sched_modelIdentifier;
             break;
     }
 
-    std::string dynlib_dir = m_directory + "/" + m_bin_directory;
+    std::string dynlib_dir = m_library->m_directory + "/" + m_library->m_bin_directory;
     std::string dynlib_name = dynlib_dir + "/" + modelIdentifier + std::string(SHARED_LIBRARY_SUFFIX);
 
-    if (m_verbose)
-        std::cout << "Loading shared library " << dynlib_name << std::endl;
+    if (!m_library->m_archive.empty()) {
+        // link the library image read from the archive
+        const std::string& bin_directory = m_library->m_bin_directory;
+        std::string entry = bin_directory.substr(bin_directory.find_first_not_of('/')) + "/" + modelIdentifier +
+                            std::string(SHARED_LIBRARY_SUFFIX);
+        dynlib_name = m_library->m_archive + ":" + entry;
+        if (m_verbose)
+            std::cout << "Loading shared library from memory " << dynlib_name << std::endl;
 
-    dynlib_handle = RuntimeLinkLibrary(dynlib_dir, dynlib_name);
+        std::vector<char> image = ReadFmuArchiveEntry(m_library->m_archive, entry);
+        m_library->dynlib_handle = RuntimeLinkLibraryFromMemory(image.data(), image.size() - 1,
+                                                                modelIdentifier + std::string(SHARED_LIBRARY_SUFFIX));
+    } else {
+        if (m_verbose)
+            std::cout << "Loading shared library " << dynlib_name << std::endl;
+
+        m_library->dynlib_handle = RuntimeLinkLibrary(dynlib_dir, dynlib_name);
+    }
 
-    if (!dynlib_handle)
+    if (!m_library->dynlib_handle)
         throw std::runtime_error("Could not locate the compiled FMU files: " + dynlib_name + "\n");
 
     // run time binding of functions
@@ -957,12 +1991,12 @@ void FmuUnit::LoadSharedLibrary(FmuType fmuType) {
     LOAD_FMI_FUNCTION(fmi3EvaluateDiscreteStates);
     LOAD_FMI_FUNCTION(fmi3UpdateDiscreteStates);
 
-    if (has_cosimulation) {
+    if (m_library->has_cosimulation) {
         LOAD_FMI_FUNCTION(fmi3EnterStepMode);
         LOAD_FMI_FUNCTION(fmi3GetOutputDerivatives);
         LOAD_FMI_FUNCTION(fmi3DoStep);
     }
-    if (has_model_exchange) {
+    if (m_library->has_model_exchange) {
         LOAD_FMI_FUNCTION(fmi3EnterContinuousTimeMode);
         LOAD_FMI_FUNCTION(fmi3CompletedIntegratorStep);
         LOAD_FMI_FUNCTION(fmi3SetTime);
@@ -974,59 +2008,113 @@ void FmuUnit::LoadSharedLibrary(FmuType fmuType) {
         LOAD_FMI_FUNCTION(fmi3GetNumberOfEventIndicators);
         LOAD_FMI_FUNCTION(fmi3GetNumberOfContinuousStates);
     }
-    if (has_scheduled_execution) {
+    if (m_library->has_scheduled_execution) {
         LOAD_FMI_FUNCTION(fmi3ActivateModelPartition);
     }
 
+    m_library->functions = *this;
+    BindFunctions(modelIdentifier);
+
     if (m_verbose) {
         std::cout << "FMI version:  " << GetVersion() << std::endl;
     }
 }
 
+void FmuUnit::BindFunctions(const std::string& modelIdentifier) {
+    static_cast<FmuFunctions&>(*this) = m_library->functions;
+
+    m_traceChannel = nullptr;
+    if (m_tracer) {
+        m_traceChannel = m_tracer->AddChannel(m_traceName.empty() ? modelIdentifier : m_traceName);
+#define TRACE_FMI_FUNCTION(funcName) FmuTracer::Interpose<FmuTrace_##funcName>(*m_traceChannel, this->_##funcName);
+        FMU_TRACED_FUNCTIONS(TRACE_FMI_FUNCTION)
+#undef TRACE_FMI_FUNCTION
+    }
+}
+
 void FmuUnit::BuildVariablesTree() {
     if (m_verbose)
         std::cout << "Building variables tree" << std::endl;
 
-    for (auto& iv : this->m_variables) {
-        std::string token;
-        std::istringstream ss(iv.second.GetName());
-
-        // scan all tokens delimited by "."
-        int ntokens = 0;
-        FmuVariableTreeNode* tree_node = &this->tree_variables;
-        while (std::getline(ss, token, '.') && ntokens < 300) {
-            auto next_node = tree_node->children.find(token);
-            if (next_node != tree_node->children.end())  // already added
-            {
-                tree_node = &(next_node->second);
-            } else {
-                FmuVariableTreeNode new_node;
-                new_node.object_name = token;
-                tree_node->children[token] = new_node;
-                tree_node = &tree_node->children[token];
-            }
-            ++ntokens;
+    materializeVariables();
+
+    FmuVariableTree& tree = m_library->tree_variables;
+    tree.Clear();
+    for (auto& iv : m_library->m_variables)
+        tree.Insert(iv.second.GetName(), &iv.second);
+    tree.Finalize();
+}
+
+void FmuUnit::BuildVariablesIndex() {
+    m_library->m_valrefsByName.clear();
+    m_library->m_valrefsByName.reserve(m_library->m_variables.size());
+    m_library->m_variablesByValref.clear();
+    m_library->m_variablesByValref.reserve(m_library->m_variables.size());
+
+    // m_variables is ordered by value reference, thus m_variablesByValref comes out already sorted
+    for (auto& iv : m_library->m_variables) {
+        m_library->m_valrefsByName[iv.second.GetName()] = iv.first;
+        m_library->m_variablesByValref.push_back({iv.first, &iv.second, nullptr, iv.second.m_is_state});
+    }
+}
+
+void FmuUnit::materializeVariables() const {
+    if (!m_library->m_xml_source)
+        return;
+
+    for (auto& entry : m_library->m_variablesByValref) {
+        if (!entry.variable) {
+            findVariable(entry.valref);
         }
-        tree_node->leaf = &iv.second;
     }
+
+    // All records created: the model description is no longer needed
+    for (auto& entry : m_library->m_variablesByValref)
+        entry.node = nullptr;
+    m_library->m_xml_source.reset();
+}
+
+FmuUnit::VariableEntry& FmuUnit::findEntry(fmi3ValueReference vr) const {
+    auto it = std::lower_bound(m_library->m_variablesByValref.begin(), m_library->m_variablesByValref.end(), vr,
+                               [](const VariableEntry& entry, fmi3ValueReference val) { return entry.valref < val; });
+    if (it == m_library->m_variablesByValref.end() || it->valref != vr)
+        throw std::out_of_range("Variable not found with value reference: " + std::to_string(vr));
+    return *it;
+}
+
+FmuVariableImport& FmuUnit::findVariable(fmi3ValueReference vr) {
+    return const_cast<FmuVariableImport&>(static_cast<const FmuUnit*>(this)->findVariable(vr));
+}
+
+const FmuVariableImport& FmuUnit::findVariable(fmi3ValueReference vr) const {
+    VariableEntry& entry = findEntry(vr);
+    if (!entry.variable) {
+        // Lazy mode: create the variable record from its XML node
+        FmuVariableImport& var = m_library->m_variables[vr];
+        var = parseVariable(entry.node);
+        var.m_is_state = entry.is_state;
+        entry.variable = &var;
+    }
+    return *entry.variable;
 }
 
-void FmuUnit::PrintVariablesTree(FmuVariableTreeNode* mynode, int tab) {
-    for (auto& in : mynode->children) {
+void FmuUnit::PrintVariablesTree(FmuVariableTree::NodeId node, int tab) {
+    const FmuVariableTree& tree = m_library->tree_variables;
+    for (auto child = tree.ChildrenBegin(node); child != tree.ChildrenEnd(node); ++child) {
         for (int itab = 0; itab < tab; ++itab) {
             std::cout << "\t";
         }
 
         // name of tree level
-        std::cout << in.first;
+        std::cout << tree.GetSegmentName(*child);
 
         // level is a FMU variable (tree leaf)
-        if (in.second.leaf) {
-            std::cout << " -> FMU reference:" << in.second.leaf->GetValueReference();
+        if (tree.GetNode(*child).leaf) {
+            std::cout << " -> FMU reference:" << tree.GetNode(*child).leaf->GetValueReference();
         }
 
         std::cout << "\n";
-        PrintVariablesTree(&in.second, tab + 1);
+        PrintVariablesTree(*child, tab + 1);
     }
 }
 
@@ -1043,25 +2131,29 @@ void FmuUnit::Instantiate(const std::string& instanceName,
 
     log_message_callback = LoggingUtilities::logger_default;
 
-    fmi3InstanceEnvironment instance_environment = NULL;
+    fmi3InstanceEnvironment instance_environment = this;
+
+    const char* instantiationToken = m_library->instantiationToken.c_str();
+
+    auto trace_start = std::chrono::steady_clock::now();
 
-    if (m_fmuType == FmuType::MODEL_EXCHANGE) {
+    if (m_library->m_fmuType == FmuType::MODEL_EXCHANGE) {
         instance = _fmi3InstantiateModelExchange(instanceName.c_str(),            // instanceName
-                                                 instantiationToken.c_str(),      // instantiationToken
+                                                 instantiationToken,                         // instantiationToken
                                                  resource_dir.c_str(),            // resourcePath
                                                  visible ? fmi3True : fmi3False,  // visible
                                                  logging,                         // loggingOn
                                                  instance_environment,            // instanceEnvironment
                                                  log_message_callback             // logMessage
         );
-    } else if (m_fmuType == FmuType::COSIMULATION) {
+    } else if (m_library->m_fmuType == FmuType::COSIMULATION) {
         fmi3Boolean eventModeUsed = fmi3False;
-        fmi3Boolean earlyReturnAllowed = fmi3False;
+        fmi3Boolean earlyReturnAllowed = early_return_allowed ? fmi3True : fmi3False;
         const size_t nRequiredIntermediateVariables = 1;
         fmi3ValueReference requiredIntermediateVariables[nRequiredIntermediateVariables];
 
         instance = _fmi3InstantiateCoSimulation(instanceName.c_str(),            // instanceName
-                                                instantiationToken.c_str(),      // instantiationToken
+                                                instantiationToken,                         // instantiationToken
                                                 resource_dir.c_str(),            // resourcePath
                                                 visible ? fmi3True : fmi3False,  // visible
                                                 logging,                         // loggingOn
@@ -1072,9 +2164,9 @@ void FmuUnit::Instantiate(const std::string& instanceName,
                                                 instance_environment,            // instanceEnvironment
                                                 log_message_callback,            // logMessage
                                                 intermediate_update_callback);   // intermediateUpdate
-    } else if (m_fmuType == FmuType::SCHEDULED_EXECUTION) {
+    } else if (m_library->m_fmuType == FmuType::SCHEDULED_EXECUTION) {
         instance = _fmi3InstantiateScheduledExecution(instanceName.c_str(),            // instance name
-                                                      instantiationToken.c_str(),      // instantiationToken
+                                                      instantiationToken,                         // instantiationToken
                                                       resource_dir.c_str(),            // resource dir
                                                       visible ? fmi3True : fmi3False,  // visible
                                                       logging,                         // logging
@@ -1088,11 +2180,24 @@ void FmuUnit::Instantiate(const std::string& instanceName,
 
     if (!instance)
         throw std::runtime_error("Failed to instantiate the FMU.");
+
+    // checkpoints of a previous instance are released with it
+    m_checkpoints.clear();
+    m_checkpointCount = 0;
+
+    if (m_traceChannel) {
+        m_tracer->Record(*m_traceChannel, FmuTrace_fmi3Instantiate, trace_start, std::chrono::steady_clock::now());
+        FmuTracer::RegisterInstance(instance, m_traceChannel);
+    }
+
+    InvalidateVariableSizes();
 }
 
 void FmuUnit::Instantiate(const std::string& instanceName, bool logging, bool visible) {
+    ExtractResources();
+
     try {
-        Instantiate(instanceName, "file:///" + m_directory + "/resources", logging, visible);
+        Instantiate(instanceName, "file:///" + m_library->m_directory + "/resources", logging, visible);
     } catch (std::exception&) {
         throw;
     }
@@ -1111,6 +2216,9 @@ fmi3Status FmuUnit::EnterInitializationMode(fmi3Boolean toleranceDefined,
                                             fmi3Float64 startTime,
                                             fmi3Boolean stopTimeDefined,
                                             fmi3Float64 stopTime) {
+    // structural parameters may have been set while instantiated
+    InvalidateVariableSizes();
+
     auto status = _fmi3EnterInitializationMode(this->instance,               //
                                                toleranceDefined, tolerance,  // define tolerance
                                                startTime,                    // start time
@@ -1122,10 +2230,425 @@ fmi3Status FmuUnit::ExitInitializationMode() {
     return _fmi3ExitInitializationMode(this->instance);
 }
 
+fmi3Status FmuUnit::Recycle(fmi3Boolean toleranceDefined,
+                            fmi3Float64 tolerance,
+                            fmi3Float64 startTime,
+                            fmi3Boolean stopTimeDefined,
+                            fmi3Float64 stopTime) {
+    fmi3Status status = _fmi3Reset(this->instance);
+    if (status > fmi3Status::fmi3Warning)
+        return status;
+
+    if (!m_startValuesPrepared)
+        prepareStartValues();
+
+    for (const auto& start : m_startValues) {
+        status = std::max(status, applyStartValue(start));
+        if (status > fmi3Status::fmi3Warning)
+            return status;
+    }
+
+    return std::max(status, EnterInitializationMode(toleranceDefined, tolerance, startTime, stopTimeDefined, stopTime));
+}
+
+bool FmuUnit::EnableCheckpoints(size_t capacity, bool serialize) {
+    DisableCheckpoints();
+
+    bool model_exchange = m_library->m_fmuType == FmuType::MODEL_EXCHANGE;
+    bool cosimulation = m_library->m_fmuType == FmuType::COSIMULATION;
+    const std::string& can_get_set = model_exchange ? m_library->info_modex_canGetAndSetFMUState
+                                                    : m_library->info_cosim_canGetAndSetFMUState;
+    const std::string& can_serialize = model_exchange ? m_library->info_modex_canSerializeFMUState
+                                                      : m_library->info_cosim_canSerializeFMUState;
+    if (!instance || capacity == 0 || !(model_exchange || cosimulation) || can_get_set != "true" ||
+        (serialize && can_serialize != "true"))
+        return false;
+
+    m_checkpoints.resize(capacity);
+    for (auto& slot : m_checkpoints) {
+        if (_fmi3GetFMUState(this->instance, &slot.state) > fmi3Status::fmi3Warning) {
+            DisableCheckpoints();
+            return false;
+        }
+    }
+
+    m_checkpointSerialize = serialize;
+    m_checkpointNext = 0;
+    m_checkpointCount = 0;
+
+    return true;
+}
+
+void FmuUnit::DisableCheckpoints() {
+    for (auto& slot : m_checkpoints) {
+        if (slot.state)
+            _fmi3FreeFMUState(this->instance, &slot.state);
+    }
+    m_checkpoints.clear();
+    m_checkpointCount = 0;
+}
+
+fmi3Status FmuUnit::Checkpoint(fmi3Float64 time) {
+    if (m_checkpoints.empty())
+        throw std::runtime_error("Checkpoint: checkpoints are not enabled (see EnableCheckpoints).");
+
+    CheckpointSlot& slot = m_checkpoints[m_checkpointNext];
+
+    fmi3Status status = _fmi3GetFMUState(this->instance, &slot.state);
+    if (status > fmi3Status::fmi3Warning)
+        return status;
+
+    if (m_checkpointSerialize) {
+        // the buffer keeps its capacity, so that it is reallocated only if the state grows
+        size_t size = 0;
+        status = std::max(status, _fmi3SerializedFMUStateSize(this->instance, slot.state, &size));
+        if (status > fmi3Status::fmi3Warning)
+            return status;
+        slot.serialized.resize(size);
+        status = std::max(status, _fmi3SerializeFMUState(this->instance, slot.state, slot.serialized.data(), size));
+        if (status > fmi3Status::fmi3Warning)
+            return status;
+    }
+
+    slot.time = time;
+    m_checkpointNext = (m_checkpointNext + 1) % m_checkpoints.size();
+    m_checkpointCount = std::min(m_checkpointCount + 1, m_checkpoints.size());
+
+    return status;
+}
+
+fmi3Status FmuUnit::Rollback(size_t n) {
+    const CheckpointSlot& slot = checkpointSlot(n);
+
+    fmi3Status status = _fmi3SetFMUState(this->instance, slot.state);
+    if (status > fmi3Status::fmi3Warning)
+        return status;
+
+    m_checkpointNext = (m_checkpointNext + m_checkpoints.size() - n) % m_checkpoints.size();
+    m_checkpointCount -= n;
+
+    // structural parameters may have been restored
+    InvalidateVariableSizes();
+
+    return status;
+}
+
+const FmuUnit::CheckpointSlot& FmuUnit::checkpointSlot(size_t n) const {
+    if (n >= m_checkpointCount)
+        throw std::runtime_error("Checkpoint " + std::to_string(n) + " not available: only " +
+                                 std::to_string(m_checkpointCount) + " checkpoints are stored.");
+
+    return m_checkpoints[(m_checkpointNext + m_checkpoints.size() - 1 - n) % m_checkpoints.size()];
+}
+
+size_t FmuUnit::GetCheckpointMemory() const {
+    if (m_checkpointCount == 0)
+        return 0;
+
+    const CheckpointSlot& slot = checkpointSlot(0);
+    if (m_checkpointSerialize)
+        return slot.serialized.size();
+
+    const std::string& can_serialize = m_library->m_fmuType == FmuType::MODEL_EXCHANGE
+                                           ? m_library->info_modex_canSerializeFMUState
+                                           : m_library->info_cosim_canSerializeFMUState;
+    size_t size = 0;
+    if (can_serialize != "true" ||
+        _fmi3SerializedFMUStateSize(this->instance, slot.state, &size) > fmi3Status::fmi3Warning)
+        return 0;
+
+    return size;
+}
+
+void FmuUnit::LoadDependencies() {
+    auto source = std::make_shared<ModelDescriptionSource>();
+    if (!m_library->m_archive.empty()) {
+        source->buffer = ReadFmuArchiveEntry(m_library->m_archive, "modelDescription.xml");
+    } else {
+        source->file.reset(new MappedFile(m_library->m_directory + "/modelDescription.xml"));
+    }
+    source->doc.parse<rapidxml::parse_non_destructive>(const_cast<char*>(source->text()));
+
+    auto root_node = source->doc.first_node("fmiModelDescription");
+    if (!root_node)
+        throw std::runtime_error("Not a valid FMU. Missing <fmiModelDescription> in XML. \n");
+
+    static const char* kind_names[] = {"independent", "constant", "fixed", "tunable", "discrete", "dependent"};
+
+    std::map<fmi3ValueReference, DependencyRow> rows;
+
+    // initial unknowns are dependencies in Initialization Mode only
+    auto structure_node = root_node->first_node("ModelStructure");
+    for (auto node = structure_node ? structure_node->first_node() : nullptr; node; node = node->next_sibling()) {
+        if (areStringsEqual(node->name(), node->name_size(), "InitialUnknown"))
+            continue;
+
+        auto valref_attr = node->first_attribute("valueReference");
+        if (!valref_attr)
+            throw std::runtime_error("Cannot find 'valueReference' property in <ModelStructure> element.");
+        auto& row = rows[static_cast<fmi3ValueReference>(XmlToUnsigned(valref_attr))];
+
+        auto deps_attr = node->first_attribute("dependencies");
+        if (!deps_attr)
+            continue;
+
+        std::vector<fmi3DependencyKind> kinds;
+        if (auto kinds_attr = node->first_attribute("dependenciesKind")) {
+            std::istringstream kinds_stream(XmlString(kinds_attr));
+            std::string kind;
+            while (kinds_stream >> kind) {
+                auto k = std::find_if(std::begin(kind_names), std::end(kind_names),
+                                      [&kind](const char* name) { return kind == name; });
+                if (k == std::end(kind_names))
+                    throw std::runtime_error("Unknown dependency kind in <ModelStructure>: " + kind);
+                kinds.push_back(static_cast<fmi3DependencyKind>(k - std::begin(kind_names)));
+            }
+        }
+
+        if (!row)
+            row.reset(new DependencyRow::element_type);
+        std::istringstream deps_stream(XmlString(deps_attr));
+        unsigned long long dep;
+        for (size_t i = 0; deps_stream >> dep; ++i)
+            row->push_back({static_cast<fmi3ValueReference>(dep), i < kinds.size() ? kinds[i] : fmi3Dependent});
+    }
+
+    buildDependencies(rows);
+}
+
+fmi3Status FmuUnit::LoadDependenciesFromInstance() {
+    m_dependencies.Clear();
+    m_inputs.clear();
+    if (!instance)
+        return fmi3Status::fmi3Error;
+
+    std::map<fmi3ValueReference, DependencyRow> rows;
+
+    std::vector<size_t> element_indices, independent_indices;
+    std::vector<fmi3ValueReference> independents;
+    std::vector<fmi3DependencyKind> kinds;
+    for (const auto& iv : GetVariablesList()) {
+        const FmuVariableImport& var = iv.second;
+        if (var.GetCausality() != FmuVariable::CausalityType::output && !var.IsDeriv())
+            continue;
+
+        auto& row = rows[iv.first];
+        size_t n = 0;
+        if (_fmi3GetNumberOfVariableDependencies(instance, iv.first, &n) > fmi3Status::fmi3Warning)
+            continue;
+
+        element_indices.resize(n);
+        independents.resize(n);
+        independent_indices.resize(n);
+        kinds.resize(n);
+        if (_fmi3GetVariableDependencies(instance, iv.first, element_indices.data(), independents.data(),
+                                         independent_indices.data(), kinds.data(), n) > fmi3Status::fmi3Warning)
+            continue;
+
+        row.reset(new DependencyRow::element_type);
+        for (size_t i = 0; i < n; ++i)
+            row->push_back({independents[i], kinds[i]});
+    }
+
+    buildDependencies(rows);
+    return fmi3Status::fmi3OK;
+}
+
+void FmuUnit::buildDependencies(std::map<fmi3ValueReference, DependencyRow>& rows) {
+    m_dependencies.Clear();
+    for (auto& row : rows) {
+        m_dependencies.unknowns.push_back(row.first);
+        m_dependencies.declared.push_back(row.second ? 1 : 0);
+        if (row.second) {
+            // dependencies on different elements of the same variable are merged
+            auto& deps = *row.second;
+            std::sort(deps.begin(), deps.end());
+            deps.erase(std::unique(deps.begin(), deps.end(),
+                                   [](const std::pair<fmi3ValueReference, fmi3DependencyKind>& a,
+                                      const std::pair<fmi3ValueReference, fmi3DependencyKind>& b) {
+                                       return a.first == b.first;
+                                   }),
+                       deps.end());
+            for (const auto& dep : deps) {
+                m_dependencies.independents.push_back(dep.first);
+                m_dependencies.kinds.push_back(dep.second);
+            }
+        }
+        m_dependencies.offsets.push_back(m_dependencies.independents.size());
+    }
+
+    m_inputs.clear();
+    for (const auto& iv : GetVariablesList()) {
+        if (iv.second.GetCausality() == FmuVariable::CausalityType::input)
+            m_inputs.push_back(iv.first);
+    }
+}
+
+bool FmuUnit::DependsOn(fmi3ValueReference unknown, fmi3ValueReference known) const {
+    size_t row = m_dependencies.Find(unknown);
+    if (row == m_dependencies.unknowns.size() || !m_dependencies.declared[row])
+        return true;
+
+    auto begin = m_dependencies.independents.begin() + m_dependencies.offsets[row];
+    auto end = m_dependencies.independents.begin() + m_dependencies.offsets[row + 1];
+    return std::binary_search(begin, end, known);
+}
+
+std::vector<fmi3ValueReference> FmuUnit::GetFeedthroughInputs(fmi3ValueReference output) const {
+    size_t row = m_dependencies.Find(output);
+    if (row == m_dependencies.unknowns.size() || !m_dependencies.declared[row])
+        return m_inputs;
+
+    std::vector<fmi3ValueReference> inputs;
+    auto begin = m_dependencies.independents.begin() + m_dependencies.offsets[row];
+    auto end = m_dependencies.independents.begin() + m_dependencies.offsets[row + 1];
+    std::set_intersection(begin, end, m_inputs.begin(), m_inputs.end(), std::back_inserter(inputs));
+    return inputs;
+}
+
+bool FmuUnit::HasDirectFeedthrough(fmi3ValueReference output) const {
+    size_t row = m_dependencies.Find(output);
+    if (row == m_dependencies.unknowns.size() || !m_dependencies.declared[row])
+        return !m_inputs.empty();
+
+    auto begin = m_dependencies.independents.begin() + m_dependencies.offsets[row];
+    auto end = m_dependencies.independents.begin() + m_dependencies.offsets[row + 1];
+    return std::any_of(begin, end, [this](fmi3ValueReference vr) {
+        return std::binary_search(m_inputs.begin(), m_inputs.end(), vr);
+    });
+}
+
+template <typename T>
+static void AppendStartValue(std::vector<fmi3Byte>& data, T value) {
+    size_t offset = data.size();
+    data.resize(offset + sizeof(T));
+    std::memcpy(data.data() + offset, &value, sizeof(T));
+}
+
+void FmuUnit::prepareStartValues() {
+    m_startValues.clear();
+
+    // structural parameters are set first, since they may change the size of other variables
+    for (int structural = 1; structural >= 0; --structural) {
+        for (const auto& iv : GetVariablesList()) {
+            const FmuVariableImport& var = iv.second;
+            bool is_structural = var.GetCausality() == FmuVariable::CausalityType::structuralParameter;
+            if (var.GetStartValues().empty() || is_structural != (structural == 1) ||
+                !var.IsSetAllowed(FmuMachineState::instantiated))
+                continue;
+
+            StartValue start;
+            start.valref = iv.first;
+            start.type = var.GetType();
+            start.count = var.GetStartValues().size();
+
+            for (const auto& value : var.GetStartValues()) {
+                switch (start.type) {
+                    case FmuVariable::Type::Float32:
+                        AppendStartValue(start.data, std::stof(value));
+                        break;
+                    case FmuVariable::Type::Float64:
+                        AppendStartValue(start.data, std::stod(value));
+                        break;
+                    case FmuVariable::Type::Int8:
+                        AppendStartValue(start.data, static_cast<fmi3Int8>(std::stol(value)));
+                        break;
+                    case FmuVariable::Type::UInt8:
+                        AppendStartValue(start.data, static_cast<fmi3UInt8>(std::stoul(value)));
+                        break;
+                    case FmuVariable::Type::Int16:
+                        AppendStartValue(start.data, static_cast<fmi3Int16>(std::stol(value)));
+                        break;
+                    case FmuVariable::Type::UInt16:
+                        AppendStartValue(start.data, static_cast<fmi3UInt16>(std::stoul(value)));
+                        break;
+                    case FmuVariable::Type::Int32:
+                        AppendStartValue(start.data, static_cast<fmi3Int32>(std::stol(value)));
+                        break;
+                    case FmuVariable::Type::UInt32:
+                        AppendStartValue(start.data, static_cast<fmi3UInt32>(std::stoul(value)));
+                        break;
+                    case FmuVariable::Type::Int64:
+                        AppendStartValue(start.data, static_cast<fmi3Int64>(std::stoll(value)));
+                        break;
+                    case FmuVariable::Type::UInt64:
+                        AppendStartValue(start.data, static_cast<fmi3UInt64>(std::stoull(value)));
+                        break;
+                    case FmuVariable::Type::Boolean:
+                        AppendStartValue(start.data, static_cast<fmi3Boolean>(value == "true" || value == "1"));
+                        break;
+                    case FmuVariable::Type::String:
+                        start.strings.push_back(value);
+                        break;
+                    case FmuVariable::Type::Binary: {
+                        std::vector<fmi3Byte> bytes(value.size() / 2);
+                        for (size_t i = 0; i < bytes.size(); ++i)
+                            bytes[i] = static_cast<fmi3Byte>(std::stoul(value.substr(2 * i, 2), nullptr, 16));
+                        start.binaries.push_back(std::move(bytes));
+                        break;
+                    }
+                    default:
+                        throw std::runtime_error("Fmu Variable type not valid.");
+                }
+            }
+
+            m_startValues.push_back(std::move(start));
+        }
+    }
+
+    m_startValuesPrepared = true;
+}
+
+fmi3Status FmuUnit::applyStartValue(const StartValue& start) {
+    const fmi3ValueReference* vr = &start.valref;
+    const void* data = start.data.data();
+
+    switch (start.type) {
+        case FmuVariable::Type::Float32:
+            return _fmi3SetFloat32(this->instance, vr, 1, static_cast<const fmi3Float32*>(data), start.count);
+        case FmuVariable::Type::Float64:
+            return _fmi3SetFloat64(this->instance, vr, 1, static_cast<const fmi3Float64*>(data), start.count);
+        case FmuVariable::Type::Int8:
+            return _fmi3SetInt8(this->instance, vr, 1, static_cast<const fmi3Int8*>(data), start.count);
+        case FmuVariable::Type::UInt8:
+            return _fmi3SetUInt8(this->instance, vr, 1, static_cast<const fmi3UInt8*>(data), start.count);
+        case FmuVariable::Type::Int16:
+            return _fmi3SetInt16(this->instance, vr, 1, static_cast<const fmi3Int16*>(data), start.count);
+        case FmuVariable::Type::UInt16:
+            return _fmi3SetUInt16(this->instance, vr, 1, static_cast<const fmi3UInt16*>(data), start.count);
+        case FmuVariable::Type::Int32:
+            return _fmi3SetInt32(this->instance, vr, 1, static_cast<const fmi3Int32*>(data), start.count);
+        case FmuVariable::Type::UInt32:
+            return _fmi3SetUInt32(this->instance, vr, 1, static_cast<const fmi3UInt32*>(data), start.count);
+        case FmuVariable::Type::Int64:
+            return _fmi3SetInt64(this->instance, vr, 1, static_cast<const fmi3Int64*>(data), start.count);
+        case FmuVariable::Type::UInt64:
+            return _fmi3SetUInt64(this->instance, vr, 1, static_cast<const fmi3UInt64*>(data), start.count);
+        case FmuVariable::Type::Boolean:
+            return _fmi3SetBoolean(this->instance, vr, 1, static_cast<const fmi3Boolean*>(data), start.count);
+        case FmuVariable::Type::String:
+            m_stringBuffer.resize(start.count);
+            for (size_t i = 0; i < start.count; ++i)
+                m_stringBuffer[i] = start.strings[i].c_str();
+            return _fmi3SetString(this->instance, vr, 1, m_stringBuffer.data(), start.count);
+        case FmuVariable::Type::Binary:
+            m_binaryBuffer.resize(start.count);
+            m_binarySizeBuffer.resize(start.count);
+            for (size_t i = 0; i < start.count; ++i) {
+                m_binaryBuffer[i] = start.binaries[i].data();
+                m_binarySizeBuffer[i] = start.binaries[i].size();
+            }
+            return _fmi3SetBinary(this->instance, vr, 1, m_binarySizeBuffer.data(), m_binaryBuffer.data(),
+                                  start.count);
+        default:
+            throw std::runtime_error("Fmu Variable type not valid.");
+    }
+}
+
 fmi3Status FmuUnit::DoStep(fmi3Float64 currentCommunicationPoint,
                            fmi3Float64 communicationStepSize,
                            fmi3Boolean noSetFMUStatePriorToCurrentPoint) {
-    if (!has_cosimulation)
+    if (!m_library->has_cosimulation)
         throw std::runtime_error("DoStep available only for a Co-Simulation FMU.\n");
 
     // TODO
@@ -1140,8 +2663,41 @@ fmi3Status FmuUnit::DoStep(fmi3Float64 currentCommunicationPoint,
     return status;
 }
 
+FmuStepHandle FmuUnit::DoStepAsync(fmi3Float64 currentCommunicationPoint,
+                                   fmi3Float64 communicationStepSize,
+                                   fmi3Boolean noSetFMUStatePriorToCurrentPoint) {
+    if (!m_library->has_cosimulation)
+        throw std::runtime_error("DoStepAsync available only for a Co-Simulation FMU.\n");
+    if (!m_asyncStepAllowed && m_library->info_cosim_canRunAsynchronuously != "true")
+        throw std::runtime_error(
+            "DoStepAsync: the FMU does not declare canRunAsynchronuously (see SetAsyncStepAllowed).\n");
+
+    if (!m_stepWorker) {
+        m_stepWorker.reset(new FmuStepWorker([this](fmi3Float64 time, fmi3Float64 step, fmi3Boolean noSetFMUState) {
+            return DoStep(time, step, noSetFMUState);
+        }));
+    }
+
+    m_stepWorker->Submit(currentCommunicationPoint, communicationStepSize, noSetFMUStatePriorToCurrentPoint);
+    return FmuStepHandle(m_stepWorker.get());
+}
+
+fmi3Status FmuUnit::DoStep(fmi3Float64 currentCommunicationPoint,
+                           fmi3Float64 communicationStepSize,
+                           fmi3Boolean noSetFMUStatePriorToCurrentPoint,
+                           fmi3Boolean* eventHandlingNeeded,
+                           fmi3Boolean* terminateSimulation,
+                           fmi3Boolean* earlyReturn,
+                           fmi3Float64* lastSuccessfulTime) {
+    if (!m_library->has_cosimulation)
+        throw std::runtime_error("DoStep available only for a Co-Simulation FMU.\n");
+
+    return _fmi3DoStep(instance, currentCommunicationPoint, communicationStepSize, noSetFMUStatePriorToCurrentPoint,
+                       eventHandlingNeeded, terminateSimulation, earlyReturn, lastSuccessfulTime);
+}
+
 fmi3Status FmuUnit::SetTime(const fmi3Float64 time) {
-    if (!has_model_exchange)
+    if (!m_library->has_model_exchange)
         throw std::runtime_error("SetTime available only for a Model Exchange FMU.\n");
 
     auto status = _fmi3SetTime(this->instance, time);
@@ -1150,7 +2706,7 @@ fmi3Status FmuUnit::SetTime(const fmi3Float64 time) {
 }
 
 fmi3Status FmuUnit::GetContinuousStates(fmi3Float64 x[], size_t nx) {
-    if (!has_model_exchange)
+    if (!m_library->has_model_exchange)
         throw std::runtime_error("GetContinuousStates available only for a Model Exchange FMU. \n");
 
     auto status = _fmi3GetContinuousStates(this->instance, x, nx);
@@ -1159,7 +2715,7 @@ fmi3Status FmuUnit::GetContinuousStates(fmi3Float64 x[], size_t nx) {
 }
 
 fmi3Status FmuUnit::SetContinuousStates(const fmi3Float64 x[], size_t nx) {
-    if (!has_model_exchange)
+    if (!m_library->has_model_exchange)
         throw std::runtime_error("SetContinuousStates available only for a Model Exchange FMU. \n");
 
     auto status = _fmi3SetContinuousStates(this->instance, x, nx);
@@ -1168,7 +2724,7 @@ fmi3Status FmuUnit::SetContinuousStates(const fmi3Float64 x[], size_t nx) {
 }
 
 fmi3Status FmuUnit::GetContinuousStateDerivatives(fmi3Float64 derivatives[], size_t nx) {
-    if (!has_model_exchange)
+    if (!m_library->has_model_exchange)
         throw std::runtime_error("GetContinuousStateDerivatives available only for a Model Exchange FMU. \n");
 
     auto status = _fmi3GetContinuousStateDerivatives(this->instance, derivatives, nx);
@@ -1176,11 +2732,19 @@ fmi3Status FmuUnit::GetContinuousStateDerivatives(fmi3Float64 derivatives[], siz
     return status;
 }
 
+fmi3Status FmuUnit::ActivateModelPartition(fmi3ValueReference clockReference, fmi3Float64 activationTime) {
+    if (m_library->m_fmuType != FmuType::SCHEDULED_EXECUTION)
+        throw std::runtime_error("ActivateModelPartition available only for a Scheduled Execution FMU. \n");
+
+    return _fmi3ActivateModelPartition(this->instance, clockReference, activationTime);
+}
+
 template <class T>
 fmi3Status FmuUnit::SetVariable(fmi3ValueReference vr, const T& value, size_t nValues) noexcept(false) {
     fmi3Status status = fmi3Status::fmi3Error;
 
-    FmuVariableImport& var = m_variables.at(vr);
+    FmuVariableImport& var = findVariable(vr);
+    onSetVariable(var);
 
     if (!nValues)
         nValues = GetVariableSize(var);
@@ -1252,7 +2816,8 @@ template <class T>
 fmi3Status FmuUnit::SetVariable(fmi3ValueReference vr, const std::vector<T>& values_vect) noexcept(false) {
     fmi3Status status = fmi3Status::fmi3Error;
 
-    FmuVariableImport& var = m_variables.at(vr);
+    FmuVariableImport& var = findVariable(vr);
+    onSetVariable(var);
 
     size_t nValues = GetVariableSize(var);
     auto vartype = var.GetType();
@@ -1328,28 +2893,28 @@ fmi3Status FmuUnit::SetVariable(fmi3ValueReference vr, const std::vector<T>& val
 }
 
 fmi3Status FmuUnit::SetVariable(fmi3ValueReference vr, const std::vector<fmi3Byte>& values) noexcept(false) {
-    FmuVariableImport& var = m_variables.at(vr);
+    FmuVariableImport& var = findVariable(vr);
+    onSetVariable(var);
 
     size_t nValues = GetVariableSize(var);
     assert(nValues == 1 && "Developer error: the variable is expected to be a scalar but it is an array indeed.");
 
-    std::vector<size_t> valueSizes(1);
-    valueSizes[0] = values.size();
+    size_t valueSize = values.size();
+    fmi3Binary value = values.data();
 
     // only one variable will be parsed at a time
     const size_t nValueReferences = 1;
 
     assert(var.GetType() == FmuVariable::Type::Binary &&
            "Developer Error: SetVariable for std::vector<fmi3Byte> has been called for the wrong FMI variable type");
-    // TODO: why the casting is needed?
-    fmi3Status status = this->_fmi3SetBinary(this->instance, &vr, nValueReferences, valueSizes.data(),
-                                             (fmi3Binary*)values.data(), nValues);
+    fmi3Status status = this->_fmi3SetBinary(this->instance, &vr, nValueReferences, &valueSize, &value, nValues);
 
     return status;
 }
 
 fmi3Status FmuUnit::SetVariable(fmi3ValueReference vr, fmi3Binary& value, size_t valueSize) noexcept(false) {
-    FmuVariableImport& var = m_variables.at(vr);
+    FmuVariableImport& var = findVariable(vr);
+    onSetVariable(var);
 
     size_t nValues = GetVariableSize(var);
     assert(nValues == 1 && "The FMU variable is expected to be a scalar but it is an array.");
@@ -1367,7 +2932,8 @@ fmi3Status FmuUnit::SetVariable(fmi3ValueReference vr, fmi3Binary& value, size_t
 fmi3Status FmuUnit::SetVariable(fmi3ValueReference vr,
                                 const std::vector<fmi3Binary>& values_vect,
                                 const std::vector<size_t>& valueSizes) noexcept(false) {
-    FmuVariableImport& var = m_variables.at(vr);
+    FmuVariableImport& var = findVariable(vr);
+    onSetVariable(var);
 
     size_t nValues = GetVariableSize(var);
     assert(valueSizes.size() == values_vect.size() && "values_vect and valueSizes vectors must have the same size.");
@@ -1387,23 +2953,55 @@ fmi3Status FmuUnit::SetVariable(fmi3ValueReference vr,
 fmi3Status FmuUnit::SetVariable(fmi3ValueReference vr,
                                 const std::vector<std::vector<fmi3Byte>>& values_vect) noexcept(false) {
     size_t nValues = values_vect.size();
-    std::vector<fmi3Binary> values_vect_temp(values_vect.size());
-    for (auto s = 0; s < nValues; ++s) {
-        values_vect_temp[s] = values_vect[s].data();
+    m_binaryBuffer.resize(nValues);
+    m_binarySizeBuffer.resize(nValues);
+    for (size_t i = 0; i < nValues; ++i) {
+        m_binaryBuffer[i] = values_vect[i].data();
+        m_binarySizeBuffer[i] = values_vect[i].size();
     }
 
-    std::vector<size_t> valueSizes(nValues);
+    fmi3Status status = SetVariable(vr, m_binaryBuffer, m_binarySizeBuffer);
+
+    return status;
+}
+
+fmi3Status FmuUnit::SetVariable(fmi3ValueReference vr, const std::vector<FmuBinaryView>& values) noexcept(false) {
+    size_t nValues = values.size();
+    m_binaryBuffer.resize(nValues);
+    m_binarySizeBuffer.resize(nValues);
     for (size_t i = 0; i < nValues; ++i) {
-        valueSizes[i] = values_vect[i].size();
+        m_binaryBuffer[i] = values[i].data;
+        m_binarySizeBuffer[i] = values[i].size;
     }
 
-    fmi3Status status = SetVariable(vr, values_vect_temp, valueSizes);
+    fmi3Status status = SetVariable(vr, m_binaryBuffer, m_binarySizeBuffer);
+
+    return status;
+}
+
+fmi3Status FmuUnit::SetVariable(fmi3ValueReference vr, const FmuBinaryView& value) noexcept(false) {
+    FmuVariableImport& var = findVariable(vr);
+    onSetVariable(var);
+
+    size_t nValues = GetVariableSize(var);
+    assert(nValues == 1 && "The FMU variable is expected to be a scalar but it is an array.");
+
+    size_t valueSize = value.size;
+    fmi3Binary value_ptr = value.data;
+
+    // only one variable will be parsed at a time
+    const size_t nValueReferences = 1;
+
+    assert(var.GetType() == FmuVariable::Type::Binary &&
+           "Developer Error: SetVariable for FmuBinaryView has been called for the wrong FMI variable type");
+    fmi3Status status = this->_fmi3SetBinary(this->instance, &vr, nValueReferences, &valueSize, &value_ptr, nValues);
 
     return status;
 }
 
 fmi3Status FmuUnit::SetVariable(fmi3ValueReference vr, const std::vector<fmi3String>& values_vect) noexcept(false) {
-    FmuVariableImport& var = m_variables.at(vr);
+    FmuVariableImport& var = findVariable(vr);
+    onSetVariable(var);
 
     size_t nValues = GetVariableSize(var);
     assert(nValues == values_vect.size() && "Developer error: the variable has a size that differs from values_vect.");
@@ -1419,11 +3017,30 @@ fmi3Status FmuUnit::SetVariable(fmi3ValueReference vr, const std::vector<fmi3Str
 }
 
 fmi3Status FmuUnit::SetVariable(fmi3ValueReference vr, const std::vector<std::string>& values_vect) noexcept(false) {
-    std::vector<fmi3String> values_vect_temp(values_vect.size());
+    m_stringBuffer.resize(values_vect.size());
     for (size_t i = 0; i < values_vect.size(); ++i) {
-        values_vect_temp[i] = values_vect[i].data();
+        m_stringBuffer[i] = values_vect[i].c_str();
     }
-    fmi3Status status = SetVariable(vr, values_vect_temp);
+    fmi3Status status = SetVariable(vr, m_stringBuffer);
+
+    return status;
+}
+
+fmi3Status FmuUnit::SetVariable(fmi3ValueReference vr, const std::string& value) noexcept(false) {
+    FmuVariableImport& var = findVariable(vr);
+    onSetVariable(var);
+
+    size_t nValues = GetVariableSize(var);
+    assert(nValues == 1 && "The FMU variable is expected to be a scalar but it is an array.");
+
+    fmi3String value_ptr = value.c_str();
+
+    // only one variable will be parsed at a time
+    const size_t nValueReferences = 1;
+
+    assert(var.GetType() == FmuVariable::Type::String &&
+           "Developer Error: SetVariable for std::string has been called for the wrong FMI variable type");
+    fmi3Status status = this->_fmi3SetString(this->instance, &vr, nValueReferences, &value_ptr, nValues);
 
     return status;
 }
@@ -1436,7 +3053,7 @@ fmi3Status FmuUnit::GetVariable(fmi3ValueReference vr, T& value, size_t nValues)
     size_t valueSizes[1];
     valueSizes[0] = 1;
 
-    const FmuVariableImport& var = m_variables.at(vr);
+    const FmuVariableImport& var = findVariable(vr);
 
     if (!nValues)
         nValues = GetVariableSize(var);
@@ -1503,7 +3120,7 @@ template <class T>
 fmi3Status FmuUnit::GetVariable(fmi3ValueReference vr, std::vector<T>& values_vect) const noexcept(false) {
     fmi3Status status = fmi3Status::fmi3Error;
 
-    const FmuVariableImport& var = m_variables.at(vr);
+    const FmuVariableImport& var = findVariable(vr);
 
     size_t nValues = GetVariableSize(var);
     auto vartype = var.GetType();
@@ -1579,7 +3196,7 @@ fmi3Status FmuUnit::GetVariable(fmi3ValueReference vr, std::vector<T>& values_ve
 }
 
 fmi3Status FmuUnit::GetVariable(fmi3ValueReference vr, fmi3Binary& values, size_t& valueSize) const noexcept(false) {
-    const FmuVariableImport& var = m_variables.at(vr);
+    const FmuVariableImport& var = findVariable(vr);
 
     size_t nValues = GetVariableSize(var);
     assert(nValues == 1 && "Developer error: the variable is expected to be a scalar but it is an array indeed.");
@@ -1593,7 +3210,7 @@ fmi3Status FmuUnit::GetVariable(fmi3ValueReference vr, fmi3Binary& values, size_
 }
 
 fmi3Status FmuUnit::GetVariable(fmi3ValueReference vr, std::vector<fmi3Byte>& values) const noexcept(false) {
-    const FmuVariableImport& var = m_variables.at(vr);
+    const FmuVariableImport& var = findVariable(vr);
 
     size_t nValues = GetVariableSize(var);
     assert(nValues == 1 && "Developer error: the variable is expected to be a scalar but it is an array indeed.");
@@ -1601,15 +3218,27 @@ fmi3Status FmuUnit::GetVariable(fmi3ValueReference vr, std::vector<fmi3Byte>& va
            "Developer Error: GetVariable for std::vector<fmi3Byte> has been called for the wrong FMI variable type");
 
     const size_t nValueReferences = 1;
-    std::vector<size_t> valueSizes(1);
-    std::vector<fmi3Binary> values_ptr(1);
-    fmi3Status status =
-        this->_fmi3GetBinary(this->instance, &vr, nValueReferences, valueSizes.data(), values_ptr.data(), nValues);
+    size_t valueSize = 0;
+    fmi3Binary value_ptr = nullptr;
+    fmi3Status status = this->_fmi3GetBinary(this->instance, &vr, nValueReferences, &valueSize, &value_ptr, nValues);
 
-    values.resize(valueSizes[0]);
-    for (auto val = 0; val < valueSizes[0]; ++val) {
-        values[val] = values_ptr[0][val];
-    }
+    values.assign(value_ptr, value_ptr + valueSize);
+
+    return status;
+}
+
+fmi3Status FmuUnit::GetVariable(fmi3ValueReference vr, FmuBinaryView& value) const noexcept(false) {
+    const FmuVariableImport& var = findVariable(vr);
+
+    size_t nValues = GetVariableSize(var);
+    assert(nValues == 1 && "Developer error: the variable is expected to be a scalar but it is an array indeed.");
+    assert(var.GetType() == FmuVariable::Type::Binary &&
+           "Developer Error: GetVariable for FmuBinaryView has been called for the wrong FMI variable type");
+
+    const size_t nValueReferences = 1;
+    value.size = 0;
+    value.data = nullptr;
+    fmi3Status status = this->_fmi3GetBinary(this->instance, &vr, nValueReferences, &value.size, &value.data, nValues);
 
     return status;
 }
@@ -1617,7 +3246,7 @@ fmi3Status FmuUnit::GetVariable(fmi3ValueReference vr, std::vector<fmi3Byte>& va
 fmi3Status FmuUnit::GetVariable(fmi3ValueReference vr,
                                 std::vector<fmi3Binary>& values_vect,
                                 std::vector<size_t>& valueSizes) const noexcept(false) {
-    const FmuVariableImport& var = m_variables.at(vr);
+    const FmuVariableImport& var = findVariable(vr);
     assert(var.GetType() == FmuVariable::Type::Binary &&
            "Developer Error: GetVariable for std::vector<fmi3Binary> has been called for the wrong FMI variable type");
 
@@ -1634,33 +3263,36 @@ fmi3Status FmuUnit::GetVariable(fmi3ValueReference vr,
 
 fmi3Status FmuUnit::GetVariable(fmi3ValueReference vr, std::vector<std::vector<fmi3Byte>>& values_vect) const
     noexcept(false) {
-    const FmuVariableImport& var = m_variables.at(vr);
+    assert(findVariable(vr).GetType() == FmuVariable::Type::Binary &&
+           "GetVariable for std::vector<std::vector<fmi3Byte>> has been called for the wrong FMI variable type");
 
-    size_t nValues = GetVariableSize(var);
+    fmi3Status status = GetVariable(vr, m_binaryBuffer, m_binarySizeBuffer);
+
+    // copy the values from the FMU, reusing the storage of the elements
+    size_t nValues = m_binaryBuffer.size();
     values_vect.resize(nValues);
-    std::vector<size_t> valueSizes(nValues);
+    for (size_t val = 0; val < nValues; ++val) {
+        values_vect[val].assign(m_binaryBuffer[val], m_binaryBuffer[val] + m_binarySizeBuffer[val]);
+    }
 
-    const size_t nValueReferences = 1;
+    return status;
+}
 
-    assert(var.GetType() == FmuVariable::Type::Binary &&
-           "GetVariable for std::vector<std::vector<fmi3Byte>> has been called for the wrong FMI variable type");
-    std::vector<fmi3Binary> values_ptr(nValues);
-    fmi3Status status =
-        this->_fmi3GetBinary(this->instance, &vr, nValueReferences, valueSizes.data(), values_ptr.data(), nValues);
+fmi3Status FmuUnit::GetVariable(fmi3ValueReference vr, std::vector<FmuBinaryView>& values) const noexcept(false) {
+    fmi3Status status = GetVariable(vr, m_binaryBuffer, m_binarySizeBuffer);
 
-    // copy the values from the FMU
-    for (auto val = 0; val < nValues; ++val) {
-        values_vect[val].resize(valueSizes[val]);
-        for (auto sel = 0; sel < valueSizes[val]; ++sel) {
-            values_vect[val][sel] = values_ptr[val][sel];
-        }
+    size_t nValues = m_binaryBuffer.size();
+    values.resize(nValues);
+    for (size_t val = 0; val < nValues; ++val) {
+        values[val].data = m_binaryBuffer[val];
+        values[val].size = m_binarySizeBuffer[val];
     }
 
     return status;
 }
 
 fmi3Status FmuUnit::GetVariable(fmi3ValueReference vr, std::vector<fmi3String>& values_vect) const noexcept(false) {
-    const FmuVariableImport& var = m_variables.at(vr);
+    const FmuVariableImport& var = findVariable(vr);
     assert(var.GetType() == FmuVariable::Type::String &&
            "Developer Error: GetVariable for std::vector<fmi3String> has been called for the wrong FMI variable type");
 
@@ -1674,12 +3306,214 @@ fmi3Status FmuUnit::GetVariable(fmi3ValueReference vr, std::vector<fmi3String>&
 }
 
 fmi3Status FmuUnit::GetVariable(fmi3ValueReference vr, std::vector<std::string>& values_vect) const noexcept(false) {
-    std::vector<fmi3String> values_vect_temp;  // will be resized later
+    fmi3Status status = GetVariable(vr, m_stringBuffer);
+
+    // copy the strings from the FMU, reusing the storage of the elements
+    values_vect.resize(m_stringBuffer.size());
+    for (size_t i = 0; i < m_stringBuffer.size(); ++i) {
+        values_vect[i].assign(m_stringBuffer[i] ? m_stringBuffer[i] : "");
+    }
+
+    return status;
+}
+
+fmi3Status FmuUnit::GetVariable(fmi3ValueReference vr, std::string& value) const noexcept(false) {
+    const FmuVariableImport& var = findVariable(vr);
+
+    size_t nValues = GetVariableSize(var);
+    assert(nValues == 1 && "Developer error: the variable is expected to be a scalar but it is an array indeed.");
+    assert(var.GetType() == FmuVariable::Type::String &&
+           "Developer Error: GetVariable for std::string has been called for the wrong FMI variable type");
+
+    const size_t nValueReferences = 1;
+    fmi3String value_ptr = nullptr;
+    fmi3Status status = this->_fmi3GetString(this->instance, &vr, nValueReferences, &value_ptr, nValues);
+
+    value.assign(value_ptr ? value_ptr : "");
+
+    return status;
+}
+
+// -----------------------------------------------------------------------------
+
+FmuVariableGroup::FmuVariableGroup(FmuUnit& fmu, const std::vector<std::string>& varnames) : m_fmu(fmu) {
+    m_blockIndex.fill(-1);
+    for (const auto& name : varnames)
+        addVariable(m_fmu.GetValueReference(name));
+    allocate();
+}
+
+FmuVariableGroup::FmuVariableGroup(FmuUnit& fmu, const std::vector<fmi3ValueReference>& valrefs) : m_fmu(fmu) {
+    m_blockIndex.fill(-1);
+    for (const auto& vr : valrefs)
+        addVariable(vr);
+    allocate();
+}
+
+void FmuVariableGroup::addVariable(fmi3ValueReference vr) {
+    const FmuVariableImport* var;
+    try {
+        var = &m_fmu.GetVariableInfo(vr);
+    } catch (std::out_of_range&) {
+        throw std::runtime_error("Variable not found with value reference: " + std::to_string(vr));
+    }
+
+    auto vartype = var->GetType();
+    if (vartype == FmuVariable::Type::Unknown)
+        throw std::runtime_error("Fmu Variable type not initialized.");
+
+    int& block_id = m_blockIndex[static_cast<size_t>(vartype)];
+    if (block_id < 0) {
+        block_id = static_cast<int>(m_blocks.size());
+        m_blocks.push_back(TypeBlock());
+        m_blocks.back().type = vartype;
+    }
+
+    TypeBlock& block = m_blocks[block_id];
+    Member member;
+    member.block = block_id;
+    member.offset = block.nValues;
+    member.size = m_fmu.GetVariableSize(vr);
+
+    block.valrefs.push_back(vr);
+    block.nValues += member.size;
+    m_members.push_back(member);
+
+    if (var->GetCausality() == FmuVariable::CausalityType::structuralParameter)
+        m_structural = true;
+}
+
+void FmuVariableGroup::allocate() {
+    for (auto& block : m_blocks) {
+        size_t nbytes = block.nValues * FmuVariable::GetTypeSize(block.type);
+        block.buffer.assign((nbytes + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t), 0);
+        if (block.type == FmuVariable::Type::Binary)
+            block.valueSizes.assign(block.nValues, 0);
+    }
+}
+
+fmi3Status FmuVariableGroup::Fetch() {
+    fmi3Status status = fmi3Status::fmi3OK;
+    fmi3Instance instance = m_fmu.instance;
+
+    for (auto& block : m_blocks) {
+        const fmi3ValueReference* vrs = block.valrefs.data();
+        size_t nvr = block.valrefs.size();
+        void* values = block.buffer.data();
+        fmi3Status block_status = fmi3Status::fmi3Error;
+
+        switch (block.type) {
+            case FmuVariable::Type::Float32:
+                block_status = m_fmu._fmi3GetFloat32(instance, vrs, nvr, (fmi3Float32*)values, block.nValues);
+                break;
+            case FmuVariable::Type::Float64:
+                block_status = m_fmu._fmi3GetFloat64(instance, vrs, nvr, (fmi3Float64*)values, block.nValues);
+                break;
+            case FmuVariable::Type::Int8:
+                block_status = m_fmu._fmi3GetInt8(instance, vrs, nvr, (fmi3Int8*)values, block.nValues);
+                break;
+            case FmuVariable::Type::UInt8:
+                block_status = m_fmu._fmi3GetUInt8(instance, vrs, nvr, (fmi3UInt8*)values, block.nValues);
+                break;
+            case FmuVariable::Type::Int16:
+                block_status = m_fmu._fmi3GetInt16(instance, vrs, nvr, (fmi3Int16*)values, block.nValues);
+                break;
+            case FmuVariable::Type::UInt16:
+                block_status = m_fmu._fmi3GetUInt16(instance, vrs, nvr, (fmi3UInt16*)values, block.nValues);
+                break;
+            case FmuVariable::Type::Int32:
+                block_status = m_fmu._fmi3GetInt32(instance, vrs, nvr, (fmi3Int32*)values, block.nValues);
+                break;
+            case FmuVariable::Type::UInt32:
+                block_status = m_fmu._fmi3GetUInt32(instance, vrs, nvr, (fmi3UInt32*)values, block.nValues);
+                break;
+            case FmuVariable::Type::Int64:
+                block_status = m_fmu._fmi3GetInt64(instance, vrs, nvr, (fmi3Int64*)values, block.nValues);
+                break;
+            case FmuVariable::Type::UInt64:
+                block_status = m_fmu._fmi3GetUInt64(instance, vrs, nvr, (fmi3UInt64*)values, block.nValues);
+                break;
+            case FmuVariable::Type::Boolean:
+                block_status = m_fmu._fmi3GetBoolean(instance, vrs, nvr, (fmi3Boolean*)values, block.nValues);
+                break;
+            case FmuVariable::Type::String:
+                block_status = m_fmu._fmi3GetString(instance, vrs, nvr, (fmi3String*)values, block.nValues);
+                break;
+            case FmuVariable::Type::Binary:
+                block_status = m_fmu._fmi3GetBinary(instance, vrs, nvr, block.valueSizes.data(), (fmi3Binary*)values,
+                                                    block.nValues);
+                break;
+            default:
+                throw std::runtime_error("Fmu Variable type not valid.");
+                break;
+        }
+
+        status = std::max(status, block_status);
+    }
+
+    return status;
+}
+
+fmi3Status FmuVariableGroup::Push() {
+    fmi3Status status = fmi3Status::fmi3OK;
+    fmi3Instance instance = m_fmu.instance;
+
+    if (m_structural)
+        m_fmu.InvalidateVariableSizes();
+
+    for (auto& block : m_blocks) {
+        const fmi3ValueReference* vrs = block.valrefs.data();
+        size_t nvr = block.valrefs.size();
+        const void* values = block.buffer.data();
+        fmi3Status block_status = fmi3Status::fmi3Error;
+
+        switch (block.type) {
+            case FmuVariable::Type::Float32:
+                block_status = m_fmu._fmi3SetFloat32(instance, vrs, nvr, (const fmi3Float32*)values, block.nValues);
+                break;
+            case FmuVariable::Type::Float64:
+                block_status = m_fmu._fmi3SetFloat64(instance, vrs, nvr, (const fmi3Float64*)values, block.nValues);
+                break;
+            case FmuVariable::Type::Int8:
+                block_status = m_fmu._fmi3SetInt8(instance, vrs, nvr, (const fmi3Int8*)values, block.nValues);
+                break;
+            case FmuVariable::Type::UInt8:
+                block_status = m_fmu._fmi3SetUInt8(instance, vrs, nvr, (const fmi3UInt8*)values, block.nValues);
+                break;
+            case FmuVariable::Type::Int16:
+                block_status = m_fmu._fmi3SetInt16(instance, vrs, nvr, (const fmi3Int16*)values, block.nValues);
+                break;
+            case FmuVariable::Type::UInt16:
+                block_status = m_fmu._fmi3SetUInt16(instance, vrs, nvr, (const fmi3UInt16*)values, block.nValues);
+                break;
+            case FmuVariable::Type::Int32:
+                block_status = m_fmu._fmi3SetInt32(instance, vrs, nvr, (const fmi3Int32*)values, block.nValues);
+                break;
+            case FmuVariable::Type::UInt32:
+                block_status = m_fmu._fmi3SetUInt32(instance, vrs, nvr, (const fmi3UInt32*)values, block.nValues);
+                break;
+            case FmuVariable::Type::Int64:
+                block_status = m_fmu._fmi3SetInt64(instance, vrs, nvr, (const fmi3Int64*)values, block.nValues);
+                break;
+            case FmuVariable::Type::UInt64:
+                block_status = m_fmu._fmi3SetUInt64(instance, vrs, nvr, (const fmi3UInt64*)values, block.nValues);
+                break;
+            case FmuVariable::Type::Boolean:
+                block_status = m_fmu._fmi3SetBoolean(instance, vrs, nvr, (const fmi3Boolean*)values, block.nValues);
+                break;
+            case FmuVariable::Type::String:
+                block_status = m_fmu._fmi3SetString(instance, vrs, nvr, (const fmi3String*)values, block.nValues);
+                break;
+            case FmuVariable::Type::Binary:
+                block_status = m_fmu._fmi3SetBinary(instance, vrs, nvr, block.valueSizes.data(),
+                                                    (const fmi3Binary*)values, block.nValues);
+                break;
+            default:
+                throw std::runtime_error("Fmu Variable type not valid.");
+                break;
+        }
 
-    fmi3Status status = GetVariable(vr, values_vect_temp);
-    values_vect.resize(values_vect_temp.size());
-    for (size_t i = 0; i < values_vect_temp.size(); ++i) {
-        values_vect[i] = std::string(values_vect_temp[i]);
+        status = std::max(status, block_status);
     }
 
     return status;
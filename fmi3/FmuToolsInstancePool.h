@@ -0,0 +1,364 @@
+// =============================================================================
+// fmu-forge
+//
+// Copyright (c) 2024 Project Chrono (projectchrono.org)
+// Copyright (c) 2024 Digital Dynamics Lab, University of Parma, Italy
+// Copyright (c) 2024 Simulation Based Engineering Lab, University of Wisconsin-Madison, USA
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution.
+//
+// =============================================================================
+// Pool of instances of the same FMU for running independent simulations in parallel (FMI 3.0)
+// =============================================================================
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#if !defined(_WIN32)
+    #include <poll.h>
+    #include <sys/mman.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+#include "fmi3/FmuToolsImport.h"
+#include "fmi3/FmuToolsThreadPool.h"
+
+namespace fmu_forge {
+namespace fmi3 {
+
+/// @addtogroup fmu_forge_fmi3
+/// @{
+
+/// Pool of instances of the same FMU, used to run independent simulation jobs (e.g. parameter sweeps) in parallel.
+/// The FMU is unzipped and its shared library loaded only once; each instance is created up front and jobs are
+/// dispatched over a work-stealing thread pool.
+/// If the FMU can be instantiated only once per process, jobs are instead executed by worker processes (POSIX only;
+/// on other platforms jobs are run serially on a single instance).
+class FmuInstancePool {
+  public:
+    /// Strategy used to bring an instance back to its initial state between two jobs.
+    enum class Recycling {
+        Reset,         ///< call fmi3Reset
+        Reinstantiate  ///< call fmi3FreeInstance and instantiate again
+    };
+
+    /// Simulation job.
+    /// The job receives an instantiated FMU (the job is in charge of its initialization), the index of the job and a
+    /// vector in which results can be stored; results are collected by the pool and returned by Run.
+    using Job = std::function<void(FmuUnit& fmu, size_t job, std::vector<double>& results)>;
+
+    /// Load the FMU and create the instances.
+    /// If 'num_instances' is 0, the number of hardware threads is used.
+    FmuInstancePool(FmuType fmuType,
+                    const std::string& fmupath,
+                    const std::string& unzipdir,
+                    size_t num_instances = 0,
+                    Recycling recycling = Recycling::Reset);
+
+    ~FmuInstancePool();
+
+    /// Return the number of instances (threads or worker processes).
+    size_t GetNumInstances() const { return m_numInstances; }
+
+    /// Check if jobs are executed by worker processes.
+    bool UsesProcesses() const { return m_useProcesses; }
+
+    /// Run the given number of jobs and return the results of each job.
+    /// Exceptions thrown by the jobs are rethrown (the first one, after all the workers stopped).
+    std::vector<std::vector<double>> Run(size_t num_jobs, const Job& job);
+
+  private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<size_t> jobs;
+    };
+
+    void instantiate(FmuUnit& fmu, size_t index);
+    void recycle(FmuUnit& fmu, size_t index);
+
+    /// Get the next job for the given worker: first from its own queue, then stealing from the others.
+    bool nextJob(size_t worker, size_t& job);
+
+    std::vector<std::vector<double>> runThreads(size_t num_jobs, const Job& job);
+    std::vector<std::vector<double>> runProcesses(size_t num_jobs, const Job& job);
+
+    FmuType m_fmuType;
+    std::string m_directory;
+    Recycling m_recycling;
+    size_t m_numInstances;
+    bool m_useProcesses;
+
+    std::vector<std::unique_ptr<FmuUnit>> m_units;  ///< FMU instances (a single, non-instantiated one for processes)
+    std::vector<char> m_used;                       ///< the instance has already run a job
+    std::unique_ptr<WorkQueue[]> m_queues;
+    std::unique_ptr<FmuThreadPool> m_pool;  ///< one thread per instance (not used with processes)
+};
+
+// -----------------------------------------------------------------------------
+
+FmuInstancePool::FmuInstancePool(FmuType fmuType,
+                                 const std::string& fmupath,
+                                 const std::string& unzipdir,
+                                 size_t num_instances,
+                                 Recycling recycling)
+    : m_fmuType(fmuType), m_directory(unzipdir), m_recycling(recycling) {
+    m_numInstances = num_instances > 0 ? num_instances : std::max(1u, std::thread::hardware_concurrency());
+
+    // the first unit unzips the FMU and loads the shared library
+    m_units.emplace_back(new FmuUnit());
+    m_units[0]->Load(fmuType, fmupath, unzipdir);
+
+    m_useProcesses = m_units[0]->CanBeInstantiatedOnlyOncePerProcess() && m_numInstances > 1;
+#if defined(_WIN32)
+    if (m_useProcesses) {
+        m_useProcesses = false;
+        m_numInstances = 1;
+    }
+#endif
+
+    if (m_useProcesses)
+        return;
+
+    // further units share the model description, variables and shared library of the first one
+    auto library = m_units[0]->GetLibrary();
+    for (size_t i = 1; i < m_numInstances; ++i) {
+        m_units.emplace_back(new FmuUnit());
+        m_units[i]->LoadShared(library);
+    }
+
+    for (size_t i = 0; i < m_numInstances; ++i)
+        instantiate(*m_units[i], i);
+
+    m_used.assign(m_numInstances, 0);
+    m_queues.reset(new WorkQueue[m_numInstances]);
+    m_pool.reset(new FmuThreadPool(m_numInstances));
+}
+
+FmuInstancePool::~FmuInstancePool() {
+    if (m_useProcesses)
+        return;
+
+    for (auto& unit : m_units)
+        unit->_fmi3FreeInstance(unit->instance);
+}
+
+void FmuInstancePool::instantiate(FmuUnit& fmu, size_t index) {
+    fmu.Instantiate("FmuInstancePool_" + std::to_string(index));
+}
+
+void FmuInstancePool::recycle(FmuUnit& fmu, size_t index) {
+    // fall back to a new instance if the FMU cannot be reset
+    if (m_recycling == Recycling::Reset && fmu._fmi3Reset(fmu.instance) <= fmi3Status::fmi3Warning)
+        return;
+
+    fmu._fmi3FreeInstance(fmu.instance);
+    instantiate(fmu, index);
+}
+
+bool FmuInstancePool::nextJob(size_t worker, size_t& job) {
+    {
+        std::lock_guard<std::mutex> lock(m_queues[worker].mutex);
+        if (!m_queues[worker].jobs.empty()) {
+            job = m_queues[worker].jobs.front();
+            m_queues[worker].jobs.pop_front();
+            return true;
+        }
+    }
+
+    // steal from the back of the queues of the other workers
+    for (size_t k = 1; k < m_numInstances; ++k) {
+        auto& victim = m_queues[(worker + k) % m_numInstances];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = victim.jobs.back();
+            victim.jobs.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::vector<std::vector<double>> FmuInstancePool::Run(size_t num_jobs, const Job& job) {
+    if (m_useProcesses)
+        return runProcesses(num_jobs, job);
+    return runThreads(num_jobs, job);
+}
+
+std::vector<std::vector<double>> FmuInstancePool::runThreads(size_t num_jobs, const Job& job) {
+    std::vector<std::vector<double>> results(num_jobs);
+
+    // contiguous blocks of jobs are initially assigned to each worker
+    for (size_t i = 0; i < m_numInstances; ++i) {
+        for (size_t j = i * num_jobs / m_numInstances; j < (i + 1) * num_jobs / m_numInstances; ++j)
+            m_queues[i].jobs.push_back(j);
+    }
+
+    std::mutex exception_mutex;
+    std::exception_ptr exception;
+    std::atomic<bool> failed(false);
+
+    auto worker = [&](size_t w) {
+        size_t j;
+        while (!failed && nextJob(w, j)) {
+            try {
+                if (m_used[w])
+                    recycle(*m_units[w], w);
+                m_used[w] = 1;
+                job(*m_units[w], j, results[j]);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(exception_mutex);
+                if (!exception)
+                    exception = std::current_exception();
+                failed = true;
+            }
+        }
+    };
+
+    // each index of the parallel loop drains the queue of an instance, then steals from the others
+    m_pool->ParallelFor(m_numInstances, worker);
+
+    for (size_t i = 0; i < m_numInstances; ++i)
+        m_queues[i].jobs.clear();
+
+    if (exception)
+        std::rethrow_exception(exception);
+
+    return results;
+}
+
+std::vector<std::vector<double>> FmuInstancePool::runProcesses(size_t num_jobs, const Job& job) {
+    std::vector<std::vector<double>> results(num_jobs);
+
+#if !defined(_WIN32)
+    // job counter shared among the worker processes (dynamic scheduling)
+    void* shared = mmap(nullptr, sizeof(std::atomic<size_t>), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                        -1, 0);
+    if (shared == MAP_FAILED)
+        throw std::runtime_error("FmuInstancePool: cannot allocate shared memory.");
+    auto counter = new (shared) std::atomic<size_t>(0);
+
+    std::vector<pid_t> pids;
+    std::vector<int> fds;
+    for (size_t w = 0; w < m_numInstances; ++w) {
+        int fd[2];
+        if (pipe(fd) != 0)
+            break;
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            // worker process: results are sent as (job, size, values) records
+            close(fd[0]);
+            int exit_code = 0;
+            try {
+                FmuUnit& fmu = *m_units[0];
+                instantiate(fmu, w);
+                bool used = false;
+                std::vector<double> values;
+                for (size_t j = (*counter)++; j < num_jobs; j = (*counter)++) {
+                    if (used)
+                        recycle(fmu, w);
+                    used = true;
+                    values.clear();
+                    job(fmu, j, values);
+
+                    std::uint64_t header[2] = {j, values.size()};
+                    if (write(fd[1], header, sizeof(header)) != sizeof(header) ||
+                        write(fd[1], values.data(), values.size() * sizeof(double)) !=
+                            static_cast<ssize_t>(values.size() * sizeof(double)))
+                        throw std::runtime_error("FmuInstancePool: cannot send results.");
+                }
+                fmu._fmi3FreeInstance(fmu.instance);
+            } catch (std::exception& e) {
+                std::cerr << "FmuInstancePool worker " << w << ": " << e.what() << std::endl;
+                exit_code = 1;
+            }
+            close(fd[1]);
+            _exit(exit_code);
+        }
+
+        close(fd[1]);
+        if (pid < 0) {
+            close(fd[0]);
+            break;
+        }
+        pids.push_back(pid);
+        fds.push_back(fd[0]);
+    }
+
+    // collect the results from all the workers as they are produced
+    std::vector<std::vector<char>> buffers(fds.size());
+    std::vector<pollfd> pfds(fds.size());
+    for (size_t i = 0; i < fds.size(); ++i)
+        pfds[i] = {fds[i], POLLIN, 0};
+
+    size_t open_fds = fds.size();
+    char chunk[65536];
+    while (open_fds > 0) {
+        if (poll(pfds.data(), pfds.size(), -1) < 0)
+            break;
+        for (size_t i = 0; i < pfds.size(); ++i) {
+            if (pfds[i].fd < 0 || !(pfds[i].revents & (POLLIN | POLLHUP)))
+                continue;
+            ssize_t n = read(pfds[i].fd, chunk, sizeof(chunk));
+            if (n <= 0) {
+                close(pfds[i].fd);
+                pfds[i].fd = -1;
+                open_fds--;
+                continue;
+            }
+            auto& buffer = buffers[i];
+            buffer.insert(buffer.end(), chunk, chunk + n);
+
+            // decode the complete records
+            size_t pos = 0;
+            std::uint64_t header[2];
+            while (buffer.size() - pos >= sizeof(header)) {
+                std::memcpy(header, buffer.data() + pos, sizeof(header));
+                size_t record_size = sizeof(header) + header[1] * sizeof(double);
+                if (buffer.size() - pos < record_size)
+                    break;
+                if (header[0] < num_jobs) {
+                    results[header[0]].resize(header[1]);
+                    std::memcpy(results[header[0]].data(), buffer.data() + pos + sizeof(header),
+                                header[1] * sizeof(double));
+                }
+                pos += record_size;
+            }
+            buffer.erase(buffer.begin(), buffer.begin() + pos);
+        }
+    }
+
+    bool failed = pids.size() < m_numInstances;
+    for (auto pid : pids) {
+        int wstatus = 0;
+        waitpid(pid, &wstatus, 0);
+        failed = failed || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0;
+    }
+
+    counter->~atomic();
+    munmap(shared, sizeof(std::atomic<size_t>));
+
+    if (failed)
+        throw std::runtime_error("FmuInstancePool: one or more worker processes failed.");
+#endif
+
+    return results;
+}
+
+/// @} fmu_forge_fmi3
+
+}  // namespace fmi3
+}  // namespace fmu_forge
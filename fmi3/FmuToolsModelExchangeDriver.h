@@ -0,0 +1,615 @@
+// =============================================================================
+// fmu-forge
+//
+// Copyright (c) 2024 Project Chrono (projectchrono.org)
+// Copyright (c) 2024 Digital Dynamics Lab, University of Parma, Italy
+// Copyright (c) 2024 Simulation Based Engineering Lab, University of Wisconsin-Madison, USA
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution.
+//
+// =============================================================================
+// Driver for the simulation of Model Exchange FMUs (FMI 3.0)
+// =============================================================================
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+
+#include "fmi3/FmuToolsImport.h"
+
+namespace fmu_forge {
+namespace fmi3 {
+
+/// @addtogroup fmu_forge_fmi3
+/// @{
+
+/// Driver running the simulation loop of a Model Exchange FMU with a built-in integrator.
+/// The driver handles time, state and step events (event indicators are located through bisection on the dense
+/// output of the integrator) and the event iteration through fmi3UpdateDiscreteStates.
+/// All the buffers are allocated by Initialize, so that no allocation happens during AdvanceTo.
+class ModelExchangeDriver {
+  public:
+    enum class Integrator {
+        RK4,   ///< explicit Runge-Kutta, 4th order, fixed step
+        RK45,  ///< explicit Runge-Kutta Dormand-Prince 5(4), adaptive step
+        BDF    ///< implicit BDF2 (BDF1 at startup and after events), fixed step halved on Newton failures
+    };
+
+    ModelExchangeDriver(FmuUnit& fmu, Integrator integrator = Integrator::RK45);
+
+    void SetIntegrator(Integrator integrator) { m_integrator = integrator; }
+
+    /// Set the integration step size (fixed step integrators) or the initial step size (adaptive integrators).
+    void SetStepSize(double step_size) { m_stepSize = step_size; }
+
+    /// Set the maximum step size of the adaptive integrators.
+    void SetMaxStepSize(double max_step_size) { m_maxStepSize = max_step_size; }
+
+    /// Set the tolerances used by the RK45 error control and by the BDF Newton iterations.
+    /// Absolute tolerances are scaled by the nominal values of the continuous states.
+    void SetTolerances(double rel_tol, double abs_tol) {
+        m_relTol = rel_tol;
+        m_absTol = abs_tol;
+    }
+
+    /// Initialize the driver at the given time.
+    /// Must be called after fmi3ExitInitializationMode: the initial event iteration is performed and the FMU is put
+    /// in Continuous-Time Mode.
+    fmi3Status Initialize(double start_time);
+
+    /// Integrate the FMU up to the given time, handling any event in between.
+    /// The integration stops earlier if the FMU requests to terminate the simulation.
+    fmi3Status AdvanceTo(double time);
+
+    double GetTime() const { return m_time; }
+    bool IsTerminated() const { return m_terminated; }
+
+    const std::vector<fmi3Float64>& GetStates() const { return m_x; }
+    const std::vector<fmi3Float64>& GetDerivatives() const { return m_dx; }
+
+    size_t GetNumSteps() const { return m_numSteps; }
+    size_t GetNumRejectedSteps() const { return m_numRejectedSteps; }
+    size_t GetNumEvents() const { return m_numEvents; }
+    size_t GetNumDerivativeEvaluations() const { return m_numEvaluations; }
+
+  private:
+    /// Evaluate the state derivatives at the given time and states.
+    fmi3Status evaluate(double t, const fmi3Float64* x, fmi3Float64* dx);
+
+    /// Evaluate the event indicators at the given time and states.
+    fmi3Status evaluateIndicators(double t, const fmi3Float64* x, fmi3Float64* z);
+
+    /// Compute a step of size h (from m_time, m_x, m_dx) into m_xNew, m_dxNew.
+    /// Return false if the step is rejected (error control or Newton failure); h is updated with the suggested size.
+    bool step(double& h, double& h_next, fmi3Status& status);
+    bool stepRK4(double h, fmi3Status& status);
+    bool stepRK45(double h, double& h_next, fmi3Status& status);
+    bool stepBDF(double h, fmi3Status& status);
+
+    /// Hermite interpolation of the states over the last step, at theta in [0,1].
+    void interpolate(double h, double theta, fmi3Float64* x) const;
+
+    /// Weighted RMS norm of v, with weights based on the tolerances, the nominals and the states.
+    double weightedNorm(const fmi3Float64* v, const fmi3Float64* x) const;
+
+    /// Event iteration through fmi3UpdateDiscreteStates; the FMU is expected to be in Event Mode.
+    fmi3Status handleEvent();
+
+    /// Update the states, nominals, derivatives and event indicators after an event.
+    fmi3Status refreshAfterEvent(bool values_changed, bool nominals_changed);
+
+    /// Compute the BDF iteration matrix (I - gamma*J) and its LU factorization.
+    fmi3Status factorizeIterationMatrix(double t, const fmi3Float64* x, const fmi3Float64* dx, double gamma);
+
+    /// Solve the system with the LU factorization of the iteration matrix (in place).
+    void solveIterationMatrix(fmi3Float64* b) const;
+
+    FmuUnit& m_fmu;
+    Integrator m_integrator;
+
+    double m_stepSize = 1e-3;
+    double m_maxStepSize = std::numeric_limits<double>::infinity();
+    double m_relTol = 1e-6;
+    double m_absTol = 1e-8;
+
+    size_t m_nx = 0;
+    size_t m_nz = 0;
+
+    double m_time = 0;
+    double m_stepSizeNext = 0;  ///< step size suggested by the last step
+    bool m_nextEventTimeDefined = false;
+    double m_nextEventTime = 0;
+    bool m_terminated = false;
+
+    std::vector<fmi3Float64> m_x;         ///< continuous states
+    std::vector<fmi3Float64> m_dx;        ///< state derivatives
+    std::vector<fmi3Float64> m_xNew;      ///< continuous states at the end of the step
+    std::vector<fmi3Float64> m_dxNew;     ///< state derivatives at the end of the step
+    std::vector<fmi3Float64> m_xTmp;      ///< states at intermediate stages|interpolation points
+    std::vector<fmi3Float64> m_err;       ///< local error estimate|Newton residual
+    std::vector<fmi3Float64> m_nominals;  ///< nominal values of the continuous states
+    std::vector<std::vector<fmi3Float64>> m_k;  ///< Runge-Kutta stages
+
+    std::vector<fmi3Float64> m_z;     ///< event indicators
+    std::vector<fmi3Float64> m_zNew;  ///< event indicators at the end of the step
+    std::vector<fmi3Float64> m_zTmp;  ///< event indicators at the interpolation points
+
+    // BDF data
+    std::vector<fmi3Float64> m_xPrev;    ///< states at the previous step
+    double m_stepSizePrev = 0;           ///< size of the previous step (0 if no history is available)
+    std::vector<fmi3Float64> m_jac;      ///< iteration matrix, row-major, LU-factorized in place
+    std::vector<size_t> m_pivots;        ///< pivots of the LU factorization
+    double m_jacGamma = 0;               ///< gamma used to compute the current iteration matrix
+    bool m_jacValid = false;             ///< the iteration matrix can be reused
+
+    size_t m_numSteps = 0;
+    size_t m_numRejectedSteps = 0;
+    size_t m_numEvents = 0;
+    size_t m_numEvaluations = 0;
+};
+
+// -----------------------------------------------------------------------------
+
+ModelExchangeDriver::ModelExchangeDriver(FmuUnit& fmu, Integrator integrator) : m_fmu(fmu), m_integrator(integrator) {}
+
+fmi3Status ModelExchangeDriver::Initialize(double start_time) {
+    m_time = start_time;
+    m_terminated = false;
+    m_stepSizeNext = m_stepSize;
+    m_stepSizePrev = 0;
+    m_jacValid = false;
+    m_numSteps = 0;
+    m_numRejectedSteps = 0;
+    m_numEvents = 0;
+    m_numEvaluations = 0;
+
+    m_nx = m_fmu.GetNumStates();
+    m_nz = 0;
+    size_t nz;
+    if (m_fmu._fmi3GetNumberOfEventIndicators(m_fmu.instance, &nz) == fmi3Status::fmi3OK)
+        m_nz = nz;
+
+    m_x.assign(m_nx, 0.0);
+    m_dx.assign(m_nx, 0.0);
+    m_xNew.assign(m_nx, 0.0);
+    m_dxNew.assign(m_nx, 0.0);
+    m_xTmp.assign(m_nx, 0.0);
+    m_err.assign(m_nx, 0.0);
+    m_nominals.assign(m_nx, 1.0);
+    m_k.assign(7, std::vector<fmi3Float64>(m_nx, 0.0));
+    m_xPrev.assign(m_nx, 0.0);
+    m_jac.assign(m_nx * m_nx, 0.0);
+    m_pivots.assign(m_nx, 0);
+
+    m_z.assign(m_nz, 0.0);
+    m_zNew.assign(m_nz, 0.0);
+    m_zTmp.assign(m_nz, 0.0);
+
+    // initial states and nominals; they are refreshed again only if changed by the event iteration
+    fmi3Status status = m_fmu.GetContinuousStates(m_x.data(), m_nx);
+    if (m_nx > 0 &&
+        m_fmu._fmi3GetNominalsOfContinuousStates(m_fmu.instance, m_nominals.data(), m_nx) != fmi3Status::fmi3OK)
+        std::fill(m_nominals.begin(), m_nominals.end(), 1.0);
+
+    // initial event iteration (the FMU is in Event Mode after fmi3ExitInitializationMode)
+    return std::max(status, handleEvent());
+}
+
+fmi3Status ModelExchangeDriver::AdvanceTo(double time) {
+    fmi3Status status = fmi3Status::fmi3OK;
+
+    const double time_eps = 100 * std::numeric_limits<double>::epsilon() * std::max(1.0, std::abs(time));
+
+    while (!m_terminated && m_time < time - time_eps) {
+        // limit the step to the requested time and the next time event
+        double h = std::min(m_stepSizeNext, m_maxStepSize);
+        bool time_event = false;
+        if (m_time + h >= time - time_eps)
+            h = time - m_time;
+        if (m_nextEventTimeDefined && m_time + h >= m_nextEventTime - time_eps) {
+            h = m_nextEventTime - m_time;
+            time_event = true;
+        }
+
+        double h_next = h;
+        if (!step(h, h_next, status)) {
+            if (status > fmi3Status::fmi3Warning)
+                return status;
+            m_numRejectedSteps++;
+            m_stepSizeNext = h;
+            continue;
+        }
+
+        // look for state events by checking the sign of the event indicators at the end of the step
+        bool state_event = false;
+        double theta = 1;
+        if (m_nz > 0) {
+            status = std::max(status, evaluateIndicators(m_time + h, m_xNew.data(), m_zNew.data()));
+
+            auto crossed = [this](const std::vector<fmi3Float64>& z) {
+                for (size_t i = 0; i < m_nz; ++i) {
+                    if ((m_z[i] > 0 && z[i] <= 0) || (m_z[i] < 0 && z[i] >= 0))
+                        return true;
+                }
+                return false;
+            };
+
+            if (crossed(m_zNew)) {
+                // bisection on the dense output for the first crossing
+                state_event = true;
+                double theta_lo = 0;
+                double theta_hi = 1;
+                const double event_tol = time_eps / std::max(h, time_eps);
+                while (theta_hi - theta_lo > event_tol) {
+                    double theta_mid = 0.5 * (theta_lo + theta_hi);
+                    interpolate(h, theta_mid, m_xTmp.data());
+                    status = std::max(status, evaluateIndicators(m_time + theta_mid * h, m_xTmp.data(), m_zTmp.data()));
+                    if (crossed(m_zTmp))
+                        theta_hi = theta_mid;
+                    else
+                        theta_lo = theta_mid;
+                }
+                theta = theta_hi;
+                if (theta < 1) {
+                    interpolate(h, theta, m_xTmp.data());
+                    m_xNew.swap(m_xTmp);
+                    status = std::max(status, evaluate(m_time + theta * h, m_xNew.data(), m_dxNew.data()));
+                }
+                time_event = false;
+            }
+        }
+
+        // accept the step
+        if (m_integrator == Integrator::BDF) {
+            m_xPrev = m_x;
+            m_stepSizePrev = theta * h;
+        }
+        m_time = (time_event && theta == 1) ? m_nextEventTime : m_time + theta * h;
+        m_x.swap(m_xNew);
+        m_dx.swap(m_dxNew);
+        m_numSteps++;
+        m_stepSizeNext = h_next;
+
+        // the FMU must see the accepted time and states before fmi3CompletedIntegratorStep
+        status = std::max(status, m_fmu.SetTime(m_time));
+        status = std::max(status, m_fmu.SetContinuousStates(m_x.data(), m_nx));
+
+        fmi3Boolean step_event = fmi3False;
+        fmi3Boolean terminate = fmi3False;
+        status = std::max(status,
+                          m_fmu._fmi3CompletedIntegratorStep(m_fmu.instance, fmi3True, &step_event, &terminate));
+        if (terminate) {
+            m_terminated = true;
+            break;
+        }
+
+        if (time_event || state_event || step_event) {
+            m_numEvents++;
+            status = std::max(status, m_fmu._fmi3EnterEventMode(m_fmu.instance));
+            status = std::max(status, handleEvent());
+            if (status > fmi3Status::fmi3Warning || m_terminated)
+                return status;
+        } else if (m_nz > 0) {
+            m_z.swap(m_zNew);
+        }
+    }
+
+    return status;
+}
+
+fmi3Status ModelExchangeDriver::handleEvent() {
+    fmi3Status status = fmi3Status::fmi3OK;
+
+    fmi3Boolean discrete_states_need_update = fmi3True;
+    fmi3Boolean terminate = fmi3False;
+    fmi3Boolean nominals_changed = fmi3False;
+    fmi3Boolean values_changed = fmi3False;
+    fmi3Boolean next_event_time_defined = fmi3False;
+    fmi3Float64 next_event_time = 0;
+
+    bool any_nominals_changed = false;
+    bool any_values_changed = false;
+
+    while (discrete_states_need_update) {
+        status = std::max(status, m_fmu._fmi3UpdateDiscreteStates(m_fmu.instance, &discrete_states_need_update,
+                                                                  &terminate, &nominals_changed, &values_changed,
+                                                                  &next_event_time_defined, &next_event_time));
+        if (status > fmi3Status::fmi3Warning)
+            return status;
+
+        any_nominals_changed = any_nominals_changed || nominals_changed;
+        any_values_changed = any_values_changed || values_changed;
+
+        if (terminate) {
+            m_terminated = true;
+            return status;
+        }
+    }
+
+    m_nextEventTimeDefined = next_event_time_defined;
+    m_nextEventTime = next_event_time;
+
+    status = std::max(status, m_fmu._fmi3EnterContinuousTimeMode(m_fmu.instance));
+    if (status > fmi3Status::fmi3Warning)
+        return status;
+
+    return std::max(status, refreshAfterEvent(any_values_changed, any_nominals_changed));
+}
+
+fmi3Status ModelExchangeDriver::refreshAfterEvent(bool values_changed, bool nominals_changed) {
+    fmi3Status status = fmi3Status::fmi3OK;
+
+    if (values_changed)
+        status = std::max(status, m_fmu.GetContinuousStates(m_x.data(), m_nx));
+
+    if (nominals_changed && m_nx > 0) {
+        // FMUs not providing nominals keep the default value 1
+        if (m_fmu._fmi3GetNominalsOfContinuousStates(m_fmu.instance, m_nominals.data(), m_nx) != fmi3Status::fmi3OK)
+            std::fill(m_nominals.begin(), m_nominals.end(), 1.0);
+    }
+
+    status = std::max(status, evaluate(m_time, m_x.data(), m_dx.data()));
+    if (m_nz > 0)
+        status = std::max(status, evaluateIndicators(m_time, m_x.data(), m_z.data()));
+
+    // multistep history is not valid across events
+    m_stepSizePrev = 0;
+    m_jacValid = false;
+
+    return status;
+}
+
+fmi3Status ModelExchangeDriver::evaluate(double t, const fmi3Float64* x, fmi3Float64* dx) {
+    m_numEvaluations++;
+    fmi3Status status = m_fmu.SetTime(t);
+    status = std::max(status, m_fmu.SetContinuousStates(x, m_nx));
+    return std::max(status, m_fmu.GetContinuousStateDerivatives(dx, m_nx));
+}
+
+fmi3Status ModelExchangeDriver::evaluateIndicators(double t, const fmi3Float64* x, fmi3Float64* z) {
+    fmi3Status status = m_fmu.SetTime(t);
+    status = std::max(status, m_fmu.SetContinuousStates(x, m_nx));
+    return std::max(status, m_fmu._fmi3GetEventIndicators(m_fmu.instance, z, m_nz));
+}
+
+bool ModelExchangeDriver::step(double& h, double& h_next, fmi3Status& status) {
+    switch (m_integrator) {
+        case Integrator::RK4:
+            h_next = m_stepSize;
+            return stepRK4(h, status);
+        case Integrator::RK45: {
+            bool accepted = stepRK45(h, h_next, status);
+            if (!accepted)
+                h = h_next;
+            return accepted;
+        }
+        case Integrator::BDF: {
+            bool accepted = stepBDF(h, status);
+            if (!accepted) {
+                h = 0.5 * h;
+            } else {
+                // recover the nominal step size after Newton failures
+                h_next = std::min(2 * h, m_stepSize);
+            }
+            return accepted;
+        }
+    }
+    return false;
+}
+
+bool ModelExchangeDriver::stepRK4(double h, fmi3Status& status) {
+    auto& k2 = m_k[1];
+    auto& k3 = m_k[2];
+    auto& k4 = m_k[3];
+
+    for (size_t i = 0; i < m_nx; ++i)
+        m_xTmp[i] = m_x[i] + 0.5 * h * m_dx[i];
+    status = std::max(status, evaluate(m_time + 0.5 * h, m_xTmp.data(), k2.data()));
+
+    for (size_t i = 0; i < m_nx; ++i)
+        m_xTmp[i] = m_x[i] + 0.5 * h * k2[i];
+    status = std::max(status, evaluate(m_time + 0.5 * h, m_xTmp.data(), k3.data()));
+
+    for (size_t i = 0; i < m_nx; ++i)
+        m_xTmp[i] = m_x[i] + h * k3[i];
+    status = std::max(status, evaluate(m_time + h, m_xTmp.data(), k4.data()));
+
+    for (size_t i = 0; i < m_nx; ++i)
+        m_xNew[i] = m_x[i] + h / 6 * (m_dx[i] + 2 * k2[i] + 2 * k3[i] + k4[i]);
+    status = std::max(status, evaluate(m_time + h, m_xNew.data(), m_dxNew.data()));
+
+    return status <= fmi3Status::fmi3Warning;
+}
+
+bool ModelExchangeDriver::stepRK45(double h, double& h_next, fmi3Status& status) {
+    // Dormand-Prince 5(4) coefficients
+    static const double c[7] = {0, 1.0 / 5, 3.0 / 10, 4.0 / 5, 8.0 / 9, 1, 1};
+    static const double a[7][6] = {{0, 0, 0, 0, 0, 0},
+                                   {1.0 / 5, 0, 0, 0, 0, 0},
+                                   {3.0 / 40, 9.0 / 40, 0, 0, 0, 0},
+                                   {44.0 / 45, -56.0 / 15, 32.0 / 9, 0, 0, 0},
+                                   {19372.0 / 6561, -25360.0 / 2187, 64448.0 / 6561, -212.0 / 729, 0, 0},
+                                   {9017.0 / 3168, -355.0 / 33, 46732.0 / 5247, 49.0 / 176, -5103.0 / 18656, 0},
+                                   {35.0 / 384, 0, 500.0 / 1113, 125.0 / 192, -2187.0 / 6784, 11.0 / 84}};
+    static const double e[7] = {71.0 / 57600,  0, -71.0 / 16695, 71.0 / 1920, -17253.0 / 339200,
+                                22.0 / 525, -1.0 / 40};
+
+    // first stage is the derivative at the beginning of the step (FSAL)
+    std::copy(m_dx.begin(), m_dx.end(), m_k[0].begin());
+
+    for (int s = 1; s < 6; ++s) {
+        for (size_t i = 0; i < m_nx; ++i) {
+            double sum = 0;
+            for (int j = 0; j < s; ++j)
+                sum += a[s][j] * m_k[j][i];
+            m_xTmp[i] = m_x[i] + h * sum;
+        }
+        status = std::max(status, evaluate(m_time + c[s] * h, m_xTmp.data(), m_k[s].data()));
+    }
+
+    for (size_t i = 0; i < m_nx; ++i) {
+        double sum = 0;
+        for (int j = 0; j < 6; ++j)
+            sum += a[6][j] * m_k[j][i];
+        m_xNew[i] = m_x[i] + h * sum;
+    }
+    status = std::max(status, evaluate(m_time + h, m_xNew.data(), m_dxNew.data()));
+    std::copy(m_dxNew.begin(), m_dxNew.end(), m_k[6].begin());
+
+    if (status > fmi3Status::fmi3Warning)
+        return false;
+
+    for (size_t i = 0; i < m_nx; ++i) {
+        double sum = 0;
+        for (int j = 0; j < 7; ++j)
+            sum += e[j] * m_k[j][i];
+        m_err[i] = h * sum;
+    }
+
+    double err = weightedNorm(m_err.data(), m_xNew.data());
+    double factor = err > 0 ? 0.9 * std::pow(err, -0.2) : 5.0;
+    h_next = std::min(h * std::min(5.0, std::max(0.2, factor)), m_maxStepSize);
+
+    return err <= 1;
+}
+
+bool ModelExchangeDriver::stepBDF(double h, fmi3Status& status) {
+    // variable-step BDF2: x_new - a1*x - a2*x_prev = gamma*f(t+h, x_new); BDF1 without history
+    double a1 = 1;
+    double a2 = 0;
+    double gamma = h;
+    if (m_stepSizePrev > 0) {
+        double w = h / m_stepSizePrev;
+        a1 = (1 + w) * (1 + w) / (1 + 2 * w);
+        a2 = -w * w / (1 + 2 * w);
+        gamma = h * (1 + w) / (1 + 2 * w);
+    }
+
+    if (!m_jacValid || std::abs(gamma - m_jacGamma) > 1e-3 * gamma) {
+        status = std::max(status, factorizeIterationMatrix(m_time, m_x.data(), m_dx.data(), gamma));
+        if (status > fmi3Status::fmi3Warning)
+            return false;
+    }
+
+    // explicit Euler predictor
+    for (size_t i = 0; i < m_nx; ++i)
+        m_xNew[i] = m_x[i] + h * m_dx[i];
+
+    const int max_iterations = 5;
+    for (int iter = 0; iter < max_iterations; ++iter) {
+        status = std::max(status, evaluate(m_time + h, m_xNew.data(), m_dxNew.data()));
+        if (status > fmi3Status::fmi3Warning)
+            return false;
+
+        for (size_t i = 0; i < m_nx; ++i)
+            m_err[i] = -(m_xNew[i] - a1 * m_x[i] - a2 * m_xPrev[i] - gamma * m_dxNew[i]);
+        solveIterationMatrix(m_err.data());
+        for (size_t i = 0; i < m_nx; ++i)
+            m_xNew[i] += m_err[i];
+
+        if (weightedNorm(m_err.data(), m_xNew.data()) < 0.1) {
+            status = std::max(status, evaluate(m_time + h, m_xNew.data(), m_dxNew.data()));
+            return status <= fmi3Status::fmi3Warning;
+        }
+    }
+
+    // Newton failure: the iteration matrix is recomputed at the next attempt
+    m_jacValid = false;
+    return false;
+}
+
+fmi3Status ModelExchangeDriver::factorizeIterationMatrix(double t,
+                                                         const fmi3Float64* x,
+                                                         const fmi3Float64* dx,
+                                                         double gamma) {
+    fmi3Status status = fmi3Status::fmi3OK;
+
+    // Jacobian by forward finite differences, column by column
+    const double sqrt_eps = std::sqrt(std::numeric_limits<double>::epsilon());
+    std::copy(x, x + m_nx, m_xTmp.begin());
+    for (size_t j = 0; j < m_nx; ++j) {
+        double dxj = sqrt_eps * std::max(std::abs(x[j]), m_nominals[j]);
+        m_xTmp[j] = x[j] + dxj;
+        status = std::max(status, evaluate(t, m_xTmp.data(), m_err.data()));
+        m_xTmp[j] = x[j];
+        for (size_t i = 0; i < m_nx; ++i)
+            m_jac[i * m_nx + j] = -gamma * (m_err[i] - dx[i]) / dxj;
+        m_jac[j * m_nx + j] += 1;
+    }
+
+    // LU factorization with partial pivoting
+    for (size_t k = 0; k < m_nx; ++k) {
+        size_t p = k;
+        for (size_t i = k + 1; i < m_nx; ++i) {
+            if (std::abs(m_jac[i * m_nx + k]) > std::abs(m_jac[p * m_nx + k]))
+                p = i;
+        }
+        m_pivots[k] = p;
+        if (p != k) {
+            for (size_t j = 0; j < m_nx; ++j)
+                std::swap(m_jac[k * m_nx + j], m_jac[p * m_nx + j]);
+        }
+
+        double pivot = m_jac[k * m_nx + k];
+        if (pivot == 0)
+            return fmi3Status::fmi3Error;
+
+        for (size_t i = k + 1; i < m_nx; ++i) {
+            double l = m_jac[i * m_nx + k] / pivot;
+            m_jac[i * m_nx + k] = l;
+            for (size_t j = k + 1; j < m_nx; ++j)
+                m_jac[i * m_nx + j] -= l * m_jac[k * m_nx + j];
+        }
+    }
+
+    m_jacGamma = gamma;
+    m_jacValid = true;
+
+    return status;
+}
+
+void ModelExchangeDriver::solveIterationMatrix(fmi3Float64* b) const {
+    for (size_t k = 0; k < m_nx; ++k) {
+        std::swap(b[k], b[m_pivots[k]]);
+        for (size_t i = k + 1; i < m_nx; ++i)
+            b[i] -= m_jac[i * m_nx + k] * b[k];
+    }
+    for (size_t k = m_nx; k-- > 0;) {
+        for (size_t j = k + 1; j < m_nx; ++j)
+            b[k] -= m_jac[k * m_nx + j] * b[j];
+        b[k] /= m_jac[k * m_nx + k];
+    }
+}
+
+void ModelExchangeDriver::interpolate(double h, double theta, fmi3Float64* x) const {
+    // cubic Hermite interpolation between (m_x, m_dx) and (m_xNew, m_dxNew)
+    double t2 = theta * theta;
+    double t3 = t2 * theta;
+    double h00 = 2 * t3 - 3 * t2 + 1;
+    double h10 = t3 - 2 * t2 + theta;
+    double h01 = -2 * t3 + 3 * t2;
+    double h11 = t3 - t2;
+    for (size_t i = 0; i < m_nx; ++i)
+        x[i] = h00 * m_x[i] + h10 * h * m_dx[i] + h01 * m_xNew[i] + h11 * h * m_dxNew[i];
+}
+
+double ModelExchangeDriver::weightedNorm(const fmi3Float64* v, const fmi3Float64* x) const {
+    if (m_nx == 0)
+        return 0;
+
+    double sum = 0;
+    for (size_t i = 0; i < m_nx; ++i) {
+        double scale = m_absTol * std::abs(m_nominals[i]) + m_relTol * std::max(std::abs(x[i]), std::abs(m_x[i]));
+        double r = v[i] / scale;
+        sum += r * r;
+    }
+    return std::sqrt(sum / m_nx);
+}
+
+/// @} fmu_forge_fmi3
+
+}  // namespace fmi3
+}  // namespace fmu_forge
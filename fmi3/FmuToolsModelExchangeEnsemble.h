@@ -0,0 +1,569 @@
+// =============================================================================
+// fmu-forge
+//
+// Copyright (c) 2024 Project Chrono (projectchrono.org)
+// Copyright (c) 2024 Digital Dynamics Lab, University of Parma, Italy
+// Copyright (c) 2024 Simulation Based Engineering Lab, University of Wisconsin-Madison, USA
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution.
+//
+// =============================================================================
+// Ensemble integration of instances of the same Model Exchange FMU (FMI 3.0)
+// =============================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "fmi3/FmuToolsImport.h"
+#include "fmi3/FmuToolsThreadPool.h"
+
+namespace fmu_forge {
+namespace fmi3 {
+
+/// @addtogroup fmu_forge_fmi3
+/// @{
+
+/// Driver integrating an ensemble of instances of the same Model Exchange FMU (e.g. with perturbed parameters) with
+/// a fixed step RK4 integrator.
+/// States and derivatives of all the instances are stored in structure-of-arrays buffers: the i-th state of all the
+/// instances is contiguous, so that the integrator updates are plain loops across the ensemble, vectorized by the
+/// compiler. The derivatives of the instances are evaluated in parallel, on a thread pool, over blocks of instances.
+/// Each instance keeps its own time: steps are shortened, for each instance separately, at its time events and at
+/// its state events (located through bisection on the dense output of the integrator), whose event iteration runs
+/// in the parallel phase without stopping the other instances. An instance failing or requesting to terminate is
+/// dropped from the ensemble, while the others go on.
+/// All the buffers are allocated by Initialize, so that no allocation happens during AdvanceTo.
+class ModelExchangeEnsemble {
+  public:
+    /// Create an ensemble of the given FMU instances, using the given number of threads (if 0, the number of
+    /// hardware threads). The instances must share the same FMU (same number of states and event indicators).
+    explicit ModelExchangeEnsemble(const std::vector<FmuUnit*>& fmus, size_t num_threads = 0);
+
+    ModelExchangeEnsemble(const ModelExchangeEnsemble&) = delete;
+    ModelExchangeEnsemble& operator=(const ModelExchangeEnsemble&) = delete;
+
+    /// Set the integration step size.
+    void SetStepSize(double step_size) { m_stepSize = step_size; }
+
+    /// Initialize the ensemble at the given time.
+    /// Must be called after fmi3ExitInitializationMode of all the instances: the initial event iteration is
+    /// performed and the instances are put in Continuous-Time Mode.
+    /// Throws an exception if the instances do not share the same number of states and event indicators.
+    fmi3Status Initialize(double start_time);
+
+    /// Integrate all the instances up to the given time, handling any event in between.
+    /// Return the worst status of the instances; an instance failing or terminating stops at its current time.
+    fmi3Status AdvanceTo(double time);
+
+    size_t GetNumInstances() const { return m_members.size(); }
+    size_t GetNumStates() const { return m_nx; }
+
+    /// Return the number of threads used to evaluate the instances.
+    size_t GetNumThreads() const { return m_pool->GetNumThreads(); }
+
+    double GetTime(size_t instance) const { return m_members[instance].time; }
+    bool IsTerminated(size_t instance) const { return m_members[instance].terminated; }
+
+    /// Return the worst status returned by the FMI functions of an instance.
+    fmi3Status GetStatus(size_t instance) const { return m_members[instance].status; }
+
+    /// Return the i-th continuous state of an instance.
+    fmi3Float64 GetState(size_t instance, size_t i) const { return m_x[i * m_stride + instance]; }
+
+    /// Return the i-th continuous state of all the instances (GetNumInstances values).
+    const fmi3Float64* GetStates(size_t i) const { return m_x.data() + i * m_stride; }
+
+    /// Return the i-th state derivative of all the instances (GetNumInstances values).
+    const fmi3Float64* GetDerivatives(size_t i) const { return m_dx.data() + i * m_stride; }
+
+    /// Return the number of ensemble steps (in which at least one instance was advanced).
+    size_t GetNumSteps() const { return m_numSteps; }
+
+    /// Return the number of events of an instance.
+    size_t GetNumEvents(size_t instance) const { return m_members[instance].numEvents; }
+
+    /// Return the number of derivative evaluations, summed over the instances.
+    size_t GetNumDerivativeEvaluations() const;
+
+  private:
+    /// Instances processed together, so that blocks do not share cache lines of the structure-of-arrays buffers.
+    static const size_t lanes = 8;
+
+    /// Integration data of an instance.
+    struct Member {
+        FmuUnit* fmu;
+        double time = 0;
+        bool nextEventTimeDefined = false;
+        double nextEventTime = 0;
+        bool terminated = false;
+        fmi3Status status = fmi3Status::fmi3OK;
+        size_t numEvents = 0;
+        size_t numEvaluations = 0;
+    };
+
+    /// Evaluate the derivatives of the active instances at the time t + c*h and the states 'x' (structure of arrays).
+    void evaluateStage(double c, const fmi3Float64* x, fmi3Float64* dx);
+
+    /// Complete the step of an instance: locate state events, accept the step and run the event iteration.
+    void completeStep(size_t j, double time_eps);
+
+    /// Handle a time event of an instance due at its current time.
+    void handleTimeEvent(size_t j, double time_eps);
+
+    /// Evaluate the derivatives of an instance at the given time and states (array of structures).
+    fmi3Status evaluate(size_t j, double t, const fmi3Float64* x, fmi3Float64* dx);
+
+    /// Evaluate the event indicators of an instance at the given time and states (array of structures).
+    fmi3Status evaluateIndicators(size_t j, double t, const fmi3Float64* x, fmi3Float64* z);
+
+    /// Event iteration of an instance through fmi3UpdateDiscreteStates; the FMU is expected to be in Event Mode.
+    /// The states, derivatives and event indicators are refreshed.
+    fmi3Status handleEvent(size_t j);
+
+    /// Copy the states of an instance between the structure-of-arrays buffer and its array of structures.
+    void gather(const std::vector<fmi3Float64>& soa, size_t j, fmi3Float64* aos) const;
+    void scatter(const fmi3Float64* aos, size_t j, std::vector<fmi3Float64>& soa) const;
+
+    /// Record the status of an instance, dropping it from the ensemble on errors.
+    void setStatus(size_t j, fmi3Status status);
+
+    std::vector<Member> m_members;
+    double m_stepSize = 1e-3;
+
+    size_t m_nx = 0;
+    size_t m_nz = 0;
+    size_t m_stride = 0;     ///< distance between the i-th and the (i+1)-th state of an instance (multiple of lanes)
+    size_t m_blockSize = 0;  ///< instances of a block of the parallel phase (multiple of lanes)
+    size_t m_numBlocks = 0;
+    size_t m_numSteps = 0;
+
+    // structure of arrays, m_nx rows of m_stride values
+    std::vector<fmi3Float64> m_x;      ///< continuous states
+    std::vector<fmi3Float64> m_dx;     ///< state derivatives
+    std::vector<fmi3Float64> m_xNew;   ///< continuous states at the end of the step
+    std::vector<fmi3Float64> m_dxNew;  ///< state derivatives at the end of the step
+    std::vector<fmi3Float64> m_xTmp;   ///< states at the intermediate stages
+    std::vector<fmi3Float64> m_k2;     ///< Runge-Kutta stages
+    std::vector<fmi3Float64> m_k3;
+    std::vector<fmi3Float64> m_k4;
+    std::vector<fmi3Float64> m_h;      ///< step size of each instance (0 if not advanced)
+    std::vector<uint8_t> m_advancing;  ///< the instance is advanced in the current ensemble step
+
+    // arrays of structures, one row per instance
+    std::vector<fmi3Float64> m_aosX;   ///< states exchanged with the FMU
+    std::vector<fmi3Float64> m_aosDx;  ///< derivatives exchanged with the FMU
+    std::vector<fmi3Float64> m_z;      ///< event indicators
+    std::vector<fmi3Float64> m_zNew;   ///< event indicators at the end of the step
+    std::vector<fmi3Float64> m_zTmp;   ///< event indicators at the interpolation points
+
+    std::unique_ptr<FmuThreadPool> m_pool;  ///< evaluates the blocks of instances in parallel
+};
+
+// -----------------------------------------------------------------------------
+
+ModelExchangeEnsemble::ModelExchangeEnsemble(const std::vector<FmuUnit*>& fmus, size_t num_threads) {
+    for (auto fmu : fmus) {
+        Member member;
+        member.fmu = fmu;
+        m_members.push_back(member);
+    }
+
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    num_threads = std::min(num_threads, std::max<size_t>(1, (m_members.size() + lanes - 1) / lanes));
+
+    m_pool.reset(new FmuThreadPool(num_threads));
+}
+
+size_t ModelExchangeEnsemble::GetNumDerivativeEvaluations() const {
+    size_t count = 0;
+    for (const auto& member : m_members)
+        count += member.numEvaluations;
+    return count;
+}
+
+fmi3Status ModelExchangeEnsemble::Initialize(double start_time) {
+    size_t n = m_members.size();
+    if (n == 0)
+        return fmi3Status::fmi3OK;
+
+    m_nx = m_members[0].fmu->GetNumStates();
+    m_nz = 0;
+    size_t nz;
+    if (m_members[0].fmu->_fmi3GetNumberOfEventIndicators(m_members[0].fmu->instance, &nz) == fmi3Status::fmi3OK)
+        m_nz = nz;
+    for (const auto& member : m_members) {
+        size_t member_nz = 0;
+        if (member.fmu->_fmi3GetNumberOfEventIndicators(member.fmu->instance, &member_nz) != fmi3Status::fmi3OK)
+            member_nz = 0;
+        if (member.fmu->GetNumStates() != m_nx || member_nz != m_nz)
+            throw std::runtime_error(
+                "ModelExchangeEnsemble: all the instances must have the same number of states and event indicators.");
+    }
+
+    m_stride = (n + lanes - 1) / lanes * lanes;
+    size_t num_threads = m_pool->GetNumThreads();
+    m_blockSize = std::max<size_t>(1, m_stride / lanes / (4 * num_threads)) * lanes;
+    m_numBlocks = (n + m_blockSize - 1) / m_blockSize;
+    m_numSteps = 0;
+
+    for (auto v : {&m_x, &m_dx, &m_xNew, &m_dxNew, &m_xTmp, &m_k2, &m_k3, &m_k4})
+        v->assign(m_nx * m_stride, 0.0);
+    m_h.assign(m_stride, 0.0);
+    m_advancing.assign(m_stride, 0);
+
+    m_aosX.assign(n * m_nx, 0.0);
+    m_aosDx.assign(n * m_nx, 0.0);
+    m_z.assign(n * m_nz, 0.0);
+    m_zNew.assign(n * m_nz, 0.0);
+    m_zTmp.assign(n * m_nz, 0.0);
+
+    for (auto& member : m_members) {
+        member.time = start_time;
+        member.nextEventTimeDefined = false;
+        member.terminated = false;
+        member.status = fmi3Status::fmi3OK;
+        member.numEvents = 0;
+        member.numEvaluations = 0;
+    }
+
+    // initial event iteration (the FMUs are in Event Mode after fmi3ExitInitializationMode)
+    m_pool->ParallelFor(m_numBlocks, [this, n](size_t block) {
+        for (size_t j = block * m_blockSize; j < std::min(n, (block + 1) * m_blockSize); ++j) {
+            Member& member = m_members[j];
+            setStatus(j, member.fmu->GetContinuousStates(&m_aosX[j * m_nx], m_nx));
+            scatter(&m_aosX[j * m_nx], j, m_x);
+            if (!member.terminated)
+                setStatus(j, handleEvent(j));
+        }
+    });
+
+    fmi3Status status = fmi3Status::fmi3OK;
+    for (const auto& member : m_members)
+        status = std::max(status, member.status);
+    return status;
+}
+
+fmi3Status ModelExchangeEnsemble::AdvanceTo(double time) {
+    const double time_eps = 100 * std::numeric_limits<double>::epsilon() * std::max(1.0, std::abs(time));
+    const size_t n = m_members.size();
+
+    auto event_due = [time_eps](const Member& member) {
+        return !member.terminated && member.nextEventTimeDefined && member.nextEventTime <= member.time + time_eps;
+    };
+
+    while (true) {
+        // time events due at the current time of an instance (e.g. reported by the initial event iteration) are
+        // handled before stepping, so that every advanced instance has a positive step size
+        if (std::any_of(m_members.begin(), m_members.end(), event_due)) {
+            m_pool->ParallelFor(m_numBlocks, [this, n, time_eps, &event_due](size_t block) {
+                for (size_t j = block * m_blockSize; j < std::min(n, (block + 1) * m_blockSize); ++j) {
+                    if (event_due(m_members[j]))
+                        handleTimeEvent(j, time_eps);
+                }
+            });
+        }
+
+        // step size of each instance, limited to the requested time and to its next time event
+        bool active = false;
+        for (size_t j = 0; j < n; ++j) {
+            const Member& member = m_members[j];
+            double h = 0;
+            bool advancing = !member.terminated && member.time < time - time_eps;
+            if (advancing) {
+                h = std::min(m_stepSize, time - member.time);
+                if (member.nextEventTimeDefined && member.time + h >= member.nextEventTime - time_eps)
+                    h = member.nextEventTime - member.time;
+                active = true;
+            }
+            m_h[j] = h;
+            m_advancing[j] = advancing;
+        }
+        if (!active)
+            break;
+
+        // RK4 stages; instances not advanced (h = 0) keep their states
+        const fmi3Float64* h = m_h.data();
+        const fmi3Float64* x = m_x.data();
+        const fmi3Float64* dx = m_dx.data();
+        fmi3Float64* x_tmp = m_xTmp.data();
+        fmi3Float64* x_new = m_xNew.data();
+        const fmi3Float64* k2 = m_k2.data();
+        const fmi3Float64* k3 = m_k3.data();
+        const fmi3Float64* k4 = m_k4.data();
+
+        for (size_t i = 0; i < m_nx; ++i) {
+            size_t row = i * m_stride;
+            for (size_t j = 0; j < m_stride; ++j)
+                x_tmp[row + j] = x[row + j] + 0.5 * h[j] * dx[row + j];
+        }
+        evaluateStage(0.5, x_tmp, m_k2.data());
+
+        for (size_t i = 0; i < m_nx; ++i) {
+            size_t row = i * m_stride;
+            for (size_t j = 0; j < m_stride; ++j)
+                x_tmp[row + j] = x[row + j] + 0.5 * h[j] * k2[row + j];
+        }
+        evaluateStage(0.5, x_tmp, m_k3.data());
+
+        for (size_t i = 0; i < m_nx; ++i) {
+            size_t row = i * m_stride;
+            for (size_t j = 0; j < m_stride; ++j)
+                x_tmp[row + j] = x[row + j] + h[j] * k3[row + j];
+        }
+        evaluateStage(1.0, x_tmp, m_k4.data());
+
+        for (size_t i = 0; i < m_nx; ++i) {
+            size_t row = i * m_stride;
+            for (size_t j = 0; j < m_stride; ++j)
+                x_new[row + j] =
+                    x[row + j] + h[j] / 6 * (dx[row + j] + 2 * k2[row + j] + 2 * k3[row + j] + k4[row + j]);
+        }
+        evaluateStage(1.0, x_new, m_dxNew.data());
+
+        // events and acceptance, for each instance separately
+        m_pool->ParallelFor(m_numBlocks, [this, n, time_eps](size_t block) {
+            for (size_t j = block * m_blockSize; j < std::min(n, (block + 1) * m_blockSize); ++j) {
+                if (m_advancing[j] && !m_members[j].terminated)
+                    completeStep(j, time_eps);
+            }
+        });
+
+        m_numSteps++;
+    }
+
+    fmi3Status status = fmi3Status::fmi3OK;
+    for (const auto& member : m_members)
+        status = std::max(status, member.status);
+    return status;
+}
+
+void ModelExchangeEnsemble::evaluateStage(double c, const fmi3Float64* x, fmi3Float64* dx) {
+    const size_t n = m_members.size();
+    m_pool->ParallelFor(m_numBlocks, [this, n, c, x, dx](size_t block) {
+        for (size_t j = block * m_blockSize; j < std::min(n, (block + 1) * m_blockSize); ++j) {
+            if (!m_advancing[j] || m_members[j].terminated)
+                continue;
+
+            fmi3Float64* aos_x = &m_aosX[j * m_nx];
+            fmi3Float64* aos_dx = &m_aosDx[j * m_nx];
+            for (size_t i = 0; i < m_nx; ++i)
+                aos_x[i] = x[i * m_stride + j];
+            setStatus(j, evaluate(j, m_members[j].time + c * m_h[j], aos_x, aos_dx));
+            for (size_t i = 0; i < m_nx; ++i)
+                dx[i * m_stride + j] = aos_dx[i];
+        }
+    });
+}
+
+void ModelExchangeEnsemble::completeStep(size_t j, double time_eps) {
+    Member& member = m_members[j];
+    FmuUnit& fmu = *member.fmu;
+    const double h = m_h[j];
+    fmi3Float64* aos_x = &m_aosX[j * m_nx];
+    fmi3Float64* aos_dx = &m_aosDx[j * m_nx];
+    fmi3Float64* z = &m_z[j * m_nz];
+    fmi3Float64* z_new = &m_zNew[j * m_nz];
+    fmi3Float64* z_tmp = &m_zTmp[j * m_nz];
+
+    bool time_event = member.nextEventTimeDefined && member.time + h >= member.nextEventTime - time_eps;
+
+    // cubic Hermite interpolation of the states of the instance over the step, at theta in [0,1]
+    auto interpolate = [this, j, h](double theta, fmi3Float64* x) {
+        double t2 = theta * theta;
+        double t3 = t2 * theta;
+        double h00 = 2 * t3 - 3 * t2 + 1;
+        double h10 = t3 - 2 * t2 + theta;
+        double h01 = -2 * t3 + 3 * t2;
+        double h11 = t3 - t2;
+        for (size_t i = 0; i < m_nx; ++i) {
+            size_t k = i * m_stride + j;
+            x[i] = h00 * m_x[k] + h10 * h * m_dx[k] + h01 * m_xNew[k] + h11 * h * m_dxNew[k];
+        }
+    };
+
+    auto crossed = [this, z](const fmi3Float64* z_end) {
+        for (size_t i = 0; i < m_nz; ++i) {
+            if ((z[i] > 0 && z_end[i] <= 0) || (z[i] < 0 && z_end[i] >= 0))
+                return true;
+        }
+        return false;
+    };
+
+    // look for state events by checking the sign of the event indicators at the end of the step
+    bool state_event = false;
+    double theta = 1;
+    if (m_nz > 0) {
+        gather(m_xNew, j, aos_x);
+        setStatus(j, evaluateIndicators(j, member.time + h, aos_x, z_new));
+
+        if (crossed(z_new)) {
+            // bisection on the dense output for the first crossing
+            state_event = true;
+            double theta_lo = 0;
+            double theta_hi = 1;
+            const double event_tol = time_eps / std::max(h, time_eps);
+            while (theta_hi - theta_lo > event_tol) {
+                double theta_mid = 0.5 * (theta_lo + theta_hi);
+                interpolate(theta_mid, aos_x);
+                setStatus(j, evaluateIndicators(j, member.time + theta_mid * h, aos_x, z_tmp));
+                if (crossed(z_tmp))
+                    theta_hi = theta_mid;
+                else
+                    theta_lo = theta_mid;
+            }
+            if (theta_hi < 1) {
+                interpolate(theta_hi, aos_x);
+                setStatus(j, evaluate(j, member.time + theta_hi * h, aos_x, aos_dx));
+                scatter(aos_x, j, m_xNew);
+                scatter(aos_dx, j, m_dxNew);
+            }
+            theta = theta_hi;
+            time_event = false;
+        }
+    }
+
+    // accept the step
+    member.time = (time_event && theta == 1) ? member.nextEventTime : member.time + theta * h;
+    for (size_t i = 0; i < m_nx; ++i) {
+        size_t k = i * m_stride + j;
+        m_x[k] = m_xNew[k];
+        m_dx[k] = m_dxNew[k];
+    }
+    if (member.terminated)
+        return;
+
+    // the FMU must see the accepted time and states before fmi3CompletedIntegratorStep
+    gather(m_x, j, aos_x);
+    setStatus(j, fmu.SetTime(member.time));
+    setStatus(j, fmu.SetContinuousStates(aos_x, m_nx));
+
+    fmi3Boolean step_event = fmi3False;
+    fmi3Boolean terminate = fmi3False;
+    setStatus(j, fmu._fmi3CompletedIntegratorStep(fmu.instance, fmi3True, &step_event, &terminate));
+    if (terminate) {
+        member.terminated = true;
+        return;
+    }
+
+    if (time_event || state_event || step_event) {
+        member.numEvents++;
+        setStatus(j, fmu._fmi3EnterEventMode(fmu.instance));
+        if (!member.terminated)
+            setStatus(j, handleEvent(j));
+    } else if (m_nz > 0) {
+        std::copy(z_new, z_new + m_nz, z);
+    }
+}
+
+void ModelExchangeEnsemble::handleTimeEvent(size_t j, double time_eps) {
+    Member& member = m_members[j];
+    member.numEvents++;
+    setStatus(j, member.fmu->_fmi3EnterEventMode(member.fmu->instance));
+    if (!member.terminated)
+        setStatus(j, handleEvent(j));
+
+    // a next event time not in the future would stall the instance
+    if (member.nextEventTimeDefined && member.nextEventTime <= member.time + time_eps)
+        member.nextEventTimeDefined = false;
+}
+
+fmi3Status ModelExchangeEnsemble::handleEvent(size_t j) {
+    Member& member = m_members[j];
+    FmuUnit& fmu = *member.fmu;
+    fmi3Status status = fmi3Status::fmi3OK;
+
+    fmi3Boolean discrete_states_need_update = fmi3True;
+    fmi3Boolean terminate = fmi3False;
+    fmi3Boolean nominals_changed = fmi3False;
+    fmi3Boolean values_changed = fmi3False;
+    fmi3Boolean next_event_time_defined = fmi3False;
+    fmi3Float64 next_event_time = 0;
+
+    bool any_values_changed = false;
+
+    while (discrete_states_need_update) {
+        status = std::max(status, fmu._fmi3UpdateDiscreteStates(fmu.instance, &discrete_states_need_update,
+                                                                &terminate, &nominals_changed, &values_changed,
+                                                                &next_event_time_defined, &next_event_time));
+        if (status > fmi3Status::fmi3Warning)
+            return status;
+
+        any_values_changed = any_values_changed || values_changed;
+
+        if (terminate) {
+            member.terminated = true;
+            return status;
+        }
+    }
+
+    member.nextEventTimeDefined = next_event_time_defined;
+    member.nextEventTime = next_event_time;
+
+    status = std::max(status, fmu._fmi3EnterContinuousTimeMode(fmu.instance));
+    if (status > fmi3Status::fmi3Warning)
+        return status;
+
+    // refresh the states, derivatives and event indicators of the instance
+    fmi3Float64* aos_x = &m_aosX[j * m_nx];
+    fmi3Float64* aos_dx = &m_aosDx[j * m_nx];
+    if (any_values_changed) {
+        status = std::max(status, fmu.GetContinuousStates(aos_x, m_nx));
+        scatter(aos_x, j, m_x);
+    } else {
+        gather(m_x, j, aos_x);
+    }
+
+    status = std::max(status, evaluate(j, member.time, aos_x, aos_dx));
+    scatter(aos_dx, j, m_dx);
+    if (m_nz > 0)
+        status = std::max(status, evaluateIndicators(j, member.time, aos_x, &m_z[j * m_nz]));
+
+    return status;
+}
+
+fmi3Status ModelExchangeEnsemble::evaluate(size_t j, double t, const fmi3Float64* x, fmi3Float64* dx) {
+    FmuUnit& fmu = *m_members[j].fmu;
+    m_members[j].numEvaluations++;
+    fmi3Status status = fmu.SetTime(t);
+    status = std::max(status, fmu.SetContinuousStates(x, m_nx));
+    return std::max(status, fmu.GetContinuousStateDerivatives(dx, m_nx));
+}
+
+fmi3Status ModelExchangeEnsemble::evaluateIndicators(size_t j, double t, const fmi3Float64* x, fmi3Float64* z) {
+    FmuUnit& fmu = *m_members[j].fmu;
+    fmi3Status status = fmu.SetTime(t);
+    status = std::max(status, fmu.SetContinuousStates(x, m_nx));
+    return std::max(status, fmu._fmi3GetEventIndicators(fmu.instance, z, m_nz));
+}
+
+void ModelExchangeEnsemble::gather(const std::vector<fmi3Float64>& soa, size_t j, fmi3Float64* aos) const {
+    for (size_t i = 0; i < m_nx; ++i)
+        aos[i] = soa[i * m_stride + j];
+}
+
+void ModelExchangeEnsemble::scatter(const fmi3Float64* aos, size_t j, std::vector<fmi3Float64>& soa) const {
+    for (size_t i = 0; i < m_nx; ++i)
+        soa[i * m_stride + j] = aos[i];
+}
+
+void ModelExchangeEnsemble::setStatus(size_t j, fmi3Status status) {
+    Member& member = m_members[j];
+    member.status = std::max(member.status, status);
+    if (status > fmi3Status::fmi3Warning)
+        member.terminated = true;
+}
+
+/// @} fmu_forge_fmi3
+
+}  // namespace fmi3
+}  // namespace fmu_forge
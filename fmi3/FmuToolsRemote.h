@@ -0,0 +1,901 @@
+// =============================================================================
+// fmu-forge
+//
+// Copyright (c) 2024 Project Chrono (projectchrono.org)
+// Copyright (c) 2024 Digital Dynamics Lab, University of Parma, Italy
+// Copyright (c) 2024 Simulation Based Engineering Lab, University of Wisconsin-Madison, USA
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution.
+//
+// =============================================================================
+// Out-of-process execution of an imported FMU (FMI 3.0): worker hosting the FMU and client proxy, communicating
+// through shared memory
+// =============================================================================
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+    #error "FmuToolsRemote.h requires POSIX shared memory and semaphores."
+#endif
+
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+#include "fmi3/FmuToolsImport.h"
+
+namespace fmu_forge {
+namespace fmi3 {
+
+/// @addtogroup fmu_forge_fmi3
+/// @{
+
+/// Commands sent by FmuRemoteUnit to FmuRemoteWorker.
+enum class FmuRemoteCommand : uint32_t {
+    HELLO,  ///< handshake, once the worker is attached to the channel
+    LOAD,
+    LOAD_UNZIPPED,
+    INSTANTIATE,
+    FREE_INSTANCE,
+    GET_VALUE_REFERENCE,
+    ENTER_INITIALIZATION_MODE,
+    EXIT_INITIALIZATION_MODE,
+    DO_STEP,
+    TERMINATE,
+    RESET,
+    GET,
+    SET,
+    QUIT
+};
+
+/// Shared-memory channel between an FmuRemoteUnit and its FmuRemoteWorker: a message header followed by the payload
+/// of the values.
+/// Each side publishes a message by incrementing its sequence number, and waits for the other side spinning for a
+/// short while before parking on a process-shared semaphore (the doorbell), rung only if the other side is parked.
+class FmuRemoteChannel {
+  public:
+    /// Header of the shared memory region.
+    struct Header {
+        std::atomic<uint32_t> request;  ///< sequence number of the last request (client)
+        std::atomic<uint32_t> reply;    ///< sequence number of the last reply (worker)
+        std::atomic<uint32_t> worker_parked;
+        std::atomic<uint32_t> client_parked;
+        sem_t worker_doorbell;
+        sem_t client_doorbell;
+        uint32_t command;
+        int32_t status;      ///< fmi3Status of the reply, or -1 if the worker threw an exception (see error)
+        uint64_t count;      ///< number of value references (GET, SET) or values (reply)
+        uint64_t integer;    ///< additional argument (e.g. FMU type, value reference, variable type)
+        double reals[5];     ///< additional arguments (e.g. time and step size)
+        uint64_t payload_size;
+        uint64_t payload_capacity;
+        char error[512];
+    };
+
+    static const int spin_count = 2000;      ///< polls of the sequence number before parking
+    static const int park_timeout_ms = 100;  ///< period of the liveness checks while parked
+
+    /// Create a new shared memory region, with the given payload capacity (client).
+    FmuRemoteChannel(const std::string& name, size_t payload_capacity);
+
+    /// Attach to an existing shared memory region (worker).
+    explicit FmuRemoteChannel(const std::string& name);
+
+    ~FmuRemoteChannel();
+
+    FmuRemoteChannel(const FmuRemoteChannel&) = delete;
+    FmuRemoteChannel& operator=(const FmuRemoteChannel&) = delete;
+
+    /// Remove the name of the shared memory region; the mapping stays valid in both processes.
+    void Unlink();
+
+    Header& GetHeader() { return *m_header; }
+    char* GetPayload() { return reinterpret_cast<char*>(m_header) + payload_offset; }
+
+    /// Return the capacity of the payload as mapped by this process.
+    /// Unlike Header::payload_capacity, it cannot be altered by the other side of the channel.
+    size_t GetPayloadCapacity() const { return m_size - payload_offset; }
+
+    /// Publish a new request (client) or reply (worker) and ring the other side, if parked.
+    void Publish(bool reply);
+
+    /// Wait for the reply to the last request (client) or for a new request (worker).
+    /// 'alive' is called periodically while parked: waiting is abandoned, returning false, if it returns false.
+    template <typename Alive>
+    bool Wait(bool reply, Alive alive);
+
+  private:
+    static const size_t payload_offset = (sizeof(Header) + 63) / 64 * 64;
+
+    void map(int fd, size_t size);
+
+    std::string m_name;
+    Header* m_header;
+    size_t m_size;
+    uint32_t m_seen;  ///< last request handled (worker side)
+    bool m_owner;     ///< the region has been created by this process
+};
+
+// -----------------------------------------------------------------------------
+
+/// Worker hosting an FmuUnit on behalf of an FmuRemoteUnit in another process (see fmu_forge_worker_fmi3).
+/// Requests are served one at a time until the QUIT command, or until the client process terminates.
+class FmuRemoteWorker {
+  public:
+    explicit FmuRemoteWorker(const std::string& channel_name) : m_channel(channel_name) {}
+
+    /// Serve the requests of the client.
+    void Run();
+
+  private:
+    /// Execute the current request, filling the reply.
+    void handle(FmuRemoteChannel::Header& header, char* payload);
+
+    fmi3Status getValues(FmuRemoteChannel::Header& header, char* payload);
+    fmi3Status setValues(FmuRemoteChannel::Header& header, char* payload);
+
+    /// Return the number of value references of a GET or SET request, checking that they fit in the payload.
+    size_t numValueReferences(const FmuRemoteChannel::Header& header, const char* command) const;
+
+    FmuRemoteChannel m_channel;
+    FmuUnit m_fmu;
+    std::vector<fmi3String> m_strings;
+};
+
+// -----------------------------------------------------------------------------
+
+/// Proxy of an FMU running in a separate worker process (see FmuRemoteWorker), with the same functions as FmuUnit.
+/// A crash of the FMU terminates only the worker: the proxy then throws std::runtime_error on any call.
+/// Values are exchanged through shared memory, typed according to the FMU variables: the value type T must have the
+/// size of the FMI type of the variable (e.g. fmi3Float64 for Float64 variables, std::string for String variables).
+/// Binary variables are not supported.
+class FmuRemoteUnit {
+  public:
+    /// Start a worker process from the given executable (fmu_forge_worker_fmi3), with a shared memory channel
+    /// whose payload can hold 'payload_capacity' bytes of values and value references.
+    explicit FmuRemoteUnit(const std::string& worker_executable, size_t payload_capacity = 1 << 20);
+
+    /// Stop the worker process (the FMU instance, if any, is freed).
+    ~FmuRemoteUnit();
+
+    FmuRemoteUnit(const FmuRemoteUnit&) = delete;
+    FmuRemoteUnit& operator=(const FmuRemoteUnit&) = delete;
+
+    /// Check if the worker process is still running.
+    bool IsAlive();
+
+    /// Load the FMU in the worker (see FmuUnit::Load).
+    void Load(FmuType fmuType, const std::string& fmupath, const std::string& unzipdir);
+
+    /// Load the FMU in the worker, from an unzipped folder (see FmuUnit::LoadUnzipped).
+    void LoadUnzipped(FmuType fmuType, const std::string& directory);
+
+    /// Instantiate the FMU in the worker, with the resources folder of the unzipped FMU.
+    void Instantiate(const std::string& instanceName, bool logging = false, bool visible = false);
+
+    /// Free the FMU instance in the worker.
+    void FreeInstance();
+
+    /// Get the value reference of a variable from its name (throws if not found).
+    fmi3ValueReference GetValueReference(const std::string& varname);
+
+    fmi3Status EnterInitializationMode(fmi3Boolean toleranceDefined,
+                                       fmi3Float64 tolerance,
+                                       fmi3Float64 startTime,
+                                       fmi3Boolean stopTimeDefined,
+                                       fmi3Float64 stopTime);
+    fmi3Status ExitInitializationMode();
+
+    fmi3Status DoStep(fmi3Float64 currentCommunicationPoint,
+                      fmi3Float64 communicationStepSize,
+                      fmi3Boolean noSetFMUStatePriorToCurrentPoint);
+
+    fmi3Status Terminate();
+    fmi3Status Reset();
+
+    /// Get the value of a scalar variable.
+    template <class T>
+    fmi3Status GetVariable(fmi3ValueReference vr, T& value);
+
+    /// Get the values of an array variable.
+    template <class T>
+    fmi3Status GetVariable(fmi3ValueReference vr, std::vector<T>& values);
+
+    /// Get the values of several variables of the same type with a single exchange.
+    template <class T>
+    fmi3Status GetVariables(const std::vector<fmi3ValueReference>& vrs, std::vector<T>& values);
+
+    /// Set the value of a scalar variable.
+    template <class T>
+    fmi3Status SetVariable(fmi3ValueReference vr, const T& value);
+
+    /// Set the values of an array variable.
+    template <class T>
+    fmi3Status SetVariable(fmi3ValueReference vr, const std::vector<T>& values);
+
+    /// Set the values of several variables of the same type with a single exchange.
+    template <class T>
+    fmi3Status SetVariables(const std::vector<fmi3ValueReference>& vrs, const std::vector<T>& values);
+
+  private:
+    /// Send the current request and wait for the reply; throws if the worker failed or terminated.
+    fmi3Status call(FmuRemoteCommand command);
+
+    /// Copy a string argument in the payload.
+    void putString(const std::string& str);
+
+    fmi3Status getValues(const fmi3ValueReference* vrs, size_t nvrs, size_t elem_size);
+    fmi3Status setValues(const fmi3ValueReference* vrs, size_t nvrs, const void* values, size_t size);
+
+    template <class T>
+    void readValues(size_t nvrs, std::vector<T>& values);
+    void readValues(size_t nvrs, std::vector<std::string>& values);
+
+    template <class T>
+    fmi3Status setValues(const fmi3ValueReference* vrs, size_t nvrs, const std::vector<T>& values) {
+        return setValues(vrs, nvrs, values.data(), values.size() * sizeof(T));
+    }
+    fmi3Status setValues(const fmi3ValueReference* vrs, size_t nvrs, const std::vector<std::string>& values);
+
+    std::unique_ptr<FmuRemoteChannel> m_channel;
+    int m_pid;
+    bool m_alive;
+    std::vector<fmi3ValueReference> m_vr;  ///< single value reference, reused by the scalar functions
+};
+
+// -----------------------------------------------------------------------------
+
+namespace remote_utils {
+
+/// Size of the values of the given variable type, as stored in the payload (0 for variable-length types).
+inline size_t ValueSize(FmuVariable::Type type) {
+    return FmuVariable::IsFixedSizeType(type) ? FmuVariable::GetTypeSize(type) : 0;
+}
+
+/// Offset of the values in the payload of GET and SET, after the value references.
+inline size_t ValuesOffset(size_t nvrs) {
+    return (nvrs * sizeof(fmi3ValueReference) + 7) / 8 * 8;
+}
+
+}  // namespace remote_utils
+
+// -----------------------------------------------------------------------------
+
+FmuRemoteChannel::FmuRemoteChannel(const std::string& name, size_t payload_capacity)
+    : m_name(name), m_header(nullptr), m_size(0), m_seen(0), m_owner(true) {
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+        throw std::runtime_error("Cannot create the shared memory channel " + name + ": " + std::strerror(errno));
+
+    size_t size = payload_offset + payload_capacity;
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Cannot size the shared memory channel " + name + ": " + std::strerror(errno));
+    }
+    map(fd, size);
+
+    Header* header = new (m_header) Header();
+    header->request.store(0);
+    header->reply.store(0);
+    header->worker_parked.store(0);
+    header->client_parked.store(0);
+    sem_init(&header->worker_doorbell, 1, 0);
+    sem_init(&header->client_doorbell, 1, 0);
+    header->payload_capacity = payload_capacity;
+}
+
+FmuRemoteChannel::FmuRemoteChannel(const std::string& name)
+    : m_name(name), m_header(nullptr), m_size(0), m_seen(0), m_owner(false) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open the shared memory channel " + name + ": " + std::strerror(errno));
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < payload_offset) {
+        close(fd);
+        throw std::runtime_error("Invalid shared memory channel " + name + ".");
+    }
+    map(fd, static_cast<size_t>(info.st_size));
+}
+
+FmuRemoteChannel::~FmuRemoteChannel() {
+    if (m_owner) {
+        sem_destroy(&m_header->worker_doorbell);
+        sem_destroy(&m_header->client_doorbell);
+        Unlink();
+    }
+    munmap(m_header, m_size);
+}
+
+void FmuRemoteChannel::map(int fd, size_t size) {
+    void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+        throw std::runtime_error("Cannot map the shared memory channel " + m_name + ": " + std::strerror(errno));
+    m_header = static_cast<Header*>(address);
+    m_size = size;
+}
+
+void FmuRemoteChannel::Unlink() {
+    if (!m_name.empty())
+        shm_unlink(m_name.c_str());
+    m_name.clear();
+}
+
+void FmuRemoteChannel::Publish(bool reply) {
+    std::atomic<uint32_t>& seq = reply ? m_header->reply : m_header->request;
+    std::atomic<uint32_t>& parked = reply ? m_header->client_parked : m_header->worker_parked;
+    sem_t& doorbell = reply ? m_header->client_doorbell : m_header->worker_doorbell;
+
+    if (reply)
+        seq.store(m_seen);
+    else
+        seq.store(seq.load() + 1);
+    if (parked.load())
+        sem_post(&doorbell);
+}
+
+template <typename Alive>
+bool FmuRemoteChannel::Wait(bool reply, Alive alive) {
+    // the client waits for the reply to its request, the worker for a request not yet seen
+    auto ready = [this, reply]() {
+        return reply ? m_header->reply.load(std::memory_order_acquire) == m_header->request.load()
+                     : m_header->request.load(std::memory_order_acquire) != m_seen;
+    };
+    std::atomic<uint32_t>& parked = reply ? m_header->client_parked : m_header->worker_parked;
+    sem_t& doorbell = reply ? m_header->client_doorbell : m_header->worker_doorbell;
+
+    bool ok = true;
+    for (int i = 0; i < spin_count && !ready(); ++i)
+        std::this_thread::yield();
+
+    if (!ready()) {
+        // the flag is raised before checking again, so that a concurrent publish cannot be missed
+        parked.store(1);
+        while (!ready()) {
+            timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += park_timeout_ms * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            if (sem_timedwait(&doorbell, &deadline) != 0 && !ready() && !alive()) {
+                ok = false;
+                break;
+            }
+        }
+        parked.store(0);
+    }
+
+    if (ok && !reply)
+        m_seen = m_header->request.load();
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+
+void FmuRemoteWorker::Run() {
+    pid_t parent = getppid();
+    auto parent_alive = [parent]() { return getppid() == parent; };
+
+    FmuRemoteChannel::Header& header = m_channel.GetHeader();
+    char* payload = m_channel.GetPayload();
+
+    while (m_channel.Wait(false, parent_alive)) {
+        auto command = static_cast<FmuRemoteCommand>(header.command);
+        try {
+            header.error[0] = 0;
+            handle(header, payload);
+        } catch (std::exception& e) {
+            header.status = -1;
+            std::strncpy(header.error, e.what(), sizeof(header.error) - 1);
+            header.error[sizeof(header.error) - 1] = 0;
+        }
+        m_channel.Publish(true);
+
+        if (command == FmuRemoteCommand::QUIT)
+            return;
+    }
+}
+
+void FmuRemoteWorker::handle(FmuRemoteChannel::Header& header, char* payload) {
+    fmi3Status status = fmi3Status::fmi3OK;
+
+    switch (static_cast<FmuRemoteCommand>(header.command)) {
+        case FmuRemoteCommand::HELLO:
+            break;
+        case FmuRemoteCommand::LOAD: {
+            // payload: FMU path and unzip directory, null-terminated
+            std::string fmupath(payload);
+            std::string unzipdir(payload + fmupath.size() + 1);
+            m_fmu.Load(static_cast<FmuType>(header.integer), fmupath, unzipdir);
+            break;
+        }
+        case FmuRemoteCommand::LOAD_UNZIPPED:
+            m_fmu.LoadUnzipped(static_cast<FmuType>(header.integer), std::string(payload));
+            break;
+        case FmuRemoteCommand::INSTANTIATE:
+            m_fmu.Instantiate(std::string(payload), header.reals[0] != 0, header.reals[1] != 0);
+            break;
+        case FmuRemoteCommand::FREE_INSTANCE:
+            if (m_fmu.instance)
+                m_fmu._fmi3FreeInstance(m_fmu.instance);
+            m_fmu.instance = nullptr;
+            break;
+        case FmuRemoteCommand::GET_VALUE_REFERENCE: {
+            fmi3ValueReference vr;
+            if (!m_fmu.GetValueReference(std::string(payload), vr))
+                throw std::runtime_error("Variable not found: " + std::string(payload));
+            header.integer = vr;
+            break;
+        }
+        case FmuRemoteCommand::ENTER_INITIALIZATION_MODE:
+            status = m_fmu.EnterInitializationMode(header.reals[0] != 0, header.reals[1], header.reals[2],
+                                                   header.reals[3] != 0, header.reals[4]);
+            break;
+        case FmuRemoteCommand::EXIT_INITIALIZATION_MODE:
+            status = m_fmu.ExitInitializationMode();
+            break;
+        case FmuRemoteCommand::DO_STEP:
+            status = m_fmu.DoStep(header.reals[0], header.reals[1], header.reals[2] != 0);
+            break;
+        case FmuRemoteCommand::TERMINATE:
+            status = m_fmu._fmi3Terminate(m_fmu.instance);
+            break;
+        case FmuRemoteCommand::RESET:
+            status = m_fmu._fmi3Reset(m_fmu.instance);
+            break;
+        case FmuRemoteCommand::GET:
+            status = getValues(header, payload);
+            break;
+        case FmuRemoteCommand::SET:
+            status = setValues(header, payload);
+            break;
+        case FmuRemoteCommand::QUIT:
+            if (m_fmu.instance)
+                m_fmu._fmi3FreeInstance(m_fmu.instance);
+            m_fmu.instance = nullptr;
+            break;
+    }
+
+    header.status = static_cast<int32_t>(status);
+}
+
+fmi3Status FmuRemoteWorker::getValues(FmuRemoteChannel::Header& header, char* payload) {
+    // request: value references; reply: variable type, number of values and values, after the value references
+    const fmi3ValueReference* vrs = reinterpret_cast<const fmi3ValueReference*>(payload);
+    size_t nvrs = numValueReferences(header, "GET");
+
+    FmuVariable::Type type = m_fmu.GetVariableInfo(vrs[0]).GetType();
+    size_t nValues = 0;
+    for (size_t i = 0; i < nvrs; ++i)
+        nValues += m_fmu.GetVariableSize(vrs[i]);
+
+    size_t offset = remote_utils::ValuesOffset(nvrs);
+    size_t capacity = m_channel.GetPayloadCapacity() - offset;
+    size_t elem_size = remote_utils::ValueSize(type);
+    if (nValues * elem_size > capacity)
+        throw std::runtime_error("GET: the values exceed the capacity of the channel.");
+
+    void* values = payload + offset;
+    fmi3Status status = fmi3Status::fmi3Error;
+    fmi3Instance instance = m_fmu.instance;
+    switch (type) {
+        case FmuVariable::Type::Float32:
+            status = m_fmu._fmi3GetFloat32(instance, vrs, nvrs, static_cast<fmi3Float32*>(values), nValues);
+            break;
+        case FmuVariable::Type::Float64:
+            status = m_fmu._fmi3GetFloat64(instance, vrs, nvrs, static_cast<fmi3Float64*>(values), nValues);
+            break;
+        case FmuVariable::Type::Int8:
+            status = m_fmu._fmi3GetInt8(instance, vrs, nvrs, static_cast<fmi3Int8*>(values), nValues);
+            break;
+        case FmuVariable::Type::UInt8:
+            status = m_fmu._fmi3GetUInt8(instance, vrs, nvrs, static_cast<fmi3UInt8*>(values), nValues);
+            break;
+        case FmuVariable::Type::Int16:
+            status = m_fmu._fmi3GetInt16(instance, vrs, nvrs, static_cast<fmi3Int16*>(values), nValues);
+            break;
+        case FmuVariable::Type::UInt16:
+            status = m_fmu._fmi3GetUInt16(instance, vrs, nvrs, static_cast<fmi3UInt16*>(values), nValues);
+            break;
+        case FmuVariable::Type::Int32:
+            status = m_fmu._fmi3GetInt32(instance, vrs, nvrs, static_cast<fmi3Int32*>(values), nValues);
+            break;
+        case FmuVariable::Type::UInt32:
+            status = m_fmu._fmi3GetUInt32(instance, vrs, nvrs, static_cast<fmi3UInt32*>(values), nValues);
+            break;
+        case FmuVariable::Type::Int64:
+            status = m_fmu._fmi3GetInt64(instance, vrs, nvrs, static_cast<fmi3Int64*>(values), nValues);
+            break;
+        case FmuVariable::Type::UInt64:
+            status = m_fmu._fmi3GetUInt64(instance, vrs, nvrs, static_cast<fmi3UInt64*>(values), nValues);
+            break;
+        case FmuVariable::Type::Boolean:
+            status = m_fmu._fmi3GetBoolean(instance, vrs, nvrs, static_cast<fmi3Boolean*>(values), nValues);
+            break;
+        case FmuVariable::Type::String: {
+            // strings are copied null-terminated, one after the other
+            m_strings.resize(nValues);
+            status = m_fmu._fmi3GetString(instance, vrs, nvrs, m_strings.data(), nValues);
+            size_t size = 0;
+            for (const auto str : m_strings) {
+                size_t length = std::strlen(str) + 1;
+                if (size + length > capacity)
+                    throw std::runtime_error("GET: the values exceed the capacity of the channel.");
+                std::memcpy(static_cast<char*>(values) + size, str, length);
+                size += length;
+            }
+            header.payload_size = offset + size;
+            break;
+        }
+        default:
+            throw std::runtime_error("GET: variable type not supported by the remote FMU.");
+    }
+
+    if (type != FmuVariable::Type::String)
+        header.payload_size = offset + nValues * elem_size;
+    header.integer = static_cast<uint64_t>(type);
+    header.count = nValues;
+
+    return status;
+}
+
+fmi3Status FmuRemoteWorker::setValues(FmuRemoteChannel::Header& header, char* payload) {
+    // request: value references, then the values
+    const fmi3ValueReference* vrs = reinterpret_cast<const fmi3ValueReference*>(payload);
+    size_t nvrs = numValueReferences(header, "SET");
+
+    FmuVariable::Type type = m_fmu.GetVariableInfo(vrs[0]).GetType();
+    size_t nValues = 0;
+    bool structural = false;
+    for (size_t i = 0; i < nvrs; ++i) {
+        nValues += m_fmu.GetVariableSize(vrs[i]);
+        structural |= m_fmu.GetVariableInfo(vrs[i]).GetCausality() == FmuVariable::CausalityType::structuralParameter;
+    }
+
+    // structural parameters change the size of other variables
+    if (structural)
+        m_fmu.InvalidateVariableSizes();
+
+    size_t offset = remote_utils::ValuesOffset(nvrs);
+    if (header.payload_size < offset || header.payload_size > m_channel.GetPayloadCapacity())
+        throw std::runtime_error("SET: invalid payload size.");
+    size_t size = static_cast<size_t>(header.payload_size) - offset;
+    size_t elem_size = remote_utils::ValueSize(type);
+    if (elem_size && elem_size * nValues != size)
+        throw std::runtime_error("SET: the number or the type of the values does not match the variables.");
+
+    const void* values = payload + offset;
+    fmi3Instance instance = m_fmu.instance;
+    switch (type) {
+        case FmuVariable::Type::Float32:
+            return m_fmu._fmi3SetFloat32(instance, vrs, nvrs, static_cast<const fmi3Float32*>(values), nValues);
+        case FmuVariable::Type::Float64:
+            return m_fmu._fmi3SetFloat64(instance, vrs, nvrs, static_cast<const fmi3Float64*>(values), nValues);
+        case FmuVariable::Type::Int8:
+            return m_fmu._fmi3SetInt8(instance, vrs, nvrs, static_cast<const fmi3Int8*>(values), nValues);
+        case FmuVariable::Type::UInt8:
+            return m_fmu._fmi3SetUInt8(instance, vrs, nvrs, static_cast<const fmi3UInt8*>(values), nValues);
+        case FmuVariable::Type::Int16:
+            return m_fmu._fmi3SetInt16(instance, vrs, nvrs, static_cast<const fmi3Int16*>(values), nValues);
+        case FmuVariable::Type::UInt16:
+            return m_fmu._fmi3SetUInt16(instance, vrs, nvrs, static_cast<const fmi3UInt16*>(values), nValues);
+        case FmuVariable::Type::Int32:
+            return m_fmu._fmi3SetInt32(instance, vrs, nvrs, static_cast<const fmi3Int32*>(values), nValues);
+        case FmuVariable::Type::UInt32:
+            return m_fmu._fmi3SetUInt32(instance, vrs, nvrs, static_cast<const fmi3UInt32*>(values), nValues);
+        case FmuVariable::Type::Int64:
+            return m_fmu._fmi3SetInt64(instance, vrs, nvrs, static_cast<const fmi3Int64*>(values), nValues);
+        case FmuVariable::Type::UInt64:
+            return m_fmu._fmi3SetUInt64(instance, vrs, nvrs, static_cast<const fmi3UInt64*>(values), nValues);
+        case FmuVariable::Type::Boolean:
+            return m_fmu._fmi3SetBoolean(instance, vrs, nvrs, static_cast<const fmi3Boolean*>(values), nValues);
+        case FmuVariable::Type::String: {
+            m_strings.resize(nValues);
+            const char* str = static_cast<const char*>(values);
+            const char* end = str + size;
+            for (size_t i = 0; i < nValues; ++i) {
+                if (str >= end)
+                    throw std::runtime_error("SET: the number of the values does not match the variables.");
+                size_t length = strnlen(str, static_cast<size_t>(end - str));
+                if (length == static_cast<size_t>(end - str))
+                    throw std::runtime_error("SET: unterminated string value.");
+                m_strings[i] = str;
+                str += length + 1;
+            }
+            return m_fmu._fmi3SetString(instance, vrs, nvrs, m_strings.data(), nValues);
+        }
+        default:
+            throw std::runtime_error("SET: variable type not supported by the remote FMU.");
+    }
+}
+
+size_t FmuRemoteWorker::numValueReferences(const FmuRemoteChannel::Header& header, const char* command) const {
+    size_t capacity = m_channel.GetPayloadCapacity();
+    if (header.count == 0)
+        throw std::runtime_error(std::string(command) + ": no value references.");
+    if (header.count > capacity / sizeof(fmi3ValueReference) ||
+        remote_utils::ValuesOffset(static_cast<size_t>(header.count)) > capacity)
+        throw std::runtime_error(std::string(command) + ": the value references exceed the capacity of the channel.");
+    return static_cast<size_t>(header.count);
+}
+
+// -----------------------------------------------------------------------------
+
+FmuRemoteUnit::FmuRemoteUnit(const std::string& worker_executable, size_t payload_capacity)
+    : m_pid(-1), m_alive(false), m_vr(1) {
+    static std::atomic<int> counter(0);
+    std::string name = "/fmu_forge_" + std::to_string(getpid()) + "_" + std::to_string(counter++);
+    m_channel.reset(new FmuRemoteChannel(name, payload_capacity));
+
+    std::vector<char> arg0(worker_executable.begin(), worker_executable.end());
+    std::vector<char> arg1(name.begin(), name.end());
+    arg0.push_back(0);
+    arg1.push_back(0);
+    char* argv[] = {arg0.data(), arg1.data(), nullptr};
+    pid_t pid;
+    if (posix_spawn(&pid, worker_executable.c_str(), nullptr, nullptr, argv, environ) != 0)
+        throw std::runtime_error("Cannot start the FMU worker " + worker_executable + ".");
+    m_pid = static_cast<int>(pid);
+    m_alive = true;
+
+    // the name of the channel is no longer needed once the worker is attached
+    try {
+        call(FmuRemoteCommand::HELLO);
+    } catch (std::exception&) {
+        // the destructor does not run for a partially constructed object: reap the worker here
+        if (m_pid > 0) {
+            if (m_alive)
+                kill(m_pid, SIGKILL);
+            waitpid(m_pid, nullptr, 0);
+        }
+        throw;
+    }
+    m_channel->Unlink();
+}
+
+FmuRemoteUnit::~FmuRemoteUnit() {
+    if (m_alive) {
+        try {
+            call(FmuRemoteCommand::QUIT);
+        } catch (std::exception&) {
+        }
+    }
+    if (m_pid > 0) {
+        if (m_alive)
+            kill(m_pid, SIGKILL);
+        waitpid(m_pid, nullptr, 0);
+    }
+}
+
+bool FmuRemoteUnit::IsAlive() {
+    if (m_alive && waitpid(m_pid, nullptr, WNOHANG) == m_pid) {
+        m_alive = false;
+        m_pid = -1;  // already reaped
+    }
+    return m_alive;
+}
+
+fmi3Status FmuRemoteUnit::call(FmuRemoteCommand command) {
+    if (!IsAlive())
+        throw std::runtime_error("The FMU worker process is not running.");
+
+    FmuRemoteChannel::Header& header = m_channel->GetHeader();
+    header.command = static_cast<uint32_t>(command);
+    m_channel->Publish(false);
+
+    if (!m_channel->Wait(true, [this]() { return IsAlive(); }))
+        throw std::runtime_error("The FMU worker process terminated unexpectedly.");
+
+    if (header.status < 0)
+        throw std::runtime_error(std::string("FMU worker: ") + header.error);
+
+    return static_cast<fmi3Status>(header.status);
+}
+
+void FmuRemoteUnit::putString(const std::string& str) {
+    FmuRemoteChannel::Header& header = m_channel->GetHeader();
+    if (header.payload_size + str.size() + 1 > header.payload_capacity)
+        throw std::runtime_error("The argument exceeds the capacity of the channel.");
+    std::memcpy(m_channel->GetPayload() + header.payload_size, str.c_str(), str.size() + 1);
+    header.payload_size += str.size() + 1;
+}
+
+void FmuRemoteUnit::Load(FmuType fmuType, const std::string& fmupath, const std::string& unzipdir) {
+    FmuRemoteChannel::Header& header = m_channel->GetHeader();
+    header.integer = static_cast<uint64_t>(fmuType);
+    header.payload_size = 0;
+    putString(fmupath);
+    putString(unzipdir);
+    call(FmuRemoteCommand::LOAD);
+}
+
+void FmuRemoteUnit::LoadUnzipped(FmuType fmuType, const std::string& directory) {
+    FmuRemoteChannel::Header& header = m_channel->GetHeader();
+    header.integer = static_cast<uint64_t>(fmuType);
+    header.payload_size = 0;
+    putString(directory);
+    call(FmuRemoteCommand::LOAD_UNZIPPED);
+}
+
+void FmuRemoteUnit::Instantiate(const std::string& instanceName, bool logging, bool visible) {
+    FmuRemoteChannel::Header& header = m_channel->GetHeader();
+    header.reals[0] = logging ? 1 : 0;
+    header.reals[1] = visible ? 1 : 0;
+    header.payload_size = 0;
+    putString(instanceName);
+    call(FmuRemoteCommand::INSTANTIATE);
+}
+
+void FmuRemoteUnit::FreeInstance() {
+    call(FmuRemoteCommand::FREE_INSTANCE);
+}
+
+fmi3ValueReference FmuRemoteUnit::GetValueReference(const std::string& varname) {
+    m_channel->GetHeader().payload_size = 0;
+    putString(varname);
+    call(FmuRemoteCommand::GET_VALUE_REFERENCE);
+    return static_cast<fmi3ValueReference>(m_channel->GetHeader().integer);
+}
+
+fmi3Status FmuRemoteUnit::EnterInitializationMode(fmi3Boolean toleranceDefined,
+                                                  fmi3Float64 tolerance,
+                                                  fmi3Float64 startTime,
+                                                  fmi3Boolean stopTimeDefined,
+                                                  fmi3Float64 stopTime) {
+    FmuRemoteChannel::Header& header = m_channel->GetHeader();
+    header.reals[0] = toleranceDefined ? 1 : 0;
+    header.reals[1] = tolerance;
+    header.reals[2] = startTime;
+    header.reals[3] = stopTimeDefined ? 1 : 0;
+    header.reals[4] = stopTime;
+    return call(FmuRemoteCommand::ENTER_INITIALIZATION_MODE);
+}
+
+fmi3Status FmuRemoteUnit::ExitInitializationMode() {
+    return call(FmuRemoteCommand::EXIT_INITIALIZATION_MODE);
+}
+
+fmi3Status FmuRemoteUnit::DoStep(fmi3Float64 currentCommunicationPoint,
+                                 fmi3Float64 communicationStepSize,
+                                 fmi3Boolean noSetFMUStatePriorToCurrentPoint) {
+    FmuRemoteChannel::Header& header = m_channel->GetHeader();
+    header.reals[0] = currentCommunicationPoint;
+    header.reals[1] = communicationStepSize;
+    header.reals[2] = noSetFMUStatePriorToCurrentPoint ? 1 : 0;
+    return call(FmuRemoteCommand::DO_STEP);
+}
+
+fmi3Status FmuRemoteUnit::Terminate() {
+    return call(FmuRemoteCommand::TERMINATE);
+}
+
+fmi3Status FmuRemoteUnit::Reset() {
+    return call(FmuRemoteCommand::RESET);
+}
+
+fmi3Status FmuRemoteUnit::getValues(const fmi3ValueReference* vrs, size_t nvrs, size_t elem_size) {
+    FmuRemoteChannel::Header& header = m_channel->GetHeader();
+    if (remote_utils::ValuesOffset(nvrs) > header.payload_capacity)
+        throw std::runtime_error("The value references exceed the capacity of the channel.");
+
+    std::memcpy(m_channel->GetPayload(), vrs, nvrs * sizeof(fmi3ValueReference));
+    header.count = nvrs;
+    header.payload_size = nvrs * sizeof(fmi3ValueReference);
+    fmi3Status status = call(FmuRemoteCommand::GET);
+
+    size_t value_size = remote_utils::ValueSize(static_cast<FmuVariable::Type>(header.integer));
+    if (value_size != elem_size)
+        throw std::runtime_error("GetVariable: the value type does not match the type of the variable.");
+
+    return status;
+}
+
+template <class T>
+void FmuRemoteUnit::readValues(size_t nvrs, std::vector<T>& values) {
+    values.resize(static_cast<size_t>(m_channel->GetHeader().count));
+    const char* data = m_channel->GetPayload() + remote_utils::ValuesOffset(nvrs);
+    std::memcpy(values.data(), data, values.size() * sizeof(T));
+}
+
+void FmuRemoteUnit::readValues(size_t nvrs, std::vector<std::string>& values) {
+    values.resize(static_cast<size_t>(m_channel->GetHeader().count));
+    const char* str = m_channel->GetPayload() + remote_utils::ValuesOffset(nvrs);
+    for (auto& value : values) {
+        value.assign(str);
+        str += value.size() + 1;
+    }
+}
+
+template <class T>
+fmi3Status FmuRemoteUnit::GetVariable(fmi3ValueReference vr, T& value) {
+    std::vector<T> values;
+    fmi3Status status = GetVariable(vr, values);
+    if (values.size() != 1)
+        throw std::runtime_error("GetVariable: the variable is not a scalar.");
+    value = values[0];
+    return status;
+}
+
+template <class T>
+fmi3Status FmuRemoteUnit::GetVariable(fmi3ValueReference vr, std::vector<T>& values) {
+    m_vr[0] = vr;
+    return GetVariables(m_vr, values);
+}
+
+template <class T>
+fmi3Status FmuRemoteUnit::GetVariables(const std::vector<fmi3ValueReference>& vrs, std::vector<T>& values) {
+    bool is_string = std::is_same<T, std::string>::value;
+    fmi3Status status = getValues(vrs.data(), vrs.size(), is_string ? 0 : sizeof(T));
+    readValues(vrs.size(), values);
+    return status;
+}
+
+fmi3Status FmuRemoteUnit::setValues(const fmi3ValueReference* vrs, size_t nvrs, const void* values, size_t size) {
+    FmuRemoteChannel::Header& header = m_channel->GetHeader();
+    size_t offset = remote_utils::ValuesOffset(nvrs);
+    if (offset + size > header.payload_capacity)
+        throw std::runtime_error("The values exceed the capacity of the channel.");
+
+    std::memcpy(m_channel->GetPayload(), vrs, nvrs * sizeof(fmi3ValueReference));
+    std::memcpy(m_channel->GetPayload() + offset, values, size);
+    header.count = nvrs;
+    header.payload_size = offset + size;
+    return call(FmuRemoteCommand::SET);
+}
+
+fmi3Status FmuRemoteUnit::setValues(const fmi3ValueReference* vrs,
+                                    size_t nvrs,
+                                    const std::vector<std::string>& values) {
+    size_t size = 0;
+    for (const auto& str : values)
+        size += str.size() + 1;
+    std::string buffer;
+    buffer.reserve(size);
+    for (const auto& str : values)
+        buffer.append(str.c_str(), str.size() + 1);
+    return setValues(vrs, nvrs, buffer.data(), buffer.size());
+}
+
+template <class T>
+fmi3Status FmuRemoteUnit::SetVariable(fmi3ValueReference vr, const T& value) {
+    return SetVariable(vr, std::vector<T>(1, value));
+}
+
+template <class T>
+fmi3Status FmuRemoteUnit::SetVariable(fmi3ValueReference vr, const std::vector<T>& values) {
+    m_vr[0] = vr;
+    return SetVariables(m_vr, values);
+}
+
+template <class T>
+fmi3Status FmuRemoteUnit::SetVariables(const std::vector<fmi3ValueReference>& vrs, const std::vector<T>& values) {
+    return setValues(vrs.data(), vrs.size(), values);
+}
+
+/// @} fmu_forge_fmi3
+
+}  // namespace fmi3
+}  // namespace fmu_forge
@@ -0,0 +1,409 @@
+// =============================================================================
+// fmu-forge
+//
+// Copyright (c) 2024 Project Chrono (projectchrono.org)
+// Copyright (c) 2024 Digital Dynamics Lab, University of Parma, Italy
+// Copyright (c) 2024 Simulation Based Engineering Lab, University of Wisconsin-Madison, USA
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution.
+//
+// =============================================================================
+// Binary recorder of the results of an FMU simulation (FMI 3.0)
+// =============================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fmi3/FmuToolsImport.h"
+
+namespace fmu_forge {
+namespace fmi3 {
+
+/// @addtogroup fmu_forge_fmi3
+/// @{
+
+/// Recorder of the values of a set of variables of an FMU, written to a columnar binary file.
+/// After each DoStep the host calls Sample: the variables are read through an FmuVariableGroup, with a single fmi3Get
+/// call per variable type, and appended to the active chunk; full chunks are written to file by a background thread
+/// while the other chunk is filled (double buffering).
+/// Numeric and Boolean variables (scalars or arrays) can be recorded.
+///
+/// File layout (little endian, as written by the host):
+/// - header: "FMURES01", uint32 number of variables, then for each variable:
+///   uint32 name length, name, uint8 type (FmuVariable::Type), uint64 number of values per sample;
+/// - chunks: uint64 number of samples N, then the time column (N fmi3Float64), then the column of each variable
+///   (N x number of values, in the variable type).
+class ResultRecorder {
+  public:
+    /// Create a recorder of the given FMU, writing to 'filename'; each chunk holds 'chunk_size' samples.
+    ResultRecorder(FmuUnit& fmu, const std::string& filename, size_t chunk_size = 4096);
+
+    ~ResultRecorder();
+
+    ResultRecorder(const ResultRecorder&) = delete;
+    ResultRecorder& operator=(const ResultRecorder&) = delete;
+
+    /// Add a variable to the recorded set (before the first Sample).
+    void AddVariable(fmi3ValueReference valref);
+
+    /// Add a variable to the recorded set, given its name (before the first Sample).
+    void AddVariable(const std::string& name) { AddVariable(m_fmu.GetValueReference(name)); }
+
+    /// Record one every 'num_steps' calls to Sample (default: 1).
+    void SetStepDecimation(size_t num_steps) { m_stepDecimation = std::max<size_t>(num_steps, 1); }
+
+    /// Record samples at least 'interval' apart in time (default: 0, i.e. no time decimation).
+    void SetTimeInterval(fmi3Float64 interval) { m_timeInterval = interval; }
+
+    /// Sample the recorded variables at the given time, subject to decimation.
+    /// Call after each DoStep; the file is opened at the first call.
+    void Sample(fmi3Float64 time);
+
+    /// Write the pending samples and close the file. Called by the destructor.
+    void Close();
+
+    /// Return the number of samples recorded so far.
+    size_t GetNumSamples() const { return m_numSamples; }
+
+    /// Convert a file written by a ResultRecorder into a CSV file (one row per sample, arrays expanded by element).
+    static void ExportCSV(const std::string& result_filename, const std::string& csv_filename, char separator = ',');
+
+  private:
+    struct Column {
+        fmi3ValueReference valref;
+        std::string name;
+        FmuVariable::Type type;
+        size_t size;       ///< number of values per sample
+        size_t elem_size;  ///< size in bytes of each value
+    };
+
+    /// Samples of all the columns; columns are stored one after the other.
+    struct Chunk {
+        size_t numSamples = 0;
+        std::vector<fmi3Float64> time;
+        std::vector<std::vector<char>> columns;
+    };
+
+    template <typename T>
+    static void printValue(std::ostream& out, const char* value) {
+        T v;
+        std::memcpy(&v, value, sizeof(T));
+        out << +v;  // promote 8-bit integers and Booleans
+    }
+    static void printValue(std::ostream& out, FmuVariable::Type type, const char* value);
+
+    void open();
+    void writeHeader();
+    void writeChunk(const Chunk& chunk);
+    void writerLoop();
+
+    /// Hand the active chunk to the writer thread and switch to the other one.
+    void swapChunks();
+
+    FmuUnit& m_fmu;
+    std::string m_filename;
+    std::ofstream m_file;
+    size_t m_chunkSize;
+
+    std::vector<Column> m_columns;
+    std::unique_ptr<FmuVariableGroup> m_group;  ///< recorded variables, in the order of the columns
+
+    size_t m_stepDecimation = 1;
+    fmi3Float64 m_timeInterval = 0;
+    size_t m_numCalls = 0;
+    size_t m_numSamples = 0;
+    fmi3Float64 m_lastTime = -std::numeric_limits<fmi3Float64>::infinity();
+
+    Chunk m_chunks[2];
+    size_t m_active = 0;
+
+    std::thread m_writer;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    const Chunk* m_pending = nullptr;  ///< chunk being written by the writer thread
+    bool m_stop = false;
+    bool m_opened = false;
+    bool m_closed = false;
+};
+
+// -----------------------------------------------------------------------------
+
+ResultRecorder::ResultRecorder(FmuUnit& fmu, const std::string& filename, size_t chunk_size)
+    : m_fmu(fmu), m_filename(filename), m_chunkSize(std::max<size_t>(chunk_size, 1)) {}
+
+ResultRecorder::~ResultRecorder() {
+    try {
+        Close();
+    } catch (...) {
+    }
+}
+
+void ResultRecorder::AddVariable(fmi3ValueReference valref) {
+    if (m_opened)
+        throw std::runtime_error("ResultRecorder: variables must be added before the first sample.");
+
+    const FmuVariableImport& var = m_fmu.GetVariableInfo(valref);
+    if (!FmuVariable::IsFixedSizeType(var.GetType()))
+        throw std::runtime_error("ResultRecorder: only numeric and Boolean variables can be recorded ('" +
+                                 var.GetName() + "').");
+
+    Column column;
+    column.valref = valref;
+    column.name = var.GetName();
+    column.type = var.GetType();
+    column.size = m_fmu.GetVariableSize(var);
+    column.elem_size = FmuVariable::GetTypeSize(column.type);
+
+    m_columns.push_back(column);
+}
+
+void ResultRecorder::Sample(fmi3Float64 time) {
+    if (m_closed)
+        throw std::runtime_error("ResultRecorder: sampling after Close.");
+    if (!m_opened)
+        open();
+
+    if (m_numCalls++ % m_stepDecimation != 0)
+        return;
+    if (time < m_lastTime + m_timeInterval)
+        return;
+    m_lastTime = time;
+
+    if (m_group->Fetch() > fmi3Status::fmi3Warning)
+        throw std::runtime_error("ResultRecorder: failed to get the values of the recorded variables.");
+
+    Chunk& chunk = m_chunks[m_active];
+    size_t row = chunk.numSamples;
+    chunk.time[row] = time;
+    for (size_t c = 0; c < m_columns.size(); ++c) {
+        const Column& column = m_columns[c];
+        size_t bytes = column.size * column.elem_size;
+        std::memcpy(chunk.columns[c].data() + row * bytes, m_group->RawValues(c), bytes);
+    }
+    ++chunk.numSamples;
+    ++m_numSamples;
+
+    if (chunk.numSamples == m_chunkSize)
+        swapChunks();
+}
+
+void ResultRecorder::Close() {
+    if (!m_opened || m_closed)
+        return;
+
+    if (m_chunks[m_active].numSamples > 0)
+        swapChunks();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    m_writer.join();
+
+    m_file.close();
+    m_closed = true;
+}
+
+void ResultRecorder::printValue(std::ostream& out, FmuVariable::Type type, const char* value) {
+    switch (type) {
+        case FmuVariable::Type::Float64:
+            return printValue<fmi3Float64>(out, value);
+        case FmuVariable::Type::Float32:
+            return printValue<fmi3Float32>(out, value);
+        case FmuVariable::Type::Int8:
+            return printValue<fmi3Int8>(out, value);
+        case FmuVariable::Type::UInt8:
+            return printValue<fmi3UInt8>(out, value);
+        case FmuVariable::Type::Int16:
+            return printValue<fmi3Int16>(out, value);
+        case FmuVariable::Type::UInt16:
+            return printValue<fmi3UInt16>(out, value);
+        case FmuVariable::Type::Int32:
+            return printValue<fmi3Int32>(out, value);
+        case FmuVariable::Type::UInt32:
+            return printValue<fmi3UInt32>(out, value);
+        case FmuVariable::Type::Int64:
+            return printValue<fmi3Int64>(out, value);
+        case FmuVariable::Type::UInt64:
+            return printValue<fmi3UInt64>(out, value);
+        case FmuVariable::Type::Boolean:
+            return printValue<fmi3Boolean>(out, value);
+        default:
+            return;
+    }
+}
+
+void ResultRecorder::open() {
+    m_file.open(m_filename, std::ios::binary | std::ios::trunc);
+    if (!m_file)
+        throw std::runtime_error("ResultRecorder: unable to open '" + m_filename + "'.");
+
+    // sizes of array variables are those in effect at the first sample
+    std::vector<fmi3ValueReference> valrefs;
+    for (const auto& column : m_columns)
+        valrefs.push_back(column.valref);
+    m_group.reset(new FmuVariableGroup(m_fmu, valrefs));
+    for (size_t c = 0; c < m_columns.size(); ++c)
+        m_columns[c].size = m_group->GetSize(c);
+
+    for (auto& chunk : m_chunks) {
+        chunk.time.resize(m_chunkSize);
+        chunk.columns.resize(m_columns.size());
+        for (size_t c = 0; c < m_columns.size(); ++c)
+            chunk.columns[c].resize(m_chunkSize * m_columns[c].size * m_columns[c].elem_size);
+    }
+
+    writeHeader();
+
+    m_writer = std::thread(&ResultRecorder::writerLoop, this);
+    m_opened = true;
+}
+
+void ResultRecorder::writeHeader() {
+    m_file.write("FMURES01", 8);
+
+    std::uint32_t num_columns = static_cast<std::uint32_t>(m_columns.size());
+    m_file.write(reinterpret_cast<const char*>(&num_columns), sizeof(num_columns));
+    for (const auto& column : m_columns) {
+        std::uint32_t length = static_cast<std::uint32_t>(column.name.size());
+        std::uint8_t type = static_cast<std::uint8_t>(column.type);
+        std::uint64_t size = column.size;
+        m_file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        m_file.write(column.name.data(), length);
+        m_file.write(reinterpret_cast<const char*>(&type), sizeof(type));
+        m_file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    }
+}
+
+void ResultRecorder::writeChunk(const Chunk& chunk) {
+    std::uint64_t num_samples = chunk.numSamples;
+    m_file.write(reinterpret_cast<const char*>(&num_samples), sizeof(num_samples));
+    m_file.write(reinterpret_cast<const char*>(chunk.time.data()), chunk.numSamples * sizeof(fmi3Float64));
+    for (size_t c = 0; c < m_columns.size(); ++c)
+        m_file.write(chunk.columns[c].data(), chunk.numSamples * m_columns[c].size * m_columns[c].elem_size);
+}
+
+void ResultRecorder::swapChunks() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // wait for the writer to release the other chunk
+    m_cv.wait(lock, [this]() { return m_pending == nullptr; });
+    m_pending = &m_chunks[m_active];
+    lock.unlock();
+    m_cv.notify_all();
+
+    m_active = 1 - m_active;
+    m_chunks[m_active].numSamples = 0;
+}
+
+void ResultRecorder::writerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cv.wait(lock, [this]() { return m_stop || m_pending != nullptr; });
+        if (m_pending) {
+            const Chunk* chunk = m_pending;
+            lock.unlock();
+            writeChunk(*chunk);
+            lock.lock();
+            m_pending = nullptr;
+            m_cv.notify_all();
+        } else if (m_stop) {
+            return;
+        }
+    }
+}
+
+void ResultRecorder::ExportCSV(const std::string& result_filename, const std::string& csv_filename, char separator) {
+    std::ifstream in(result_filename, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("ResultRecorder: unable to open '" + result_filename + "'.");
+
+    char magic[8];
+    in.read(magic, 8);
+    if (!in || std::memcmp(magic, "FMURES01", 8) != 0)
+        throw std::runtime_error("ResultRecorder: '" + result_filename + "' is not a result file.");
+
+    std::uint32_t num_columns = 0;
+    in.read(reinterpret_cast<char*>(&num_columns), sizeof(num_columns));
+
+    std::vector<Column> columns(num_columns);
+    for (auto& column : columns) {
+        std::uint32_t length = 0;
+        std::uint8_t type = 0;
+        std::uint64_t size = 0;
+        in.read(reinterpret_cast<char*>(&length), sizeof(length));
+        column.name.resize(length);
+        in.read(&column.name[0], length);
+        in.read(reinterpret_cast<char*>(&type), sizeof(type));
+        in.read(reinterpret_cast<char*>(&size), sizeof(size));
+        column.type = static_cast<FmuVariable::Type>(type);
+        column.size = static_cast<size_t>(size);
+        column.elem_size = FmuVariable::GetTypeSize(column.type);
+        if (!in || !FmuVariable::IsFixedSizeType(column.type))
+            throw std::runtime_error("ResultRecorder: corrupted header in '" + result_filename + "'.");
+    }
+
+    std::ofstream out(csv_filename);
+    if (!out)
+        throw std::runtime_error("ResultRecorder: unable to open '" + csv_filename + "'.");
+    out << std::setprecision(std::numeric_limits<fmi3Float64>::max_digits10);
+
+    out << "time";
+    for (const auto& column : columns) {
+        if (column.size == 1)
+            out << separator << column.name;
+        else
+            for (size_t k = 0; k < column.size; ++k)
+                out << separator << column.name << "[" << k << "]";
+    }
+    out << "\n";
+
+    std::vector<fmi3Float64> time;
+    std::vector<std::vector<char>> data(num_columns);
+    std::uint64_t num_samples = 0;
+    while (in.read(reinterpret_cast<char*>(&num_samples), sizeof(num_samples))) {
+        size_t n = static_cast<size_t>(num_samples);
+        time.resize(n);
+        in.read(reinterpret_cast<char*>(time.data()), n * sizeof(fmi3Float64));
+        for (size_t c = 0; c < num_columns; ++c) {
+            data[c].resize(n * columns[c].size * columns[c].elem_size);
+            in.read(data[c].data(), data[c].size());
+        }
+        if (!in)
+            throw std::runtime_error("ResultRecorder: truncated chunk in '" + result_filename + "'.");
+
+        for (size_t row = 0; row < n; ++row) {
+            out << time[row];
+            for (size_t c = 0; c < num_columns; ++c) {
+                const Column& column = columns[c];
+                const char* values = data[c].data() + row * column.size * column.elem_size;
+                for (size_t k = 0; k < column.size; ++k) {
+                    out << separator;
+                    printValue(out, column.type, values + k * column.elem_size);
+                }
+            }
+            out << "\n";
+        }
+    }
+}
+
+/// @} fmu_forge_fmi3
+
+}  // namespace fmi3
+}  // namespace fmu_forge
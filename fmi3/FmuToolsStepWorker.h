@@ -0,0 +1,200 @@
+// =============================================================================
+// fmu-forge
+//
+// Copyright (c) 2024 Project Chrono (projectchrono.org)
+// Copyright (c) 2024 Digital Dynamics Lab, University of Parma, Italy
+// Copyright (c) 2024 Simulation Based Engineering Lab, University of Wisconsin-Madison, USA
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution.
+//
+// =============================================================================
+// Dedicated worker thread for the asynchronous steps of an imported FMU (FMI 3.0)
+// =============================================================================
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "fmi3/fmi3_headers/fmi3FunctionTypes.h"
+
+namespace fmu_forge {
+namespace fmi3 {
+
+/// @addtogroup fmu_forge_fmi3
+/// @{
+
+/// Worker thread running the steps of a single FMU instance, one at a time (see FmuUnit::DoStepAsync).
+/// A step is handed off to the worker, and its completion back to the caller, through an atomic state: each side
+/// spins for a short while before parking on a condition variable, so that the mutex is only used when the other
+/// side is idle for longer.
+class FmuStepWorker {
+  public:
+    typedef std::function<fmi3Status(fmi3Float64, fmi3Float64, fmi3Boolean)> StepFunction;
+
+    explicit FmuStepWorker(StepFunction step);
+    ~FmuStepWorker();
+
+    FmuStepWorker(const FmuStepWorker&) = delete;
+    FmuStepWorker& operator=(const FmuStepWorker&) = delete;
+
+    /// Start a step on the worker thread; no other step must be in progress.
+    void Submit(fmi3Float64 currentCommunicationPoint,
+                fmi3Float64 communicationStepSize,
+                fmi3Boolean noSetFMUStatePriorToCurrentPoint);
+
+    /// Check if a step was submitted and is not completed yet.
+    bool IsBusy() const;
+
+    /// Check if the last submitted step is completed (or no step was submitted).
+    bool IsReady() const { return !IsBusy(); }
+
+    /// Wait for the completion of the last submitted step and return its status.
+    /// Exceptions thrown by the step are rethrown here.
+    fmi3Status Wait();
+
+  private:
+    enum State { IDLE, PENDING, DONE, STOP };
+
+    static const int spin_count = 2000;  ///< polls of the state before parking
+
+    void workerLoop();
+
+    /// Wait until the state satisfies 'pred', spinning first and then parking with the given flag.
+    template <typename Pred>
+    void waitFor(std::atomic<bool>& parked, std::condition_variable& cv, Pred pred);
+
+    /// Set the state and wake the other side, if parked.
+    void publish(State state, std::atomic<bool>& parked, std::condition_variable& cv);
+
+    StepFunction m_step;
+
+    std::atomic<int> m_state;
+    fmi3Float64 m_currentCommunicationPoint = 0;
+    fmi3Float64 m_communicationStepSize = 0;
+    fmi3Boolean m_noSetFMUStatePriorToCurrentPoint = fmi3True;
+    fmi3Status m_status = fmi3Status::fmi3OK;
+    std::exception_ptr m_exception;
+
+    std::mutex m_mutex;
+    std::condition_variable m_workerCv;
+    std::condition_variable m_callerCv;
+    std::atomic<bool> m_workerParked;
+    std::atomic<bool> m_callerParked;
+
+    std::thread m_worker;
+};
+
+/// Completion handle of an asynchronous step (see FmuUnit::DoStepAsync).
+/// The handle is valid until the next asynchronous step of the same FMU.
+class FmuStepHandle {
+  public:
+    explicit FmuStepHandle(FmuStepWorker* worker = nullptr) : m_worker(worker) {}
+
+    /// Check if the step is completed.
+    bool IsReady() const { return !m_worker || m_worker->IsReady(); }
+
+    /// Wait for the completion of the step and return its status.
+    fmi3Status Wait() const { return m_worker ? m_worker->Wait() : fmi3Status::fmi3OK; }
+
+  private:
+    FmuStepWorker* m_worker;
+};
+
+// -----------------------------------------------------------------------------
+
+FmuStepWorker::FmuStepWorker(StepFunction step)
+    : m_step(step), m_state(IDLE), m_workerParked(false), m_callerParked(false) {
+    m_worker = std::thread(&FmuStepWorker::workerLoop, this);
+}
+
+FmuStepWorker::~FmuStepWorker() {
+    // let a step in progress complete, then stop the worker
+    if (IsBusy())
+        waitFor(m_callerParked, m_callerCv, [](int state) { return state == DONE; });
+    publish(STOP, m_workerParked, m_workerCv);
+    m_worker.join();
+}
+
+void FmuStepWorker::Submit(fmi3Float64 currentCommunicationPoint,
+                           fmi3Float64 communicationStepSize,
+                           fmi3Boolean noSetFMUStatePriorToCurrentPoint) {
+    if (IsBusy())
+        throw std::runtime_error("FmuStepWorker: a step is already in progress.");
+
+    m_currentCommunicationPoint = currentCommunicationPoint;
+    m_communicationStepSize = communicationStepSize;
+    m_noSetFMUStatePriorToCurrentPoint = noSetFMUStatePriorToCurrentPoint;
+    m_exception = nullptr;
+
+    publish(PENDING, m_workerParked, m_workerCv);
+}
+
+bool FmuStepWorker::IsBusy() const {
+    return m_state.load(std::memory_order_acquire) == PENDING;
+}
+
+fmi3Status FmuStepWorker::Wait() {
+    waitFor(m_callerParked, m_callerCv, [](int state) { return state != PENDING; });
+
+    if (m_state.load(std::memory_order_acquire) == DONE) {
+        m_state.store(IDLE, std::memory_order_relaxed);
+        if (m_exception)
+            std::rethrow_exception(m_exception);
+    }
+
+    return m_status;
+}
+
+void FmuStepWorker::workerLoop() {
+    while (true) {
+        waitFor(m_workerParked, m_workerCv, [](int state) { return state == PENDING || state == STOP; });
+        if (m_state.load(std::memory_order_acquire) == STOP)
+            return;
+
+        try {
+            m_status =
+                m_step(m_currentCommunicationPoint, m_communicationStepSize, m_noSetFMUStatePriorToCurrentPoint);
+        } catch (...) {
+            m_status = fmi3Status::fmi3Error;
+            m_exception = std::current_exception();
+        }
+
+        publish(DONE, m_callerParked, m_callerCv);
+    }
+}
+
+template <typename Pred>
+void FmuStepWorker::waitFor(std::atomic<bool>& parked, std::condition_variable& cv, Pred pred) {
+    for (int i = 0; i < spin_count; ++i) {
+        if (pred(m_state.load(std::memory_order_acquire)))
+            return;
+        std::this_thread::yield();
+    }
+
+    // the flag is raised before checking the state again, so that a concurrent publish cannot be missed
+    std::unique_lock<std::mutex> lock(m_mutex);
+    parked.store(true);
+    cv.wait(lock, [this, &pred]() { return pred(m_state.load()); });
+    parked.store(false);
+}
+
+void FmuStepWorker::publish(State state, std::atomic<bool>& parked, std::condition_variable& cv) {
+    m_state.store(state);
+    if (parked.load()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        cv.notify_one();
+    }
+}
+
+/// @} fmu_forge_fmi3
+
+}  // namespace fmi3
+}  // namespace fmu_forge
@@ -0,0 +1,160 @@
+// =============================================================================
+// fmu-forge
+//
+// Copyright (c) 2024 Project Chrono (projectchrono.org)
+// Copyright (c) 2024 Digital Dynamics Lab, University of Parma, Italy
+// Copyright (c) 2024 Simulation Based Engineering Lab, University of Wisconsin-Madison, USA
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution.
+//
+// =============================================================================
+// Thread pool for running parallel loops over imported FMUs (FMI 3.0)
+// =============================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fmu_forge {
+namespace fmi3 {
+
+/// @addtogroup fmu_forge_fmi3
+/// @{
+
+/// Pool of persistent threads running parallel loops.
+/// The calling thread takes part in each loop, so that a pool of N threads starts N-1 workers. Indices are handed out
+/// dynamically, one at a time, so that tasks of uneven duration are balanced among the threads.
+class FmuThreadPool {
+  public:
+    /// Create a pool with the given number of threads (if 0, the number of hardware threads).
+    explicit FmuThreadPool(size_t num_threads = 0);
+
+    ~FmuThreadPool();
+
+    FmuThreadPool(const FmuThreadPool&) = delete;
+    FmuThreadPool& operator=(const FmuThreadPool&) = delete;
+
+    /// Return the number of threads running the loops, including the calling one.
+    size_t GetNumThreads() const { return m_workers.size() + 1; }
+
+    /// Call 'task' for indices in [0, n) and wait for all of them to complete.
+    /// Exceptions thrown by the task are rethrown (the first one, once all the indices have been processed).
+    void ParallelFor(size_t n, const std::function<void(size_t)>& task);
+
+  private:
+    /// Process indices of the current loop until none is left.
+    void runTasks(const std::function<void(size_t)>& task, size_t n);
+
+    void workerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    const std::function<void(size_t)>* m_task = nullptr;
+    size_t m_taskSize = 0;
+    std::atomic<size_t> m_taskNext;
+    size_t m_taskPending = 0;
+    size_t m_generation = 0;
+    bool m_stop = false;
+    std::exception_ptr m_exception;
+};
+
+// -----------------------------------------------------------------------------
+
+FmuThreadPool::FmuThreadPool(size_t num_threads) : m_taskNext(0) {
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t i = 1; i < num_threads; ++i)
+        m_workers.emplace_back(&FmuThreadPool::workerLoop, this);
+}
+
+FmuThreadPool::~FmuThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_start.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+}
+
+void FmuThreadPool::ParallelFor(size_t n, const std::function<void(size_t)>& task) {
+    if (m_workers.empty() || n <= 1) {
+        for (size_t i = 0; i < n; ++i)
+            task(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_taskSize = n;
+        m_taskNext = 0;
+        m_taskPending = m_workers.size() + 1;
+        m_exception = nullptr;
+        ++m_generation;
+    }
+    m_start.notify_all();
+
+    runTasks(task, n);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (--m_taskPending > 0)
+        m_done.wait(lock, [this]() { return m_taskPending == 0; });
+    m_task = nullptr;
+
+    if (m_exception)
+        std::rethrow_exception(m_exception);
+}
+
+void FmuThreadPool::runTasks(const std::function<void(size_t)>& task, size_t n) {
+    size_t i;
+    while ((i = m_taskNext.fetch_add(1)) < n) {
+        try {
+            task(i);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_exception)
+                m_exception = std::current_exception();
+        }
+    }
+}
+
+void FmuThreadPool::workerLoop() {
+    size_t generation = 0;
+    while (true) {
+        const std::function<void(size_t)>* task;
+        size_t n;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [this, generation]() { return m_stop || m_generation != generation; });
+            if (m_stop)
+                return;
+            generation = m_generation;
+            task = m_task;
+            n = m_taskSize;
+        }
+
+        runTasks(*task, n);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_taskPending == 0)
+            m_done.notify_one();
+    }
+}
+
+/// @} fmu_forge_fmi3
+
+}  // namespace fmi3
+}  // namespace fmu_forge
@@ -0,0 +1,401 @@
+// =============================================================================
+// fmu-forge
+//
+// Copyright (c) 2024 Project Chrono (projectchrono.org)
+// Copyright (c) 2024 Digital Dynamics Lab, University of Parma, Italy
+// Copyright (c) 2024 Simulation Based Engineering Lab, University of Wisconsin-Madison, USA
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution.
+//
+// =============================================================================
+// Tracing of the calls to the FMI functions of imported FMUs (FMI 3.0)
+// =============================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fmi3/fmi3_headers/fmi3FunctionTypes.h"
+
+namespace fmu_forge {
+namespace fmi3 {
+
+/// @addtogroup fmu_forge_fmi3
+/// @{
+
+/// FMI functions called on an instance, interposed by the tracer (see FmuUnit::SetTracer).
+#define FMU_TRACED_FUNCTIONS(X)              \
+    X(fmi3SetDebugLogging)                   \
+    X(fmi3FreeInstance)                      \
+    X(fmi3EnterInitializationMode)           \
+    X(fmi3ExitInitializationMode)            \
+    X(fmi3EnterEventMode)                    \
+    X(fmi3Terminate)                         \
+    X(fmi3Reset)                             \
+    X(fmi3GetFloat32)                        \
+    X(fmi3GetFloat64)                        \
+    X(fmi3GetInt8)                           \
+    X(fmi3GetUInt8)                          \
+    X(fmi3GetInt16)                          \
+    X(fmi3GetUInt16)                         \
+    X(fmi3GetInt32)                          \
+    X(fmi3GetUInt32)                         \
+    X(fmi3GetInt64)                          \
+    X(fmi3GetUInt64)                         \
+    X(fmi3GetBoolean)                        \
+    X(fmi3GetString)                         \
+    X(fmi3GetBinary)                         \
+    X(fmi3GetClock)                          \
+    X(fmi3SetFloat32)                        \
+    X(fmi3SetFloat64)                        \
+    X(fmi3SetInt8)                           \
+    X(fmi3SetUInt8)                          \
+    X(fmi3SetInt16)                          \
+    X(fmi3SetUInt16)                         \
+    X(fmi3SetInt32)                          \
+    X(fmi3SetUInt32)                         \
+    X(fmi3SetInt64)                          \
+    X(fmi3SetUInt64)                         \
+    X(fmi3SetBoolean)                        \
+    X(fmi3SetString)                         \
+    X(fmi3SetBinary)                         \
+    X(fmi3SetClock)                          \
+    X(fmi3GetNumberOfVariableDependencies)   \
+    X(fmi3GetVariableDependencies)           \
+    X(fmi3GetFMUState)                       \
+    X(fmi3SetFMUState)                       \
+    X(fmi3FreeFMUState)                      \
+    X(fmi3SerializedFMUStateSize)            \
+    X(fmi3SerializeFMUState)                 \
+    X(fmi3DeserializeFMUState)               \
+    X(fmi3GetDirectionalDerivative)          \
+    X(fmi3GetAdjointDerivative)              \
+    X(fmi3EnterConfigurationMode)            \
+    X(fmi3ExitConfigurationMode)             \
+    X(fmi3GetIntervalDecimal)                \
+    X(fmi3GetIntervalFraction)               \
+    X(fmi3GetShiftDecimal)                   \
+    X(fmi3GetShiftFraction)                  \
+    X(fmi3SetIntervalDecimal)                \
+    X(fmi3SetIntervalFraction)               \
+    X(fmi3SetShiftDecimal)                   \
+    X(fmi3SetShiftFraction)                  \
+    X(fmi3EvaluateDiscreteStates)            \
+    X(fmi3UpdateDiscreteStates)              \
+    X(fmi3EnterStepMode)                     \
+    X(fmi3GetOutputDerivatives)              \
+    X(fmi3DoStep)                            \
+    X(fmi3EnterContinuousTimeMode)           \
+    X(fmi3CompletedIntegratorStep)           \
+    X(fmi3SetTime)                           \
+    X(fmi3SetContinuousStates)               \
+    X(fmi3GetContinuousStateDerivatives)     \
+    X(fmi3GetEventIndicators)                \
+    X(fmi3GetContinuousStates)               \
+    X(fmi3GetNominalsOfContinuousStates)     \
+    X(fmi3GetNumberOfEventIndicators)        \
+    X(fmi3GetNumberOfContinuousStates)       \
+    X(fmi3ActivateModelPartition)
+
+/// Identifiers of the traced functions; instantiation is timed by FmuUnit::Instantiate.
+enum FmuTracedFunction : std::uint16_t {
+#define FMU_TRACED_FUNCTION_ID(funcName) FmuTrace_##funcName,
+    FMU_TRACED_FUNCTIONS(FMU_TRACED_FUNCTION_ID)
+#undef FMU_TRACED_FUNCTION_ID
+    FmuTrace_fmi3Instantiate,
+    FmuTrace_NumFunctions
+};
+
+/// Return the name of a traced function.
+const char* FmuTracedFunctionName(size_t id);
+
+// -----------------------------------------------------------------------------
+
+/// Histogram of the latencies of a function, with logarithmic (power of 2) buckets.
+struct FmuLatencyHistogram {
+    static const size_t num_buckets = 64;
+
+    std::uint64_t calls = 0;
+    std::uint64_t total_ns = 0;
+    std::uint64_t min_ns = UINT64_MAX;
+    std::uint64_t max_ns = 0;
+    std::uint64_t buckets[num_buckets] = {};  ///< bucket i counts latencies in [2^(i-1), 2^i) ns
+
+    void Add(std::uint64_t ns);
+
+    /// Return an upper bound of the given percentile (0-100) of the latencies, in ns.
+    std::uint64_t Percentile(double p) const;
+};
+
+class FmuTracer;
+
+/// Calls recorded for one FMU instance.
+struct FmuTraceChannel {
+    /// Call to an FMI function.
+    struct Event {
+        std::uint16_t function;
+        std::int64_t start_ns;  ///< since the creation of the tracer
+        std::int64_t duration_ns;
+    };
+
+    const FmuTracer* tracer;
+    std::string name;
+    size_t index;
+    void* originals[FmuTrace_NumFunctions] = {};  ///< function pointers of the FMU library
+    std::vector<Event> events;
+    size_t max_events;
+    size_t dropped_events = 0;  ///< calls not stored in the timeline since 'max_events' was reached
+    FmuLatencyHistogram histograms[FmuTrace_NumFunctions];
+};
+
+/// Tracer of the calls to the FMI functions of a set of FMUs.
+/// FMUs attached to the tracer before loading (FmuUnit::SetTracer) have their FMI function pointers replaced by
+/// wrappers timing each call. The tracer records per-function latency histograms and a timeline of the calls of each
+/// FMU, which can be exported in the Chrome trace event format (viewable with chrome://tracing or Perfetto).
+/// Each FMU records into its own channel: FMUs can be run concurrently, but the tracer must not be queried or exported
+/// while they run.
+class FmuTracer {
+  public:
+    /// Create a tracer storing up to 'max_events' calls per FMU in the timeline.
+    explicit FmuTracer(size_t max_events = 1 << 20)
+        : m_maxEvents(max_events), m_start(std::chrono::steady_clock::now()) {}
+
+    FmuTracer(const FmuTracer&) = delete;
+    FmuTracer& operator=(const FmuTracer&) = delete;
+
+    /// Return the number of channels (one per traced FMU).
+    size_t GetNumChannels() const { return m_channels.size(); }
+
+    /// Return the channel with the given index.
+    const FmuTraceChannel& GetChannel(size_t index) const { return *m_channels.at(index); }
+
+    /// Write the timelines of all the channels in the Chrome trace event format (one thread per FMU).
+    void WriteChromeTrace(const std::string& filename) const;
+
+    /// Write the latency histograms of the called functions, in CSV format.
+    void WriteHistograms(const std::string& filename) const;
+
+    /// Discard the recorded events and histograms.
+    void Clear();
+
+    /// Add a channel for an FMU (called when loading a traced FmuUnit).
+    FmuTraceChannel* AddChannel(const std::string& name);
+
+    /// Record a call in the given channel.
+    void Record(FmuTraceChannel& channel,
+                size_t function,
+                std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end) const;
+
+    /// Replace the function pointer with a wrapper tracing its calls (if not null).
+    template <size_t Id, typename Fn>
+    static void Interpose(FmuTraceChannel& channel, Fn*& function) {
+        if (!function)
+            return;
+        channel.originals[Id] = reinterpret_cast<void*>(function);
+        function = &Wrapper<Id, Fn>::call;
+    }
+
+    /// Associate an FMU instance with its channel, so that the wrappers can find the original functions.
+    static void RegisterInstance(fmi3Instance instance, FmuTraceChannel* channel);
+    static void UnregisterInstance(fmi3Instance instance);
+    static FmuTraceChannel* FindChannel(fmi3Instance instance);
+
+  private:
+    template <size_t Id, typename Fn>
+    struct Wrapper;
+
+    struct InstanceRegistry {
+        std::shared_timed_mutex mutex;
+        std::unordered_map<fmi3Instance, FmuTraceChannel*> channels;
+    };
+
+    static InstanceRegistry& registry() {
+        static InstanceRegistry instance_registry;
+        return instance_registry;
+    }
+
+    size_t m_maxEvents;
+    std::chrono::steady_clock::time_point m_start;
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<FmuTraceChannel>> m_channels;
+};
+
+/// Wrapper of an FMI function: calls the original function of the channel of the instance and records the call.
+template <size_t Id, typename R, typename... Args>
+struct FmuTracer::Wrapper<Id, R(fmi3Instance, Args...)> {
+    static R call(fmi3Instance instance, Args... args) {
+        FmuTraceChannel* channel = FindChannel(instance);
+        if (!channel)
+            return static_cast<R>(fmi3Error);  // instance already freed or not created by a traced FmuUnit
+        auto original = reinterpret_cast<R (*)(fmi3Instance, Args...)>(channel->originals[Id]);
+        if (Id == FmuTrace_fmi3FreeInstance)
+            UnregisterInstance(instance);
+
+        struct Scope {
+            FmuTraceChannel& channel;
+            std::chrono::steady_clock::time_point start;
+            ~Scope() { channel.tracer->Record(channel, Id, start, std::chrono::steady_clock::now()); }
+        } scope{*channel, std::chrono::steady_clock::now()};
+
+        return original(instance, args...);
+    }
+};
+
+// -----------------------------------------------------------------------------
+
+const char* FmuTracedFunctionName(size_t id) {
+    static const char* names[] = {
+#define FMU_TRACED_FUNCTION_NAME(funcName) #funcName,
+        FMU_TRACED_FUNCTIONS(FMU_TRACED_FUNCTION_NAME)
+#undef FMU_TRACED_FUNCTION_NAME
+        "fmi3Instantiate"};
+    return id < FmuTrace_NumFunctions ? names[id] : "unknown";
+}
+
+void FmuLatencyHistogram::Add(std::uint64_t ns) {
+    size_t bucket = 0;
+    while (bucket < num_buckets - 1 && (ns >> bucket) != 0)
+        ++bucket;
+    buckets[bucket]++;
+    calls++;
+    total_ns += ns;
+    if (ns < min_ns)
+        min_ns = ns;
+    if (ns > max_ns)
+        max_ns = ns;
+}
+
+std::uint64_t FmuLatencyHistogram::Percentile(double p) const {
+    if (calls == 0)
+        return 0;
+    std::uint64_t target = static_cast<std::uint64_t>(p / 100.0 * calls + 0.5);
+    if (target < 1)
+        target = 1;
+    std::uint64_t count = 0;
+    for (size_t i = 0; i < num_buckets; ++i) {
+        count += buckets[i];
+        if (count >= target)
+            return std::max(min_ns, std::min<std::uint64_t>(max_ns, (std::uint64_t(1) << i) - 1));
+    }
+    return max_ns;
+}
+
+FmuTraceChannel* FmuTracer::AddChannel(const std::string& name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_channels.emplace_back(new FmuTraceChannel);
+    FmuTraceChannel* channel = m_channels.back().get();
+    channel->tracer = this;
+    channel->name = name;
+    channel->index = m_channels.size() - 1;
+    channel->max_events = m_maxEvents;
+    return channel;
+}
+
+void FmuTracer::Record(FmuTraceChannel& channel,
+                       size_t function,
+                       std::chrono::steady_clock::time_point start,
+                       std::chrono::steady_clock::time_point end) const {
+    auto duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    channel.histograms[function].Add(static_cast<std::uint64_t>(duration_ns));
+
+    if (channel.events.size() < channel.max_events) {
+        auto start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start - m_start).count();
+        channel.events.push_back({static_cast<std::uint16_t>(function), start_ns, duration_ns});
+    } else {
+        channel.dropped_events++;
+    }
+}
+
+void FmuTracer::Clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& channel : m_channels) {
+        channel->events.clear();
+        channel->dropped_events = 0;
+        for (auto& histogram : channel->histograms)
+            histogram = FmuLatencyHistogram();
+    }
+}
+
+void FmuTracer::WriteChromeTrace(const std::string& filename) const {
+    std::ofstream out(filename);
+    if (!out)
+        throw std::runtime_error("FmuTracer: cannot open " + filename + ".");
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+    out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"fmu-forge\"}}";
+    for (const auto& channel : m_channels) {
+        // one thread per FMU, named after it; escape the characters that are not allowed in a JSON string
+        std::string name;
+        for (char c : channel->name) {
+            if (c == '"' || c == '\\')
+                name += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20)
+                name += c;
+        }
+        out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << channel->index
+            << ", \"args\": {\"name\": \"" << name << "\"}}";
+        for (const auto& event : channel->events) {
+            out << ",\n{\"name\": \"" << FmuTracedFunctionName(event.function)
+                << "\", \"cat\": \"fmi3\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << channel->index
+                << ", \"ts\": " << event.start_ns * 1e-3 << ", \"dur\": " << event.duration_ns * 1e-3 << "}";
+        }
+    }
+    out << "\n]}\n";
+}
+
+void FmuTracer::WriteHistograms(const std::string& filename) const {
+    std::ofstream out(filename);
+    if (!out)
+        throw std::runtime_error("FmuTracer: cannot open " + filename + ".");
+
+    out << "fmu,function,calls,total_ns,mean_ns,min_ns,p50_ns,p90_ns,p99_ns,max_ns\n";
+    for (const auto& channel : m_channels) {
+        for (size_t f = 0; f < FmuTrace_NumFunctions; ++f) {
+            const auto& h = channel->histograms[f];
+            if (h.calls == 0)
+                continue;
+            out << channel->name << "," << FmuTracedFunctionName(f) << "," << h.calls << "," << h.total_ns << ","
+                << h.total_ns / h.calls << "," << h.min_ns << "," << h.Percentile(50) << "," << h.Percentile(90)
+                << "," << h.Percentile(99) << "," << h.max_ns << "\n";
+        }
+    }
+}
+
+void FmuTracer::RegisterInstance(fmi3Instance instance, FmuTraceChannel* channel) {
+    auto& reg = registry();
+    std::unique_lock<std::shared_timed_mutex> lock(reg.mutex);
+    reg.channels[instance] = channel;
+}
+
+void FmuTracer::UnregisterInstance(fmi3Instance instance) {
+    auto& reg = registry();
+    std::unique_lock<std::shared_timed_mutex> lock(reg.mutex);
+    reg.channels.erase(instance);
+}
+
+FmuTraceChannel* FmuTracer::FindChannel(fmi3Instance instance) {
+    auto& reg = registry();
+    std::shared_lock<std::shared_timed_mutex> lock(reg.mutex);
+    auto it = reg.channels.find(instance);
+    return it == reg.channels.end() ? nullptr : it->second;
+}
+
+/// @} fmu_forge_fmi3
+
+}  // namespace fmi3
+}  // namespace fmu_forge
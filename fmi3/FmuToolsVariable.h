@@ -21,6 +21,9 @@
 #include <cstdarg>
 #include <typeindex>
 #include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <cstdint>
 #include <cassert>
 
 #include "fmi3/fmi3_headers/fmi3FunctionTypes.h"
@@ -94,13 +97,65 @@ struct LoggingUtilities {
 
 // =============================================================================
 
+/// Process-wide pool of interned strings, storing the metadata (names, units, descriptions) of FMU variables.
+/// Each distinct string is stored once and never released, so that references stay valid for the whole process
+/// lifetime. Units (only a few distinct values) are shared by all variables, while names and descriptions are shared
+/// by all the instances of the same FMU and by all the copies of a variable.
+class FmuStringPool {
+  public:
+    /// Return the interned copy of the given string.
+    static const std::string& Intern(const std::string& str) {
+        if (str.empty())
+            return Empty();
+        Pool& pool = GetPool();
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        return *pool.strings.insert(str).first;
+    }
+
+    /// Return the interned copy of the given string, moving it into the pool if not yet interned.
+    static const std::string& Intern(std::string&& str) {
+        if (str.empty())
+            return Empty();
+        Pool& pool = GetPool();
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        return *pool.strings.insert(std::move(str)).first;
+    }
+
+    /// Return the interned empty string.
+    static const std::string& Empty() {
+        static const std::string empty;
+        return empty;
+    }
+
+    /// Return the number of distinct strings in the pool.
+    static size_t GetNumStrings() {
+        Pool& pool = GetPool();
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        return pool.strings.size();
+    }
+
+  private:
+    struct Pool {
+        std::mutex mutex;
+        std::unordered_set<std::string> strings;  ///< node-based: references are stable across insertions
+    };
+
+    // Never destroyed, since variables might be still referring to its strings during static destruction
+    static Pool& GetPool() {
+        static Pool* pool = new Pool;
+        return *pool;
+    }
+};
+
+// =============================================================================
+
 /// Implementation of an FMU variable.
 /// Objects of this type are created during:
 /// - FMU export (and encoded in the model description XML)
 /// - FMU import (retrieved from the model description XML)
 class FmuVariable {
   public:
-    enum class Type {
+    enum class Type : uint8_t {
         Float32 = 0,
         Float64 = 1,
         Int8 = 2,
@@ -119,11 +174,19 @@ class FmuVariable {
 
     using DimensionsArrayType = std::vector<std::pair<std::uint64_t, bool>>;
 
-    enum class CausalityType { structuralParameter, parameter, calculatedParameter, input, output, local, independent };
+    enum class CausalityType : uint8_t {
+        structuralParameter,
+        parameter,
+        calculatedParameter,
+        input,
+        output,
+        local,
+        independent
+    };
 
-    enum class VariabilityType { constant, fixed, tunable, discrete, continuous };
+    enum class VariabilityType : uint8_t { constant, fixed, tunable, discrete, continuous };
 
-    enum class InitialType { automatic, none, exact, approx, calculated };
+    enum class InitialType : uint8_t { automatic, none, exact, approx, calculated };
 
     FmuVariable() : FmuVariable("", FmuVariable::Type::Float64) {}
 
@@ -133,15 +196,15 @@ class FmuVariable {
                 CausalityType causality = CausalityType::local,
                 VariabilityType variability = VariabilityType::continuous,
                 InitialType initial = InitialType::automatic)
-        : m_name(name),
-          m_valueReference(0),
-          m_unitname("1"),
-          m_type(type),
-          m_dimensions(_dimensions),
+        : m_type(type),
           m_causality(causality),
           m_variability(variability),
           m_initial(initial),
-          m_description("") {
+          m_valueReference(0),
+          m_name(&FmuStringPool::Intern(name)),
+          m_unitname(&FmuStringPool::Intern("1")),
+          m_description(&FmuStringPool::Empty()),
+          m_dimensions(_dimensions) {
         // Readibility replacements
         bool c_structural = (m_causality == CausalityType::structuralParameter);
         bool c_parameter = (m_causality == CausalityType::parameter);
@@ -221,37 +284,10 @@ class FmuVariable {
                 "For simplicity, only fixed and tunable parameters|calculatedParameters shall be defined.");
     }
 
-    FmuVariable(const FmuVariable& other) {
-        m_type = other.m_type;
-        m_name = other.m_name;
-        m_valueReference = other.m_valueReference;
-        m_unitname = other.m_unitname;
-        m_causality = other.m_causality;
-        m_variability = other.m_variability;
-        m_initial = other.m_initial;
-        m_description = other.m_description;
-        m_dimensions = other.m_dimensions;
-    }
-
-    // Copy assignment operator
-    // Copy assignment operator
-    FmuVariable& operator=(const FmuVariable& other) {
-        if (this == &other) {
-            return *this;  // Self-assignment guard
-        }
-
-        m_type = other.m_type;
-        m_name = other.m_name;
-        m_valueReference = other.m_valueReference;
-        m_unitname = other.m_unitname;
-        m_causality = other.m_causality;
-        m_variability = other.m_variability;
-        m_initial = other.m_initial;
-        m_description = other.m_description;
-        m_dimensions = other.m_dimensions;
-
-        return *this;
-    }
+    FmuVariable(const FmuVariable& other) = default;
+    FmuVariable(FmuVariable&& other) = default;
+    FmuVariable& operator=(const FmuVariable& other) = default;
+    FmuVariable& operator=(FmuVariable&& other) = default;
 
     virtual ~FmuVariable() {}
 
@@ -263,6 +299,7 @@ class FmuVariable {
     bool operator==(const FmuVariable& other) const {
         // according to FMI Reference can exist two different variables with same type and same valueReference;
         // they are called "alias" thus they should be allowed but not considered equal
+        // (names are interned: equal names share the same storage)
         return this->m_name == other.m_name;
     }
 
@@ -330,6 +367,45 @@ class FmuVariable {
         }
     }
 
+    /// Return the size in bytes of a value of the specified FMU variable type (0 for Unknown).
+    /// Values of String and Binary variables are exchanged through pointers, whose size is returned.
+    static size_t GetTypeSize(Type type) {
+        switch (type) {
+            case Type::Float32:
+                return sizeof(fmi3Float32);
+            case Type::Float64:
+                return sizeof(fmi3Float64);
+            case Type::Int8:
+                return sizeof(fmi3Int8);
+            case Type::UInt8:
+                return sizeof(fmi3UInt8);
+            case Type::Int16:
+                return sizeof(fmi3Int16);
+            case Type::UInt16:
+                return sizeof(fmi3UInt16);
+            case Type::Int32:
+                return sizeof(fmi3Int32);
+            case Type::UInt32:
+                return sizeof(fmi3UInt32);
+            case Type::Int64:
+                return sizeof(fmi3Int64);
+            case Type::UInt64:
+                return sizeof(fmi3UInt64);
+            case Type::Boolean:
+                return sizeof(fmi3Boolean);
+            case Type::String:
+                return sizeof(fmi3String);
+            case Type::Binary:
+                return sizeof(fmi3Binary);
+            default:
+                return 0;
+        }
+    }
+
+    /// Check if the values of the specified FMU variable type are stored in place (numeric and Boolean types), as
+    /// opposed to String and Binary values that are exchanged through pointers.
+    static bool IsFixedSizeType(Type type) { return type <= Type::Boolean; }
+
     /// Return a string with the name of the specified FMU variable type.
     /// Return a string with the name of the specified FMU variable type.
     static std::string Type_toString(Type type) {
@@ -382,16 +458,16 @@ class FmuVariable {
         }
     }
 
-    const inline std::string& GetName() const { return m_name; }
+    const inline std::string& GetName() const { return *m_name; }
     inline CausalityType GetCausality() const { return m_causality; }
     inline VariabilityType GetVariability() const { return m_variability; }
     inline InitialType GetInitial() const { return m_initial; }
-    const inline std::string& GetDescription() const { return m_description; }
-    void SetDescription(const std::string& description) { m_description = description; }
+    const inline std::string& GetDescription() const { return *m_description; }
+    void SetDescription(const std::string& description) { m_description = &FmuStringPool::Intern(description); }
     const inline fmi3ValueReference GetValueReference() const { return m_valueReference; }
     void SetValueReference(fmi3ValueReference valref) { m_valueReference = valref; }
-    const inline std::string& GetUnitName() const { return m_unitname; }
-    void SetUnitName(const std::string& unitname) { m_unitname = unitname; }
+    const inline std::string& GetUnitName() const { return *m_unitname; }
+    void SetUnitName(const std::string& unitname) { m_unitname = &FmuStringPool::Intern(unitname); }
     Type GetType() const { return m_type; }
 
     /// [INTERNAL] Return the dimensions array.
@@ -399,7 +475,7 @@ class FmuVariable {
     /// This method is intended for internal use only.
     /// In order to retrieve a more user-friendly representation of the dimensions, use
     /// FmuComponentBase::GetVariableDimensions().
-    DimensionsArrayType GetDimensions() const { return m_dimensions; }
+    const DimensionsArrayType& GetDimensions() const { return m_dimensions; }
 
     /// Return true is this variable is a scalar (i.e., has dimension 1).
     bool IsScalar() const { return m_dimensions.empty(); }
@@ -426,15 +502,16 @@ class FmuVariable {
     }
 
   protected:
+    // Fixed-size record: enumerations are packed in the first bytes, strings are interned in FmuStringPool
     Type m_type = Type::Unknown;          ///< variable type
-    std::string m_name;                   ///< variable name
-    fmi3ValueReference m_valueReference;  ///< reference among variables of same type
-    std::string m_unitname;               ///< variable units
     CausalityType m_causality;            ///< variable causality
     VariabilityType m_variability;        ///< variable variability
     InitialType m_initial;                ///< type of initial value
-    std::string m_description;            ///< description of this variable
     bool m_intermediateUpdate = false;    ///< TODO: if true, this variable is updated at intermediate steps
+    fmi3ValueReference m_valueReference;  ///< reference among variables of same type
+    const std::string* m_name;            ///< variable name (interned)
+    const std::string* m_unitname;        ///< variable units (interned)
+    const std::string* m_description;     ///< description of this variable (interned)
 
     /// List of pairs (size, fixed) for each dimension.
     /// - if m_dimensions[i].second == true (i.e. labelled as 'fixed') then 'size' is the actual size for that
@@ -16,7 +16,11 @@
 #ifndef FMUTOLS_FMI3_TYPESVARIANTS_H
 #define FMUTOLS_FMI3_TYPESVARIANTS_H
 
+#include <cstddef>
+#include <functional>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "variant/variant_guard.hpp"
 #include "fmi3/fmi3_headers/fmi3PlatformTypes.h"
@@ -29,6 +33,31 @@ namespace fmi3 {
 
 #define FMITYPESPLATFORM_DEFAULT
 
+/// Binding of an array variable to a contiguous buffer with a given number of values.
+/// Unlike a plain pointer binding, the number of values is checked on every access.
+template <class T>
+struct FmuSpan {
+    T* data;
+    size_t size;
+};
+
+/// Binding of a fmi3Binary variable exchanged without copies of its bytes.
+/// fmi3GetBinary hands out 'data' and 'size' as they are, so that the model can point them to its own buffer.
+/// fmi3SetBinary copies the bytes in 'storage' and points 'data' to it or, if 'reference' is set, makes 'data' point
+/// to the buffer of the importer, which must then stay valid until the end of the following step; the reference is
+/// dropped (empty value) at the end of the step.
+struct FmuBinaryBuffer {
+    const fmi3Byte* data = nullptr;
+    size_t size = 0;
+    bool reference = false;         ///< keep a reference to the buffer of the importer instead of copying it
+    std::vector<fmi3Byte> storage;  ///< copy of the last value set, if not referenced
+};
+
+/// Bulk getter|setter pair, exchanging all the values of an array variable at once.
+/// The getter fills the given buffer, the setter reads from it; the second argument is the number of values.
+template <class T>
+using FunGetSetArray = std::pair<std::function<void(T*, size_t)>, std::function<void(const T*, size_t)>>;
+
 // TODO: DARIOM double check if it setter function for big objects can pass by (const?) reference instead of value
 
 /// List of pointers to all (unique) types used to define VariableTypes.
@@ -57,6 +86,7 @@ using FmuVariableBindType = varns::variant<float*,                  // fmi3Float
                                            bool*,                   // fmi3Boolean
                                            std::string*,            // fmi3String
                                            std::vector<fmi3Byte>*,  // fmi3Binary
+                                           FmuBinaryBuffer*,        // fmi3Binary (no copies)
                                            std::pair<std::function<float()>, std::function<void(float)>>,
                                            std::pair<std::function<double()>, std::function<void(double)>>,
                                            std::pair<std::function<int8_t()>, std::function<void(int8_t)>>,
@@ -69,7 +99,38 @@ using FmuVariableBindType = varns::variant<float*,                  // fmi3Float
                                            std::pair<std::function<uint64_t()>, std::function<void(uint64_t)>>,
                                            std::pair<std::function<bool()>, std::function<void(bool)>>,
                                            std::pair<std::function<char()>, std::function<void(char)>>,
-                                           std::pair<std::function<std::string()>, std::function<void(std::string)>>>;
+                                           std::pair<std::function<std::string()>, std::function<void(std::string)>>,
+                                           FmuSpan<float>,
+                                           FmuSpan<double>,
+                                           FmuSpan<int8_t>,
+                                           FmuSpan<uint8_t>,
+                                           FmuSpan<int16_t>,
+                                           FmuSpan<uint16_t>,
+                                           FmuSpan<int32_t>,
+                                           FmuSpan<uint32_t>,
+                                           FmuSpan<int64_t>,
+                                           FmuSpan<uint64_t>,
+                                           FmuSpan<bool>,
+                                           std::vector<float>*,  // (std::vector<uint8_t>* is the fmi3Binary binding)
+                                           std::vector<double>*,
+                                           std::vector<int8_t>*,
+                                           std::vector<int16_t>*,
+                                           std::vector<uint16_t>*,
+                                           std::vector<int32_t>*,
+                                           std::vector<uint32_t>*,
+                                           std::vector<int64_t>*,
+                                           std::vector<uint64_t>*,
+                                           FunGetSetArray<float>,
+                                           FunGetSetArray<double>,
+                                           FunGetSetArray<int8_t>,
+                                           FunGetSetArray<uint8_t>,
+                                           FunGetSetArray<int16_t>,
+                                           FunGetSetArray<uint16_t>,
+                                           FunGetSetArray<int32_t>,
+                                           FunGetSetArray<uint32_t>,
+                                           FunGetSetArray<int64_t>,
+                                           FunGetSetArray<uint64_t>,
+                                           FunGetSetArray<bool>>;
 
 /// @} fmu_forge_fmi3
 
@@ -0,0 +1,104 @@
+// =============================================================================
+// fmu-forge
+//
+// Copyright (c) 2024 Project Chrono (projectchrono.org)
+// Copyright (c) 2024 Digital Dynamics Lab, University of Parma, Italy
+// Copyright (c) 2024 Simulation Based Engineering Lab, University of Wisconsin-Madison, USA
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution.
+//
+// =============================================================================
+// Synthetic FMU for benchmarking (FMI 3.0 standard)
+// Exposes a configurable number of scalar and array variables; the step does nothing.
+// =============================================================================
+
+#include <string>
+
+#include "benchFmu_fmi3.h"
+
+using namespace fmu_forge;
+using namespace fmu_forge::fmi3;
+
+// -----------------------------------------------------------------------------
+
+FmuComponentBase* fmi3::fmi3InstantiateIMPL(FmuType fmiInterfaceType,
+                                            fmi3String instanceName,
+                                            fmi3String instantiationToken,
+                                            fmi3String resourcePath,
+                                            fmi3Boolean visible,
+                                            fmi3Boolean loggingOn,
+                                            fmi3InstanceEnvironment instanceEnvironment,
+                                            fmi3LogMessageCallback logMessage) {
+    return new benchFmuComponent(fmiInterfaceType, instanceName, instantiationToken, resourcePath, visible, loggingOn,
+                                 instanceEnvironment, logMessage);
+}
+
+// -----------------------------------------------------------------------------
+
+benchFmuComponent::benchFmuComponent(FmuType fmiInterfaceType,
+                                     fmi3String instanceName,
+                                     fmi3String instantiationToken,
+                                     fmi3String resourcePath,
+                                     fmi3Boolean visible,
+                                     fmi3Boolean loggingOn,
+                                     fmi3InstanceEnvironment instanceEnvironment,
+                                     fmi3LogMessageCallback logMessage)
+    : FmuComponentBase(fmiInterfaceType,
+                       instanceName,
+                       instantiationToken,
+                       resourcePath,
+                       visible,
+                       loggingOn,
+                       instanceEnvironment,
+                       logMessage,
+                       {{"logStatusWarning", true},
+                        {"logStatusError", true},
+                        {"logStatusFatal", true},
+                        {"logAll", false}},
+                       {"logStatusWarning", "logStatusError", "logStatusFatal"}),
+      u(BENCH_NUM_SCALARS, 0.0),
+      y(BENCH_NUM_SCALARS, 0.0),
+      ua(BENCH_ARRAY_SIZE, 0.0),
+      ya(BENCH_ARRAY_SIZE, 0.0) {
+    initializeType(fmiInterfaceType);
+
+    setFMUStateSupport(true, true);
+
+    for (size_t i = 0; i < u.size(); ++i) {
+        AddFmuVariable(&u[i], "u" + std::to_string(i), FmuVariable::Type::Float64, "1", "scalar input",
+                       FmuVariable::CausalityType::input, FmuVariable::VariabilityType::continuous);
+    }
+    for (size_t i = 0; i < y.size(); ++i) {
+        AddFmuVariable(&y[i], "y" + std::to_string(i), FmuVariable::Type::Float64, "1", "scalar output",
+                       FmuVariable::CausalityType::output, FmuVariable::VariabilityType::continuous,
+                       FmuVariable::InitialType::exact);
+    }
+
+    AddFmuVariable(ua.data(), "ua", FmuVariable::Type::Float64, {{ua.size(), true}}, "1", "array input",
+                   FmuVariable::CausalityType::input, FmuVariable::VariabilityType::continuous);
+    AddFmuVariable(ya.data(), "ya", FmuVariable::Type::Float64, {{ya.size(), true}}, "1", "array output",
+                   FmuVariable::CausalityType::output, FmuVariable::VariabilityType::continuous,
+                   FmuVariable::InitialType::exact);
+}
+
+// -----------------------------------------------------------------------------
+
+// Empty step: measures the overhead of the DoStep call chain only
+fmi3Status benchFmuComponent::doStepIMPL(fmi3Float64 currentCommunicationPoint,
+                                         fmi3Float64 communicationStepSize,
+                                         fmi3Boolean /*noSetFMUStatePriorToCurrentPoint*/,
+                                         fmi3Boolean* eventHandlingNeeded,
+                                         fmi3Boolean* terminateSimulation,
+                                         fmi3Boolean* earlyReturn,
+                                         fmi3Float64* lastSuccessfulTime) {
+    m_time = currentCommunicationPoint + communicationStepSize;
+
+    *eventHandlingNeeded = fmi3False;
+    *terminateSimulation = fmi3False;
+    *earlyReturn = fmi3False;
+    *lastSuccessfulTime = m_time;
+
+    return fmi3Status::fmi3OK;
+}
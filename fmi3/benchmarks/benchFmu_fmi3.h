@@ -0,0 +1,62 @@
+// =============================================================================
+// fmu-forge
+//
+// Copyright (c) 2024 Project Chrono (projectchrono.org)
+// Copyright (c) 2024 Digital Dynamics Lab, University of Parma, Italy
+// Copyright (c) 2024 Simulation Based Engineering Lab, University of Wisconsin-Madison, USA
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution.
+//
+// =============================================================================
+// Synthetic FMU for benchmarking (FMI 3.0 standard)
+// Exposes a configurable number of scalar and array variables; the step does nothing.
+// =============================================================================
+
+#pragma once
+
+#include <vector>
+
+#include "fmi3/FmuToolsExport.h"
+
+// Number of scalar inputs and outputs (each)
+#ifndef BENCH_NUM_SCALARS
+    #define BENCH_NUM_SCALARS 1000
+#endif
+
+// Size of the array input and output
+#ifndef BENCH_ARRAY_SIZE
+    #define BENCH_ARRAY_SIZE 1000
+#endif
+
+class benchFmuComponent : public fmu_forge::fmi3::FmuComponentBase {
+  public:
+    benchFmuComponent(fmu_forge::fmi3::FmuType fmiInterfaceType,
+                      fmi3String instanceName,
+                      fmi3String instantiationToken,
+                      fmi3String resourcePath,
+                      fmi3Boolean visible,
+                      fmi3Boolean loggingOn,
+                      fmi3InstanceEnvironment instanceEnvironment,
+                      fmi3LogMessageCallback logMessage);
+
+    ~benchFmuComponent() {}
+
+    virtual fmi3Status doStepIMPL(fmi3Float64 currentCommunicationPoint,
+                                  fmi3Float64 communicationStepSize,
+                                  fmi3Boolean noSetFMUStatePriorToCurrentPoint,
+                                  fmi3Boolean* eventHandlingNeeded,
+                                  fmi3Boolean* terminateSimulation,
+                                  fmi3Boolean* earlyReturn,
+                                  fmi3Float64* lastSuccessfulTime) override;
+
+  private:
+    virtual bool is_cosimulation_available() const override { return true; }
+    virtual bool is_modelexchange_available() const override { return false; }
+
+    std::vector<fmi3Float64> u;   ///< scalar inputs
+    std::vector<fmi3Float64> y;   ///< scalar outputs
+    std::vector<fmi3Float64> ua;  ///< array input
+    std::vector<fmi3Float64> ya;  ///< array output
+};
@@ -0,0 +1,269 @@
+// =============================================================================
+// fmu-forge
+//
+// Copyright (c) 2024 Project Chrono (projectchrono.org)
+// Copyright (c) 2024 Digital Dynamics Lab, University of Parma, Italy
+// Copyright (c) 2024 Simulation Based Engineering Lab, University of Wisconsin-Madison, USA
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution.
+//
+// =============================================================================
+// Benchmarks of the FMI 3.0 hot paths (loading, instantiation, get/set, step, model description export)
+// Results are written in JSON format to the file given as first argument (default: benchmark_fmi3_results.json).
+// =============================================================================
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "fmi3/FmuToolsImport.h"
+
+using namespace fmu_forge;
+using namespace fmu_forge::fmi3;
+
+// -----------------------------------------------------------------------------
+
+struct BenchmarkResult {
+    std::string name;
+    std::string fmu;
+    size_t iterations;
+    double ns_min;
+    double ns_median;
+};
+
+static std::vector<BenchmarkResult> results;
+static volatile double sink = 0;
+
+// Run 'func' in 'repetitions' batches of 'iterations' calls; record minimum and median time per call.
+static void Run(const std::string& name,
+                const std::string& fmu,
+                size_t iterations,
+                const std::function<void()>& func,
+                size_t repetitions = 5) {
+    func();  // warm up
+
+    std::vector<double> times;
+    for (size_t r = 0; r < repetitions; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+            func();
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::nano>(end - start).count() / iterations);
+    }
+    std::sort(times.begin(), times.end());
+
+    results.push_back({name, fmu, iterations, times.front(), times[times.size() / 2]});
+    std::cerr << "  " << fmu << " / " << name << ": " << times[times.size() / 2] << " ns" << std::endl;
+}
+
+static void InitializeUnit(FmuUnit& fmu) {
+    fmu.Instantiate("benchmark");
+    fmu.EnterInitializationMode(fmi3False, 0.0, 0.0, fmi3False, 0.0);
+    fmu.ExitInitializationMode();
+}
+
+// Benchmarks common to all FMUs: loading and instantiation
+static void RunLoadBenchmarks(const std::string& label,
+                              const std::string& fmu_filename,
+                              const std::string& unpack_dir) {
+    Run("Load", label, 10, [&]() {
+        FmuUnit fmu;
+        fmu.Load(FmuType::COSIMULATION, fmu_filename, unpack_dir);
+    });
+
+    Run("LoadUnzipped", label, 20, [&]() {
+        FmuUnit fmu;
+        fmu.LoadUnzipped(FmuType::COSIMULATION, unpack_dir);
+    });
+
+    Run("LoadModelDescription", label, 20, [&]() {
+        FmuUnit fmu;
+        fmu.LoadModelDescription(fmu_filename);
+    });
+
+    FmuUnit fmu;
+    fmu.LoadUnzipped(FmuType::COSIMULATION, unpack_dir);
+    Run("Instantiate", label, 100, [&]() {
+        fmu.Instantiate("benchmark");
+        fmu._fmi3FreeInstance(fmu.instance);
+        fmu.instance = nullptr;
+    });
+}
+
+// -----------------------------------------------------------------------------
+
+static void RunDemoBenchmarks() {
+    std::string label = "myFmuCosimulation_fmi3";
+    RunLoadBenchmarks(label, DEMO_FMU_FILENAME, DEMO_FMU_UNPACK_DIRECTORY);
+
+    FmuUnit fmu;
+    fmu.LoadUnzipped(FmuType::COSIMULATION, DEMO_FMU_UNPACK_DIRECTORY);
+    InitializeUnit(fmu);
+    fmu.SetDebugLogging(fmi3False, {"logAll"});  // do not time the logging of each step
+
+    fmi3ValueReference vr_x = fmu.GetValueReference("x");
+    double x;
+    Run("GetScalarByValref", label, 100000, [&]() {
+        fmu.GetVariable(vr_x, x);
+        sink = x;
+    });
+    Run("GetScalarByName", label, 100000, [&]() {
+        fmu.GetVariable("x", x);
+        sink = x;
+    });
+
+    double t = 0;
+    const double h = 1e-3;
+    Run("DoStep", label, 10000, [&]() {
+        fmu.DoStep(t, h, fmi3True);
+        t += h;
+    });
+}
+
+static void RunSyntheticBenchmarks() {
+    std::string label = "benchFmu_fmi3";
+    RunLoadBenchmarks(label, BENCH_FMU_FILENAME, BENCH_FMU_UNPACK_DIRECTORY);
+
+    FmuUnit fmu;
+    fmu.LoadUnzipped(FmuType::COSIMULATION, BENCH_FMU_UNPACK_DIRECTORY);
+    InitializeUnit(fmu);
+
+    // single scalars
+    fmi3ValueReference vr_u = fmu.GetValueReference("u0");
+    fmi3ValueReference vr_y = fmu.GetValueReference("y0");
+    double value = 1.0;
+    Run("SetScalarByValref", label, 100000, [&]() { fmu.SetVariable(vr_u, value); });
+    Run("GetScalarByValref", label, 100000, [&]() {
+        fmu.GetVariable(vr_y, value);
+        sink = value;
+    });
+    Run("SetScalarByName", label, 100000, [&]() { fmu.SetVariable("u0", value); });
+    Run("GetScalarByName", label, 100000, [&]() {
+        fmu.GetVariable("y0", value);
+        sink = value;
+    });
+
+    // all scalars, one at a time and batched
+    std::vector<std::string> u_names;
+    std::vector<std::string> y_names;
+    std::vector<fmi3ValueReference> u_vrs;
+    std::vector<fmi3ValueReference> y_vrs;
+    for (size_t i = 0; i < BENCH_NUM_SCALARS; ++i) {
+        u_names.push_back("u" + std::to_string(i));
+        y_names.push_back("y" + std::to_string(i));
+        u_vrs.push_back(fmu.GetValueReference(u_names.back()));
+        y_vrs.push_back(fmu.GetValueReference(y_names.back()));
+    }
+
+    Run("SetAllScalarsByValref", label, 100, [&]() {
+        for (auto vr : u_vrs)
+            fmu.SetVariable(vr, value);
+    });
+    Run("GetAllScalarsByValref", label, 100, [&]() {
+        for (auto vr : y_vrs)
+            fmu.GetVariable(vr, value);
+        sink = value;
+    });
+
+    FmuVariableGroup u_group(fmu, u_vrs);
+    FmuVariableGroup y_group(fmu, y_names);
+    Run("SetAllScalarsBatched", label, 1000, [&]() { u_group.Push(); });
+    Run("GetAllScalarsBatched", label, 1000, [&]() {
+        y_group.Fetch();
+        sink = y_group.GetValue<fmi3Float64>(0);
+    });
+
+    std::vector<fmi3Float64> raw(BENCH_NUM_SCALARS, 1.0);
+    Run("SetAllScalarsRaw", label, 1000, [&]() {
+        fmu._fmi3SetFloat64(fmu.instance, u_vrs.data(), u_vrs.size(), raw.data(), raw.size());
+    });
+    Run("GetAllScalarsRaw", label, 1000, [&]() {
+        fmu._fmi3GetFloat64(fmu.instance, y_vrs.data(), y_vrs.size(), raw.data(), raw.size());
+        sink = raw[0];
+    });
+
+    // arrays
+    fmi3ValueReference vr_ua = fmu.GetValueReference("ua");
+    fmi3ValueReference vr_ya = fmu.GetValueReference("ya");
+    std::vector<fmi3Float64> array(BENCH_ARRAY_SIZE, 1.0);
+    Run("SetArray", label, 1000, [&]() { fmu.SetVariable(vr_ua, array); });
+    Run("GetArray", label, 1000, [&]() {
+        fmu.GetVariable(vr_ya, array);
+        sink = array[0];
+    });
+
+    // step with empty doStepIMPL
+    double t = 0;
+    const double h = 1e-3;
+    Run("DoStepEmpty", label, 100000, [&]() {
+        fmu.DoStep(t, h, fmi3True);
+        t += h;
+    });
+
+    // model description export (as done by fmi_modeldescription when building the FMU)
+    std::string dynlib_dir = std::string(BENCH_FMU_UNPACK_DIRECTORY) + "/binaries/" + FMI3_PLATFORM + "/";
+    std::string dynlib_path = dynlib_dir + BENCH_FMU_MODEL_IDENTIFIER + SHARED_LIBRARY_SUFFIX;
+    DYNLIB_HANDLE dynlib_handle = RuntimeLinkLibrary(dynlib_dir, dynlib_path);
+    if (!dynlib_handle)
+        throw std::runtime_error("Cannot link to library: " + dynlib_path);
+
+    typedef bool (*createModelDescriptionPtrType)(const std::string& path, std::string& err_msg);
+    auto createModelDescription =
+        (createModelDescriptionPtrType)get_function_ptr(dynlib_handle, "createModelDescription");
+    std::string output_dir = std::string(BENCH_FMU_UNPACK_DIRECTORY) + "/../md_export";
+    fs::create_directories(output_dir);
+    Run("ModelDescriptionExport", label, 10, [&]() {
+        std::string err_msg;
+        if (!createModelDescription(output_dir, err_msg))
+            throw std::runtime_error(err_msg);
+    });
+}
+
+// -----------------------------------------------------------------------------
+
+static void WriteResults(std::ostream& out) {
+    out << "{\n";
+    out << "  \"fmi_version\": \"3.0\",\n";
+    out << "  \"num_scalars\": " << BENCH_NUM_SCALARS << ",\n";
+    out << "  \"array_size\": " << BENCH_ARRAY_SIZE << ",\n";
+    out << "  \"unit\": \"ns/op\",\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"fmu\": \"" << r.fmu << "\", \"iterations\": " << r.iterations
+            << ", \"min\": " << r.ns_min << ", \"median\": " << r.ns_median << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        std::cerr << "Benchmarking " << DEMO_FMU_FILENAME << std::endl;
+        RunDemoBenchmarks();
+
+        std::cerr << "Benchmarking " << BENCH_FMU_FILENAME << std::endl;
+        RunSyntheticBenchmarks();
+    } catch (std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::string results_filename = argc > 1 ? argv[1] : "benchmark_fmi3_results.json";
+    std::ofstream out(results_filename);
+    if (!out) {
+        std::cerr << "ERROR: cannot open " << results_filename << std::endl;
+        return 1;
+    }
+    WriteResults(out);
+    std::cerr << "Results written to " << results_filename << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,180 @@
+// =============================================================================
+// fmu-forge
+//
+// Copyright (c) 2024 Project Chrono (projectchrono.org)
+// Copyright (c) 2024 Digital Dynamics Lab, University of Parma, Italy
+// Copyright (c) 2024 Simulation Based Engineering Lab, University of Wisconsin-Madison, USA
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution.
+//
+// =============================================================================
+// Check of the allocation guarantees of the FMI 3.0 real-time mode.
+// The demo co-simulation FMU is compiled in this executable with FMU_FORGE_REALTIME; once it is initialized, the
+// replaced global operator new counts the allocations made by the fmi3Get|fmi3Set and fmi3DoStep calls.
+// Returns a non-zero exit code if any allocation is detected.
+// =============================================================================
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "fmi3/FmuToolsExport.h"
+
+using namespace fmu_forge;
+using namespace fmu_forge::fmi3;
+
+// -----------------------------------------------------------------------------
+
+static bool counting = false;
+static size_t num_allocations = 0;
+
+void* operator new(size_t size) {
+    if (counting)
+        ++num_allocations;
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+// -----------------------------------------------------------------------------
+
+static void Logger(fmi3InstanceEnvironment, fmi3Status, fmi3String category, fmi3String message) {
+    std::cerr << "[" << category << "] " << message;
+}
+
+// Value references and number of values of the variables of given type and causality with fixed dimensions.
+static size_t CollectVariables(const FmuComponentBase& comp,
+                               FmuVariable::Type type,
+                               FmuVariable::CausalityType causality,
+                               std::vector<fmi3ValueReference>& vrs) {
+    size_t num_values = 0;
+    for (const auto& var : comp.GetVariables()) {
+        if (var.GetType() != type || var.GetCausality() != causality)
+            continue;
+        if (causality == FmuVariable::CausalityType::parameter &&
+            var.GetVariability() != FmuVariable::VariabilityType::tunable)
+            continue;
+
+        size_t size = 1;
+        bool fixed = true;
+        for (const auto& dim : var.GetDimensions()) {
+            fixed = fixed && dim.second;
+            size *= static_cast<size_t>(dim.first);
+        }
+        if (!fixed)
+            continue;
+
+        vrs.push_back(var.GetValueReference());
+        num_values += size;
+    }
+    return num_values;
+}
+
+int main() {
+    const size_t num_steps = 1000;
+    const fmi3Float64 step_size = 1e-3;
+
+    std::string resources = std::string("file:///") + RT_CHECK_RESOURCES_DIRECTORY;
+    fmi3Instance instance = fmi3InstantiateCoSimulation("realtime_check", FMU_GUID, resources.c_str(), fmi3False,
+                                                      fmi3False, fmi3False, fmi3False, nullptr, 0, nullptr, Logger,
+                                                      nullptr);
+    if (!instance) {
+        std::cerr << "ERROR: cannot instantiate the FMU." << std::endl;
+        return 1;
+    }
+    auto& comp = *reinterpret_cast<FmuComponentBase*>(instance);
+    if (!comp.IsRealTimeMode()) {
+        std::cerr << "ERROR: the FMU is not in real-time mode." << std::endl;
+        return 1;
+    }
+
+    if (fmi3EnterInitializationMode(instance, fmi3False, 0.0, 0.0, fmi3False, 0.0) != fmi3OK ||
+        fmi3ExitInitializationMode(instance) != fmi3OK) {
+        std::cerr << "ERROR: cannot initialize the FMU." << std::endl;
+        return 1;
+    }
+
+    // messages of enabled log categories are formatted at each call: they are not covered by the guarantees
+    fmi3String categories[] = {"logAll"};
+    fmi3SetDebugLogging(instance, fmi3False, 1, categories);
+
+    std::vector<fmi3ValueReference> float64_outputs, uint64_outputs, float64_tunables;
+    size_t num_float64_outputs =
+        CollectVariables(comp, FmuVariable::Type::Float64, FmuVariable::CausalityType::output, float64_outputs);
+    size_t num_uint64_outputs =
+        CollectVariables(comp, FmuVariable::Type::UInt64, FmuVariable::CausalityType::output, uint64_outputs);
+    size_t num_float64_tunables =
+        CollectVariables(comp, FmuVariable::Type::Float64, FmuVariable::CausalityType::parameter, float64_tunables);
+
+    std::vector<fmi3Float64> float64_values(num_float64_outputs);
+    std::vector<fmi3UInt64> uint64_values(num_uint64_outputs);
+    std::vector<fmi3Float64> tunable_values(num_float64_tunables);
+
+    fmi3Float64 time = 0;
+    bool ok = true;
+    auto iteration = [&]() {
+        fmi3Boolean eventHandlingNeeded, terminateSimulation, earlyReturn;
+        fmi3Float64 lastSuccessfulTime;
+        ok = ok &&
+             fmi3GetFloat64(instance, float64_tunables.data(), float64_tunables.size(), tunable_values.data(),
+                            tunable_values.size()) == fmi3OK &&
+             fmi3SetFloat64(instance, float64_tunables.data(), float64_tunables.size(), tunable_values.data(),
+                            tunable_values.size()) == fmi3OK &&
+             fmi3DoStep(instance, time, step_size, fmi3True, &eventHandlingNeeded, &terminateSimulation, &earlyReturn,
+                        &lastSuccessfulTime) == fmi3OK &&
+             fmi3GetFloat64(instance, float64_outputs.data(), float64_outputs.size(), float64_values.data(),
+                            float64_values.size()) == fmi3OK &&
+             fmi3GetUInt64(instance, uint64_outputs.data(), uint64_outputs.size(), uint64_values.data(),
+                           uint64_values.size()) == fmi3OK;
+        time += step_size;
+    };
+
+    iteration();  // warm up
+
+    counting = true;
+    for (size_t i = 0; i < num_steps; ++i)
+        iteration();
+    counting = false;
+
+    fmi3Terminate(instance);
+    fmi3FreeInstance(instance);
+
+    std::cout << "Real-time check: " << num_steps << " iterations (" << float64_outputs.size() << " Float64 and "
+              << uint64_outputs.size() << " UInt64 outputs, " << float64_tunables.size()
+              << " tunable parameters), " << num_allocations << " allocations." << std::endl;
+
+    if (!ok) {
+        std::cerr << "ERROR: an FMI function call failed." << std::endl;
+        return 1;
+    }
+    if (num_allocations > 0) {
+        std::cerr << "ERROR: allocations in fmi3Get|fmi3Set|fmi3DoStep in real-time mode." << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
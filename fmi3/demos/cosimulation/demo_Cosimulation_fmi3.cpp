@@ -86,11 +86,13 @@ int main(int argc, char* argv[]) {
     double time_end = 10;
     double dt = 0.01;
 
+    // Outputs are retrieved all at once (one fmi3Get call per variable type)
+    FmuVariableGroup outputs(my_fmu, std::vector<std::string>{"x", "theta"});
+
     while (time < time_end) {
-        double x, theta;
-        my_fmu.GetVariable("x", x);
-        my_fmu.GetVariable("theta", theta);
-        ofile << time << " " << x << " " << theta << std::endl;
+        outputs.Fetch();
+        ofile << time << " " << outputs.GetValue<fmi3Float64>(0) << " " << outputs.GetValue<fmi3Float64>(1)
+              << std::endl;
 
         // Set next communication time
         time += dt;
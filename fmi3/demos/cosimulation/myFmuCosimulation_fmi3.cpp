@@ -87,6 +87,12 @@ myFmuComponent::myFmuComponent(FmuType fmiInterfaceType,
       stringarrayinput{"arrivederci", "au_revoir"} {
     initializeType(fmiInterfaceType);
 
+    // Resolve the log categories used in the hot path: FMU_LOG skips building messages of disabled categories
+    logAll_id = GetLogCategoryId("logAll");
+
+    // The whole model state is exposed through FMU variables: no internal data needs to be saved
+    setFMUStateSupport(true, true);
+
     // Define new units if needed
     UnitDefinition UD_J("J");
     UD_J.kg = 1;
@@ -289,7 +295,7 @@ fmi3Status myFmuComponent::doStepIMPL(fmi3Float64 currentCommunicationPoint,
 
         m_time = m_time + h;
 
-        sendToLog("Step at time: " + std::to_string(m_time) + " succeeded.\n", fmi3Status::fmi3OK, "logAll");
+        FMU_LOG(logAll_id, fmi3Status::fmi3OK, "Step at time: " + std::to_string(m_time) + " succeeded.\n");
     }
 
     *eventHandlingNeeded = fmi3False;
@@ -76,6 +76,8 @@ class myFmuComponent : public fmu_forge::fmi3::FmuComponentBase {
     fmi3Boolean approximateOn = fmi3False;
     std::string filename;
 
+    int logAll_id;  ///< id of the "logAll" log category, resolved once
+
     // Problem states
     vec4 q;
     double x_dd;
@@ -18,7 +18,7 @@
 #include <fstream>
 #include <cstddef>
 
-#include "fmi3/FmuToolsImport.h"
+#include "fmi3/FmuToolsModelExchangeDriver.h"
 
 using namespace fmu_forge::fmi3;
 
@@ -62,12 +62,11 @@ int main(int argc, char* argv[]) {
     );
     my_fmu.ExitInitializationMode();
 
-    // States and derivatives
-    std::vector<fmi3Float64> states(num_states);
-    std::vector<fmi3Float64> derivs(num_states);
-
-    // Get initial conditions (states)
-    my_fmu.GetContinuousStates(states.data(), num_states);
+    // The driver integrates the FMU (adaptive Runge-Kutta) and handles the events
+    ModelExchangeDriver driver(my_fmu, ModelExchangeDriver::Integrator::RK45);
+    driver.SetStepSize(1e-3);
+    driver.SetTolerances(1e-6, 1e-8);
+    driver.Initialize(0.0);
 
     // Prepare output file
     std::ofstream ofile("results.out");
@@ -83,19 +82,14 @@ int main(int argc, char* argv[]) {
         my_fmu.GetVariable("theta", theta);
         ofile << time << " " << x << " " << theta << std::endl;
 
-        // Compute derivatives (RHS)
-        my_fmu.GetContinuousStateDerivatives(derivs.data(), num_states);
-
-        // Advance time
+        // Advance time (the FMU is left at the final time and states)
         time += dt;
-        my_fmu.SetTime(time);
-
-        // Perform integration (forward Euler) and set state
-        for (int i = 0; i < num_states; i++)
-            states[i] += derivs[i] * dt;
-        my_fmu.SetContinuousStates(states.data(), num_states);
+        driver.AdvanceTo(time);
     }
 
+    std::cout << "Integration steps: " << driver.GetNumSteps() << " (rejected: " << driver.GetNumRejectedSteps()
+              << "), derivative evaluations: " << driver.GetNumDerivativeEvaluations() << std::endl;
+
     // Close output file
     ofile.close();
 
@@ -82,6 +82,9 @@ myFmuComponent::myFmuComponent(FmuType fmiInterfaceType,
       theta_dd(0) {
     initializeType(fmiInterfaceType);
 
+    // Partial derivatives are approximated by finite differences, using the declared dependencies
+    setDirectionalDerivativeSupport(true, true);
+
     // Define new units if needed
     UnitDefinition UD_J("J");
     UD_J.kg = 1;
@@ -259,22 +262,6 @@ fmi3Status myFmuComponent::exitInitializationModeIMPL() {
     return fmi3Status::fmi3OK;
 }
 
-fmi3Status myFmuComponent::getContinuousStatesIMPL(fmi3Float64 continuousStates[], size_t nContinuousStates) {
-    for (size_t i = 0; i < nContinuousStates; i++) {
-        continuousStates[i] = q[i];
-    }
-
-    return fmi3Status::fmi3OK;
-}
-
-fmi3Status myFmuComponent::setContinuousStatesIMPL(const fmi3Float64 continuousStates[], size_t nContinuousStates) {
-    for (size_t i = 0; i < nContinuousStates; i++) {
-        q[i] = continuousStates[i];
-    }
-
-    return fmi3Status::fmi3OK;
-}
-
 fmi3Status myFmuComponent::getDerivativesIMPL(fmi3Float64 derivatives[], size_t nContinuousStates) {
     auto rhs = calcRHS(m_time, q);
 
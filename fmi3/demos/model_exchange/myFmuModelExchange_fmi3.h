@@ -44,8 +44,7 @@ class myFmuComponent : public fmu_forge::fmi3::FmuComponentBase {
     virtual fmi3Status enterInitializationModeIMPL() override;
     virtual fmi3Status exitInitializationModeIMPL() override;
 
-    virtual fmi3Status getContinuousStatesIMPL(fmi3Float64 continuousStates[], size_t nContinuousStates) override;
-    virtual fmi3Status setContinuousStatesIMPL(const fmi3Float64 continuousStates[], size_t nContinuousStates) override;
+    // the continuous states (x, theta, v, omg) are exchanged directly with 'q', in the order they were declared
     virtual fmi3Status getDerivativesIMPL(fmi3Float64 derivatives[], size_t nContinuousStates) override;
 
     // Problem-specific functions
@@ -0,0 +1,38 @@
+// =============================================================================
+// fmu-forge
+//
+// Copyright (c) 2024 Project Chrono (projectchrono.org)
+// Copyright (c) 2024 Digital Dynamics Lab, University of Parma, Italy
+// Copyright (c) 2024 Simulation Based Engineering Lab, University of Wisconsin-Madison, USA
+// All rights reserved.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file at the top level of the distribution.
+//
+// =============================================================================
+// Worker process hosting an FMU (FMI 3.0) on behalf of an FmuRemoteUnit.
+// Started by FmuRemoteUnit with the name of the shared memory channel as only argument.
+// =============================================================================
+
+#include <iostream>
+
+#include "fmi3/FmuToolsRemote.h"
+
+using namespace fmu_forge::fmi3;
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <shared memory channel>" << std::endl;
+        return 1;
+    }
+
+    try {
+        FmuRemoteWorker worker(argv[1]);
+        worker.Run();
+    } catch (std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}